@@ -13,12 +13,17 @@
 #cmakedefine LINUX 1
 #cmakedefine FREEBSD 1
 #cmakedefine _HAVE_GSSAPI 1
+#cmakedefine HAVE_GSS_IOV 1
 #cmakedefine HAVE_STRING_H 1
 #cmakedefine HAVE_STRINGS_H 1
 #cmakedefine LITTLEEND 1
 #cmakedefine BIGEND 1
 #cmakedefine TIRPC_EPOLL 1
 #cmakedefine USE_RPC_RDMA 1
+#cmakedefine USE_RPC_TLS 1
+#cmakedefine USE_RPC_SHM 1
+#cmakedefine USE_USDT 1
+#cmakedefine USE_LOCK_PROF 1
 
 /* Package stuff */
 #define PACKAGE "libntirpc"
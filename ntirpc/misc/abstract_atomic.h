@@ -74,10 +74,15 @@
  * uint64_t atomic_postclear_uint64_t_bits(uint64_t *var,
  * uint64_t atomic_postset_uint64_t_bits(uint64_t *var,
  *
+ * Compare and swap is provided for uint64_t, uint32_t, and void *:
+ *
+ * bool atomic_cas_uint64_t(uint64_t *var, uint64_t expect, uint64_t val)
+ *
  */
 
 #ifndef _ABSTRACT_ATOMIC_H
 #define _ABSTRACT_ATOMIC_H
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
@@ -2478,4 +2483,86 @@ static inline void atomic_store_uint8_t(uint8_t *var, uint8_t val)
 	(void)__sync_lock_test_and_set(var, val);
 }
 #endif
+
+/**
+ * @brief Atomically compare and swap a uint64_t
+ *
+ * This function atomically stores the new value iff the variable
+ * still holds the expected value.
+ *
+ * @param[in,out] var    Pointer to the variable to modify
+ * @param[in]     expect The value var is expected to hold
+ * @param[in]     val    The value to store
+ *
+ * @return true if val was stored.
+ */
+
+#ifdef GCC_ATOMIC_FUNCTIONS
+static inline bool atomic_cas_uint64_t(uint64_t *var, uint64_t expect,
+				       uint64_t val)
+{
+	return __atomic_compare_exchange_n(var, &expect, val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(GCC_SYNC_FUNCTIONS)
+static inline bool atomic_cas_uint64_t(uint64_t *var, uint64_t expect,
+				       uint64_t val)
+{
+	return __sync_bool_compare_and_swap(var, expect, val);
+}
+#endif
+
+/**
+ * @brief Atomically compare and swap a uint32_t
+ *
+ * This function atomically stores the new value iff the variable
+ * still holds the expected value.
+ *
+ * @param[in,out] var    Pointer to the variable to modify
+ * @param[in]     expect The value var is expected to hold
+ * @param[in]     val    The value to store
+ *
+ * @return true if val was stored.
+ */
+
+#ifdef GCC_ATOMIC_FUNCTIONS
+static inline bool atomic_cas_uint32_t(uint32_t *var, uint32_t expect,
+				       uint32_t val)
+{
+	return __atomic_compare_exchange_n(var, &expect, val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(GCC_SYNC_FUNCTIONS)
+static inline bool atomic_cas_uint32_t(uint32_t *var, uint32_t expect,
+				       uint32_t val)
+{
+	return __sync_bool_compare_and_swap(var, expect, val);
+}
+#endif
+
+/**
+ * @brief Atomically compare and swap a void *
+ *
+ * This function atomically stores the new value iff the variable
+ * still holds the expected value.
+ *
+ * @param[in,out] var    Pointer to the variable to modify
+ * @param[in]     expect The value var is expected to hold
+ * @param[in]     val    The value to store
+ *
+ * @return true if val was stored.
+ */
+
+#ifdef GCC_ATOMIC_FUNCTIONS
+static inline bool atomic_cas_voidptr(void **var, void *expect, void *val)
+{
+	return __atomic_compare_exchange_n(var, &expect, val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(GCC_SYNC_FUNCTIONS)
+static inline bool atomic_cas_voidptr(void **var, void *expect, void *val)
+{
+	return __sync_bool_compare_and_swap(var, expect, val);
+}
+#endif
 #endif				/* !_ABSTRACT_ATOMIC_H */
@@ -61,8 +61,11 @@ static inline struct opr_rbtree_node *rbtree_x_cached_lookup(
 	if (!t)
 		t = rbtx_partition_of_scalar(xt, hk);
 
+	/* slots are stored under the read lock, and may be probed with
+	 * no lock at all:  access them atomically
+	 */
 	offset = hk % xt->cachesz;
-	nv_cached = t->cache[offset];
+	nv_cached = atomic_fetch_voidptr((void **)&t->cache[offset]);
 	if (nv_cached) {
 		if (t->t.cmpf(nv_cached, nk) == 0) {
 			nv = nv_cached;
@@ -72,7 +75,7 @@ static inline struct opr_rbtree_node *rbtree_x_cached_lookup(
 
 	nv = opr_rbtree_lookup(&t->t, nk);
 	if (nv && (xt->flags & RBT_X_FLAG_CACHE_RT))
-		t->cache[offset] = nv;
+		atomic_store_voidptr((void **)&t->cache[offset], nv);
 
 	__warnx(TIRPC_DEBUG_FLAG_RBTREE,
 		"rbtree_x_cached_lookup: t %p nk %p nv %p" "(%s hk %" PRIx64
@@ -107,7 +110,8 @@ static inline struct opr_rbtree_node *rbtree_x_cached_insert(
 
 	if (xt->flags & RBT_X_FLAG_CACHE_WT) {
 		if (!v_cached) {
-			nv = t->cache[offset] = nk;
+			atomic_store_voidptr((void **)&t->cache[offset], nk);
+			nv = nk;
 		} else {
 			nv = opr_rbtree_insert(&t->t, nk);
 			if (!nv)
@@ -115,7 +119,8 @@ static inline struct opr_rbtree_node *rbtree_x_cached_insert(
 		}
 	} else {
 		/* RBT_X_FLAG_CACHE_RT */
-		nv = v_cached = t->cache[offset] = nk;
+		atomic_store_voidptr((void **)&t->cache[offset], nk);
+		nv = nk;
 		(void)opr_rbtree_insert(&t->t, nk);
 	}
 
@@ -146,13 +151,15 @@ static inline void rbtree_x_cached_remove(struct rbtree_x *xt,
 
 	if (xt->flags & RBT_X_FLAG_CACHE_WT) {
 		if (v_cached && (t->t.cmpf(nk, v_cached) == 0))
-			t->cache[offset] = NULL;
+			atomic_store_voidptr((void **)&t->cache[offset],
+					     NULL);
 		else
 			return (opr_rbtree_remove(&t->t, nk));
 	} else {
 		/* RBT_X_FLAG_CACHE_RT */
 		if (v_cached && (t->t.cmpf(nk, v_cached) == 0))
-			t->cache[offset] = NULL;
+			atomic_store_voidptr((void **)&t->cache[offset],
+					     NULL);
 		return (opr_rbtree_remove(&t->t, nk));
 	}
 }
@@ -124,6 +124,15 @@ AUTH *authgss_ncreate_default(CLIENT *, char *, struct rpc_gss_sec *);
 bool authgss_service(AUTH *auth, int svc);
 bool authgss_get_private_data(AUTH *auth, struct authgss_private_data *);
 
+/* Several contexts for the same principal, spreading calls in flight */
+struct authgss_pool;
+
+struct authgss_pool *authgss_pool_ncreate(CLIENT *, gss_name_t,
+					  struct rpc_gss_sec *, u_int);
+AUTH *authgss_pool_get(struct authgss_pool *);
+void authgss_pool_put(struct authgss_pool *, AUTH *);
+void authgss_pool_destroy(struct authgss_pool *);
+
 void gss_log_status(char *m, OM_uint32 major, OM_uint32 minor);
 void gss_log_hexdump(const u_char *buf, int len, int offset);
 __END_DECLS
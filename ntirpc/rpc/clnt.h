@@ -497,6 +497,22 @@ clnt_vc_ncreate(const int fd, const struct netbuf *raddr,
 				 CLNT_CREATE_FLAG_CONNECT));
 }
 
+/*
+ * Create a client handle over shared-memory rings, negotiated on a
+ * connected AF_LOCAL socket (see svc_shm_ncreatef).  Only with
+ * USE_RPC_SHM (Linux).
+ */
+extern CLIENT *clnt_shm_ncreatef(const int, const rpcprog_t,
+				 const rpcvers_t, const u_int,
+				 const uint32_t);
+/*
+ *      const int fd;                           -- connected AF_LOCAL socket
+ *      const rpcprog_t prog;                   -- RPC program number
+ *      const rpcvers_t vers;                   -- RPC program version
+ *      const u_int ringsz;                     -- bytes per direction
+ *      const uint32_t flags;                   -- flags
+ */
+
 /*
  * Create a client handle from an active service transport handle.
  */
@@ -36,6 +36,7 @@
 #include <misc/rbtree_x.h>
 #include <misc/queue.h>
 #include <misc/abstract_atomic.h>
+#include <misc/portable.h>
 #include <intrinsic.h>
 
 #ifdef HAVE_HEIMDAL
@@ -68,16 +69,21 @@ typedef gss_union_ctx_id_desc *gss_union_ctx_id_t;
 #define SVC_RPC_GSS_FLAG_NONE    0x0000
 #define SVC_RPC_GSS_FLAG_MSPAC   0x0001
 #define SVC_RPC_GSS_FLAG_LOCKED  0x0002
+#define SVC_RPC_GSS_FLAG_REFERENCED  0x0004
+
+/* smallest (and legacy) replay window */
+#define SVC_RPC_GSS_SEQ_WIN_MIN  32
 
 struct svc_rpc_gss_data {
 	struct opr_rbtree_node node_k;
 	 TAILQ_ENTRY(svc_rpc_gss_data) lru_q;
+	struct svc_rpc_gss_data *gc_next;	/* idle sweep reap list */
 	mutex_t lock;
 	uint32_t flags;
 	uint32_t refcnt;
 	uint32_t gen;
 	struct {
-		uint32_t k;
+		uint64_t k;
 	} hk;
 	bool established;
 	gss_ctx_id_t ctx;	/* context id */
@@ -85,8 +91,14 @@ struct svc_rpc_gss_data {
 	gss_buffer_desc cname;	/* GSS client name */
 	u_int seq;
 	u_int win;
-	u_int seqlast;
-	uint32_t seqmask;
+	struct {
+		/* replay bitmap ring, one word per 32 sequence numbers:
+		 * the upper half tags the block, the lower half marks
+		 * sequence numbers seen within it */
+		uint64_t *ring;
+		uint32_t nwords;
+		uint32_t last;	/* highest sequence number seen */
+	} seqwin;
 	gss_name_t client_name;
 	gss_buffer_desc checksum;
 	struct {
@@ -94,11 +106,26 @@ struct svc_rpc_gss_data {
 		gss_buffer_desc ms_pac;
 	} pac;
 	SVCAUTH *auth;
-	uint32_t endtime;
+	uint32_t endtime;	/* context expiry (get_time_fast() seconds) */
+	uint32_t exp_ix;	/* 1-based position in partition expiry heap */
 };
 
 bool svcauth_gss_destroy(SVCAUTH *auth);
 
+#ifdef __APPLE__
+/* there's also mach_absolute_time() - don't know if it's faster */
+#define get_time_fast()	time(0)
+#else
+static inline int64_t
+get_time_fast(void)
+{
+	struct timespec ts[1];
+	(void)clock_gettime(CLOCK_MONOTONIC_FAST, ts);
+	return ts->tv_sec;
+}
+#endif
+
+
 static inline struct
 svc_rpc_gss_data *alloc_svc_rpc_gss_data(void)
 {
@@ -142,6 +169,31 @@ unref_svc_rpc_gss_data(struct svc_rpc_gss_data *gd,
 struct svc_rpc_gss_data *authgss_ctx_hash_get(struct rpc_gss_cred *gc);
 bool authgss_ctx_hash_set(struct svc_rpc_gss_data *gd);
 bool authgss_ctx_hash_del(struct svc_rpc_gss_data *gd);
+bool authgss_ctx_hash_stats(struct svc_gss_cache_stats *);
+
+#ifdef HAVE_GSS_IOV
+/* in-place wrap of an xdr_ioq stream, see authgss_prot.c */
+struct rpc_gss_wrap_iov {
+	rpc_gss_svc_t svc;
+	u_int start;		/* databody length */
+	u_int data;		/* rpc_gss_data_t */
+	u_int end;
+	u_int hdrlen;		/* reserved wrap token header (privacy) */
+};
+
+bool xdr_rpc_gss_wrap_marshal(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
+			      gss_ctx_id_t ctx, gss_qop_t qop,
+			      rpc_gss_svc_t svc, u_int seq,
+			      struct rpc_gss_wrap_iov *wi);
+bool xdr_rpc_gss_wrap_seal(XDR *xdrs, gss_ctx_id_t ctx, gss_qop_t qop,
+			   struct rpc_gss_wrap_iov *wi);
+#endif
+
+struct xdr_ioq;
+
+void svcauth_gss_crypto_init(void);
+void svcauth_gss_crypto_shutdown(void);
+bool svcauth_gss_reply_ioq(struct svc_req *, struct xdr_ioq *, bool *);
 
 bool svcauth_gss_acquire_cred(void);
 bool svcauth_gss_release_cred(void);
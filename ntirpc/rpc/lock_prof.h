@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file lock_prof.h
+ * @brief Lock contention profiling
+ *
+ * When built with USE_LOCK_PROF, the library's shared locks (poolq_head
+ * qmutex, svc_rqst ev_lock, rbtree_x partition locks, the duplex recv
+ * lock, ops_lock, and the GSS context partition locks) are taken through
+ * a profiling layer.  While enabled (TIRPC_SET_LOCK_PROF), each thread
+ * counts acquisitions, contended acquisitions, wait time and hold time
+ * per acquiring site (lock name, function and line) in its own table.
+ *
+ * A snapshot (TIRPC_GET_LOCK_STATS) sums the tables of live and exited
+ * threads;  it is not a consistent cut.  Condition waits end the hold.
+ */
+
+#ifndef TIRPC_LOCK_PROF_H
+#define TIRPC_LOCK_PROF_H
+
+#include <rpc/types.h>
+
+#define TIRPC_LOCK_SITES 512
+
+enum tirpc_lock_kind {
+	TIRPC_LOCK_MUTEX,
+	TIRPC_LOCK_RDLOCK,
+	TIRPC_LOCK_WRLOCK,
+};
+
+/* one per acquiring site;  static, registered on first use */
+struct tirpc_lock_site {
+	const char *name;		/* lock, e.g. "ev_lock" */
+	const char *func;
+	uint32_t line;
+	uint32_t kind;			/* enum tirpc_lock_kind */
+	uint32_t id;			/* index + 1, or 0 */
+};
+
+struct tirpc_lock_stat {
+	const char *name;
+	const char *func;
+	uint32_t line;
+	uint32_t kind;
+	uint64_t acquired;
+	uint64_t contended;		/* not immediately available */
+	uint64_t wait_ns;
+	uint64_t wait_max_ns;
+	uint64_t hold_ns;
+	uint64_t hold_max_ns;
+};
+
+struct tirpc_lock_snapshot {
+	struct tirpc_lock_stat *stats;	/* IN: caller's array */
+	u_int max;			/* IN: entries in stats */
+	u_int count;			/* OUT: entries filled (acquired) */
+	u_int threads;			/* OUT: live thread tables */
+};
+
+#endif				/* TIRPC_LOCK_PROF_H */
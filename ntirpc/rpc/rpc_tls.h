@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file rpc_tls.h
+ * @brief RPC-over-TLS (RFC 9289)
+ *
+ * The TLS handshake runs in user space (OpenSSL) over the existing
+ * connection, then the session is handed to kernel TLS.  Thereafter, the
+ * usual stream send and receive paths carry plaintext records.
+ *
+ * The application owns the SSL_CTX (certificates, verification);  it is
+ * prepared here for TLS 1.3, the "sunrpc" ALPN, and kernel TLS.
+ *
+ * Only available when built with USE_RPC_TLS.
+ */
+
+#ifndef TIRPC_RPC_TLS_H
+#define TIRPC_RPC_TLS_H
+
+#include <rpc/svc.h>
+#include <rpc/clnt.h>
+
+struct ssl_ctx_st;	/* SSL_CTX */
+
+__BEGIN_DECLS
+/* server:  answer AUTH_TLS probes on stream transports */
+extern bool svc_tls_init(struct ssl_ctx_st *);
+
+/* client:  probe, then upgrade the connection */
+extern bool clnt_tls_prepare(struct ssl_ctx_st *);
+extern enum clnt_stat clnt_vc_starttls(CLIENT *, struct ssl_ctx_st *,
+				       const char *, struct timespec);
+__END_DECLS
+
+#endif				/* TIRPC_RPC_TLS_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file rpc_trace.h
+ * @brief Per-thread binary trace rings
+ *
+ * Debug sites on the request path record fixed-size binary records
+ * (timestamp, event, source line, arguments) instead of formatting text,
+ * when their debug flag is set in the trace flags
+ * (TIRPC_SET_TRACE_FLAGS).  Each thread writes its own ring without
+ * locks or atomic read-modify-write;  the oldest records are overwritten.
+ *
+ * A consumer (one thread at a time) copies out new records with
+ * tirpc_trace_drain(), and may decode them with tirpc_trace_format().
+ * String arguments are pointers to static strings in this process.
+ *
+ * Sites with a flag in debug_flags but not the trace flags are formatted and
+ * passed to warnx_ as before.
+ */
+
+#ifndef TIRPC_RPC_TRACE_H
+#define TIRPC_RPC_TRACE_H
+
+#include <sys/cdefs.h>
+#include <rpc/types.h>
+
+#define TIRPC_TRACE_ARGS 5
+#define TIRPC_TRACE_RING_SIZE 4096	/* records per thread, power of 2 */
+
+enum tirpc_trace_event {
+	TIRPC_TRACE_NONE = 0,
+	TIRPC_TRACE_XPRT,		/* XPRT_TRACE() */
+	TIRPC_TRACE_SVC_VC_RECV,
+	TIRPC_TRACE_SVC_VC_EAGAIN,
+	TIRPC_TRACE_SVC_RQST_EVENT,
+	TIRPC_TRACE_SVC_RQST_REARM,
+	TIRPC_TRACE_SVC_RQST_WAIT,
+	TIRPC_TRACE_SVC_RQST_WAKEUP,
+	TIRPC_TRACE_CLNT_REQ_WAIT,
+	TIRPC_TRACE_CLNT_REQ_REPLIED,
+	TIRPC_TRACE_CLNT_REQ_RESULT,
+	TIRPC_TRACE_CLNT_REQ_IGNORED,
+	TIRPC_TRACE_EVENTS
+};
+
+struct tirpc_trace_rec {
+	uint64_t tr_seq;		/* (ring << 48) | (position + 1) */
+	uint64_t tr_ns;			/* CLOCK_MONOTONIC */
+	uint32_t tr_event;		/* enum tirpc_trace_event */
+	uint32_t tr_line;		/* source line */
+	uint64_t tr_arg[TIRPC_TRACE_ARGS];
+};
+
+#define TIRPC_TRACE_RING(seq) ((uint32_t)((seq) >> 48))
+
+__BEGIN_DECLS
+extern void tirpc_trace_put(uint32_t, uint32_t, uint64_t, uint64_t,
+			    uint64_t, uint64_t, uint64_t);
+extern void tirpc_trace_warnx(uint32_t, uint32_t, uint64_t, uint64_t,
+			      uint64_t, uint64_t, uint64_t);
+
+/* returns records copied;  *lost counts records overwritten unread */
+extern u_int tirpc_trace_drain(struct tirpc_trace_rec *, u_int, uint64_t *);
+extern int tirpc_trace_format(const struct tirpc_trace_rec *, char *, size_t);
+__END_DECLS
+
+#define TIRPC_TRACE_ARG(a) ((uint64_t)(uintptr_t)(a))
+
+/*
+ * Record event ev (with exactly TIRPC_TRACE_ARGS arguments, pad with 0),
+ * or fall back to __warnx() formatting.
+ */
+#define __tracex(flags, ev, a0, a1, a2, a3, a4)				\
+	do {								\
+		if (__ntirpc_trace_flags & (flags)) {			\
+			tirpc_trace_put((ev), __LINE__,			\
+					TIRPC_TRACE_ARG(a0),		\
+					TIRPC_TRACE_ARG(a1),		\
+					TIRPC_TRACE_ARG(a2),		\
+					TIRPC_TRACE_ARG(a3),		\
+					TIRPC_TRACE_ARG(a4));		\
+		} else if (__ntirpc_pkg_params.debug_flags & (flags)) {	\
+			tirpc_trace_warnx((ev), __LINE__,		\
+					  TIRPC_TRACE_ARG(a0),		\
+					  TIRPC_TRACE_ARG(a1),		\
+					  TIRPC_TRACE_ARG(a2),		\
+					  TIRPC_TRACE_ARG(a3),		\
+					  TIRPC_TRACE_ARG(a4));		\
+		}							\
+	} while (0)
+
+#endif				/* TIRPC_RPC_TRACE_H */
@@ -45,6 +45,7 @@
 #include <sys/cdefs.h>
 #include <rpc/rpc_msg.h>
 #include <rpc/types.h>
+#include <rpc/rpc_trace.h>
 #include <rpc/work_pool.h>
 #include <misc/portable.h>
 #include "reentrant.h"
@@ -89,6 +90,9 @@ enum xprt_stat {
 #define SVC_INIT_EPOLL          0x0002
 #define SVC_INIT_NOREG_XPRTS    0x0008
 #define SVC_INIT_BLKIN          0x0010
+#define SVC_INIT_AUTH_SHORT     0x0020	/* issue AUTH_SHORT verifiers */
+#define SVC_INIT_LATENCY        0x0040	/* per-procedure latency histograms */
+#define SVC_INIT_ARENA          0x0080	/* decode arguments into rq_arena */
 
 #define SVC_SHUTDOWN_FLAG_NONE  0x0000
 
@@ -103,6 +107,7 @@ enum xprt_stat {
 #define SVCSET_XP_FLAGS         8
 #define SVCGET_XP_FREE_USER_DATA        15
 #define SVCSET_XP_FREE_USER_DATA        16
+#define SVCGET_XP_STATS         17	/* struct svc_xprt_stats * */
 
 /*
  * Operations for rpc_control().
@@ -114,6 +119,21 @@ enum xprt_stat {
 #define RPC_SVC_FDSET_GET       4
 #define RPC_SVC_FDSET_SET       5
 
+/*
+ * Operations for svc_control().
+ */
+#define SVC_CTL_LATENCY_GET     1	/* struct svc_latency_snapshot * */
+#define SVC_CTL_LATENCY_RESET   2	/* (unused) */
+#define SVC_CTL_LATENCY_ENABLE  3	/* bool * */
+#define SVC_CTL_XPRT_STATS_GET  4	/* struct svc_xprt_stats_snapshot * */
+#define SVC_CTL_SLOW_SET        5	/* struct svc_slow_params * */
+#define SVC_CTL_SLOW_GET        6	/* struct svc_slow_snapshot * */
+#define SVC_CTL_SLOW_DUMP       7	/* (unused) */
+#define SVC_CTL_WORK_POOL_GET   8	/* struct work_pool_stats * */
+#define SVC_CTL_BUFFERS_GET     9	/* struct svc_buffer_stats * */
+#define SVC_CTL_GSS_CACHE_GET   10	/* struct svc_gss_cache_stats * */
+/* 11 is reserved, a test hook (svc_internal.h) */
+
 typedef enum xprt_stat (*svc_xprt_fun_t) (SVCXPRT *);
 typedef enum xprt_stat (*svc_xprt_xdr_fun_t) (SVCXPRT *, XDR *);
 
@@ -131,6 +151,12 @@ typedef struct svc_init_params {
 	u_int gss_max_ctx;
 	u_int gss_max_idle_gen;
 	u_int gss_max_gc;
+	u_int gss_seq_win;
+	u_int gss_crypto_thrd_max;	/* 0: seal replies inline */
+	u_int gss_crypto_min;		/* smallest deferred reply (bytes) */
+	u_int authsys_max_cred;		/* interned AUTH_SYS, 0: none */
+	u_int drc_cksum;		/* SVC_DRC_CKSUM_* */
+	u_int drc_cksum_len;		/* prefix bytes, 0: default */
 	uint32_t channels;
 	int32_t idle_timeout;
 } svc_init_params;
@@ -138,6 +164,14 @@ typedef struct svc_init_params {
 /* Svc param flags */
 #define SVC_FLAG_NONE             0x0000
 #define SVC_FLAG_NOREG_XPRTS      0x0001
+#define SVC_FLAG_AUTH_SHORT       0x0002
+#define SVC_FLAG_ARENA            0x0004
+
+/* Duplicate request cache checksum (rq_cksum) of the call body */
+#define SVC_DRC_CKSUM_PREFIX      0	/* CityHash64, drc_cksum_len bytes */
+#define SVC_DRC_CKSUM_BODY        1	/* CityHash64, contiguous bytes */
+#define SVC_DRC_CKSUM_STREAM      2	/* crc32c, all record segments */
+#define SVC_DRC_CKSUM_LEN_DEFAULT 256
 
 /*
  * SVCXPRT xp_flags
@@ -153,6 +187,9 @@ typedef struct svc_init_params {
 #define SVC_XPRT_FLAG_DESTROYING	0x0020	/* SVC_DESTROY() was called */
 #define SVC_XPRT_FLAG_RELEASING		0x0040	/* (*xp_destroy) was called */
 #define SVC_XPRT_FLAG_UREG		0x0080
+#define SVC_XPRT_FLAG_TLS		0x0100	/* kernel TLS installed */
+#define SVC_XPRT_FLAG_TLS_ACCEPT	0x0200	/* handshake before next record */
+#define SVC_XPRT_FLAG_TLS_CONNECT	0x0400	/* client handshake owns fd */
 
 #define SVC_XPRT_FLAG_DESTROYED (SVC_XPRT_FLAG_DESTROYING \
 				| SVC_XPRT_FLAG_RELEASING)
@@ -189,7 +226,8 @@ typedef enum xprt_type {
 	XPRT_RDMA,
 	XPRT_RDMA_RENDEZVOUS,
 	XPRT_VSOCK,
-	XPRT_VSOCK_RENDEZVOUS
+	XPRT_VSOCK_RENDEZVOUS,
+	XPRT_SHM
 } xprt_type_t;
 
 struct SVCAUTH;			/* forward decl. */
@@ -310,6 +348,16 @@ struct svc_req {
 	/* avoid separate alloc/free */
 	struct rpc_msg rq_msg;
 
+	/* latency histograms (SVC_INIT_LATENCY) */
+	struct timespec rq_lat_ts;	/* dispatch */
+	uint32_t rq_lat;		/* histogram slot, or 0 */
+
+	/* slow request recorder (SVC_CTL_SLOW_SET), owned by the stream */
+	struct svc_slow_req *rq_slow;
+
+	/* decoded arguments (SVC_INIT_ARENA), until SVCAUTH_RELEASE() */
+	struct xdr_arena rq_arena;
+
 #if defined(HAVE_BLKIN)
 	/* blkin tracing */
 	struct blkin_trace bl_trace;
@@ -343,7 +391,15 @@ extern void svc_xprt_trace(SVCXPRT *, const char *, const char *, const int);
 __END_DECLS
 
 #define XPRT_TRACE(xprt, func, tag, line)				 \
-	if (__ntirpc_pkg_params.debug_flags & TIRPC_DEBUG_FLAG_REFCNT) { \
+	if (__ntirpc_trace_flags & TIRPC_DEBUG_FLAG_REFCNT) {		 \
+		tirpc_trace_put(TIRPC_TRACE_XPRT, (line),		 \
+				TIRPC_TRACE_ARG(xprt),			 \
+				TIRPC_TRACE_ARG((xprt)->xp_fd),		 \
+				TIRPC_TRACE_ARG((xprt)->xp_refs),	 \
+				TIRPC_TRACE_ARG(func),			 \
+				TIRPC_TRACE_ARG(tag));			 \
+	} else if (__ntirpc_pkg_params.debug_flags			 \
+		   & TIRPC_DEBUG_FLAG_REFCNT) {				 \
 		svc_xprt_trace((xprt), (func), (tag), (line));		 \
 	}
 
@@ -539,6 +595,19 @@ extern enum xprt_stat svcerr_systemerr(struct svc_req *);
 extern int rpc_reg(rpcprog_t, rpcvers_t, rpcproc_t, char *(*)(char *),
 		   xdrproc_t, xdrproc_t, char *);
 __END_DECLS
+
+/*
+ * Free the arguments decoded by SVCAUTH_UNWRAP() or SVCAUTH_CHECKSUM(),
+ * in place of xdr_free().  With SVC_INIT_ARENA, their storage belongs to
+ * the request until SVCAUTH_RELEASE();  only the pointers are cleared.
+ */
+static inline bool
+svc_freeargs(struct svc_req *req, xdrproc_t proc, void *where)
+{
+	if (req->rq_arena.xa_flags & XDR_ARENA_FLAG_ENABLED)
+		return (*proc) (&xdr_free_arena_stream, where);
+	return xdr_nfree(proc, where);
+}
 /*
  * a small program implemented by the svc_rpc implementation itself;
  * also see clnt.h for protocol numbers.
@@ -665,11 +734,165 @@ svc_fd_ncreate(const int fd, const u_int sendsize, const u_int recvsize)
 	return (svc_fd_ncreatef(fd, sendsize, recvsize, SVC_CREATE_FLAG_NONE));
 }
 
+/*
+ * Service control (package global)
+ */
+extern bool svc_control(const u_int, void *);
+
+/*
+ * Per-procedure latency histograms (SVC_INIT_LATENCY, SVC_CTL_LATENCY_*)
+ */
+enum svc_latency_stage {
+	SVC_LATENCY_QUEUE,	/* event to dispatch, incl. work pool wait */
+	SVC_LATENCY_SERVICE,	/* dispatch to reply */
+	SVC_LATENCY_OUTPUT,	/* reply to write complete */
+	SVC_LATENCY_STAGES
+};
+
+/* log-linear, 4 per power of 2 nanoseconds;  see svc_latency_bucket_ns() */
+#define SVC_LATENCY_BUCKETS 144
+
+struct svc_latency_hist {
+	rpcprog_t prog;
+	rpcvers_t vers;
+	rpcproc_t proc;
+	uint64_t count[SVC_LATENCY_STAGES][SVC_LATENCY_BUCKETS];
+};
+
+struct svc_latency_snapshot {
+	struct svc_latency_hist *hist;	/* IN: caller's array */
+	u_int max;			/* IN: entries in hist */
+	u_int count;			/* OUT: entries filled */
+	uint64_t dropped;		/* OUT: calls without a slot */
+};
+
+/* lower bound of a bucket (nanoseconds) */
+extern uint64_t svc_latency_bucket_ns(u_int);
+
+/*
+ * Per-transport counters (SVCGET_XP_STATS, SVC_CTL_XPRT_STATS_GET)
+ *
+ * Maintained with relaxed atomics;  a snapshot is not a consistent cut.
+ * Datagram traffic is counted on the listening transport.
+ */
+struct svc_xprt_stats {
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t records_in;		/* complete calls (or replies) */
+	uint64_t records_out;
+	uint64_t frags_in;
+	uint64_t frags_out;
+	uint64_t partial_writes;	/* writev short counts */
+	uint64_t eagain;		/* recv EAGAIN, rearmed */
+	uint32_t queued;		/* output waiting for writev */
+	uint32_t queued_max;
+	struct timespec active;		/* last event (CLOCK_MONOTONIC_FAST) */
+};
+
+struct svc_xprt_stats_entry {
+	struct svc_xprt_stats stats;
+	struct sockaddr_storage remote;
+	int fd;
+	int type;			/* enum xprt_type */
+};
+
+struct svc_xprt_stats_snapshot {
+	struct svc_xprt_stats_entry *xprts;	/* IN: caller's array */
+	u_int max;			/* IN: entries in xprts */
+	u_int count;			/* OUT: entries filled */
+	u_int total;			/* OUT: transports seen */
+};
+
+/*
+ * Slowest requests per window (SVC_CTL_SLOW_*)
+ *
+ * Stage times are CLOCK_MONOTONIC nanoseconds, 0 when not reached.
+ * Procedure dispatch is the application's, so the last library stage
+ * before it is the call header decode (xp_dispatch.process_cb).
+ */
+enum svc_slow_stage {
+	SVC_SLOW_RECV,		/* event that completed the call */
+	SVC_SLOW_ENQUEUE,	/* receive task queued to svc_work_pool */
+	SVC_SLOW_DEQUEUE,	/* receive task started */
+	SVC_SLOW_DISPATCH,	/* call header decoded, to process_cb */
+	SVC_SLOW_AUTH,		/* svc_auth_authenticate() done */
+	SVC_SLOW_REPLY,		/* SVC_REPLY() */
+	SVC_SLOW_WRITE,		/* reply written (or sent) */
+	SVC_SLOW_STAGES
+};
+
+struct svc_slow_req {
+	uint64_t ns[SVC_SLOW_STAGES];
+	struct sockaddr_storage remote;
+	uint32_t xid;
+	rpcprog_t prog;
+	rpcvers_t vers;
+	rpcproc_t proc;
+	uint32_t call_bytes;
+	uint32_t reply_bytes;
+};
+
+struct svc_slow_params {
+	u_int slowest;			/* kept per window, 0 disables */
+	u_int window;			/* seconds */
+	int signo;			/* dump on this signal, or 0 */
+};
+
+struct svc_slow_snapshot {
+	struct svc_slow_req *reqs;	/* IN: caller's array */
+	u_int max;			/* IN: entries in reqs */
+	u_int count;			/* OUT: entries filled, slowest first */
+	u_int previous;			/* OUT: trailing, previous window */
+};
+
+/*
+ * xdr_ioq buffer segments (SVC_CTL_BUFFERS_GET), relaxed counters.
+ * Segments are allocated per stream unless the transport keeps a fixed
+ * pool (RDMA), whose fetches may wait for another stream's recycle.
+ */
+struct svc_buffer_stats {
+	uint64_t created;		/* segments allocated */
+	uint64_t freed;
+	uint64_t bytes_created;
+	uint64_t bytes_freed;
+	uint64_t grown;			/* reallocated to max_bsize */
+	uint64_t pool_fetches;		/* segments taken from a pool */
+	uint64_t pool_waits;		/* fetches that waited */
+	uint64_t pool_recycles;
+};
+
+/*
+ * RPCSEC_GSS context cache (SVC_CTL_GSS_CACHE_GET), relaxed counters.
+ * Fails without GSS support.
+ */
+struct svc_gss_cache_stats {
+	uint64_t hits;			/* lock-free partition cache */
+	uint64_t tree_hits;		/* partition tree, under read lock */
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t deletes;		/* explicit (context destroyed) */
+	uint64_t expired;		/* idle sweep, past endtime */
+	uint64_t evicted;		/* idle sweep, over max_ctx */
+	uint32_t size;
+	uint32_t max;
+	uint32_t partitions;
+};
+
 /*
  * Memory based rpc (for speed check and testing)
  */
 extern SVCXPRT *svc_raw_ncreate(void);
 
+/*
+ * Shared-memory rings offered by a same-host client (clnt_shm_ncreatef)
+ * over a connected AF_LOCAL socket.  Only with USE_RPC_SHM (Linux).
+ */
+extern SVCXPRT *svc_shm_ncreatef(const int, const uint32_t);
+/*
+ *      const int fd;                           -- connected AF_LOCAL socket
+ *      const uint32_t flags;                   -- flags
+ */
+
 /*
  * RPC over RDMA
  */
@@ -66,8 +66,15 @@ typedef struct SVCAUTH {
 #define SVCAUTH_CHECKSUM(req) \
 	((*(((req)->rq_auth)->svc_ah_ops->svc_ah_checksum))(req))
 
-#define SVCAUTH_RELEASE(req) \
-	((*(((req)->rq_auth)->svc_ah_ops->svc_ah_release))(req))
+/* the request arena goes with the decoded arguments */
+static inline bool
+svcauth_release(struct svc_req *req)
+{
+	xdr_arena_release(&req->rq_arena);
+	return ((*(req->rq_auth->svc_ah_ops->svc_ah_release))(req));
+}
+
+#define SVCAUTH_RELEASE(req) svcauth_release(req)
 
 #define SVCAUTH_DESTROY(auth) \
 	((*((auth)->svc_ah_ops->svc_ah_destroy))(auth))
@@ -78,5 +85,12 @@ typedef struct SVCAUTH {
 __BEGIN_DECLS
 extern enum auth_stat svc_auth_authenticate(struct svc_req *, bool *);
 extern int svc_auth_reg(int, enum auth_stat (*)(struct svc_req *));
+extern int svc_auth_reg_flags(int, enum auth_stat (*)(struct svc_req *),
+			      uint32_t);
 __END_DECLS
+
+/* flavor capabilities (svc_auth_reg_flags()) */
+#define SVC_AUTH_FLAG_NONE	0x0000
+#define SVC_AUTH_FLAG_NOWRAP	0x0001	/* results are never wrapped */
+
 #endif				/* !_RPC_SVC_AUTH_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file svc_stats.h
+ * @brief Library statistics as an RPC program
+ *
+ * A server may offer the library's internal statistics on any of its
+ * transports, without another daemon or port:  svc_stats_reg() adds the
+ * program to the callout list (for the application's process_cb lookup),
+ * or process_cb may call svc_stats_dispatch() directly for the program.
+ *
+ * Each procedure returns one svc_control() snapshot in XDR form;  the
+ * counters are cumulative, so a client polls and differences them (see
+ * tests/rpcstat.c).  Tables (latency, transports) may exceed a datagram,
+ * prefer a stream transport.
+ *
+ * Procedures other than NULL are refused (AUTH_TOOWEAK) unless the caller
+ * is on this host (AF_LOCAL or loopback), or uses RPCSEC_GSS.
+ */
+
+#ifndef TIRPC_SVC_STATS_H
+#define TIRPC_SVC_STATS_H
+
+#include <rpc/svc.h>
+#include <rpc/work_pool.h>
+
+/* from the user-defined range */
+#define TIRPC_STATS_PROG	((rpcprog_t)0x20004e54)
+#define TIRPC_STATS_VERS	((rpcvers_t)1)
+
+#define TIRPC_STATSPROC_NULL	((rpcproc_t)0)
+#define TIRPC_STATSPROC_LATENCY	((rpcproc_t)1)	/* void -> latency */
+#define TIRPC_STATSPROC_XPRTS	((rpcproc_t)2)	/* u_int max -> xprts */
+#define TIRPC_STATSPROC_POOL	((rpcproc_t)3)	/* void -> work pool */
+#define TIRPC_STATSPROC_GSS	((rpcproc_t)4)	/* void -> gss result */
+#define TIRPC_STATSPROC_BUFFERS	((rpcproc_t)5)	/* void -> buffers */
+
+/* bounds on decoded tables;  the server also caps XPRTS at max */
+#define TIRPC_STATS_LATENCY_MAX	1024
+#define TIRPC_STATS_XPRTS_MAX	4096
+
+/* absent (stats false) without GSS support */
+struct svc_stats_gss_res {
+	bool_t stats;
+	struct svc_gss_cache_stats gss;
+};
+
+__BEGIN_DECLS
+/*
+ * Decoding allocates the hist and xprts arrays (max = count);
+ * release them with xdr_free().  Remote addresses are carried as
+ * universal addresses (AF_INET, AF_INET6), otherwise only the family.
+ */
+extern bool xdr_svc_latency_snapshot(XDR *, struct svc_latency_snapshot *);
+extern bool xdr_svc_xprt_stats_snapshot(XDR *,
+					struct svc_xprt_stats_snapshot *);
+extern bool xdr_work_pool_stats(XDR *, struct work_pool_stats *);
+extern bool xdr_svc_stats_gss_res(XDR *, struct svc_stats_gss_res *);
+extern bool xdr_svc_buffer_stats(XDR *, struct svc_buffer_stats *);
+
+extern enum xprt_stat svc_stats_dispatch(struct svc_req *);
+extern bool svc_stats_reg(SVCXPRT *, const struct netconfig *);
+extern void svc_stats_unreg(void);
+__END_DECLS
+
+#endif				/* TIRPC_SVC_STATS_H */
@@ -115,6 +115,11 @@ typedef int32_t rpc_inline_t;
 #define TIRPC_SET_DEBUG_FLAGS		3
 #define TIRPC_GET_OTHER_FLAGS		4
 #define TIRPC_SET_OTHER_FLAGS		5
+#define TIRPC_GET_TRACE_FLAGS		6
+#define TIRPC_SET_TRACE_FLAGS		7
+#define TIRPC_GET_LOCK_STATS		8	/* struct tirpc_lock_snapshot * */
+#define TIRPC_SET_LOCK_PROF		9	/* bool * (USE_LOCK_PROF) */
+#define TIRPC_RESET_LOCK_STATS		10	/* (unused) */
 
 /*
  * Debug flags support
@@ -185,6 +190,7 @@ typedef struct tirpc_pkg_params {
 } tirpc_pkg_params;
 
 extern tirpc_pkg_params __ntirpc_pkg_params;
+extern uint32_t __ntirpc_trace_flags;	/* TIRPC_SET_TRACE_FLAGS */
 
 #include <misc/abstract_atomic.h>
 
@@ -48,6 +48,38 @@ struct work_pool_params {
 };
 
 struct work_pool_thread;
+struct work_pool_entry;
+
+typedef void (*work_pool_fun_t) (struct work_pool_entry *);
+
+/* submit to start, power of 2 nanoseconds:  bucket b counts waits in
+ * [2^b, 2^(b+1)), bucket 0 also counts 0, the last counts the rest.
+ */
+#define WORK_POOL_WAIT_BUCKETS 40
+#define WORK_POOL_FUNS 16		/* task types tracked by fun */
+
+struct work_pool_fun_stats {
+	work_pool_fun_t fun;		/* NULL in the last:  all others */
+	uint64_t runs;
+	uint64_t run_ns;
+	uint64_t run_max_ns;
+};
+
+struct work_pool_stats {
+	uint64_t submitted;
+	uint64_t started;
+	uint64_t spawned;		/* worker threads started */
+	uint64_t retired;		/* worker threads exited */
+	uint64_t spawn_failed;
+	uint64_t depth_ns;		/* sum of queued tasks x nanoseconds */
+	uint64_t wait[WORK_POOL_WAIT_BUCKETS];
+	uint32_t queued;		/* gauges at the snapshot */
+	uint32_t queued_max;
+	uint32_t busy;
+	uint32_t idle;
+	uint32_t threads;
+	struct work_pool_fun_stats fun[WORK_POOL_FUNS + 1];
+};
 
 struct work_pool {
 	struct poolq_head pqh;
@@ -58,9 +90,11 @@ struct work_pool {
 	long timeout_ms;
 	uint32_t n_threads;
 	uint32_t worker_index;
-};
 
-struct work_pool_entry;
+	/* telemetry, under pqh.qmutex */
+	struct work_pool_stats stats;
+	uint64_t depth_ts;		/* last change of queued tasks */
+};
 
 struct work_pool_thread {
 	struct poolq_entry pqe;		/*** 1st ***/
@@ -74,17 +108,20 @@ struct work_pool_thread {
 	uint32_t worker_index;
 };
 
-typedef void (*work_pool_fun_t) (struct work_pool_entry *);
-
 struct work_pool_entry {
 	struct poolq_entry pqe;		/*** 1st ***/
 	struct work_pool_thread *wpt;
 	work_pool_fun_t fun;
 	void *arg;
+	uint64_t submitted_ns;		/* CLOCK_MONOTONIC (telemetry) */
 };
 
+/* Exported, so an application may run and observe pools of its own;  the
+ * service pool is private, read with svc_control(SVC_CTL_WORK_POOL_GET).
+ */
 int work_pool_init(struct work_pool *, const char *, struct work_pool_params *);
 int work_pool_submit(struct work_pool *, struct work_pool_entry *);
 int work_pool_shutdown(struct work_pool *);
+void work_pool_stats_get(struct work_pool *, struct work_pool_stats *);
 
 #endif				/* WORK_POOL_H */
@@ -133,6 +133,7 @@ typedef struct xdr_vio {
 #define UIO_FLAG_GIFT		0x0004
 #define UIO_FLAG_MORE		0x0008
 #define UIO_FLAG_REALLOC	0x0010
+#define UIO_FLAG_REFER		0x0020	/* data spliced by XDR_PUTBUFS */
 
 struct xdr_uio;
 typedef void (*xdr_uio_release)(struct xdr_uio *, u_int);
@@ -160,6 +161,7 @@ typedef struct xdr_uio {
 #define XDR_FLAG_CKSUM		0x0001
 #define XDR_FLAG_FREE		0x0002
 #define XDR_FLAG_VIO		0x0004
+#define XDR_FLAG_ARENA		0x0008	/* x_lib[0] arena */
 
 /*
  * The XDR handle.
@@ -167,6 +169,9 @@ typedef struct xdr_uio {
  * an operations vector for the particular implementation (e.g. see xdr_mem.c),
  * and two private fields for the use of the particular implementation.
  * XXX: w/64-bit pointers, u_int not enough!
+ *
+ * Stream creators must initialize x_flags:  xdr_alloc() and friends
+ * take x_lib[0] as an arena whenever XDR_FLAG_ARENA is set.
  */
 typedef struct rpc_xdr {
 	const struct xdr_ops {
@@ -638,6 +643,98 @@ xdr_nfree(xdrproc_t proc, void *objp)
 	return (*proc) (&xdr_free_null_stream, objp);
 }
 
+/*
+ * Decode arena (XDR_FLAG_ARENA)
+ *
+ * While a decoding stream carries XDR_FLAG_ARENA, the bytes, strings,
+ * arrays and references it allocates are carved from the arena in its
+ * x_lib[0], and XDR_FREE only clears their pointers.  The storage is
+ * released all at once by xdr_arena_release(), returning its chunks to
+ * a small per-thread cache for the next decode.
+ */
+#define XDR_ARENA_ALIGN		16
+
+#define XDR_ARENA_FLAG_NONE	0x0000
+#define XDR_ARENA_FLAG_ENABLED	0x0001
+
+struct xdr_arena_chunk;
+
+struct xdr_arena {
+	struct xdr_arena_chunk *xa_chunks;	/* in use, newest first */
+	char *xa_next;
+	char *xa_end;
+	u_int xa_flags;
+};
+
+__BEGIN_DECLS
+extern XDR xdr_free_arena_stream;
+
+extern void *xdr_arena_grow(struct xdr_arena *, size_t);
+extern void xdr_arena_release(struct xdr_arena *);
+__END_DECLS
+
+static inline void
+xdr_arena_init(struct xdr_arena *arena, u_int flags)
+{
+	arena->xa_chunks = NULL;
+	arena->xa_next = NULL;
+	arena->xa_end = NULL;
+	arena->xa_flags = flags;
+}
+
+static inline void *
+xdr_arena_alloc(struct xdr_arena *arena, size_t size)
+{
+	char *p = arena->xa_next;
+
+	size = (size + XDR_ARENA_ALIGN - 1) & ~(size_t)(XDR_ARENA_ALIGN - 1);
+	if (unlikely(size > (size_t)(arena->xa_end - p)))
+		return (xdr_arena_grow(arena, size));
+	arena->xa_next = p + size;
+	return (p);
+}
+
+/* no-op unless the arena is enabled */
+static inline void
+xdr_arena_attach(XDR *xdrs, struct xdr_arena *arena)
+{
+	if (!(arena->xa_flags & XDR_ARENA_FLAG_ENABLED))
+		return;
+	xdrs->x_lib[0] = arena;
+	xdrs->x_flags |= XDR_FLAG_ARENA;
+}
+
+static inline void
+xdr_arena_detach(XDR *xdrs)
+{
+	xdrs->x_flags &= ~XDR_FLAG_ARENA;
+}
+
+/* allocation by decoders, from the stream's arena when attached */
+static inline void *
+xdr_alloc(XDR *xdrs, size_t size)
+{
+	if (xdrs->x_flags & XDR_FLAG_ARENA)
+		return (xdr_arena_alloc(xdrs->x_lib[0], size));
+	return (mem_alloc(size));
+}
+
+static inline void *
+xdr_zalloc(XDR *xdrs, size_t size)
+{
+	if (xdrs->x_flags & XDR_FLAG_ARENA)
+		return (memset(xdr_arena_alloc(xdrs->x_lib[0], size), 0, size));
+	return (mem_zalloc(size));
+}
+
+static inline void
+xdr_dealloc(XDR *xdrs, void *p, size_t size)
+{
+	if (xdrs->x_flags & XDR_FLAG_ARENA)
+		return;
+	mem_free(p, size);
+}
+
 /*
  * Common opaque bytes objects used by many rpc protocols;
  * declared here due to commonality.
@@ -603,11 +603,11 @@ xdr_bytes_decode(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize)
 	if (!size)
 		return (true);
 	if (!sp)
-		sp = (char *)mem_alloc(size);
+		sp = (char *)xdr_alloc(xdrs, size);
 
 	ret = xdr_opaque_decode(xdrs, sp, size);
 	if (!ret) {
-		mem_free(sp, size);
+		xdr_dealloc(xdrs, sp, size);
 		return (ret);
 	}
 	*cpp = sp;			/* only valid pointer */
@@ -651,7 +651,7 @@ static inline bool
 xdr_bytes_free(XDR *xdrs, char **cpp, size_t size)
 {
 	if (*cpp) {
-		mem_free(*cpp, size);
+		xdr_dealloc(xdrs, *cpp, size);
 		*cpp = NULL;
 		return (true);
 	}
@@ -801,7 +801,7 @@ xdr_array_decode(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize,
 	if (!size)
 		return (true);
 	if (!target)
-		*cpp = target = (char*) mem_zalloc(size * selem);
+		*cpp = target = (char *)xdr_zalloc(xdrs, size * selem);
 
 	for (; (i < size) && stat; i++) {
 		stat = (*xdr_elem) (xdrs, target);
@@ -873,7 +873,7 @@ xdr_array_free(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize,
 		target += selem;
 	}
 
-	mem_free(*cpp, size * selem);
+	xdr_dealloc(xdrs, *cpp, size * selem);
 	*cpp = NULL;
 
 	return (stat);
@@ -955,11 +955,11 @@ xdr_string_decode(XDR *xdrs, char **cpp, u_int maxsize)
 	 * now deal with the actual bytes
 	 */
 	if (!sp)
-		sp = (char *)mem_alloc(nodesize);
+		sp = (char *)xdr_alloc(xdrs, nodesize);
 
 	ret = xdr_opaque_decode(xdrs, sp, size);
 	if (!ret) {
-		mem_free(sp, nodesize);
+		xdr_dealloc(xdrs, sp, nodesize);
 		return (ret);
 	}
 	sp[size] = '\0';
@@ -1013,7 +1013,7 @@ static inline bool
 xdr_string_free(XDR *xdrs, char **cpp)
 {
 	if (*cpp) {
-		mem_free(*cpp, strlen(*cpp) + 1);
+		xdr_dealloc(xdrs, *cpp, strlen(*cpp) + 1);
 		*cpp = NULL;
 		return (true);
 	}
@@ -89,6 +89,13 @@ struct xdr_ioq {
 	struct xdr_ioq_uv_head ioq_uv;	/* header/vectors */
 
 	uint64_t id;
+
+	/* latency histograms:  event (request) or reply (output) time */
+	struct timespec ioq_ts;
+	uint32_t ioq_lat;		/* histogram slot, or 0 */
+
+	/* slow request recorder:  request, then reply stream */
+	struct svc_slow_req *ioq_slow;
 };
 
 #define _IOQ(p) (opr_containerof((p), struct xdr_ioq, ioq_s))
@@ -122,6 +129,9 @@ extern struct xdr_ioq *xdr_ioq_create(size_t min_bsize, size_t max_bsize,
 extern void xdr_ioq_release(struct poolq_head *ioqh);
 extern void xdr_ioq_reset(struct xdr_ioq *xioq, u_int wh_pos);
 extern void xdr_ioq_setup(struct xdr_ioq *xioq);
+extern int xdr_ioq_vio(XDR *xdrs, u_int start, u_int end, xdr_vio *vio,
+		       int count);
+extern void xdr_ioq_unsplice(XDR *xdrs, u_int start, u_int end);
 
 extern void xdr_ioq_destroy(struct xdr_ioq *xioq, size_t qsize);
 extern void xdr_ioq_destroy_pool(struct poolq_head *ioqh);
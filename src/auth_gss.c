@@ -142,8 +142,16 @@ struct rpc_gss_data {
 	gss_ctx_id_t ctx;	/* context id */
 	struct rpc_gss_cred gc;	/* client credentials */
 	u_int win;		/* sequence window */
+	uint32_t inflight;	/* calls issued from an authgss_pool */
 	bool established;	/* context established */
 };
+
+struct authgss_pool {
+	uint32_t next;		/* rotates the starting member */
+	u_int count;
+	u_int max;
+	AUTH *auth[];
+};
 #define AUTH_PRIVATE(p) (opr_containerof((p), struct rpc_gss_data, gd_auth))
 
 /* retry timeout default to the moon and back */
@@ -152,7 +160,7 @@ static const struct timespec to = { 3, 0 };
 AUTH *
 authgss_ncreate(CLIENT *clnt, gss_name_t name, struct rpc_gss_sec *sec)
 {
-	struct rpc_gss_data *gd = mem_alloc(sizeof(*gd));
+	struct rpc_gss_data *gd = mem_zalloc(sizeof(*gd));
 	AUTH *auth = &gd->gd_auth;
 	OM_uint32 maj_stat;
 	OM_uint32 min_stat = 0;
@@ -232,6 +240,109 @@ authgss_ncreate_default(CLIENT *clnt, char *service,
 	return (auth);
 }
 
+/*
+ * Each established context has its own sequence space and replay window
+ * on the server.  A pool establishes several contexts for the same
+ * principal, and hands out the least loaded, so that concurrent callers
+ * need not share one window.  A member found unusable is refreshed by the
+ * usual AUTH_REFRESH() path.  Every member is attempted;  those that fail
+ * to establish are skipped, and the pool holds the remainder (NULL if none).
+ */
+struct authgss_pool *
+authgss_pool_ncreate(CLIENT *clnt, gss_name_t name, struct rpc_gss_sec *sec,
+		     u_int count)
+{
+	struct authgss_pool *pool;
+	AUTH *auth;
+	u_int ix;
+
+	__warnx(TIRPC_DEBUG_FLAG_RPCSEC_GSS, "%s() count %u",
+		__func__, count);
+
+	if (!count)
+		count = 1;
+
+	pool = mem_zalloc(sizeof(*pool) + count * sizeof(AUTH *));
+	pool->max = count;
+
+	for (ix = 0; ix < count; ++ix) {
+		auth = authgss_ncreate(clnt, name, sec);
+		if (!auth)
+			continue;
+		if (AUTH_FAILURE(auth)) {
+			/* not referenced;  try the rest */
+			authgss_destroy(auth);
+			continue;
+		}
+		pool->auth[pool->count++] = auth;
+	}
+
+	if (!pool->count) {
+		mem_free(pool, sizeof(*pool) + count * sizeof(AUTH *));
+		return (NULL);
+	}
+
+	if (pool->count < count) {
+		__warnx(TIRPC_DEBUG_FLAG_RPCSEC_GSS,
+			"%s() established %u of %u contexts",
+			__func__, pool->count, count);
+	}
+	return (pool);
+}
+
+/*
+ * Returns a referenced member, to be released with authgss_pool_put().
+ * Members with room left in their sequence window are preferred.
+ */
+AUTH *
+authgss_pool_get(struct authgss_pool *pool)
+{
+	struct rpc_gss_data *gd, *best = NULL;
+	uint32_t inflight, least = UINT32_MAX;
+	u_int start, ix;
+
+	start = atomic_inc_uint32_t(&pool->next) % pool->count;
+
+	for (ix = 0; ix < pool->count; ++ix) {
+		gd = AUTH_PRIVATE(pool->auth[(start + ix) % pool->count]);
+		inflight = atomic_fetch_uint32_t(&gd->inflight);
+		if (inflight < least) {
+			least = inflight;
+			best = gd;
+			if (!inflight)
+				break;
+		}
+	}
+
+	if (best->win && least >= best->win)
+		__warnx(TIRPC_DEBUG_FLAG_RPCSEC_GSS,
+			"%s() all %u contexts at window %u",
+			__func__, pool->count, best->win);
+
+	(void)atomic_inc_uint32_t(&best->inflight);
+	auth_get(&best->gd_auth);
+	return (&best->gd_auth);
+}
+
+void
+authgss_pool_put(struct authgss_pool *pool, AUTH *auth)
+{
+	struct rpc_gss_data *gd = AUTH_PRIVATE(auth);
+
+	(void)atomic_dec_uint32_t(&gd->inflight);
+	AUTH_DESTROY(auth);
+}
+
+void
+authgss_pool_destroy(struct authgss_pool *pool)
+{
+	u_int ix;
+
+	for (ix = 0; ix < pool->count; ++ix)
+		AUTH_DESTROY(pool->auth[ix]);
+	mem_free(pool, sizeof(*pool) + pool->max * sizeof(AUTH *));
+}
+
 bool
 authgss_get_private_data(AUTH *auth, struct authgss_private_data *pd)
 {
@@ -54,6 +54,8 @@
 #include <rpc/auth.h>
 #include <misc/opr.h>
 
+#include "lock_prof_internal.h"
+
 #define MAX_MARSHAL_SIZE 20
 
 /*
@@ -184,7 +186,7 @@ authnone_dummy(void)
 	extern mutex_t ops_lock; /* XXXX does this need to be extern? */
 
        /* VARIABLES PROTECTED BY ops_lock: ops */
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.ah_nextverf == NULL) {
 		ops.ah_nextverf = authnone_verf;
 		ops.ah_marshal = authnone_marshal;
@@ -194,7 +196,7 @@ authnone_dummy(void)
 		ops.ah_wrap = authnone_wrap;
 		ops.ah_unwrap = authnone_wrap;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	return (&ops);
 }
 
@@ -205,7 +207,7 @@ authnone_ops(void)
 	extern mutex_t ops_lock; /* XXXX does this need to be extern? */
 
        /* VARIABLES PROTECTED BY ops_lock: ops */
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.ah_nextverf == NULL) {
 		ops.ah_nextverf = authnone_verf;
 		ops.ah_marshal = authnone_marshal;
@@ -215,6 +217,6 @@ authnone_ops(void)
 		ops.ah_wrap = authnone_wrap;
 		ops.ah_unwrap = authnone_wrap;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	return (&ops);
 }
@@ -61,6 +61,8 @@
 #include <rpc/auth_inline.h>
 #include <rpc/auth_unix.h>
 
+#include "lock_prof_internal.h"
+
 /* auth_unix.c */
 static void authunix_nextverf(AUTH *);
 static bool authunix_marshal(AUTH *, XDR *);
@@ -346,7 +348,7 @@ authunix_ops(void)
 	extern mutex_t ops_lock; /* XXXX does it need to be extern? */
 
 	/* VARIABLES PROTECTED BY ops_lock: ops */
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.ah_nextverf == NULL) {
 		ops.ah_nextverf = authunix_nextverf;
 		ops.ah_marshal = authunix_marshal;
@@ -356,6 +358,6 @@ authunix_ops(void)
 		ops.ah_wrap = authunix_wrap;
 		ops.ah_unwrap = authunix_wrap;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	return (&ops);
 }
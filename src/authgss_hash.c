@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 #include <rpc/rpc.h>
 #include <rpc/types.h>
 #include "rpc_com.h"
@@ -39,13 +40,30 @@
 #include <rpc/svc_auth.h>
 #include <rpc/gss_internal.h>
 #include "svc_internal.h"
+#include "rpc_dplx_internal.h"
 
 /* GSS context cache */
 
+/* Lookups first probe the partition's read-through cache without
+ * taking any lock.  Readers announce themselves in one of two counters
+ * selected by the partition epoch; after unlinking an entry, writers
+ * flip the epoch and wait for the previous readers to drain before
+ * dropping the hash reference (see authgss_x_part_synchronize).
+ *
+ * Recency is approximated CLOCK-style:  a hit only marks the entry
+ * referenced, and the idle sweep gives marked entries a second chance.
+ */
 struct authgss_x_part {
-	uint32_t gen;
 	uint32_t size;
+	uint32_t epoch;
+	uint32_t readers[2];
 	 TAILQ_HEAD(ctx_tailq, svc_rpc_gss_data) lru_q;
+	struct {
+		/* binary min-heap on gd->endtime */
+		struct svc_rpc_gss_data **v;
+		uint32_t n;
+		uint32_t max;
+	} expq;
 };
 
 struct authgss_hash_st {
@@ -67,15 +85,17 @@ static struct authgss_hash_st authgss_hash_st = {
 	false			/* initialized */
 };
 
+/* SVC_CTL_GSS_CACHE_GET */
+static struct svc_gss_cache_stats authgss_hash_stats;
+
 static inline uint64_t
-gss_ctx_hash(gss_union_ctx_id_desc *gss_ctx)
+gss_ctx_hash(gss_ctx_id_t ctx)
 {
-	/* Mash together two pointers, can overflow top bit.
-	 * Our only concern here is that it be unique
-	 * (or have a very rare collision rate).
+	/* The context id, as issued in the handle, is unique among live
+	 * contexts.  A sum of the mechglue fields behind it was not:
+	 * allocator slots collide, and the layout differs by release.
 	 */
-	return ((uint64_t)(uintptr_t)gss_ctx->mech_type +
-		(uint64_t)(uintptr_t)gss_ctx->internal_ctx_id);
+	return ((uint64_t)(uintptr_t)ctx);
 }
 
 static int
@@ -140,35 +160,204 @@ authgss_hash_init()
 		} while (0); \
 	}
 
+/* A reader that counts itself only after the epoch has moved on may be
+ * missed by the synchronizer that flipped it, so it must try again
+ * under the new epoch.
+ */
+static inline uint32_t
+authgss_x_part_read_lock(struct authgss_x_part *axp)
+{
+	uint32_t epoch;
+	uint32_t ix;
+
+	for (;;) {
+		epoch = atomic_fetch_uint32_t(&axp->epoch);
+		ix = epoch & 1;
+		(void)atomic_inc_uint32_t(&axp->readers[ix]);
+		if (likely(atomic_fetch_uint32_t(&axp->epoch) == epoch))
+			return (ix);
+		(void)atomic_dec_uint32_t(&axp->readers[ix]);
+	}
+}
+
+static inline void
+authgss_x_part_read_unlock(struct authgss_x_part *axp, uint32_t ix)
+{
+	(void)atomic_dec_uint32_t(&axp->readers[ix]);
+}
+
+/* Wait out lock-free readers that may still see unlinked entries.
+ * Called without t->lock;  t->mtx serializes epoch flips.
+ */
+static void
+authgss_x_part_synchronize(struct rbtree_x_part *t)
+{
+	struct authgss_x_part *axp = (struct authgss_x_part *)t->u1;
+	uint32_t ix;
+
+	prof_mutex_lock(&t->mtx, "authgss_hash.xt.mtx");
+	ix = atomic_postinc_uint32_t(&axp->epoch) & 1;
+	while (atomic_fetch_uint32_t(&axp->readers[ix]))
+		sched_yield();
+	prof_mutex_unlock(&t->mtx);
+}
+
+/*
+ * Expiry heap.  Contexts are ordered by the endtime recorded when they
+ * were established, so the idle sweep need not consult the mechanism.
+ * Called with t->lock held for write.
+ */
+static inline void
+authgss_expq_set(struct authgss_x_part *axp, uint32_t ix,
+		 struct svc_rpc_gss_data *gd)
+{
+	axp->expq.v[ix] = gd;
+	gd->exp_ix = ix + 1;
+}
+
+static void
+authgss_expq_up(struct authgss_x_part *axp, uint32_t ix)
+{
+	struct svc_rpc_gss_data *gd = axp->expq.v[ix];
+	uint32_t parent;
+
+	while (ix > 0) {
+		parent = (ix - 1) / 2;
+		if (axp->expq.v[parent]->endtime <= gd->endtime)
+			break;
+		authgss_expq_set(axp, ix, axp->expq.v[parent]);
+		ix = parent;
+	}
+	authgss_expq_set(axp, ix, gd);
+}
+
+static void
+authgss_expq_down(struct authgss_x_part *axp, uint32_t ix)
+{
+	struct svc_rpc_gss_data *gd = axp->expq.v[ix];
+	uint32_t child;
+
+	while ((child = (2 * ix) + 1) < axp->expq.n) {
+		if (child + 1 < axp->expq.n
+		    && axp->expq.v[child + 1]->endtime
+		     < axp->expq.v[child]->endtime)
+			++child;
+		if (gd->endtime <= axp->expq.v[child]->endtime)
+			break;
+		authgss_expq_set(axp, ix, axp->expq.v[child]);
+		ix = child;
+	}
+	authgss_expq_set(axp, ix, gd);
+}
+
+static void
+authgss_expq_insert(struct authgss_x_part *axp, struct svc_rpc_gss_data *gd)
+{
+	if (axp->expq.n == axp->expq.max) {
+		axp->expq.max = axp->expq.max ? axp->expq.max * 2 : 64;
+		axp->expq.v = mem_realloc(axp->expq.v,
+					  axp->expq.max * sizeof(gd));
+	}
+	axp->expq.v[axp->expq.n] = gd;
+	authgss_expq_up(axp, axp->expq.n++);
+}
+
+static void
+authgss_expq_remove(struct authgss_x_part *axp, struct svc_rpc_gss_data *gd)
+{
+	struct svc_rpc_gss_data *last;
+	uint32_t ix = gd->exp_ix - 1;
+
+	if (!gd->exp_ix)
+		return;
+	gd->exp_ix = 0;
+
+	if (ix == --(axp->expq.n))
+		return;
+
+	/* refill the hole with the last entry and restore order */
+	last = axp->expq.v[axp->expq.n];
+	axp->expq.v[ix] = last;
+	authgss_expq_down(axp, ix);
+	authgss_expq_up(axp, last->exp_ix - 1);
+}
+
+/* unhash gd;  caller drops the sentinel ref after synchronizing */
+static void
+authgss_ctx_unlink(struct rbtree_x_part *t, struct svc_rpc_gss_data *gd)
+{
+	struct authgss_x_part *axp = (struct authgss_x_part *)t->u1;
+
+	rbtree_x_cached_remove(&authgss_hash_st.xt, t, &gd->node_k, gd->hk.k);
+	TAILQ_REMOVE(&axp->lru_q, gd, lru_q);
+	TAILQ_INIT_ENTRY(gd, lru_q);
+	authgss_expq_remove(axp, gd);
+	--(axp->size);
+
+	/* global size */
+	(void)atomic_dec_uint32_t(&authgss_hash_st.size);
+}
+
+static inline void
+authgss_ctx_referenced(struct svc_rpc_gss_data *gd)
+{
+	if (!(atomic_fetch_uint32_t(&gd->flags) & SVC_RPC_GSS_FLAG_REFERENCED))
+		(void)atomic_set_uint32_t_bits(&gd->flags,
+					       SVC_RPC_GSS_FLAG_REFERENCED);
+}
+
 struct svc_rpc_gss_data *
 authgss_ctx_hash_get(struct rpc_gss_cred *gc)
 {
 	struct svc_rpc_gss_data gk, *gd = NULL;
-	gss_union_ctx_id_desc *gss_ctx;
 	struct opr_rbtree_node *ngd;
 	struct authgss_x_part *axp;
 	struct rbtree_x_part *t;
+	gss_ctx_id_t ctx;
+	uint32_t ix;
 
 	cond_init_authgss_hash();
 
-	gss_ctx = (gss_union_ctx_id_desc *) (gc->gc_ctx.value);
-	gk.hk.k = gss_ctx_hash(gss_ctx);
+	if (gc->gc_ctx.length != sizeof(ctx))
+		return (NULL);
+	memcpy(&ctx, gc->gc_ctx.value, sizeof(ctx));
+	gk.hk.k = gss_ctx_hash(ctx);
 
 	t = rbtx_partition_of_scalar(&authgss_hash_st.xt, gk.hk.k);
-	mutex_lock(&t->mtx);
-	ngd =
-	    rbtree_x_cached_lookup(&authgss_hash_st.xt, t, &gk.node_k, gk.hk.k);
-	if (ngd) {
+	axp = (struct authgss_x_part *)t->u1;
+
+	/* lock-free fast path */
+	ix = authgss_x_part_read_lock(axp);
+	ngd = atomic_fetch_voidptr((void **)&t->cache[gk.hk.k %
+						      authgss_hash_st.xt.cachesz]);
+	if (ngd && svc_rpc_gss_cmpf(ngd, &gk.node_k) == 0) {
 		gd = opr_containerof(ngd, struct svc_rpc_gss_data, node_k);
-		/* lru adjust */
-		axp = (struct authgss_x_part *)t->u1;
-		TAILQ_REMOVE(&axp->lru_q, gd, lru_q);
-		TAILQ_INSERT_TAIL(&axp->lru_q, gd, lru_q);
-		++(axp->gen);
 		(void)atomic_inc_uint32_t(&gd->refcnt);
+	}
+	authgss_x_part_read_unlock(axp, ix);
+
+	if (gd)
+		rpc_dplx_stat_inc(&authgss_hash_stats.hits);
+
+	if (!gd) {
+		prof_rwlock_rdlock(&t->lock, "authgss_hash.xt");
+		ngd = rbtree_x_cached_lookup(&authgss_hash_st.xt, t,
+					     &gk.node_k, gk.hk.k);
+		if (ngd) {
+			gd = opr_containerof(ngd, struct svc_rpc_gss_data,
+					     node_k);
+			(void)atomic_inc_uint32_t(&gd->refcnt);
+		}
+		prof_rwlock_unlock(&t->lock);
+		rpc_dplx_stat_inc(gd ? &authgss_hash_stats.tree_hits
+				     : &authgss_hash_stats.misses);
+	}
+
+	if (gd) {
+		/* lru adjust */
+		authgss_ctx_referenced(gd);
 		(void)atomic_inc_uint32_t(&gd->gen);
 	}
-	mutex_unlock(&t->mtx);
 
 	return (gd);
 }
@@ -178,28 +367,28 @@ authgss_ctx_hash_set(struct svc_rpc_gss_data *gd)
 {
 	struct rbtree_x_part *t;
 	struct authgss_x_part *axp;
-	gss_union_ctx_id_desc *gss_ctx;
 	bool rslt;
 
 	cond_init_authgss_hash();
 
-	gss_ctx = (gss_union_ctx_id_desc *) (gd->ctx);
-	gd->hk.k = gss_ctx_hash(gss_ctx);
+	gd->hk.k = gss_ctx_hash(gd->ctx);
 
 	(void)atomic_inc_uint32_t(&gd->refcnt);
 	t = rbtx_partition_of_scalar(&authgss_hash_st.xt, gd->hk.k);
-	mutex_lock(&t->mtx);
+	prof_rwlock_wrlock(&t->lock, "authgss_hash.xt");
 	rslt =
 	    rbtree_x_cached_insert(&authgss_hash_st.xt, t, &gd->node_k,
 				   gd->hk.k);
 	/* lru */
 	axp = (struct authgss_x_part *)t->u1;
 	TAILQ_INSERT_TAIL(&axp->lru_q, gd, lru_q);
+	authgss_expq_insert(axp, gd);
 	++(axp->size);
-	mutex_unlock(&t->mtx);
+	prof_rwlock_unlock(&t->lock);
 
 	/* global size */
 	(void)atomic_inc_uint32_t(&authgss_hash_st.size);
+	rpc_dplx_stat_inc(&authgss_hash_stats.inserts);
 
 	return (rslt);
 }
@@ -208,12 +397,11 @@ bool
 authgss_ctx_hash_del(struct svc_rpc_gss_data *gd)
 {
 	struct rbtree_x_part *t;
-	struct authgss_x_part *axp;
 
 	cond_init_authgss_hash();
 
 	t = rbtx_partition_of_scalar(&authgss_hash_st.xt, gd->hk.k);
-	mutex_lock(&t->mtx);
+	prof_rwlock_wrlock(&t->lock, "authgss_hash.xt");
 
 	/* Another thread could have removed the entry from the hash.
 	 * We use its presence in the lru list to detect this. @todo:
@@ -223,36 +411,21 @@ authgss_ctx_hash_del(struct svc_rpc_gss_data *gd)
 	 * the hash as well?
 	 */
 	if (!TAILQ_IS_ENQUEUED(gd, lru_q)) {
-		mutex_unlock(&t->mtx);
+		prof_rwlock_unlock(&t->lock);
 		return false;
 	}
 
-	rbtree_x_cached_remove(&authgss_hash_st.xt, t, &gd->node_k, gd->hk.k);
-	axp = (struct authgss_x_part *)t->u1;
-	TAILQ_REMOVE(&axp->lru_q, gd, lru_q);
-	TAILQ_INIT_ENTRY(gd, lru_q);
-	--(axp->size);
-	mutex_unlock(&t->mtx);
+	authgss_ctx_unlink(t, gd);
+	prof_rwlock_unlock(&t->lock);
+	rpc_dplx_stat_inc(&authgss_hash_stats.deletes);
 
-	/* global size */
-	(void)atomic_dec_uint32_t(&authgss_hash_st.size);
-
-	/* release gd */
+	/* release gd once no lock-free reader can reach it */
+	authgss_x_part_synchronize(t);
 	unref_svc_rpc_gss_data(gd, SVC_RPC_GSS_FLAG_NONE);
 
 	return (true);
 }
 
-static inline bool
-authgss_ctx_expired(struct svc_rpc_gss_data *gd)
-{
-	OM_uint32 maj_stat, min_stat;
-	maj_stat =
-	    gss_inquire_context(&min_stat, gd->ctx, NULL, NULL, NULL, NULL,
-				NULL, NULL, NULL);
-	return (maj_stat == GSS_S_CONTEXT_EXPIRED);
-}
-
 static uint32_t idle_next;
 
 #define IDLE_NEXT() \
@@ -262,8 +435,9 @@ void authgss_ctx_gc_idle(void)
 {
 	struct rbtree_x_part *xp;
 	struct authgss_x_part *axp;
-	struct svc_rpc_gss_data *gd;
-	int ix, cnt, part;
+	struct svc_rpc_gss_data *gd, *reap;
+	int64_t now = get_time_fast();
+	int ix, cnt, part, scan;
 
 	cond_init_authgss_hash();
 
@@ -273,36 +447,77 @@ void authgss_ctx_gc_idle(void)
 	     ++ix, part = IDLE_NEXT()) {
 		xp = &(authgss_hash_st.xt.tree[part]);
 		axp = (struct authgss_x_part *)xp->u1;
-		mutex_lock(&xp->mtx);
- again:
-		gd = TAILQ_FIRST(&axp->lru_q);
-		if (!gd)
-			goto next_t;
-
-		/* Remove the least-recently-used entry in this hash
-		 * partition iff it is expired, or the partition size
-		 * limit is exceeded */
-		if (unlikely((axp->size > authgss_hash_st.max_part)
-				|| (authgss_ctx_expired(gd)))) {
-
-			/* remove entry */
-			rbtree_x_cached_remove(&authgss_hash_st.xt, xp,
-					       &gd->node_k, gd->hk.k);
-			TAILQ_REMOVE(&axp->lru_q, gd, lru_q);
-			TAILQ_INIT_ENTRY(gd, lru_q);
-			--(axp->size);
-			(void)atomic_dec_uint32_t(&authgss_hash_st.size);
-
-			/* drop sentinel ref (may free gd) */
-			unref_svc_rpc_gss_data(gd, SVC_RPC_GSS_FLAG_NONE);
-
-			if (++cnt < __svc_params->gss.max_gc)
-				goto again;
+		reap = NULL;
+		scan = 0;
+		prof_rwlock_wrlock(&xp->lock, "authgss_hash.xt");
+
+		/* Remove expired entries in this hash partition, soonest
+		 * first */
+		while (axp->expq.n && (cnt < __svc_params->gss.max_gc)) {
+			gd = axp->expq.v[0];
+			if (gd->endtime > now)
+				break;
+			authgss_ctx_unlink(xp, gd);
+			gd->gc_next = reap;
+			reap = gd;
+			++cnt;
+			rpc_dplx_stat_inc(&authgss_hash_stats.expired);
+		}
+
+		/* Then least-recently-used entries while the partition
+		 * size limit is exceeded.  Referenced entries get a second
+		 * chance at the tail (once around the partition). */
+		while ((axp->size > authgss_hash_st.max_part)
+		       && (cnt < __svc_params->gss.max_gc)) {
+			gd = TAILQ_FIRST(&axp->lru_q);
+			if ((gd->flags & SVC_RPC_GSS_FLAG_REFERENCED)
+			    && (++scan <= axp->size)) {
+				(void)atomic_clear_uint32_t_bits(&gd->flags,
+						SVC_RPC_GSS_FLAG_REFERENCED);
+				TAILQ_REMOVE(&axp->lru_q, gd, lru_q);
+				TAILQ_INSERT_TAIL(&axp->lru_q, gd, lru_q);
+				continue;
+			}
+			authgss_ctx_unlink(xp, gd);
+			gd->gc_next = reap;
+			reap = gd;
+			++cnt;
+			rpc_dplx_stat_inc(&authgss_hash_stats.evicted);
+		}
+		prof_rwlock_unlock(&xp->lock);
+
+		/* defer sentinel refs until readers drain */
+		if (reap) {
+			authgss_x_part_synchronize(xp);
+			while ((gd = reap)) {
+				reap = gd->gc_next;
+				/* drop sentinel ref (may free gd) */
+				unref_svc_rpc_gss_data(gd,
+						       SVC_RPC_GSS_FLAG_NONE);
+			}
 		}
- next_t:
-		mutex_unlock(&xp->mtx);
 	}
 
 	/* perturb by 1 */
 	(void)IDLE_NEXT();
 }
+
+bool
+authgss_ctx_hash_stats(struct svc_gss_cache_stats *out)
+{
+	struct svc_gss_cache_stats *stats = &authgss_hash_stats;
+
+	cond_init_authgss_hash();
+
+	out->hits = atomic_fetch_uint64_t(&stats->hits);
+	out->tree_hits = atomic_fetch_uint64_t(&stats->tree_hits);
+	out->misses = atomic_fetch_uint64_t(&stats->misses);
+	out->inserts = atomic_fetch_uint64_t(&stats->inserts);
+	out->deletes = atomic_fetch_uint64_t(&stats->deletes);
+	out->expired = atomic_fetch_uint64_t(&stats->expired);
+	out->evicted = atomic_fetch_uint64_t(&stats->evicted);
+	out->size = atomic_fetch_uint32_t(&authgss_hash_st.size);
+	out->max = authgss_hash_st.max_part * authgss_hash_st.xt.npart;
+	out->partitions = authgss_hash_st.xt.npart;
+	return (true);
+}
@@ -44,7 +44,13 @@
 #include <rpc/auth.h>
 #include <rpc/auth_gss.h>
 #include <rpc/rpc.h>
+#include <rpc/xdr_ioq.h>
 #include <gssapi/gssapi.h>
+#ifdef HAVE_GSS_IOV
+#include <gssapi/gssapi_ext.h>
+#include <rpc/svc_auth.h>
+#include <rpc/gss_internal.h>
+#endif
 
 /* additional space needed for encoding */
 #define RPC_SLACK_SPACE 1024
@@ -73,11 +79,15 @@ xdr_rpc_gss_encode(XDR *xdrs, gss_buffer_t buf, u_int maxsize)
 bool
 xdr_rpc_gss_decode(XDR *xdrs, gss_buffer_t buf)
 {
+	u_int arena = xdrs->x_flags & XDR_FLAG_ARENA;
 	u_int tmplen = 0;
 	bool xdr_stat;
 
+	/* released by gss_release_buffer(), never from the arena */
+	xdrs->x_flags &= ~XDR_FLAG_ARENA;
 	xdr_stat = xdr_bytes_decode(xdrs, (char **)&buf->value, &tmplen,
 					   UINT_MAX);
+	xdrs->x_flags |= arena;
 
 	if (xdr_stat)
 		buf->length = tmplen;
@@ -169,6 +179,229 @@ xdr_rpc_gss_init_res(XDR *xdrs, struct rpc_gss_init_res *p)
 	return (xdr_stat);
 }
 
+#ifdef HAVE_GSS_IOV
+/* segments described on the stack before falling back to the heap */
+#define AUTHGSS_IOV_STACK 16
+
+/*
+ * Describe the encoded stream bytes [start, end) as GSS data buffers,
+ * leaving lead and trail free slots around them.  The returned vector
+ * is either iov_s, or allocated (*niov entries) and must be freed.
+ */
+static gss_iov_buffer_desc *
+xdr_rpc_gss_iov(XDR *xdrs, u_int start, u_int end, int lead, int trail,
+		gss_iov_buffer_desc *iov_s, int *niov)
+{
+	xdr_vio vio_s[AUTHGSS_IOV_STACK];
+	xdr_vio *vio = vio_s;
+	gss_iov_buffer_desc *iov = iov_s;
+	int count, ix;
+
+	count = xdr_ioq_vio(xdrs, start, end, vio, AUTHGSS_IOV_STACK);
+	if (!count)
+		return (NULL);
+
+	if (count > AUTHGSS_IOV_STACK) {
+		vio = mem_alloc(count * sizeof(xdr_vio));
+		(void)xdr_ioq_vio(xdrs, start, end, vio, count);
+	}
+
+	*niov = lead + count + trail;
+	if (*niov > AUTHGSS_IOV_STACK)
+		iov = mem_zalloc(*niov * sizeof(gss_iov_buffer_desc));
+	else
+		memset(iov, 0, *niov * sizeof(gss_iov_buffer_desc));
+
+	for (ix = 0; ix < count; ++ix) {
+		iov[lead + ix].type = GSS_IOV_BUFFER_TYPE_DATA;
+		iov[lead + ix].buffer.value = vio[ix].vio_head;
+		iov[lead + ix].buffer.length =
+			(uintptr_t)vio[ix].vio_tail
+			- (uintptr_t)vio[ix].vio_head;
+	}
+
+	if (vio != vio_s)
+		mem_free(vio, count * sizeof(xdr_vio));
+	return (iov);
+}
+
+static bool
+xdr_rpc_gss_zero(XDR *xdrs, u_int len)
+{
+	static const char zero[64];
+	u_int delta;
+
+	while (len > 0) {
+		delta = (len < sizeof(zero)) ? len : sizeof(zero);
+		if (!XDR_PUTBYTES(xdrs, zero, delta))
+			return (FALSE);
+		len -= delta;
+	}
+	return (TRUE);
+}
+
+static inline void
+xdr_rpc_gss_iov_free(gss_iov_buffer_desc *iov, gss_iov_buffer_desc *iov_s,
+		     int niov)
+{
+	OM_uint32 min_stat;
+
+	(void)gss_release_iov_buffer(&min_stat, iov, niov);
+	if (iov != iov_s)
+		mem_free(iov, niov * sizeof(gss_iov_buffer_desc));
+}
+
+/*
+ * Wrap rpc_gss_data_t in place, over the segments of an xdr_ioq stream,
+ * so large replies need not be encoded into one contiguous buffer.
+ *
+ * For privacy, room for the wrap token header is reserved ahead of the
+ * data;  the data is encrypted in place (after copying any segments
+ * spliced from the caller), and the padding and trailer are appended,
+ * so the body is the usual contiguous token on the wire.
+ *
+ * Marshalling and sealing are separate steps, so that the (expensive)
+ * sealing of a large body may be handed to another thread after the
+ * results have been encoded.
+ */
+bool
+xdr_rpc_gss_wrap_marshal(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
+			 gss_ctx_id_t ctx, gss_qop_t qop, rpc_gss_svc_t svc,
+			 u_int seq, struct rpc_gss_wrap_iov *wi)
+{
+	gss_iov_buffer_desc hdr[4];
+	OM_uint32 maj_stat, min_stat;
+	int conf_state;
+
+	wi->svc = svc;
+	wi->hdrlen = 0;
+
+	/* Write dummy for databody length. */
+	wi->start = XDR_GETPOS(xdrs);
+	if (!XDR_PUTUINT32(xdrs, 0xaaaaaaaa))
+		return (FALSE);
+
+	if (svc == RPCSEC_GSS_SVC_PRIVACY) {
+		/* Reserve the wrap token header (fixed by mechanism). */
+		memset(hdr, 0, sizeof(hdr));
+		hdr[0].type = GSS_IOV_BUFFER_TYPE_HEADER;
+		hdr[1].type = GSS_IOV_BUFFER_TYPE_DATA;
+		hdr[2].type = GSS_IOV_BUFFER_TYPE_PADDING;
+		hdr[3].type = GSS_IOV_BUFFER_TYPE_TRAILER;
+		maj_stat = gss_wrap_iov_length(&min_stat, ctx, TRUE, qop,
+					       &conf_state, hdr, 4);
+		if (maj_stat != GSS_S_COMPLETE) {
+			gss_log_status("gss_wrap_iov_length", maj_stat,
+				       min_stat);
+			return (FALSE);
+		}
+		wi->hdrlen = hdr[0].buffer.length;
+		if (!xdr_rpc_gss_zero(xdrs, wi->hdrlen))
+			return (FALSE);
+	}
+	wi->data = XDR_GETPOS(xdrs);
+
+	/* Marshal rpc_gss_data_t (sequence number + arguments). */
+	if (!XDR_PUTUINT32(xdrs, seq) || !(*xdr_func) (xdrs, xdr_ptr))
+		return (FALSE);
+	wi->end = XDR_GETPOS(xdrs);
+	return (TRUE);
+}
+
+bool
+xdr_rpc_gss_wrap_seal(XDR *xdrs, gss_ctx_id_t ctx, gss_qop_t qop,
+		      struct rpc_gss_wrap_iov *wi)
+{
+	gss_iov_buffer_desc iov_s[AUTHGSS_IOV_STACK];
+	gss_iov_buffer_desc *iov;
+	OM_uint32 maj_stat, min_stat;
+	u_int start = wi->start, data = wi->data, end = wi->end;
+	u_int hdrlen = wi->hdrlen, wraplen;
+	int conf_state, niov;
+	bool xdr_stat;
+
+	if (wi->svc == RPCSEC_GSS_SVC_INTEGRITY) {
+		iov = xdr_rpc_gss_iov(xdrs, data, end, 0, 1, iov_s, &niov);
+		if (!iov)
+			return (FALSE);
+		iov[niov - 1].type = GSS_IOV_BUFFER_TYPE_MIC_TOKEN
+				   | GSS_IOV_BUFFER_FLAG_ALLOCATE;
+
+		/* Checksum rpc_gss_data_t. */
+		maj_stat = gss_get_mic_iov(&min_stat, ctx, qop, iov, niov);
+		if (maj_stat != GSS_S_COMPLETE) {
+			gss_log_status("gss_get_mic_iov", maj_stat,
+				       min_stat);
+			xdr_rpc_gss_iov_free(iov, iov_s, niov);
+			return (FALSE);
+		}
+
+		/* Marshal databody_integ length, then checksum. */
+		xdr_stat = XDR_SETPOS(xdrs, start)
+			&& XDR_PUTUINT32(xdrs, end - data)
+			&& XDR_SETPOS(xdrs, end)
+			&& xdr_rpc_gss_encode(xdrs, &iov[niov - 1].buffer,
+					      iov[niov - 1].buffer.length
+					      + RPC_SLACK_SPACE);
+		xdr_rpc_gss_iov_free(iov, iov_s, niov);
+	} else {
+		/* never encrypt buffers spliced from the caller */
+		xdr_ioq_unsplice(xdrs, data, end);
+		iov = xdr_rpc_gss_iov(xdrs, data, end, 1, 2, iov_s, &niov);
+		if (!iov)
+			return (FALSE);
+		iov[0].type = GSS_IOV_BUFFER_TYPE_HEADER
+			    | GSS_IOV_BUFFER_FLAG_ALLOCATE;
+		iov[niov - 2].type = GSS_IOV_BUFFER_TYPE_PADDING
+				   | GSS_IOV_BUFFER_FLAG_ALLOCATE;
+		iov[niov - 1].type = GSS_IOV_BUFFER_TYPE_TRAILER
+				   | GSS_IOV_BUFFER_FLAG_ALLOCATE;
+
+		/* Encrypt rpc_gss_data_t in place. */
+		maj_stat = gss_wrap_iov(&min_stat, ctx, TRUE, qop, &conf_state,
+					iov, niov);
+		if (maj_stat != GSS_S_COMPLETE
+		 || iov[0].buffer.length != hdrlen) {
+			gss_log_status("gss_wrap_iov", maj_stat, min_stat);
+			xdr_rpc_gss_iov_free(iov, iov_s, niov);
+			return (FALSE);
+		}
+
+		/* Marshal databody_priv:  header, data, padding, trailer. */
+		wraplen = hdrlen + (end - data)
+			+ iov[niov - 2].buffer.length
+			+ iov[niov - 1].buffer.length;
+		xdr_stat = XDR_SETPOS(xdrs, start)
+			&& XDR_PUTUINT32(xdrs, wraplen)
+			&& XDR_PUTBYTES(xdrs, iov[0].buffer.value, hdrlen)
+			&& XDR_SETPOS(xdrs, end)
+			&& XDR_PUTBYTES(xdrs, iov[niov - 2].buffer.value,
+					iov[niov - 2].buffer.length)
+			&& XDR_PUTBYTES(xdrs, iov[niov - 1].buffer.value,
+					iov[niov - 1].buffer.length)
+			&& xdr_rpc_gss_zero(xdrs, RNDUP(wraplen) - wraplen);
+		xdr_rpc_gss_iov_free(iov, iov_s, niov);
+	}
+
+	if (!xdr_stat) {
+		__warnx(TIRPC_DEBUG_FLAG_RPCSEC_GSS, "%s() failed", __func__);
+	}
+	return (xdr_stat);
+}
+
+static bool
+xdr_rpc_gss_wrap_iov(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
+		     gss_ctx_id_t ctx, gss_qop_t qop, rpc_gss_svc_t svc,
+		     u_int seq)
+{
+	struct rpc_gss_wrap_iov wi;
+
+	return (xdr_rpc_gss_wrap_marshal(xdrs, xdr_func, xdr_ptr, ctx, qop,
+					 svc, seq, &wi)
+		&& xdr_rpc_gss_wrap_seal(xdrs, ctx, qop, &wi));
+}
+#endif /* HAVE_GSS_IOV */
+
 bool
 xdr_rpc_gss_wrap(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
 		 gss_ctx_id_t ctx, gss_qop_t qop, rpc_gss_svc_t svc, u_int seq)
@@ -179,6 +412,14 @@ xdr_rpc_gss_wrap(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
 	bool xdr_stat;
 	u_int databuflen, maxwrapsz;
 
+#ifdef HAVE_GSS_IOV
+	if (xdrs->x_ops == &xdr_ioq_ops
+	 && (svc == RPCSEC_GSS_SVC_INTEGRITY
+	  || svc == RPCSEC_GSS_SVC_PRIVACY))
+		return (xdr_rpc_gss_wrap_iov(xdrs, xdr_func, xdr_ptr, ctx,
+					     qop, svc, seq));
+#endif
+
 	/* Write dummy for databody length. */
 	start = XDR_GETPOS(xdrs);
 	databuflen = 0xaaaaaaaa;	/* should always overwrite */
@@ -341,6 +582,8 @@ xdr_rpc_gss_unwrap(XDR *xdrs, xdrproc_t xdr_func, void *xdr_ptr,
 	}
 	/* Decode rpc_gss_data_t (sequence number + arguments). */
 	xdrmem_create(&tmpxdrs, databuf.value, databuf.length, XDR_DECODE);
+	if (xdrs->x_flags & XDR_FLAG_ARENA)
+		xdr_arena_attach(&tmpxdrs, xdrs->x_lib[0]);
 	xdr_stat = (XDR_GETUINT32(&tmpxdrs, &seq_num)
 		    && (*xdr_func) (&tmpxdrs, xdr_ptr));
 	XDR_DESTROY(&tmpxdrs);
@@ -54,12 +54,17 @@
 #include <reentrant.h>
 #include <rpc/rpc.h>
 #include <rpc/svc_rqst.h>
+#include <rpc/xdr_ioq.h>
 #include "rpc_com.h"
 #include "clnt_internal.h"
 #include "svc_internal.h"
+#include "rpc_probe.h"
 
 #define MAX_DEFAULT_FDS                 20000
 
+/* a maximal datagram spans at most 9 RPC_MAXDATA_DEFAULT segments */
+#define CLNT_DG_MAXIOV                  16
+
 static enum xprt_stat clnt_dg_rendezvous(SVCXPRT *xprt);
 static struct clnt_ops *clnt_dg_ops(void);
 
@@ -217,19 +222,27 @@ clnt_dg_call(struct clnt_req *cc)
 	XDR *xdrs;
 	u_int32_t *uint32p;
 	size_t outlen;
-
-	/* XXX Until gss_get_mic and gss_wrap can be replaced with
-	 * iov equivalents, replies with RPCSEC_GSS security must be
-	 * encoded in a contiguous buffer.
+	xdr_vio vio[CLNT_DG_MAXIOV];
+	struct iovec iov[CLNT_DG_MAXIOV];
+	struct msghdr msg;
+	int count, ix;
+
+	/* Unless gss_get_mic_iov and gss_wrap_iov are available,
+	 * replies with RPCSEC_GSS security must be encoded in a
+	 * contiguous buffer.
 	 *
 	 * Nb, we should probably use getpagesize() on Unix.  Need
 	 * an equivalent for Windows.
 	 */
 	xioq = xdr_ioq_create(RPC_MAXDATA_DEFAULT,
 			      __svc_params->ioq.send_max + RPC_MAXDATA_DEFAULT,
+#ifdef HAVE_GSS_IOV
+			      UIO_FLAG_FREE);
+#else
 			      (cc->cc_auth->ah_cred.oa_flavor == RPCSEC_GSS)
 			      ? UIO_FLAG_REALLOC | UIO_FLAG_FREE
 			      : UIO_FLAG_FREE);
+#endif
 
 	xdrs = xioq->xdrs;
 	cc->cc_error.re_status = RPC_SUCCESS;
@@ -252,10 +265,31 @@ clnt_dg_call(struct clnt_req *cc)
 		return (RPC_CANTENCODEARGS);
 	}
 	outlen = (size_t) XDR_GETPOS(xdrs);
+	RPC_PROBE5(clnt_call, cc->cc_xid, xprt->xp_fd, ntohl(uint32p[3]),
+		   ntohl(uint32p[4]), cc->cc_proc);
 	mutex_unlock(&clnt->cl_lock);
 
-	if (sendto(xprt->xp_fd, xdrs->x_v.vio_head, outlen, 0,
-		   (struct sockaddr *)&cu->cu_raddr, cu->cu_rlen) != outlen) {
+	/* the call may span several buffer segments */
+	count = xdr_ioq_vio(xdrs, 0, outlen, vio, CLNT_DG_MAXIOV);
+	if (!count || count > CLNT_DG_MAXIOV) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: fd %d call too large (%zu)\n",
+			__func__, xprt->xp_fd, outlen);
+		XDR_DESTROY(xdrs);
+		return (RPC_CANTSEND);
+	}
+	for (ix = 0; ix < count; ++ix) {
+		iov[ix].iov_base = vio[ix].vio_head;
+		iov[ix].iov_len = (uintptr_t)vio[ix].vio_tail
+				- (uintptr_t)vio[ix].vio_head;
+	}
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = &cu->cu_raddr;
+	msg.msg_namelen = cu->cu_rlen;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	if (sendmsg(xprt->xp_fd, &msg, 0) != outlen) {
 		clnt->cl_error.re_errno = errno;
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s: fd %d sendto failed (%d)\n",
@@ -421,7 +455,7 @@ clnt_dg_ops(void)
 	/* VARIABLES PROTECTED BY ops_lock: ops */
 	sigfillset(&newmask);
 	thr_sigsetmask(SIG_SETMASK, &newmask, &mask);
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.cl_call == NULL) {
 		ops.cl_call = clnt_dg_call;
 		ops.cl_abort = clnt_dg_abort;
@@ -429,7 +463,7 @@ clnt_dg_ops(void)
 		ops.cl_destroy = clnt_dg_destroy;
 		ops.cl_control = clnt_dg_control;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	thr_sigsetmask(SIG_SETMASK, &mask, NULL);
 	return (&ops);
 }
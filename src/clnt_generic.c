@@ -48,6 +48,7 @@
 
 #include "rpc_com.h"
 #include "clnt_internal.h"
+#include "rpc_probe.h"
 
 int __rpc_raise_fd(int);
 
@@ -560,16 +561,22 @@ clnt_req_process_reply(SVCXPRT *xprt, struct svc_req *req)
 
 	if (atomic_postset_uint16_t_bits(&cc->cc_flags, CLNT_REQ_FLAG_ACKSYNC)
 	    & (CLNT_REQ_FLAG_ACKSYNC | CLNT_REQ_FLAG_BACKSYNC)) {
-		__warnx(TIRPC_DEBUG_FLAG_CLNT_REQ,
-			"%s: %p fd %d xid %" PRIu32 " ignored=%d",
-			__func__, xprt, xprt->xp_fd, cc->cc_xid,
-			cc->cc_error.re_status);
+		__tracex(TIRPC_DEBUG_FLAG_CLNT_REQ,
+			 TIRPC_TRACE_CLNT_REQ_IGNORED,
+			 xprt, xprt->xp_fd, cc->cc_xid,
+			 cc->cc_error.re_status, 0);
 		cc->cc_refreshes = 0;
 		return SVC_STAT(xprt);
 	}
 
 	_seterr_reply(&req->rq_msg, &(cc->cc_error));
 	if (cc->cc_error.re_status == RPC_SUCCESS) {
+		struct opaque_auth *verf = &req->rq_msg.RPCM_ack.ar_verf;
+
+		/* the verifier as received (length checked by decode) */
+		cc->cc_verf.oa_flavor = verf->oa_flavor;
+		cc->cc_verf.oa_length = verf->oa_length;
+		memcpy(cc->cc_verf.oa_body, verf->oa_body, verf->oa_length);
 		if (!AUTH_VALIDATE(cc->cc_auth, &(cc->cc_verf))) {
 			cc->cc_error.re_status = RPC_AUTHERROR;
 			cc->cc_error.re_why = AUTH_INVALIDRESP;
@@ -583,10 +590,10 @@ clnt_req_process_reply(SVCXPRT *xprt, struct svc_req *req)
 		cc->cc_refreshes = 0;
 	}
 
-	__warnx(TIRPC_DEBUG_FLAG_CLNT_REQ,
-		"%s: %p fd %d xid %" PRIu32 " result=%d",
-		__func__, xprt, xprt->xp_fd, cc->cc_xid,
-		cc->cc_error.re_status);
+	__tracex(TIRPC_DEBUG_FLAG_CLNT_REQ, TIRPC_TRACE_CLNT_REQ_RESULT,
+		 xprt, xprt->xp_fd, cc->cc_xid, cc->cc_error.re_status, 0);
+	RPC_PROBE4(clnt_reply, cc->cc_xid, xprt->xp_fd, cc->cc_proc,
+		   cc->cc_error.re_status);
 
 	(*cc->cc_process_cb)(cc);
 	return SVC_STAT(xprt);
@@ -600,10 +607,9 @@ clnt_req_wait_reply(struct clnt_req *cc)
 	struct timespec ts;
 	int code;
 
-	__warnx(TIRPC_DEBUG_FLAG_CLNT_REQ,
-		"%s: %p fd %d xid %" PRIu32 " (%ld.%09ld)",
-		__func__, &rec->xprt, rec->xprt.xp_fd, cc->cc_xid,
-		cc->cc_timeout.tv_sec, cc->cc_timeout.tv_nsec);
+	__tracex(TIRPC_DEBUG_FLAG_CLNT_REQ, TIRPC_TRACE_CLNT_REQ_WAIT,
+		 &rec->xprt, rec->xprt.xp_fd, cc->cc_xid,
+		 cc->cc_timeout.tv_sec, cc->cc_timeout.tv_nsec);
 
  call_again:
 	cc->cc_error.re_status = CLNT_CALL_ONCE(cc);
@@ -619,9 +625,8 @@ clnt_req_wait_reply(struct clnt_req *cc)
 	timespecadd(&ts, &cc->cc_timeout);
 	code = cond_timedwait(&cc->cc_we.cv, &cc->cc_we.mtx, &ts);
 
-	__warnx(TIRPC_DEBUG_FLAG_CLNT_REQ,
-		"%s: %p fd %d replied xid %" PRIu32,
-		__func__, &rec->xprt, rec->xprt.xp_fd, cc->cc_xid);
+	__tracex(TIRPC_DEBUG_FLAG_CLNT_REQ, TIRPC_TRACE_CLNT_REQ_REPLIED,
+		 &rec->xprt, rec->xprt.xp_fd, cc->cc_xid, 0, 0);
 
 	if (!(atomic_fetch_uint16_t(&cc->cc_flags) & CLNT_REQ_FLAG_ACKSYNC)
 	 && (code == ETIMEDOUT)) {
@@ -648,6 +653,8 @@ clnt_req_wait_reply(struct clnt_req *cc)
 	}
 	if (code == ETIMEDOUT) {
 		/* We have refreshed/retried, just log it */
+		RPC_PROBE3(clnt_expire, cc->cc_xid, rec->xprt.xp_fd,
+			   cc->cc_proc);
 		__warnx(TIRPC_DEBUG_FLAG_CLNT_DG,
 			"%s: %p fd %d ETIMEDOUT",
 			__func__, &rec->xprt, rec->xprt.xp_fd);
@@ -240,7 +240,7 @@ clnt_raw_ops(void)
 
 	/* VARIABLES PROTECTED BY ops_lock: ops */
 
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.cl_call == NULL) {
 		ops.cl_call = clnt_raw_call;
 		ops.cl_abort = clnt_raw_abort;
@@ -248,6 +248,6 @@ clnt_raw_ops(void)
 		ops.cl_destroy = clnt_raw_destroy;
 		ops.cl_control = clnt_raw_control;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	return (&ops);
 }
@@ -332,7 +332,7 @@ clnt_rdma_ops(void)
 
 	sigfillset(&newmask);
 	thr_sigsetmask(SIG_SETMASK, &newmask, &mask);
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.cl_call == NULL) {
 		ops.cl_call = clnt_rdma_call;
 		ops.cl_abort = clnt_rdma_abort;
@@ -340,7 +340,7 @@ clnt_rdma_ops(void)
 		ops.cl_destroy = clnt_rdma_destroy;
 		ops.cl_control = clnt_rdma_control;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	thr_sigsetmask(SIG_SETMASK, &mask, NULL);
 	return (&ops);
 }
@@ -74,6 +74,7 @@
 #include "svc_ioq.h"
 #include "clnt_internal.h"
 #include "svc_internal.h"
+#include "rpc_probe.h"
 
 static enum xprt_stat clnt_vc_process(struct svc_req *req);
 static struct clnt_ops *clnt_vc_ops(void);
@@ -125,6 +126,59 @@ clnt_vc_data_zalloc(void)
  *      server tranpsorts sharing an underlying bytestream (Matt).
  */
 
+/*
+ * Attach a client handle to its (shared) transport, and pre-serialize
+ * the static part of the call message.
+ */
+static void
+clnt_vc_setup(struct ct_data *ct, SVCXPRT *xprt, const struct netbuf *raddr,
+	      const rpcprog_t prog, const rpcvers_t vers)
+{
+	CLIENT *clnt = &ct->ct_cx.cx_c;
+	struct svc_vc_xprt *xd = VC_DR(REC_XPRT(xprt));
+	struct rpc_msg call_msg;
+	XDR ct_xdrs[1];		/* temp XDR stream */
+
+	if (!xd->sx_dr.ev_p) {
+		xprt->xp_dispatch.process_cb = clnt_vc_process;
+		svc_rqst_evchan_reg(__svc_params->ev_u.evchan.id, xprt,
+				    SVC_RQST_FLAG_CHAN_AFFINITY);
+	}
+	ct->ct_cx.cx_rec = &xd->sx_dr;
+
+	memcpy(&ct->ct_raddr, raddr->buf, raddr->len);
+	ct->ct_rlen = raddr->len;
+
+	/*
+	 * initialize call message
+	 */
+	call_msg.rm_xid = xd->sx_dr.call_xid;
+	call_msg.rm_direction = CALL;
+	call_msg.rm_call.cb_rpcvers = RPC_MSG_VERSION;
+	call_msg.cb_prog = prog;
+	call_msg.cb_vers = vers;
+
+	/*
+	 * pre-serialize the static part of the call msg and stash it away
+	 */
+	xdrmem_create(ct_xdrs, ct->ct_cx.cx_mcallc, MCALL_MSG_SIZE,
+		      XDR_ENCODE);
+	if (!xdr_callhdr(ct_xdrs, &call_msg)) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: fd %d xdr_callhdr failed",
+			__func__, xprt->xp_fd);
+		clnt->cl_error.re_status = RPC_CANTENCODEARGS;
+		XDR_DESTROY(ct_xdrs);
+		return;
+	}
+	ct->ct_cx.cx_mpos = XDR_GETPOS(ct_xdrs);
+	XDR_DESTROY(ct_xdrs);
+
+	__warnx(TIRPC_DEBUG_FLAG_CLNT_VC,
+		"%s: fd %d completed",
+		__func__, xprt->xp_fd);
+}
+
 /*
  * Create a client handle for a connection.
  * Default options are set, which the user can change using clnt_control()'s.
@@ -148,11 +202,8 @@ clnt_vc_ncreatef(const int fd,	/* open file descriptor */
 	struct ct_data *ct = clnt_vc_data_zalloc();
 	CLIENT *clnt = &ct->ct_cx.cx_c;
 	SVCXPRT *xprt;
-	struct svc_vc_xprt *xd;
-	struct rpc_msg call_msg;
 	sigset_t mask, newmask;
 	struct sockaddr_storage ss;
-	XDR ct_xdrs[1];		/* temp XDR stream */
 	socklen_t slen;
 
 	clnt->cl_ops = clnt_vc_ops();
@@ -208,46 +259,7 @@ clnt_vc_ncreatef(const int fd,	/* open file descriptor */
 		clnt->cl_error.re_status = RPC_TLIERROR;
 		goto err;
 	}
-	xd = VC_DR(REC_XPRT(xprt));
-
-	if (!xd->sx_dr.ev_p) {
-		xprt->xp_dispatch.process_cb = clnt_vc_process;
-		svc_rqst_evchan_reg(__svc_params->ev_u.evchan.id, xprt,
-				    SVC_RQST_FLAG_CHAN_AFFINITY);
-	}
-	ct->ct_cx.cx_rec = &xd->sx_dr;
-
-	memcpy(&ct->ct_raddr, raddr->buf, raddr->len);
-	ct->ct_rlen = raddr->len;
-
-	/*
-	 * initialize call message
-	 */
-	call_msg.rm_xid = xd->sx_dr.call_xid;
-	call_msg.rm_direction = CALL;
-	call_msg.rm_call.cb_rpcvers = RPC_MSG_VERSION;
-	call_msg.cb_prog = prog;
-	call_msg.cb_vers = vers;
-
-	/*
-	 * pre-serialize the static part of the call msg and stash it away
-	 */
-	xdrmem_create(ct_xdrs, ct->ct_cx.cx_mcallc, MCALL_MSG_SIZE,
-		      XDR_ENCODE);
-	if (!xdr_callhdr(ct_xdrs, &call_msg)) {
-		__warnx(TIRPC_DEBUG_FLAG_ERROR,
-			"%s: fd %d xdr_callhdr failed",
-			__func__, fd);
-		clnt->cl_error.re_status = RPC_CANTENCODEARGS;
-		XDR_DESTROY(ct_xdrs);
-		goto err;
-	}
-	ct->ct_cx.cx_mpos = XDR_GETPOS(ct_xdrs);
-	XDR_DESTROY(ct_xdrs);
-
-	__warnx(TIRPC_DEBUG_FLAG_CLNT_VC,
-		"%s: fd %d completed",
-		__func__, fd);
+	clnt_vc_setup(ct, xprt, raddr, prog, vers);
  err:
 	thr_sigsetmask(SIG_SETMASK, &(mask), NULL);
 	return (clnt);
@@ -268,6 +280,42 @@ clnt_vc_ncreate_svc(const SVCXPRT *xprt, const rpcprog_t prog,
 				flags | CLNT_CREATE_FLAG_SVCXPRT);
 }
 
+#ifdef USE_RPC_SHM
+/*
+ * Create a client handle over shared-memory rings, offered to the server
+ * on a connected AF_LOCAL socket (see svc_shm.c).
+ */
+CLIENT *
+clnt_shm_ncreatef(const int fd, const rpcprog_t prog, const rpcvers_t vers,
+		  const u_int ringsz, const uint32_t flags)
+{
+	struct ct_data *ct = clnt_vc_data_zalloc();
+	CLIENT *clnt = &ct->ct_cx.cx_c;
+	SVCXPRT *xprt;
+	sigset_t mask, newmask;
+
+	clnt->cl_ops = clnt_vc_ops();
+
+	sigfillset(&newmask);
+	thr_sigsetmask(SIG_SETMASK, &newmask, &mask);
+
+	xprt = svc_shm_connect(fd, ringsz, flags);
+	if (!xprt) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: fd %d svc_shm_connect failed",
+			__func__, fd);
+		clnt->cl_error.re_status = RPC_SYSTEMERROR;
+		clnt->cl_error.re_errno = errno;
+		goto err;
+	}
+
+	clnt_vc_setup(ct, xprt, &xprt->xp_remote.nb, prog, vers);
+ err:
+	thr_sigsetmask(SIG_SETMASK, &(mask), NULL);
+	return (clnt);
+}
+#endif /* USE_RPC_SHM */
+
 static enum xprt_stat
 clnt_vc_process(struct svc_req *req)
 {
@@ -290,18 +338,22 @@ clnt_vc_call(struct clnt_req *cc)
 	XDR *xdrs;
 	u_int32_t *uint32p;
 
-	/* XXX Until gss_get_mic and gss_wrap can be replaced with
-	 * iov equivalents, replies with RPCSEC_GSS security must be
-	 * encoded in a contiguous buffer.
+	/* Unless gss_get_mic_iov and gss_wrap_iov are available,
+	 * replies with RPCSEC_GSS security must be encoded in a
+	 * contiguous buffer.
 	 *
 	 * Nb, we should probably use getpagesize() on Unix.  Need
 	 * an equivalent for Windows.
 	 */
 	xioq = xdr_ioq_create(RPC_MAXDATA_DEFAULT,
 			      __svc_params->ioq.send_max + RPC_MAXDATA_DEFAULT,
+#ifdef HAVE_GSS_IOV
+			      UIO_FLAG_FREE);
+#else
 			      (cc->cc_auth->ah_cred.oa_flavor == RPCSEC_GSS)
 			      ? UIO_FLAG_REALLOC | UIO_FLAG_FREE
 			      : UIO_FLAG_FREE);
+#endif
 
 	xdrs = xioq->xdrs;
 	cc->cc_error.re_status = RPC_SUCCESS;
@@ -323,6 +375,8 @@ clnt_vc_call(struct clnt_req *cc)
 		XDR_DESTROY(xdrs);
 		return (RPC_CANTENCODEARGS);
 	}
+	RPC_PROBE5(clnt_call, cc->cc_xid, xprt->xp_fd, ntohl(uint32p[3]),
+		   ntohl(uint32p[4]), cc->cc_proc);
 	mutex_unlock(&clnt->cl_lock);
 
 	xdrs->x_lib[1] = (void *)xprt;
@@ -475,7 +529,7 @@ clnt_vc_ops(void)
 
 	sigfillset(&newmask);
 	thr_sigsetmask(SIG_SETMASK, &newmask, &mask);
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.cl_call == NULL) {
 		ops.cl_call = clnt_vc_call;
 		ops.cl_abort = clnt_vc_abort;
@@ -483,7 +537,7 @@ clnt_vc_ops(void)
 		ops.cl_destroy = clnt_vc_destroy;
 		ops.cl_control = clnt_vc_control;
 	}
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 	thr_sigsetmask(SIG_SETMASK, &(mask), NULL);
 	return (&ops);
 }
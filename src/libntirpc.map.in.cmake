@@ -2,6 +2,7 @@ NTIRPC_${NTIRPC_VERSION} {
   global:
     # __*
     __ntirpc_pkg_params;
+    __ntirpc_trace_flags;
     __rpc_address_port;
     __rpc_address_set_length;
     __rpc_dtbsize;
@@ -35,6 +36,7 @@ NTIRPC_${NTIRPC_VERSION} {
     _seterr_reply;
     _svcauth_none;
     _svcauth_short;
+    _svcauth_tls;
     _svcauth_unix;
 
     # a*
@@ -42,6 +44,10 @@ NTIRPC_${NTIRPC_VERSION} {
     authgss_ncreate_default;
     authgss_get_private_data;
     authgss_service;
+    authgss_pool_destroy;
+    authgss_pool_get;
+    authgss_pool_ncreate;
+    authgss_pool_put;
     authnone_ncreate;
     authunix_ncreate;
     authunix_ncreate_default;
@@ -65,9 +71,12 @@ NTIRPC_${NTIRPC_VERSION} {
     clnt_req_wait_reply;
     clnt_sperrno;
     clnt_tli_create;
+    clnt_shm_ncreatef;
+    clnt_tls_prepare;
     clnt_tp_ncreate_timed;
     clnt_vc_ncreatef;
     clnt_vc_ncreate_svc;
+    clnt_vc_starttls;
 
     # e*
     endnetconfig;
@@ -128,9 +137,12 @@ NTIRPC_${NTIRPC_VERSION} {
     setrpcent;
     svc_auth_authenticate;
     svc_auth_reg;
+    svc_auth_reg_flags;
+    svc_control;
     svc_dg_ncreatef;
     svc_fd_ncreatef;
     svc_init;
+    svc_latency_bucket_ns;
     svc_ncreate;
     svc_raw_ncreate;
     svc_reg;
@@ -142,7 +154,12 @@ NTIRPC_${NTIRPC_VERSION} {
     svc_rqst_thrd_signal;
     svc_sendreply;
     svc_shutdown;
+    svc_shm_ncreatef;
+    svc_stats_dispatch;
+    svc_stats_reg;
+    svc_stats_unreg;
     svc_tli_ncreate;
+    svc_tls_init;
     svc_tp_ncreate;
     svc_unreg;
     svc_validate_xprt_list;
@@ -166,11 +183,23 @@ NTIRPC_${NTIRPC_VERSION} {
     # t*
     taddr2uaddr;
     tirpc_control;
+    tirpc_trace_drain;
+    tirpc_trace_format;
+    tirpc_trace_put;
+    tirpc_trace_warnx;
 
     # u*
     uaddr2taddr;
 
+    # w*
+    work_pool_init;
+    work_pool_shutdown;
+    work_pool_stats_get;
+    work_pool_submit;
+
     # x*
+    xdr_arena_grow;
+    xdr_arena_release;
     xdr_authunix_parms;
     xdr_call_decode;
     xdr_call_encode;
@@ -178,8 +207,10 @@ NTIRPC_${NTIRPC_VERSION} {
     xdr_dplx_decode;
     xdr_dplx_msg;
     xdr_float;
+    xdr_free_arena_stream;
     xdr_free_null_stream;
     xdr_int;
+    xdr_ioq_create;
     xdr_long;
     xdr_longlong_t;
     xdr_naccepted_reply;
@@ -213,10 +244,15 @@ NTIRPC_${NTIRPC_VERSION} {
     xdr_rpcbs_proc;
     xdr_rpcbs_rmtcalllist;
     xdr_rpcbs_rmtcalllist_ptr;
+    xdr_svc_buffer_stats;
+    xdr_svc_latency_snapshot;
+    xdr_svc_stats_gss_res;
+    xdr_svc_xprt_stats_snapshot;
     xdr_u_int;
     xdr_u_long;
     xdr_u_longlong_t;
     xdr_void;
+    xdr_work_pool_stats;
     xdr_wrapstring;
     xdrmem_ncreate;
     xdrstdio_create;
@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file lock_prof.c
+ * @brief Lock contention profiling
+ *
+ * Acquisition is first tried without blocking;  only a failed try is
+ * counted as contended and timed as a wait.  Each thread keeps a short
+ * stack of its profiled holds (lock, site, time acquired), so the hold
+ * time is charged to the acquiring site when the lock is released.
+ * Holds deeper than the stack are counted, but not timed.
+ *
+ * Site counters live in per-thread tables, written only by the owner
+ * (with relaxed stores, so a snapshot reads whole values).  The tables
+ * of exited threads are folded into a shared table.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <misc/queue.h>
+#include <rpc/rpc.h>
+#include <misc/abstract_atomic.h>
+
+#include "lock_prof_internal.h"
+
+#ifdef USE_LOCK_PROF
+
+#define LOCK_PROF_HELD 16		/* holds timed per thread */
+
+struct lock_prof_count {
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t wait_ns;
+	uint64_t wait_max_ns;
+	uint64_t hold_ns;
+	uint64_t hold_max_ns;
+};
+
+struct lock_prof_held {
+	void *lock;
+	uint32_t id;
+	uint64_t since;
+};
+
+struct lock_prof_thread {
+	TAILQ_ENTRY(lock_prof_thread) q;
+	struct lock_prof_held held[LOCK_PROF_HELD];
+	struct lock_prof_count count[TIRPC_LOCK_SITES];
+};
+
+bool tirpc_lock_prof_enabled;
+__thread u_int tirpc_lock_held;
+
+static __thread struct lock_prof_thread *lock_prof_self;
+static struct tirpc_lock_site *lock_prof_sites[TIRPC_LOCK_SITES];
+static uint32_t lock_prof_nsites;
+
+static mutex_t lock_prof_mtx = MUTEX_INITIALIZER;
+static TAILQ_HEAD(lock_prof_thread_head, lock_prof_thread) lock_prof_threads
+	= TAILQ_HEAD_INITIALIZER(lock_prof_threads);
+static struct lock_prof_count lock_prof_exited[TIRPC_LOCK_SITES];
+static pthread_key_t lock_prof_key;
+static pthread_once_t lock_prof_once = PTHREAD_ONCE_INIT;
+
+static inline uint64_t
+lock_prof_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/* owner only */
+static inline void
+lock_prof_add(uint64_t *p, uint64_t val)
+{
+	__atomic_store_n(p, *p + val, __ATOMIC_RELAXED);
+}
+
+static inline void
+lock_prof_max(uint64_t *p, uint64_t val)
+{
+	if (val > *p)
+		__atomic_store_n(p, val, __ATOMIC_RELAXED);
+}
+
+static inline void
+lock_prof_merge(struct lock_prof_count *to,
+		const struct lock_prof_count *from)
+{
+	to->acquired += __atomic_load_n(&from->acquired, __ATOMIC_RELAXED);
+	to->contended += __atomic_load_n(&from->contended, __ATOMIC_RELAXED);
+	to->wait_ns += __atomic_load_n(&from->wait_ns, __ATOMIC_RELAXED);
+	to->wait_max_ns = MAX(to->wait_max_ns,
+			      __atomic_load_n(&from->wait_max_ns,
+					      __ATOMIC_RELAXED));
+	to->hold_ns += __atomic_load_n(&from->hold_ns, __ATOMIC_RELAXED);
+	to->hold_max_ns = MAX(to->hold_max_ns,
+			      __atomic_load_n(&from->hold_max_ns,
+					      __ATOMIC_RELAXED));
+}
+
+static void
+lock_prof_thread_exit(void *arg)
+{
+	struct lock_prof_thread *t = arg;
+	u_int ix;
+
+	mutex_lock(&lock_prof_mtx);
+	for (ix = 0; ix < TIRPC_LOCK_SITES; ix++)
+		lock_prof_merge(&lock_prof_exited[ix], &t->count[ix]);
+	TAILQ_REMOVE(&lock_prof_threads, t, q);
+	mutex_unlock(&lock_prof_mtx);
+
+	lock_prof_self = NULL;
+	tirpc_lock_held = 0;
+	mem_free(t, sizeof(*t));
+}
+
+static void
+lock_prof_key_init(void)
+{
+	(void)pthread_key_create(&lock_prof_key, lock_prof_thread_exit);
+}
+
+static struct lock_prof_thread *
+lock_prof_thread(void)
+{
+	struct lock_prof_thread *t = lock_prof_self;
+
+	if (likely(t))
+		return (t);
+
+	(void)pthread_once(&lock_prof_once, lock_prof_key_init);
+	t = mem_zalloc(sizeof(*t));
+
+	mutex_lock(&lock_prof_mtx);
+	TAILQ_INSERT_TAIL(&lock_prof_threads, t, q);
+	mutex_unlock(&lock_prof_mtx);
+
+	(void)pthread_setspecific(lock_prof_key, t);
+	lock_prof_self = t;
+	return (t);
+}
+
+/* returns index + 1, or 0 when the site table is full */
+static uint32_t
+lock_prof_register(struct tirpc_lock_site *site)
+{
+	uint32_t id = atomic_fetch_uint32_t(&site->id);
+	uint32_t slot;
+
+	if (likely(id))
+		return (id);
+
+	slot = atomic_postinc_uint32_t(&lock_prof_nsites);
+	if (slot >= TIRPC_LOCK_SITES)
+		return (0);
+
+	/* on a lost race, the slot stays empty */
+	if (atomic_cas_uint32_t(&site->id, 0, slot + 1))
+		atomic_store_voidptr((void **)&lock_prof_sites[slot], site);
+	return (atomic_fetch_uint32_t(&site->id));
+}
+
+static void
+lock_prof_acquired(struct lock_prof_thread *t, void *lock, uint32_t id,
+		   uint64_t start, uint64_t now)
+{
+	struct lock_prof_count *c = &t->count[id - 1];
+	struct lock_prof_held *h;
+
+	lock_prof_add(&c->acquired, 1);
+	if (start) {
+		lock_prof_add(&c->contended, 1);
+		lock_prof_add(&c->wait_ns, now - start);
+		lock_prof_max(&c->wait_max_ns, now - start);
+	}
+
+	if (tirpc_lock_held >= LOCK_PROF_HELD)
+		return;
+	h = &t->held[tirpc_lock_held++];
+	h->lock = lock;
+	h->id = id;
+	h->since = now;
+}
+
+int
+tirpc_lock_mutex(pthread_mutex_t *m, struct tirpc_lock_site *site)
+{
+	struct lock_prof_thread *t = lock_prof_thread();
+	uint32_t id = lock_prof_register(site);
+	uint64_t start;
+	int rc;
+
+	if (unlikely(!id))
+		return pthread_mutex_lock(m);
+
+	if (!pthread_mutex_trylock(m)) {
+		lock_prof_acquired(t, m, id, 0, lock_prof_now());
+		return (0);
+	}
+
+	start = lock_prof_now();
+	rc = pthread_mutex_lock(m);
+	if (!rc)
+		lock_prof_acquired(t, m, id, start, lock_prof_now());
+	return (rc);
+}
+
+int
+tirpc_lock_rwlock(pthread_rwlock_t *l, struct tirpc_lock_site *site)
+{
+	struct lock_prof_thread *t = lock_prof_thread();
+	uint32_t id = lock_prof_register(site);
+	bool rd = (site->kind == TIRPC_LOCK_RDLOCK);
+	uint64_t start;
+	int rc;
+
+	if (unlikely(!id))
+		return rd ? pthread_rwlock_rdlock(l) : pthread_rwlock_wrlock(l);
+
+	if (!(rd ? pthread_rwlock_tryrdlock(l) : pthread_rwlock_trywrlock(l))) {
+		lock_prof_acquired(t, l, id, 0, lock_prof_now());
+		return (0);
+	}
+
+	start = lock_prof_now();
+	rc = rd ? pthread_rwlock_rdlock(l) : pthread_rwlock_wrlock(l);
+	if (!rc)
+		lock_prof_acquired(t, l, id, start, lock_prof_now());
+	return (rc);
+}
+
+static inline struct lock_prof_held *
+lock_prof_find(struct lock_prof_thread *t, void *lock)
+{
+	u_int ix = tirpc_lock_held;
+
+	while (ix--)
+		if (t->held[ix].lock == lock)
+			return (&t->held[ix]);
+	return (NULL);
+}
+
+static inline void
+lock_prof_hold(struct lock_prof_thread *t, struct lock_prof_held *h,
+	       uint64_t now)
+{
+	struct lock_prof_count *c = &t->count[h->id - 1];
+
+	lock_prof_add(&c->hold_ns, now - h->since);
+	lock_prof_max(&c->hold_max_ns, now - h->since);
+}
+
+/* before unlock */
+void
+tirpc_lock_release(void *lock)
+{
+	struct lock_prof_thread *t = lock_prof_self;
+	struct lock_prof_held *h = lock_prof_find(t, lock);
+	struct lock_prof_held *last;
+
+	if (!h)
+		return;
+
+	lock_prof_hold(t, h, lock_prof_now());
+	last = &t->held[--tirpc_lock_held];
+	memmove(h, h + 1, (last - h) * sizeof(*h));
+}
+
+/* the wait is not charged to the hold */
+int
+tirpc_lock_cond_wait(pthread_cond_t *c, pthread_mutex_t *m,
+		     const struct timespec *abstime)
+{
+	struct lock_prof_thread *t = lock_prof_self;
+	struct lock_prof_held *h = lock_prof_find(t, m);
+	int rc;
+
+	if (h)
+		lock_prof_hold(t, h, lock_prof_now());
+	rc = abstime
+		? pthread_cond_timedwait(c, m, abstime)
+		: pthread_cond_wait(c, m);
+	if (h)
+		h->since = lock_prof_now();
+	return (rc);
+}
+
+static bool
+lock_prof_snapshot(struct tirpc_lock_snapshot *snap)
+{
+	u_int nsites = MIN(atomic_fetch_uint32_t(&lock_prof_nsites),
+			   TIRPC_LOCK_SITES);
+	struct lock_prof_count *sum;
+	struct lock_prof_thread *t;
+	struct tirpc_lock_site *site;
+	struct tirpc_lock_stat *stat = snap->stats;
+	bool complete = true;
+	u_int ix;
+
+	snap->count = 0;
+	snap->threads = 0;
+	if (!nsites)
+		return (true);
+
+	sum = mem_zalloc(nsites * sizeof(*sum));
+
+	mutex_lock(&lock_prof_mtx);
+	for (ix = 0; ix < nsites; ix++)
+		lock_prof_merge(&sum[ix], &lock_prof_exited[ix]);
+	TAILQ_FOREACH(t, &lock_prof_threads, q) {
+		for (ix = 0; ix < nsites; ix++)
+			lock_prof_merge(&sum[ix], &t->count[ix]);
+		snap->threads++;
+	}
+	mutex_unlock(&lock_prof_mtx);
+
+	for (ix = 0; ix < nsites; ix++) {
+		site = atomic_fetch_voidptr((void **)&lock_prof_sites[ix]);
+		if (!site || !sum[ix].acquired)
+			continue;
+		if (snap->count >= snap->max) {
+			complete = false;
+			break;
+		}
+		stat->name = site->name;
+		stat->func = site->func;
+		stat->line = site->line;
+		stat->kind = site->kind;
+		stat->acquired = sum[ix].acquired;
+		stat->contended = sum[ix].contended;
+		stat->wait_ns = sum[ix].wait_ns;
+		stat->wait_max_ns = sum[ix].wait_max_ns;
+		stat->hold_ns = sum[ix].hold_ns;
+		stat->hold_max_ns = sum[ix].hold_max_ns;
+		stat++;
+		snap->count++;
+	}
+
+	mem_free(sum, nsites * sizeof(*sum));
+	return (complete);
+}
+
+static void
+lock_prof_reset(void)
+{
+	struct lock_prof_thread *t;
+
+	/* concurrent samples may survive;  sites are kept */
+	mutex_lock(&lock_prof_mtx);
+	memset(lock_prof_exited, 0, sizeof(lock_prof_exited));
+	TAILQ_FOREACH(t, &lock_prof_threads, q)
+		memset(t->count, 0, sizeof(t->count));
+	mutex_unlock(&lock_prof_mtx);
+}
+
+bool
+tirpc_lock_prof_control(const u_int rq, void *in)
+{
+	switch (rq) {
+	case TIRPC_GET_LOCK_STATS:
+		return lock_prof_snapshot((struct tirpc_lock_snapshot *)in);
+	case TIRPC_SET_LOCK_PROF:
+		tirpc_lock_prof_enabled = *(bool *)in;
+		break;
+	case TIRPC_RESET_LOCK_STATS:
+		lock_prof_reset();
+		break;
+	default:
+		return (false);
+	}
+	return (true);
+}
+
+#else
+
+/* not built with USE_LOCK_PROF:  nothing to enable, nothing counted */
+bool
+tirpc_lock_prof_control(const u_int rq, void *in)
+{
+	struct tirpc_lock_snapshot *snap = in;
+
+	switch (rq) {
+	case TIRPC_GET_LOCK_STATS:
+		snap->count = 0;
+		snap->threads = 0;
+		break;
+	case TIRPC_SET_LOCK_PROF:
+		return !*(bool *)in;
+	case TIRPC_RESET_LOCK_STATS:
+		break;
+	default:
+		return (false);
+	}
+	return (true);
+}
+
+#endif				/* USE_LOCK_PROF */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOCK_PROF_INTERNAL_H
+#define LOCK_PROF_INTERNAL_H
+
+/**
+ * @file lock_prof_internal.h
+ * @brief Lock contention profiling layer (see rpc/lock_prof.h)
+ *
+ * Profiled locks are taken with prof_mutex_lock(m, name) and friends,
+ * which declare a static tirpc_lock_site at the call.  Without
+ * USE_LOCK_PROF these are the plain reentrant.h operations.  With it,
+ * a disabled profiler costs one test per lock, and one per unlock
+ * (of a thread-local).
+ */
+
+#include <time.h>
+#include <intrinsic.h>
+#include <reentrant.h>
+#include <rpc/lock_prof.h>
+
+bool tirpc_lock_prof_control(const u_int, void *);
+
+#ifdef USE_LOCK_PROF
+
+extern bool tirpc_lock_prof_enabled;
+extern __thread u_int tirpc_lock_held;	/* profiled holds, this thread */
+
+int tirpc_lock_mutex(pthread_mutex_t *, struct tirpc_lock_site *);
+int tirpc_lock_rwlock(pthread_rwlock_t *, struct tirpc_lock_site *);
+void tirpc_lock_release(void *);
+int tirpc_lock_cond_wait(pthread_cond_t *, pthread_mutex_t *,
+			 const struct timespec *);
+
+#define LOCK_PROF_SITE(name, kind) \
+	({ \
+		static struct tirpc_lock_site __lps = { \
+			name, __func__, __LINE__, kind, 0 \
+		}; \
+		&__lps; \
+	})
+
+static inline int
+prof_mutex_lock_at(pthread_mutex_t *m, struct tirpc_lock_site *site)
+{
+	if (likely(!tirpc_lock_prof_enabled))
+		return pthread_mutex_lock(m);
+	return tirpc_lock_mutex(m, site);
+}
+
+static inline int
+prof_mutex_unlock(pthread_mutex_t *m)
+{
+	if (tirpc_lock_held)
+		tirpc_lock_release(m);
+	return pthread_mutex_unlock(m);
+}
+
+static inline int
+prof_rwlock_at(pthread_rwlock_t *l, struct tirpc_lock_site *site)
+{
+	if (likely(!tirpc_lock_prof_enabled))
+		return (site->kind == TIRPC_LOCK_RDLOCK)
+			? pthread_rwlock_rdlock(l)
+			: pthread_rwlock_wrlock(l);
+	return tirpc_lock_rwlock(l, site);
+}
+
+static inline int
+prof_rwlock_unlock(pthread_rwlock_t *l)
+{
+	if (tirpc_lock_held)
+		tirpc_lock_release(l);
+	return pthread_rwlock_unlock(l);
+}
+
+static inline int
+prof_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
+{
+	if (tirpc_lock_held)
+		return tirpc_lock_cond_wait(c, m, NULL);
+	return pthread_cond_wait(c, m);
+}
+
+static inline int
+prof_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m,
+		    const struct timespec *abstime)
+{
+	if (tirpc_lock_held)
+		return tirpc_lock_cond_wait(c, m, abstime);
+	return pthread_cond_timedwait(c, m, abstime);
+}
+
+#define prof_mutex_lock(m, name) \
+	prof_mutex_lock_at(m, LOCK_PROF_SITE(name, TIRPC_LOCK_MUTEX))
+#define prof_rwlock_rdlock(l, name) \
+	prof_rwlock_at(l, LOCK_PROF_SITE(name, TIRPC_LOCK_RDLOCK))
+#define prof_rwlock_wrlock(l, name) \
+	prof_rwlock_at(l, LOCK_PROF_SITE(name, TIRPC_LOCK_WRLOCK))
+
+#else
+
+#define LOCK_PROF_SITE(name, kind)	NULL
+#define prof_mutex_lock_at(m, site)	mutex_lock(m)
+#define prof_mutex_lock(m, name)	mutex_lock(m)
+#define prof_mutex_unlock(m)		mutex_unlock(m)
+#define prof_rwlock_rdlock(l, name)	rwlock_rdlock(l)
+#define prof_rwlock_wrlock(l, name)	rwlock_wrlock(l)
+#define prof_rwlock_unlock(l)		rwlock_unlock(l)
+#define prof_cond_wait(c, m)		cond_wait(c, m)
+#define prof_cond_timedwait(c, m, a)	cond_timedwait(c, m, a)
+
+#endif				/* USE_LOCK_PROF */
+#endif				/* LOCK_PROF_INTERNAL_H */
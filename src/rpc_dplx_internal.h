@@ -27,12 +27,15 @@
 #ifndef RPC_DPLX_INTERNAL_H
 #define RPC_DPLX_INTERNAL_H
 
+#include <misc/abstract_atomic.h>
 #include <misc/queue.h>
 #include <misc/rbtree.h>
 #include <misc/wait_queue.h>
 #include <rpc/svc.h>
 #include <rpc/xdr_ioq.h>
 
+#include "lock_prof_internal.h"
+
 /* Svc event strategy */
 enum svc_event_type {
 	SVC_EVENT_FDSET /* trad. using select and poll (currently unhooked) */ ,
@@ -56,6 +59,9 @@ struct rpc_dplx_rec {
 	struct {
 		rpc_dplx_lock_t lock;
 		struct timespec ts;
+		struct timespec ev;	/* latest event (latency) */
+		uint64_t enq;		/* receive task queued (slow) */
+		uint64_t deq;		/* receive task started (slow) */
 	} recv;
 
 	/*
@@ -69,6 +75,7 @@ struct rpc_dplx_rec {
 #endif
 	} ev_u;
 	void *ev_p;			/* struct svc_rqst_rec (internal) */
+	struct svc_xprt_stats stats;	/* relaxed, see rpc_dplx_stat_*() */
 
 	size_t maxrec;
 	long pagesz;
@@ -132,9 +139,52 @@ rpc_dplx_rec_destroy(struct rpc_dplx_rec *rec)
 #endif
 }
 
+/* statistics only:  no ordering required */
+static inline void
+rpc_dplx_stat_add(uint64_t *var, uint64_t val)
+{
+#ifdef GCC_ATOMIC_FUNCTIONS
+	(void)__atomic_add_fetch(var, val, __ATOMIC_RELAXED);
+#else
+	(void)atomic_add_uint64_t(var, val);
+#endif
+}
+
+static inline void
+rpc_dplx_stat_inc(uint64_t *var)
+{
+	rpc_dplx_stat_add(var, 1);
+}
+
+static inline void
+rpc_dplx_stat_queued(struct rpc_dplx_rec *rec)
+{
+	uint32_t queued;
+
+#ifdef GCC_ATOMIC_FUNCTIONS
+	queued = __atomic_add_fetch(&rec->stats.queued, 1, __ATOMIC_RELAXED);
+#else
+	queued = atomic_inc_uint32_t(&rec->stats.queued);
+#endif
+	/* racy high-water mark is good enough */
+	if (queued > rec->stats.queued_max)
+		rec->stats.queued_max = queued;
+}
+
+static inline void
+rpc_dplx_stat_dequeued(struct rpc_dplx_rec *rec)
+{
+#ifdef GCC_ATOMIC_FUNCTIONS
+	(void)__atomic_sub_fetch(&rec->stats.queued, 1, __ATOMIC_RELAXED);
+#else
+	(void)atomic_dec_uint32_t(&rec->stats.queued);
+#endif
+}
+
 /* rlt: recv lock trace */
 static inline void
-rpc_dplx_rlt(struct rpc_dplx_rec *rec, const char *func, int line)
+rpc_dplx_rlt(struct rpc_dplx_rec *rec, const char *func, int line,
+	     struct tirpc_lock_site *site)
 {
 	rpc_dplx_lock_t *lk = &rec->recv.lock;
 
@@ -151,14 +201,15 @@ rpc_dplx_rlt(struct rpc_dplx_rec *rec, const char *func, int line)
 				func, line);
 		}
 	}
-	mutex_lock(&lk->we.mtx);
+	prof_mutex_lock_at(&lk->we.mtx, site);
 	lk->locktrace.func = (char *)func;
 	lk->locktrace.line = line;
 }
 
 /* rli: recv lock impl */
 #define rpc_dplx_rli(rec) \
-	rpc_dplx_rlt(rec, __func__, __LINE__)
+	rpc_dplx_rlt(rec, __func__, __LINE__, \
+		     LOCK_PROF_SITE("rpc_dplx_rec.recv", TIRPC_LOCK_MUTEX))
 
 /* rui: recv unlock trace */
 static inline void
@@ -172,7 +223,7 @@ rpc_dplx_rut(struct rpc_dplx_rec *rec, const char *func, int line)
 		lk->locktrace.func,
 		lk->locktrace.line);
 	lk->locktrace.line = 0;
-	mutex_unlock(&lk->we.mtx);
+	prof_mutex_unlock(&lk->we.mtx);
 }
 
 /* rli: recv lock impl */
@@ -191,7 +242,7 @@ rpc_dplx_rwt(struct rpc_dplx_rec *rec, const char *func, int line)
 		lk->locktrace.func,
 		lk->locktrace.line);
 	lk->locktrace.line = 0;
-	cond_wait(&lk->we.cv, &lk->we.mtx);
+	prof_cond_wait(&lk->we.cv, &lk->we.mtx);
 	lk->locktrace.func = (char *)func;
 	lk->locktrace.line = line;
 }
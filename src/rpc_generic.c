@@ -63,6 +63,7 @@
 #include <assert.h>
 
 #include "rpc_com.h"
+#include "lock_prof_internal.h"
 
 void
 thr_keyfree(void *k)
@@ -138,6 +139,9 @@ tirpc_pkg_params __ntirpc_pkg_params = {
 	tirpc_realloc,
 };
 
+/* apart from __ntirpc_pkg_params, which callers copy wholesale */
+uint32_t __ntirpc_trace_flags = TIRPC_DEBUG_FLAG_NONE;
+
 bool
 tirpc_control(const u_int rq, void *in)
 {
@@ -160,6 +164,16 @@ tirpc_control(const u_int rq, void *in)
 	case TIRPC_SET_OTHER_FLAGS:
 		__ntirpc_pkg_params.other_flags = *(int *)in;
 		break;
+	case TIRPC_GET_TRACE_FLAGS:
+		*(u_int *) in = __ntirpc_trace_flags;
+		break;
+	case TIRPC_SET_TRACE_FLAGS:
+		__ntirpc_trace_flags = *(int *)in;
+		break;
+	case TIRPC_GET_LOCK_STATS:
+	case TIRPC_SET_LOCK_PROF:
+	case TIRPC_RESET_LOCK_STATS:
+		return tirpc_lock_prof_control(rq, in);
 	default:
 		return (false);
 	}
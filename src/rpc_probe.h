@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RPC_PROBE_H
+#define RPC_PROBE_H
+
+/**
+ * @file rpc_probe.h
+ * @brief USDT (SystemTap/bpftrace) static probes, provider "ntirpc"
+ *
+ * Each probe is a nop in the text, plus an ELF note naming the argument
+ * locations;  nothing is evaluated until a tracer attaches.  Built only
+ * with USE_USDT, otherwise the macros are empty.
+ *
+ *  svc_accept	(listen fd, new fd)
+ *  svc_record	(fd, fragments)
+ *  svc_decode	(xid, fd, direction)
+ *  svc_dispatch	(xid, fd, prog, vers, proc)
+ *  svc_auth	(xid, fd, flavor, auth_stat)
+ *  svc_reply	(xid, fd, prog, vers, proc, accept_stat)
+ *  svc_write	(xid, fd, bytes)	-- before writev
+ *  svc_written	(xid, fd, bytes, errno)	-- after writev (output complete)
+ *  svc_destroy	(fd, xp_refs)
+ *  clnt_call	(xid, fd, prog, vers, proc)
+ *  clnt_reply	(xid, fd, proc, clnt_stat)
+ *  clnt_expire	(xid, fd, proc)
+ *
+ * For example, server time between dispatch and reply:
+ *
+ *  bpftrace -e 'usdt:libntirpc.so:ntirpc:svc_dispatch
+ *		{ @s[arg0, arg1] = nsecs; }
+ *	usdt:libntirpc.so:ntirpc:svc_reply /@s[arg0, arg1]/
+ *		{ @us[arg4] = hist((nsecs - @s[arg0, arg1]) / 1000);
+ *		  delete(@s[arg0, arg1]); }'
+ */
+
+#ifdef USE_USDT
+#include <sys/sdt.h>
+
+#define RPC_PROBE2(n, a1, a2) \
+	DTRACE_PROBE2(ntirpc, n, a1, a2)
+#define RPC_PROBE3(n, a1, a2, a3) \
+	DTRACE_PROBE3(ntirpc, n, a1, a2, a3)
+#define RPC_PROBE4(n, a1, a2, a3, a4) \
+	DTRACE_PROBE4(ntirpc, n, a1, a2, a3, a4)
+#define RPC_PROBE5(n, a1, a2, a3, a4, a5) \
+	DTRACE_PROBE5(ntirpc, n, a1, a2, a3, a4, a5)
+#define RPC_PROBE6(n, a1, a2, a3, a4, a5, a6) \
+	DTRACE_PROBE6(ntirpc, n, a1, a2, a3, a4, a5, a6)
+#else
+#define RPC_PROBE2(n, a1, a2) do { } while (0)
+#define RPC_PROBE3(n, a1, a2, a3) do { } while (0)
+#define RPC_PROBE4(n, a1, a2, a3, a4) do { } while (0)
+#define RPC_PROBE5(n, a1, a2, a3, a4, a5) do { } while (0)
+#define RPC_PROBE6(n, a1, a2, a3, a4, a5, a6) do { } while (0)
+#endif				/* USE_USDT */
+
+#endif				/* RPC_PROBE_H */
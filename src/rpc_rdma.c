@@ -1461,16 +1461,16 @@ rpc_rdma_ncreatef(const struct rpc_rdma_attr *xa,
 		goto failure;
 	}
 
-	pthread_mutex_lock(&svc_work_pool.pqh.qmutex);
+	prof_mutex_lock(&svc_work_pool.pqh.qmutex, "poolq_head.qmutex");
 	if (!svc_work_pool.params.thrd_max) {
-		pthread_mutex_unlock(&svc_work_pool.pqh.qmutex);
+		prof_mutex_unlock(&svc_work_pool.pqh.qmutex);
 
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s() svc_work_pool already shutdown",
 			__func__);
 		goto failure;
 	}
-	pthread_mutex_unlock(&svc_work_pool.pqh.qmutex);
+	prof_mutex_unlock(&svc_work_pool.pqh.qmutex);
 
 	/* buffer sizes MUST be page sized */
 	xd->sm_dr.pagesz = sysconf(_SC_PAGESIZE);
@@ -2220,14 +2220,14 @@ rpc_rdma_control(SVCXPRT *xprt, const u_int rq, void *in)
 {
 	switch (rq) {
 	case SVCGET_XP_FREE_USER_DATA:
-	    mutex_lock(&ops_lock);
+	    prof_mutex_lock(&ops_lock, "ops_lock");
 	    *(svc_xprt_fun_t *)in = xprt->xp_ops->xp_free_user_data;
-	    mutex_unlock(&ops_lock);
+	    prof_mutex_unlock(&ops_lock);
 	    break;
 	case SVCSET_XP_FREE_USER_DATA:
-	    mutex_lock(&ops_lock);
+	    prof_mutex_lock(&ops_lock, "ops_lock");
 	    xprt->xp_ops->xp_free_user_data = *(svc_xprt_fun_t)in;
-	    mutex_unlock(&ops_lock);
+	    prof_mutex_unlock(&ops_lock);
 	    break;
 	default:
 	    return (FALSE);
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file rpc_tls.c
+ * @brief RPC-over-TLS (RFC 9289)
+ *
+ * A client probes with a NULL call carrying AUTH_TLS;  the server answers
+ * with the "STARTTLS" verifier, then expects a TLS handshake before the
+ * next record.  The handshake runs here (OpenSSL), on the connection's
+ * own fd, and the session keys are installed in the kernel.  After that,
+ * svc_vc_recv() and svc_ioq_flushv() carry plaintext as before.
+ *
+ * Both directions must be offloaded, or the connection is dropped.  No
+ * session tickets are issued, so there are no post-handshake messages
+ * for the kernel receive path.
+ */
+
+#include "config.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/auth_inline.h>
+#include <rpc/svc.h>
+#include <rpc/svc_auth.h>
+#include <rpc/svc_rqst.h>
+#include <rpc/rpc_tls.h>
+#include <misc/abstract_atomic.h>
+#include <misc/opr.h>
+#include <misc/timespec.h>
+#include "rpc_com.h"
+#include "clnt_internal.h"
+#include "svc_internal.h"
+#include "rpc_dplx_internal.h"
+
+#define RPC_TLS_HANDSHAKE_MS (10000)	/* whole handshake */
+#define RPC_TLS_STARTTLS "STARTTLS"
+#define RPC_TLS_STARTTLS_LEN (sizeof(RPC_TLS_STARTTLS) - 1)
+
+extern SVCAUTH svc_auth_none;
+
+/* ALPN protocol-list, "sunrpc" */
+static const unsigned char rpc_tls_alpn[] = "\x06sunrpc";
+
+static SSL_CTX *svc_tls_ctx;
+
+static void
+rpc_tls_log(const char *func, const char *what)
+{
+	char buf[256];
+	unsigned long err = ERR_get_error();
+
+	if (err)
+		ERR_error_string_n(err, buf, sizeof(buf));
+	else
+		strlcpy(buf, "no error queued", sizeof(buf));
+
+	__warnx(TIRPC_DEBUG_FLAG_ERROR, "%s() %s: %s", func, what, buf);
+	ERR_clear_error();
+}
+
+static void
+rpc_tls_ctx_prepare(SSL_CTX *ctx)
+{
+	SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION);
+	SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+	SSL_CTX_set_num_tickets(ctx, 0);
+}
+
+static int
+rpc_tls_alpn_select(SSL *ssl, const unsigned char **out,
+		    unsigned char *outlen, const unsigned char *in,
+		    unsigned int inlen, void *arg)
+{
+	if (SSL_select_next_proto((unsigned char **)out, outlen,
+				  rpc_tls_alpn, sizeof(rpc_tls_alpn) - 1,
+				  in, inlen) != OPENSSL_NPN_NEGOTIATED)
+		return (SSL_TLSEXT_ERR_ALERT_FATAL);
+	return (SSL_TLSEXT_ERR_OK);
+}
+
+/* milliseconds left until the deadline, rounded up;  0 when past */
+static int
+rpc_tls_remaining_ms(const struct timespec *deadline)
+{
+	struct timespec now, left = *deadline;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!timespeccmp(&now, deadline, <))
+		return (0);
+	timespecsub(&left, &now);
+	return (left.tv_sec * 1000 + (left.tv_nsec + 999999) / 1000000);
+}
+
+/*
+ * Handshake over a (non-blocking) connected fd, then hand the session to
+ * the kernel.  The SSL is discarded;  the socket keeps the TLS state.
+ *
+ * The whole handshake is bounded by RPC_TLS_HANDSHAKE_MS, so that a
+ * peer trickling bytes cannot hold the calling (event) thread.
+ */
+static bool
+rpc_tls_handshake(SSL_CTX *ctx, int fd, const char *host, bool server)
+{
+	struct pollfd pfd = {
+		.fd = fd,
+	};
+	struct timespec deadline;
+	SSL *ssl;
+	bool result = false;
+	int rc, ms;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+	timespec_addms(&deadline, RPC_TLS_HANDSHAKE_MS);
+
+	ssl = SSL_new(ctx);
+	if (!ssl) {
+		rpc_tls_log(__func__, "SSL_new failed");
+		return (false);
+	}
+	if (!SSL_set_fd(ssl, fd)) {
+		rpc_tls_log(__func__, "SSL_set_fd failed");
+		goto out;
+	}
+	if (host
+	 && (!SSL_set_tlsext_host_name(ssl, host)
+	  || !SSL_set1_host(ssl, host))) {
+		rpc_tls_log(__func__, "SSL_set1_host failed");
+		goto out;
+	}
+
+	for (;;) {
+		rc = server ? SSL_accept(ssl) : SSL_connect(ssl);
+		if (rc == 1)
+			break;
+
+		switch (SSL_get_error(ssl, rc)) {
+		case SSL_ERROR_WANT_READ:
+			pfd.events = POLLIN;
+			break;
+		case SSL_ERROR_WANT_WRITE:
+			pfd.events = POLLOUT;
+			break;
+		default:
+			rpc_tls_log(__func__, "handshake failed");
+			goto out;
+		}
+
+		ms = rpc_tls_remaining_ms(&deadline);
+		rc = ms ? poll(&pfd, 1, ms) : 0;
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc < 0) {
+			__warnx(TIRPC_DEBUG_FLAG_ERROR,
+				"%s() fd %d poll failed (%d)",
+				__func__, fd, errno);
+			goto out;
+		}
+		if (!rc) {
+			__warnx(TIRPC_DEBUG_FLAG_ERROR,
+				"%s() fd %d handshake timed out",
+				__func__, fd);
+			goto out;
+		}
+	}
+
+	if (!BIO_get_ktls_send(SSL_get_wbio(ssl))
+	 || !BIO_get_ktls_recv(SSL_get_rbio(ssl))) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d kernel TLS unavailable (%s)",
+			__func__, fd, SSL_get_cipher_name(ssl));
+		goto out;
+	}
+
+	__warnx(TIRPC_DEBUG_FLAG_SVC_VC,
+		"%s() fd %d %s %s", __func__, fd,
+		SSL_get_version(ssl), SSL_get_cipher_name(ssl));
+	result = true;
+
+ out:
+	SSL_free(ssl);
+	return (result);
+}
+
+/*
+ * Server
+ */
+bool
+svc_tls_init(SSL_CTX *ctx)
+{
+	rpc_tls_ctx_prepare(ctx);
+	SSL_CTX_set_alpn_select_cb(ctx, rpc_tls_alpn_select, NULL);
+	svc_tls_ctx = ctx;
+	return (true);
+}
+
+enum auth_stat
+_svcauth_tls(struct svc_req *req)
+{
+	SVCXPRT *xprt = req->rq_xprt;
+	struct opaque_auth *verf = &req->rq_msg.RPCM_ack.ar_verf;
+
+	req->rq_auth = &svc_auth_none;
+
+	if (!svc_tls_ctx
+	 || xprt->xp_type != XPRT_TCP
+	 || req->rq_msg.cb_proc != NULLPROC
+	 || (xprt->xp_flags & (SVC_XPRT_FLAG_TLS | SVC_XPRT_FLAG_TLS_ACCEPT)))
+		return (AUTH_REJECTEDCRED);
+
+	/* the client starts its handshake upon this reply */
+	(void)atomic_set_uint16_t_bits(&xprt->xp_flags,
+				       SVC_XPRT_FLAG_TLS_ACCEPT);
+
+	verf->oa_flavor = AUTH_NONE;
+	verf->oa_length = RPC_TLS_STARTTLS_LEN;
+	memcpy(verf->oa_body, RPC_TLS_STARTTLS, RPC_TLS_STARTTLS_LEN);
+	return (AUTH_OK);
+}
+
+/* called by svc_vc_recv() in place of the next record */
+bool
+rpc_tls_accept(SVCXPRT *xprt)
+{
+	bool result = rpc_tls_handshake(svc_tls_ctx, xprt->xp_fd, NULL, true);
+
+	if (result)
+		(void)atomic_set_uint16_t_bits(&xprt->xp_flags,
+					       SVC_XPRT_FLAG_TLS);
+	(void)atomic_clear_uint16_t_bits(&xprt->xp_flags,
+					 SVC_XPRT_FLAG_TLS_ACCEPT);
+	return (result);
+}
+
+/*
+ * Client
+ */
+struct rpc_tls_probe {
+	AUTH auth;
+	bool starttls;
+};
+
+static void
+rpc_tls_probe_nextverf(AUTH *auth)
+{
+	/* no action necessary */
+}
+
+static bool
+rpc_tls_probe_marshal(AUTH *auth, XDR *xdrs)
+{
+	return (xdr_opaque_auth_encode(xdrs, &auth->ah_cred)
+		&& xdr_opaque_auth_encode(xdrs, &auth->ah_verf));
+}
+
+static bool
+rpc_tls_probe_validate(AUTH *auth, struct opaque_auth *verf)
+{
+	struct rpc_tls_probe *probe =
+		opr_containerof(auth, struct rpc_tls_probe, auth);
+
+	probe->starttls = (verf->oa_length == RPC_TLS_STARTTLS_LEN
+			   && !memcmp(verf->oa_body, RPC_TLS_STARTTLS,
+				      RPC_TLS_STARTTLS_LEN));
+	return (true);
+}
+
+static bool
+rpc_tls_probe_refresh(AUTH *auth, void *arg)
+{
+	return (false);
+}
+
+static void
+rpc_tls_probe_destroy(AUTH *auth)
+{
+	/* on stack */
+}
+
+static bool
+rpc_tls_probe_wrap(AUTH *auth, XDR *xdrs, xdrproc_t xfunc, void *xwhere)
+{
+	return ((*xfunc) (xdrs, xwhere));
+}
+
+static struct auth_ops rpc_tls_probe_ops = {
+	rpc_tls_probe_nextverf,
+	rpc_tls_probe_marshal,
+	rpc_tls_probe_validate,
+	rpc_tls_probe_refresh,
+	rpc_tls_probe_destroy,
+	rpc_tls_probe_wrap,
+	rpc_tls_probe_wrap
+};
+
+bool
+clnt_tls_prepare(SSL_CTX *ctx)
+{
+	rpc_tls_ctx_prepare(ctx);
+
+	/* nb, returns 0 on success */
+	return (!SSL_CTX_set_alpn_protos(ctx, rpc_tls_alpn,
+					 sizeof(rpc_tls_alpn) - 1));
+}
+
+/*
+ * Probe the server, then upgrade the connection.  No other calls may be
+ * outstanding on this connection.  host (optional) is verified against
+ * the server certificate.
+ */
+enum clnt_stat
+clnt_vc_starttls(CLIENT *clnt, SSL_CTX *ctx, const char *host,
+		 struct timespec timeout)
+{
+	struct cx_data *cx = CX_DATA(clnt);
+	SVCXPRT *xprt = &cx->cx_rec->xprt;
+	struct rpc_tls_probe probe;
+	struct clnt_req *cc;
+	enum clnt_stat stat;
+	bool result;
+
+	if (xprt->xp_type != XPRT_TCP)
+		return (RPC_CANTSEND);
+	if (xprt->xp_flags & SVC_XPRT_FLAG_TLS)
+		return (RPC_SUCCESS);
+
+	memset(&probe, 0, sizeof(probe));
+	probe.auth.ah_ops = &rpc_tls_probe_ops;
+	probe.auth.ah_cred.oa_flavor = AUTH_TLS;
+	probe.auth.ah_verf = _null_auth;
+	probe.auth.ah_refcnt = 1;
+
+	cc = mem_alloc(sizeof(*cc));
+	clnt_req_fill(cc, clnt, &probe.auth, NULLPROC,
+		      (xdrproc_t) xdr_void, NULL,
+		      (xdrproc_t) xdr_void, NULL);
+	stat = clnt_req_setup(cc, timeout);
+	if (stat == RPC_SUCCESS)
+		stat = CLNT_CALL_WAIT(cc);
+	clnt_req_release(cc);
+
+	if (stat != RPC_SUCCESS)
+		return (stat);
+	if (!probe.starttls)
+		return (RPC_AUTHERROR);
+
+	/* keep the event channel away from the handshake */
+	(void)atomic_set_uint16_t_bits(&xprt->xp_flags,
+				       SVC_XPRT_FLAG_TLS_CONNECT);
+	result = rpc_tls_handshake(ctx, xprt->xp_fd, host, false);
+	if (result)
+		(void)atomic_set_uint16_t_bits(&xprt->xp_flags,
+					       SVC_XPRT_FLAG_TLS);
+	(void)atomic_clear_uint16_t_bits(&xprt->xp_flags,
+					 SVC_XPRT_FLAG_TLS_CONNECT);
+
+	if (unlikely(svc_rqst_rearm_events(xprt))) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: %p fd %d svc_rqst_rearm_events failed (will set dead)",
+			__func__, xprt, xprt->xp_fd);
+		return (RPC_CANTRECV);
+	}
+
+	/* the connection state is unknown, the caller should destroy it */
+	return (result ? RPC_SUCCESS : RPC_AUTHERROR);
+}
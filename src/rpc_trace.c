@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file rpc_trace.c
+ * @brief Per-thread binary trace rings
+ *
+ * Each thread that records an event is given a ring on first use;  rings
+ * of exited threads are recycled, never freed.  The owner is the only
+ * writer.  Each record carries its own sequence (seqlock style):  zeroed
+ * while the record is filled, then published with its position, so the
+ * consumer can detect a record overwritten while it was being copied.
+ *
+ * Only debug sites on the request path are routed here (__tracex() and
+ * XPRT_TRACE());  see rpc/rpc_trace.h.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/rpc_trace.h>
+#include <misc/abstract_atomic.h>
+
+#define TIRPC_TRACE_MASK (TIRPC_TRACE_RING_SIZE - 1)
+#define TIRPC_TRACE_RINGS 1024		/* concurrent tracing threads */
+
+struct tirpc_trace_ring {
+	uint64_t tt_head;		/* next position (owner) */
+	uint32_t tt_id;
+	uint32_t tt_owned;		/* attached to a live thread */
+	CACHE_PAD(0);
+	uint64_t tt_tail;		/* next position (consumer) */
+	CACHE_PAD(1);
+	struct tirpc_trace_rec tt_rec[TIRPC_TRACE_RING_SIZE];
+};
+
+static struct tirpc_trace_ring *tirpc_trace_rings[TIRPC_TRACE_RINGS];
+static uint32_t tirpc_trace_nrings;
+static pthread_key_t tirpc_trace_key;
+static pthread_once_t tirpc_trace_once = PTHREAD_ONCE_INIT;
+static __thread struct tirpc_trace_ring *tirpc_trace_self;
+static __thread bool tirpc_trace_full;
+
+/*
+ * Argument decoding
+ */
+enum tirpc_trace_kind {
+	TT_NONE = 0,
+	TT_PTR,
+	TT_INT,
+	TT_UINT,
+	TT_HEX,
+	TT_STR,
+};
+
+struct tirpc_trace_desc {
+	const char *name;
+	struct {
+		enum tirpc_trace_kind kind;
+		const char *label;
+	} arg[TIRPC_TRACE_ARGS];
+};
+
+static const struct tirpc_trace_desc tirpc_trace_desc[TIRPC_TRACE_EVENTS] = {
+	[TIRPC_TRACE_XPRT] = { "xprt_trace",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_UINT, "xp_refs"},
+		  {TT_STR, "in"}, {TT_STR, "from"} } },
+	[TIRPC_TRACE_SVC_VC_RECV] = { "svc_vc_recv",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_INT, "recv"},
+		  {TT_UINT, "need"}, {TT_HEX, "flags"} } },
+	[TIRPC_TRACE_SVC_VC_EAGAIN] = { "svc_vc_recv (try again)",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_INT, "errno"} } },
+	[TIRPC_TRACE_SVC_RQST_EVENT] = { "svc_rqst_epoll_event",
+		{ {TT_PTR, "rec"}, {TT_INT, "fd"}, {TT_UINT, "xp_refs"},
+		  {TT_HEX, "events"} } },
+	[TIRPC_TRACE_SVC_RQST_REARM] = { "svc_rqst_rearm_events",
+		{ {TT_PTR, "rec"}, {TT_INT, "fd"}, {TT_UINT, "xp_refs"},
+		  {TT_INT, "evchan"}, {TT_INT, "epoll_fd"} } },
+	[TIRPC_TRACE_SVC_RQST_WAIT] = { "svc_rqst_epoll_loop",
+		{ {TT_INT, "epoll_fd"}, {TT_INT, "timeout_ms"} } },
+	[TIRPC_TRACE_SVC_RQST_WAKEUP] = { "svc_rqst_epoll_event (wakeup)",
+		{ {TT_INT, "fd"}, {TT_PTR, "sr_rec"} } },
+	[TIRPC_TRACE_CLNT_REQ_WAIT] = { "clnt_req_wait_reply",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_UINT, "xid"},
+		  {TT_INT, "sec"}, {TT_INT, "nsec"} } },
+	[TIRPC_TRACE_CLNT_REQ_REPLIED] = { "clnt_req_wait_reply (replied)",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_UINT, "xid"} } },
+	[TIRPC_TRACE_CLNT_REQ_RESULT] = { "clnt_req_process_reply",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_UINT, "xid"},
+		  {TT_INT, "result"} } },
+	[TIRPC_TRACE_CLNT_REQ_IGNORED] = { "clnt_req_process_reply (ignored)",
+		{ {TT_PTR, "xprt"}, {TT_INT, "fd"}, {TT_UINT, "xid"},
+		  {TT_INT, "result"} } },
+};
+
+static void
+tirpc_trace_detach(void *arg)
+{
+	struct tirpc_trace_ring *ring = arg;
+
+	atomic_store_uint32_t(&ring->tt_owned, 0);
+}
+
+static void
+tirpc_trace_init(void)
+{
+	(void)pthread_key_create(&tirpc_trace_key, tirpc_trace_detach);
+}
+
+static struct tirpc_trace_ring *
+tirpc_trace_attach(void)
+{
+	struct tirpc_trace_ring *ring;
+	uint32_t n = MIN(atomic_fetch_uint32_t(&tirpc_trace_nrings),
+			 TIRPC_TRACE_RINGS);
+	uint32_t ix;
+
+	(void)pthread_once(&tirpc_trace_once, tirpc_trace_init);
+
+	/* recycle the ring of an exited thread */
+	for (ix = 0; ix < n; ix++) {
+		ring = atomic_fetch_voidptr((void **)&tirpc_trace_rings[ix]);
+		if (ring && atomic_cas_uint32_t(&ring->tt_owned, 0, 1))
+			goto out;
+	}
+
+	ix = atomic_postinc_uint32_t(&tirpc_trace_nrings);
+	if (ix >= TIRPC_TRACE_RINGS) {
+		__warnx(TIRPC_DEBUG_FLAG_WARN,
+			"%s: more than %d tracing threads, not traced",
+			__func__, TIRPC_TRACE_RINGS);
+		tirpc_trace_full = true;
+		return (NULL);
+	}
+	ring = mem_aligned(CACHE_LINE_SIZE, sizeof(*ring));
+	memset(ring, 0, sizeof(*ring));
+	ring->tt_id = ix;
+	ring->tt_owned = 1;
+	atomic_store_voidptr((void **)&tirpc_trace_rings[ix], ring);
+
+ out:
+	(void)pthread_setspecific(tirpc_trace_key, ring);
+	tirpc_trace_self = ring;
+	return (ring);
+}
+
+void
+tirpc_trace_put(uint32_t event, uint32_t line, uint64_t a0, uint64_t a1,
+		uint64_t a2, uint64_t a3, uint64_t a4)
+{
+	struct tirpc_trace_ring *ring = tirpc_trace_self;
+	struct tirpc_trace_rec *rec;
+	struct timespec ts;
+	uint64_t pos;
+
+	if (unlikely(!ring)) {
+		if (tirpc_trace_full)
+			return;
+		ring = tirpc_trace_attach();
+		if (!ring)
+			return;
+	}
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	pos = ring->tt_head;
+	rec = &ring->tt_rec[pos & TIRPC_TRACE_MASK];
+
+	__atomic_store_n(&rec->tr_seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rec->tr_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	rec->tr_event = event;
+	rec->tr_line = line;
+	rec->tr_arg[0] = a0;
+	rec->tr_arg[1] = a1;
+	rec->tr_arg[2] = a2;
+	rec->tr_arg[3] = a3;
+	rec->tr_arg[4] = a4;
+	__atomic_store_n(&rec->tr_seq, ((uint64_t)ring->tt_id << 48)
+					| (pos + 1), __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->tt_head, pos + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Copy records not yet drained, ring by ring (each in order).
+ * Callers must serialize.
+ */
+u_int
+tirpc_trace_drain(struct tirpc_trace_rec *out, u_int max, uint64_t *lost)
+{
+	struct tirpc_trace_ring *ring;
+	struct tirpc_trace_rec *rec;
+	uint32_t n = MIN(atomic_fetch_uint32_t(&tirpc_trace_nrings),
+			 TIRPC_TRACE_RINGS);
+	uint64_t dropped = 0;
+	uint64_t head;
+	uint64_t pos;
+	uint64_t seq;
+	uint32_t ix;
+	u_int count = 0;
+
+	for (ix = 0; ix < n && count < max; ix++) {
+		ring = atomic_fetch_voidptr((void **)&tirpc_trace_rings[ix]);
+		if (!ring)
+			continue;
+
+		head = __atomic_load_n(&ring->tt_head, __ATOMIC_ACQUIRE);
+		pos = ring->tt_tail;
+		if (head - pos > TIRPC_TRACE_RING_SIZE) {
+			dropped += head - pos - TIRPC_TRACE_RING_SIZE;
+			pos = head - TIRPC_TRACE_RING_SIZE;
+		}
+
+		for (; pos < head && count < max; pos++) {
+			rec = &ring->tt_rec[pos & TIRPC_TRACE_MASK];
+			seq = ((uint64_t)ring->tt_id << 48) | (pos + 1);
+
+			if (__atomic_load_n(&rec->tr_seq, __ATOMIC_ACQUIRE)
+			    != seq) {
+				dropped++;
+				continue;
+			}
+			out[count] = *rec;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&rec->tr_seq, __ATOMIC_RELAXED)
+			    != seq) {
+				/* overwritten while copying */
+				dropped++;
+				continue;
+			}
+			count++;
+		}
+		ring->tt_tail = pos;
+	}
+
+	if (lost)
+		*lost += dropped;
+	return (count);
+}
+
+static int
+tirpc_trace_args(const struct tirpc_trace_rec *rec, char *buf, size_t len)
+{
+	const struct tirpc_trace_desc *desc = &tirpc_trace_desc[rec->tr_event];
+	const char *s;
+	size_t n = 0;
+	int i;
+	int r;
+
+	for (i = 0; i < TIRPC_TRACE_ARGS; i++) {
+		uint64_t a = rec->tr_arg[i];
+
+		switch (desc->arg[i].kind) {
+		case TT_PTR:
+			r = snprintf(buf + n, len - n, " %s %p",
+				     desc->arg[i].label, (void *)(uintptr_t)a);
+			break;
+		case TT_INT:
+			r = snprintf(buf + n, len - n, " %s %" PRId64,
+				     desc->arg[i].label, (int64_t)a);
+			break;
+		case TT_UINT:
+			r = snprintf(buf + n, len - n, " %s %" PRIu64,
+				     desc->arg[i].label, a);
+			break;
+		case TT_HEX:
+			r = snprintf(buf + n, len - n, " %s %#" PRIx64,
+				     desc->arg[i].label, a);
+			break;
+		case TT_STR:
+			s = (const char *)(uintptr_t)a;
+			r = snprintf(buf + n, len - n, " %s %s",
+				     desc->arg[i].label, s ? s : "(null)");
+			break;
+		case TT_NONE:
+		default:
+			continue;
+		}
+		if (r < 0)
+			return (r);
+		n += r;
+		if (n >= len)
+			break;
+	}
+	return (n);
+}
+
+/*
+ * Decode one record (as snprintf).  String arguments are only valid in
+ * the process that recorded them.
+ */
+int
+tirpc_trace_format(const struct tirpc_trace_rec *rec, char *buf, size_t len)
+{
+	int n;
+	int r;
+
+	if (rec->tr_event >= TIRPC_TRACE_EVENTS
+	 || !tirpc_trace_desc[rec->tr_event].name)
+		return snprintf(buf, len, "%" PRIu64 ".%09" PRIu64
+				" [%" PRIu32 "] event %" PRIu32,
+				rec->tr_ns / 1000000000,
+				rec->tr_ns % 1000000000,
+				TIRPC_TRACE_RING(rec->tr_seq), rec->tr_event);
+
+	n = snprintf(buf, len, "%" PRIu64 ".%09" PRIu64
+		     " [%" PRIu32 "] %s:%" PRIu32,
+		     rec->tr_ns / 1000000000, rec->tr_ns % 1000000000,
+		     TIRPC_TRACE_RING(rec->tr_seq),
+		     tirpc_trace_desc[rec->tr_event].name, rec->tr_line);
+	if (n < 0 || (size_t)n >= len)
+		return (n);
+
+	r = tirpc_trace_args(rec, buf + n, len - n);
+	return (r < 0 ? r : n + r);
+}
+
+/* tracing not enabled for this site:  format as before */
+void
+tirpc_trace_warnx(uint32_t event, uint32_t line, uint64_t a0, uint64_t a1,
+		  uint64_t a2, uint64_t a3, uint64_t a4)
+{
+	struct tirpc_trace_rec rec = {
+		.tr_event = event,
+		.tr_line = line,
+		.tr_arg = { a0, a1, a2, a3, a4 },
+	};
+	char buf[256] = "";
+
+	if (event >= TIRPC_TRACE_EVENTS || !tirpc_trace_desc[event].name)
+		return;
+
+	(void)tirpc_trace_args(&rec, buf, sizeof(buf));
+	__ntirpc_pkg_params.warnx_("%s:%" PRIu32 "%s",
+				   tirpc_trace_desc[event].name, line, buf);
+}
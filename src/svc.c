@@ -76,12 +76,25 @@
 #include "rpc_rdma.h"
 #endif
 #include "svc_ioq.h"
+#include <misc/city.h>
+#include <rpc/rpc_cksum.h>
+#include <rpc/xdr_ioq.h>
+#ifdef _HAVE_GSSAPI
+#include <rpc/gss_internal.h>
+#endif
 
 #define SVC_VERSQUIET 0x0001	/* keep quiet about vers mismatch */
 #define version_keepquiet(xp) ((u_long)(xp)->xp_p3 & SVC_VERSQUIET)
 
 #define SVC_WORK_POOL_THRD_MIN (2)
 
+/* RPCSEC_GSS replay window bounds (sequence numbers) */
+#define SVC_GSS_SEQ_WIN_DEFAULT (128)
+#define SVC_GSS_SEQ_WIN_MAX (4096)
+
+/* smallest RPCSEC_GSS reply sealed by the crypto stage (bytes) */
+#define SVC_GSS_CRYPTO_MIN_DEFAULT (32768)
+
 /* svc_internal.h */
 #ifdef IOV_MAX
 int __svc_maxiov = IOV_MAX;
@@ -170,6 +183,15 @@ svc_init(svc_init_params *params)
 	if (params->flags & SVC_INIT_NOREG_XPRTS)
 		__svc_params->flags |= SVC_FLAG_NOREG_XPRTS;
 
+	if (params->flags & SVC_INIT_AUTH_SHORT)
+		__svc_params->flags |= SVC_FLAG_AUTH_SHORT;
+
+	if (params->flags & SVC_INIT_ARENA)
+		__svc_params->flags |= SVC_FLAG_ARENA;
+
+	if (params->flags & SVC_INIT_LATENCY)
+		svc_latency_enabled = true;
+
 	if (params->ioq_send_max)
 		__svc_params->ioq.send_max = params->ioq_send_max;
 	else
@@ -225,6 +247,38 @@ svc_init(svc_init_params *params)
 	else
 		__svc_params->gss.max_gc = 200;
 
+	/* replay window, in whole bitmap words */
+	__svc_params->gss.seq_win = SVC_GSS_SEQ_WIN_DEFAULT;
+	if (params->gss_seq_win)
+		__svc_params->gss.seq_win = params->gss_seq_win;
+	if (__svc_params->gss.seq_win > SVC_GSS_SEQ_WIN_MAX)
+		__svc_params->gss.seq_win = SVC_GSS_SEQ_WIN_MAX;
+	__svc_params->gss.seq_win = (__svc_params->gss.seq_win + 31) & ~31;
+
+	/* optional crypto stage for large replies */
+	__svc_params->gss.crypto_thrd_max = params->gss_crypto_thrd_max;
+	if (params->gss_crypto_min)
+		__svc_params->gss.crypto_min = params->gss_crypto_min;
+	else
+		__svc_params->gss.crypto_min = SVC_GSS_CRYPTO_MIN_DEFAULT;
+
+#ifdef _HAVE_GSSAPI
+	svcauth_gss_crypto_init();
+#endif /* _HAVE_GSSAPI */
+
+	__svc_params->authsys.max_cred = params->authsys_max_cred;
+	svcauth_unix_init();
+
+	/* duplicate request cache checksum */
+	__svc_params->drc.mode = params->drc_cksum;
+	if (__svc_params->drc.mode > SVC_DRC_CKSUM_STREAM) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() drc_cksum (%u) unknown, using prefix",
+			__func__, params->drc_cksum);
+		__svc_params->drc.mode = SVC_DRC_CKSUM_PREFIX;
+	}
+	__svc_params->drc.len = params->drc_cksum_len;
+
 #ifdef USE_RPC_RDMA
 	rpc_rdma_internals_init();
 #endif
@@ -247,6 +301,49 @@ svc_init(svc_init_params *params)
 	return true;
 }
 
+/*
+ * Package global counterpart of SVC_CONTROL()
+ */
+bool
+svc_control(const u_int rq, void *in)
+{
+	switch (rq) {
+	case SVC_CTL_LATENCY_GET:
+	case SVC_CTL_LATENCY_RESET:
+	case SVC_CTL_LATENCY_ENABLE:
+		return svc_latency_control(rq, in);
+	case SVC_CTL_XPRT_STATS_GET:
+		return svc_xprt_stats_collect((struct svc_xprt_stats_snapshot *)
+					      in);
+	case SVC_CTL_SLOW_SET:
+	case SVC_CTL_SLOW_GET:
+	case SVC_CTL_SLOW_DUMP:
+		return svc_slow_control(rq, in);
+	case SVC_CTL_WORK_POOL_GET:
+		work_pool_stats_get(&svc_work_pool,
+				    (struct work_pool_stats *)in);
+		return (true);
+	case SVC_CTL_BUFFERS_GET:
+		xdr_ioq_stats_get((struct svc_buffer_stats *)in);
+		return (true);
+	case SVC_CTL_GSS_CACHE_GET:
+#ifdef _HAVE_GSSAPI
+		return authgss_ctx_hash_stats((struct svc_gss_cache_stats *)
+					      in);
+#else
+		return (false);
+#endif /* _HAVE_GSSAPI */
+	case SVC_CTL_CLEAN_IDLE:
+	{
+		struct svc_clean_idle *sweep = (struct svc_clean_idle *)in;
+
+		return svc_rqst_clean_idle(sweep->timeout, sweep);
+	}
+	default:
+		return (false);
+	}
+}
+
 /* ***************  SVCXPRT related stuff **************** */
 
 /*
@@ -484,6 +581,55 @@ svc_lookup(svc_rec_t **rec, svc_vers_range_t *vrange,
 	return (code);
 }
 
+/*
+ * Duplicate request cache checksum (xp_checksum) of the call body, at
+ * data with length contiguous bytes.
+ *
+ * A prefix misses retransmissions that differ only further into the
+ * payload; the body modes do not.  The stream mode continues through
+ * the later segments of an xdr_ioq record, with crc32c so that the
+ * result does not depend on the segmentation, and keeps the length in
+ * the upper half.
+ */
+uint64_t
+svc_drc_cksum(struct svc_req *req, void *data, size_t length)
+{
+	XDR *xdrs = req->rq_xdrs;
+	struct poolq_entry *have;
+	struct xdr_ioq_uv *uv;
+	uint64_t bytes = length;
+	uint32_t crc;
+	u_int len;
+
+	switch (__svc_params->drc.mode) {
+	case SVC_DRC_CKSUM_BODY:
+		return CityHash64WithSeed(data, length, 103);
+	case SVC_DRC_CKSUM_STREAM:
+		break;
+	default:
+		/* CityHash64 is -substantially- faster than the software
+		 * crc32c, so prefer it while only hashing this buffer */
+		len = __svc_params->drc.len;
+		if (!len)
+			len = SVC_DRC_CKSUM_LEN_DEFAULT;
+		return CityHash64WithSeed(data, MIN(len, length), 103);
+	}
+
+	crc = calculate_crc32c(0, data, length);
+	if (xdrs && xdrs->x_ops == &xdr_ioq_ops
+	 && (uint8_t *)data == xdrs->x_data) {
+		uv = IOQV(xdrs->x_base);
+		for (have = TAILQ_NEXT(&uv->uvq, q); have;
+		     have = TAILQ_NEXT(have, q)) {
+			uv = IOQ_(have);
+			crc = calculate_crc32c(crc, uv->v.vio_head,
+					       ioquv_length(uv));
+			bytes += ioquv_length(uv);
+		}
+	}
+	return (bytes << 32) | crc;
+}
+
 /* ******************* REPLY GENERATION ROUTINES  ************ */
 
 /*
@@ -750,6 +896,14 @@ svc_shutdown(u_long flags)
 	/* release workers after event channels */
 	work_pool_shutdown(&svc_work_pool);
 
+#ifdef _HAVE_GSSAPI
+	/* after workers, which queue sealing */
+	svcauth_gss_crypto_shutdown();
+#endif /* _HAVE_GSSAPI */
+
+	/* after workers, which hold interned credentials */
+	svcauth_unix_shutdown();
+
 	/* XXX assert quiescent */
 
 	return (code);
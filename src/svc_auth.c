@@ -41,6 +41,8 @@
 #include <rpc/rpc.h>
 #include <rpc/svc_auth.h>
 #include <stdlib.h>
+#include "rpc_probe.h"
+#include "svc_internal.h"
 
 /*
  * svcauthsw is the bdevsw of server side authentication.
@@ -55,7 +57,32 @@
  *		struct svc_req *rqst;
  *		struct rpc_msg *msg;
  *
+ * Small flavor numbers index svc_auth_flavors[] directly;  the entry also
+ * carries the flavor capabilities (see svc_auth_reply()).  Larger
+ * flavor numbers are found on the Auths list.
+ *
+ * Entries are written once, under authsvc_lock:  the flags, then the
+ * handler is published (release), so that a request reading the handler
+ * (acquire) without the lock also sees the flags.
  */
+#define SVC_AUTH_FLAVORS	16
+
+struct svc_auth_flavor {
+	enum auth_stat (*handler) (struct svc_req *);
+	uint32_t flags;
+};
+
+static struct svc_auth_flavor svc_auth_flavors[SVC_AUTH_FLAVORS] = {
+	[AUTH_NONE] = { _svcauth_none, SVC_AUTH_FLAG_NOWRAP },
+	[AUTH_SYS] = { _svcauth_unix, SVC_AUTH_FLAG_NOWRAP },
+	[AUTH_SHORT] = { _svcauth_short, SVC_AUTH_FLAG_NOWRAP },
+#ifdef DES_BUILTIN
+	[AUTH_DES] = { _svcauth_des, SVC_AUTH_FLAG_NONE },
+#endif
+#ifdef USE_RPC_TLS
+	[AUTH_TLS] = { _svcauth_tls, SVC_AUTH_FLAG_NOWRAP },
+#endif
+};
 
 /* declarations to allow servers to specify new authentication flavors */
 struct authsvc {
@@ -81,40 +108,29 @@ static struct authsvc *Auths;
  *
  * There is an assumption that any flavour less than AUTH_NULL is invalid.
  */
-enum auth_stat
-svc_auth_authenticate(struct svc_req *req, bool *no_dispatch)
+static enum auth_stat
+svc_auth_flavor(struct svc_req *req, bool *no_dispatch)
 {
+	enum auth_stat (*handler) (struct svc_req *);
 	struct authsvc *asp;
-	enum auth_stat rslt;
 	int cred_flavor;
 	extern mutex_t authsvc_lock;
 
-	/* VARIABLES PROTECTED BY authsvc_lock: asp, Auths */
 	req->rq_msg.RPCM_ack.ar_verf = _null_auth;
 	cred_flavor = req->rq_msg.cb_cred.oa_flavor;
-	switch (cred_flavor) {
+
 #ifdef _HAVE_GSSAPI
-	case RPCSEC_GSS:
-		rslt = _svcauth_gss(req, no_dispatch);
-		return (rslt);
+	if (cred_flavor == RPCSEC_GSS)
+		return (_svcauth_gss(req, no_dispatch));
 #endif /* _HAVE_GSSAPI */
-	case AUTH_NONE:
-		rslt = _svcauth_none(req);
-		return (rslt);
-		break;
-	case AUTH_SYS:
-		rslt = _svcauth_unix(req);
-		return (rslt);
-	case AUTH_SHORT:
-		rslt = _svcauth_short(req);
-		return (rslt);
-#ifdef DES_BUILTIN
-	case AUTH_DES:
-		rslt = _svcauth_des(req);
-		return (rslt);
-#endif
-	default:
-		break;
+
+	if ((u_int)cred_flavor < SVC_AUTH_FLAVORS) {
+		handler = __atomic_load_n(
+				&svc_auth_flavors[cred_flavor].handler,
+				__ATOMIC_ACQUIRE);
+		if (handler)
+			return ((*handler) (req));
+		return (AUTH_REJECTEDCRED);
 	}
 
 	/* flavor doesn't match any of the builtin types, so try new ones */
@@ -132,13 +148,56 @@ svc_auth_authenticate(struct svc_req *req, bool *no_dispatch)
 	return (AUTH_REJECTEDCRED);
 }
 
+/* as above, reporting the result to tracers;  resets the request arena */
+enum auth_stat
+svc_auth_authenticate(struct svc_req *req, bool *no_dispatch)
+{
+	enum auth_stat rslt;
+
+	/* not for the flavor's own decoding (RPCSEC_GSS control) */
+	xdr_arena_init(&req->rq_arena, XDR_ARENA_FLAG_NONE);
+	rslt = svc_auth_flavor(req, no_dispatch);
+	if (rslt == AUTH_OK && !*no_dispatch
+	 && (__svc_params->flags & SVC_FLAG_ARENA))
+		req->rq_arena.xa_flags |= XDR_ARENA_FLAG_ENABLED;
+
+	svc_slow_stamp(req->rq_slow, SVC_SLOW_AUTH);
+	RPC_PROBE4(svc_auth, req->rq_msg.rm_xid, req->rq_xprt->xp_fd,
+		   req->rq_msg.cb_cred.oa_flavor, rslt);
+	return (rslt);
+}
+
+/*
+ * Encode the results of a successful reply, skipping the indirect
+ * SVCAUTH_WRAP() for flavors that never wrap.  The request was
+ * authenticated, so its flavor entry is already visible.
+ */
+bool
+svc_auth_reply(struct svc_req *req, XDR *xdrs)
+{
+	u_int flavor = req->rq_msg.cb_cred.oa_flavor;
+
+	if (flavor < SVC_AUTH_FLAVORS
+	 && (__atomic_load_n(&svc_auth_flavors[flavor].flags,
+			     __ATOMIC_RELAXED) & SVC_AUTH_FLAG_NOWRAP))
+		return ((*req->rq_msg.RPCM_ack.ar_results.proc)
+			(xdrs, req->rq_msg.RPCM_ack.ar_results.where));
+	return (SVCAUTH_WRAP(req, xdrs));
+}
+
 /*
  *  Allow the rpc service to register new authentication types that it is
  *  prepared to handle.  When an authentication flavor is registered,
  *  the flavor is checked against already registered values.  If not
- *  registered, then a new Auths entry is added on the list.
+ *  registered, then a new entry is added to svc_auth_flavors[] (or for
+ *  large flavor numbers, the Auths list).
  *
- *  There is no provision to delete a registration once registered.
+ *  Flavors are expected to be registered before service begins;  there is
+ *  no provision to delete a registration once registered.
+ *
+ *  flags declares the flavor capabilities (below SVC_AUTH_FLAVORS):
+ *	SVC_AUTH_FLAG_NOWRAP	results are encoded directly, without
+ *				SVCAUTH_WRAP()
  *
  *  This routine returns:
  *	 0 if registration successful
@@ -146,41 +205,53 @@ svc_auth_authenticate(struct svc_req *req, bool *no_dispatch)
  *	-1 if can't register (errno set)
  */
 
-int svc_auth_reg(int cred_flavor,
-		 enum auth_stat (*handler) (struct svc_req *))
+int
+svc_auth_reg_flags(int cred_flavor,
+		   enum auth_stat (*handler) (struct svc_req *),
+		   uint32_t flags)
 {
 	struct authsvc *asp;
 	extern mutex_t authsvc_lock;
 
-	switch (cred_flavor) {
-	case AUTH_NULL:
-	case AUTH_SYS:
-	case AUTH_SHORT:
-	case RPCSEC_GSS:
-#ifdef DES_BUILTIN
-	case AUTH_DES:
-#endif
+	if (cred_flavor == RPCSEC_GSS) {
 		/* already registered */
 		return (1);
+	}
 
-	default:
-		mutex_lock(&authsvc_lock);
-		for (asp = Auths; asp; asp = asp->next) {
-			if (asp->flavor == cred_flavor) {
-				/* already registered */
-				mutex_unlock(&authsvc_lock);
-				return (1);
-			}
+	mutex_lock(&authsvc_lock);
+	if ((u_int)cred_flavor < SVC_AUTH_FLAVORS) {
+		if (svc_auth_flavors[cred_flavor].handler) {
+			/* already registered */
+			mutex_unlock(&authsvc_lock);
+			return (1);
 		}
-
-		/* this is a new one, so go ahead and register it */
-		asp = mem_alloc(sizeof(*asp));
-		asp->flavor = cred_flavor;
-		asp->handler = handler;
-		asp->next = Auths;
-		Auths = asp;
+		svc_auth_flavors[cred_flavor].flags = flags;
+		__atomic_store_n(&svc_auth_flavors[cred_flavor].handler,
+				 handler, __ATOMIC_RELEASE);
 		mutex_unlock(&authsvc_lock);
-		break;
+		return (0);
 	}
+
+	for (asp = Auths; asp; asp = asp->next) {
+		if (asp->flavor == cred_flavor) {
+			/* already registered */
+			mutex_unlock(&authsvc_lock);
+			return (1);
+		}
+	}
+
+	/* this is a new one, so go ahead and register it */
+	asp = mem_alloc(sizeof(*asp));
+	asp->flavor = cred_flavor;
+	asp->handler = handler;
+	asp->next = Auths;
+	Auths = asp;
+	mutex_unlock(&authsvc_lock);
 	return (0);
 }
+
+int svc_auth_reg(int cred_flavor,
+		 enum auth_stat (*handler) (struct svc_req *))
+{
+	return (svc_auth_reg_flags(cred_flavor, handler, SVC_AUTH_FLAG_NONE));
+}
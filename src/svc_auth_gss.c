@@ -42,6 +42,12 @@
 #include <rpc/svc_auth.h>
 #include <rpc/gss_internal.h>
 #include <misc/portable.h>
+#include "svc_internal.h"
+#ifdef HAVE_GSS_IOV
+#include <rpc/xdr_ioq.h>
+#include <rpc/work_pool.h>
+#include "svc_ioq.h"
+#endif
 
 static struct svc_auth_ops svc_auth_gss_ops;
 
@@ -105,19 +111,6 @@ svcauth_gss_import_name(char *service)
 	return (true);
 }
 
-#ifdef __APPLE__
-/* there's also mach_absolute_time() - don't know if it's faster */
-#define get_time_fast()	time(0)
-#else
-static inline int64_t
-get_time_fast(void)
-{
-	struct timespec ts[1];
-	(void)clock_gettime(CLOCK_MONOTONIC_FAST, ts);
-	return ts->tv_sec;
-}
-#endif
-
 bool
 svcauth_gss_acquire_cred(void)
 {
@@ -221,22 +214,33 @@ svcauth_gss_accept_sec_context(struct svc_req *req,
 		gss_release_buffer(&min_stat, &gr->gr_token);
 		return (false);
 	}
-	/* ANDROS: krb5 mechglue returns ctx of size 8 - two pointers,
-	 * one to the mechanism oid, one to the internal_ctx_id */
-	gr->gr_ctx.value = mem_alloc(sizeof(gss_union_ctx_id_desc));
-	memcpy(gr->gr_ctx.value, gd->ctx, sizeof(gss_union_ctx_id_desc));
-	gr->gr_ctx.length = sizeof(gss_union_ctx_id_desc);
+	/* the handle is the context id itself (see authgss_ctx_hash_get),
+	 * not a copy of the mechglue structure behind it
+	 */
+	gr->gr_ctx.value = mem_alloc(sizeof(gd->ctx));
+	memcpy(gr->gr_ctx.value, &gd->ctx, sizeof(gd->ctx));
+	gr->gr_ctx.length = sizeof(gd->ctx);
 
 	/* ANDROS: change for debugging linux kernel version...
 	   gr->gr_win = 0x00000005;
 	 */
-	gr->gr_win = sizeof(gd->seqmask) * 8;
+	if (!gd->seqwin.ring) {
+		gd->win = __svc_params->gss.seq_win;
+		if (!gd->win)
+			gd->win = SVC_RPC_GSS_SEQ_WIN_MIN;
+
+		/* one extra word covers the partial block at the trailing
+		 * edge of the window */
+		gd->seqwin.nwords = (gd->win / 32) + 1;
+		gd->seqwin.ring = mem_calloc(gd->seqwin.nwords,
+					     sizeof(uint64_t));
+	}
+	gr->gr_win = gd->win;
 
 	/* Save client info. */
 	gd->sec.mech = mech;
 	gd->sec.qop = GSS_C_QOP_DEFAULT;
 	gd->sec.svc = gc->gc_svc;
-	gd->win = gr->gr_win;
 
 	if (time_rec == GSS_C_INDEFINITE) time_rec = INDEF_EXPIRE;
 	if (time_rec > 10) time_rec -= 5;
@@ -381,6 +385,54 @@ svcauth_gss_nextverf(struct svc_req *req, struct svc_rpc_gss_data *gd,
 	return (true);
 }
 
+/*
+ * Lock-free replay detection (RFC 2203 5.3.3.1).
+ *
+ * Each ring word covers a block of 32 sequence numbers.  A word is
+ * claimed by a newer block with a single compare and swap, so any
+ * sequence number whose block has been displaced is too old, and an
+ * already marked bit is a replay.  Returns false if the request must be
+ * silently discarded.
+ */
+static bool
+svcauth_gss_seq_check(struct svc_rpc_gss_data *gd, uint32_t seq)
+{
+	uint64_t *word;
+	uint64_t old;
+	uint32_t block = seq / 32;
+	uint32_t bit = 1U << (seq % 32);
+	uint32_t last = atomic_fetch_uint32_t(&gd->seqwin.last);
+
+	if (last >= gd->win && seq <= last - gd->win)
+		return (false);
+
+	word = &gd->seqwin.ring[block % gd->seqwin.nwords];
+	do {
+		old = atomic_fetch_uint64_t(word);
+
+		if ((old >> 32) > block)
+			return (false);
+
+		if ((old >> 32) < block) {
+			if (atomic_cas_uint64_t(word, old,
+						((uint64_t)block << 32) | bit))
+				break;
+			continue;
+		}
+
+		if (old & bit)
+			return (false);
+	} while (!atomic_cas_uint64_t(word, old, old | bit));
+
+	/* advance the trailing edge */
+	while (seq > last) {
+		if (atomic_cas_uint32_t(&gd->seqwin.last, last, seq))
+			break;
+		last = atomic_fetch_uint32_t(&gd->seqwin.last);
+	}
+	return (true);
+}
+
 #define svcauth_gss_return(code) \
 	do { \
 		if (gc) \
@@ -398,7 +450,7 @@ _svcauth_gss(struct svc_req *req, bool *no_dispatch)
 	struct svc_rpc_gss_data *gd = NULL;
 	struct rpc_gss_cred *gc = NULL;
 	struct rpc_gss_init_res gr;
-	int call_stat, offset;
+	int call_stat;
 	OM_uint32 min_stat;
 	bool gd_locked = false;
 	bool gd_hashed = false;
@@ -464,39 +516,30 @@ _svcauth_gss(struct svc_req *req, bool *no_dispatch)
 		gd->auth = auth;
 	}
 
-	/* Serialize context. */
-	mutex_lock(&gd->lock);
-	gd_locked = true;
-
 	/* thread auth */
 	req->rq_auth = gd->auth;
 
-	/* Check sequence number. */
+	/* Check sequence number (without gd->lock) */
 	if (gd->established) {
 		if (get_time_fast() >= gd->endtime) {
 			*no_dispatch = true;
 			svcauth_gss_return(RPCSEC_GSS_CREDPROBLEM);
 		}
 
-		/* XXX implied serialization?  or just fudging?  advance if
-		 * greater? */
-		offset = gd->seqlast - gc->gc_seq;
-		if (offset < 0) {
-			gd->seqlast = gc->gc_seq;
-			offset = 0 - offset;
-			gd->seqmask <<= offset;
-			offset = 0;
-		} else if (offset >= gd->win || (gd->seqmask & (1 << offset))) {
+		if (!svcauth_gss_seq_check(gd, gc->gc_seq)) {
 			*no_dispatch = true;
 			svcauth_gss_return(AUTH_OK);
 		}
-		gd->seqmask |= (1 << offset);	/* XXX harmless */
 
 		req->rq_ap1 = (void *)(uintptr_t) gc->gc_seq; /* GCC casts */
 		req->rq_clntname = (char *) gd->client_name;
 		req->rq_svcname = (char *) gd->ctx;
 	}
 
+	/* Serialize context. */
+	mutex_lock(&gd->lock);
+	gd_locked = true;
+
 	/* gd->established */
 	/* Handle RPCSEC_GSS control procedure. */
 	switch (gc->gc_proc) {
@@ -523,25 +566,16 @@ _svcauth_gss(struct svc_req *req, bool *no_dispatch)
 
 		*no_dispatch = true;
 
-		req->rq_msg.RPCM_ack.ar_results.where = &gr;
-		req->rq_msg.RPCM_ack.ar_results.proc =
-					(xdrproc_t) xdr_rpc_gss_init_res;
-		call_stat = svc_sendreply(req);
-
-		/* XXX */
-		gss_release_buffer(&min_stat, &gr.gr_token);
-		gss_release_buffer(&min_stat, &gd->checksum);
-		mem_free(gr.gr_ctx.value, 0);
-
-		if (call_stat >= XPRT_DIED)
-			svcauth_gss_return(AUTH_FAILED);
-
+		/* an established context must be found by the first data
+		 * call, which may arrive as soon as the reply is sent
+		 */
 		if (gr.gr_major == GSS_S_COMPLETE) {
 			gd->established = true;
 			if (!gd_hashed) {
 
 				/* krb5 pac -- try all that apply */
 				gss_buffer_desc attr, display_buffer;
+				OM_uint32 maj_stat;
 
 				/* completely generic */
 				int auth = 1, comp = 0, more = -1;
@@ -555,17 +589,17 @@ _svcauth_gss(struct svc_req *req, bool *no_dispatch)
 				attr.value = "urn:mspac:";
 				attr.length = 10;
 
-				gr.gr_major =
-				    gss_get_name_attribute(&gr.gr_minor,
+				maj_stat =
+				    gss_get_name_attribute(&min_stat,
 							   gd->client_name,
 							   &attr, &auth, &comp,
 							   &gd->pac.ms_pac,
 							   &display_buffer,
 							   &more);
 
-				if (gr.gr_major == GSS_S_COMPLETE) {
+				if (maj_stat == GSS_S_COMPLETE) {
 					/* dont need it */
-					gss_release_buffer(&gr.gr_minor,
+					gss_release_buffer(&min_stat,
 							   &display_buffer);
 					gd->flags |= SVC_RPC_GSS_FLAG_MSPAC;
 				}
@@ -573,6 +607,19 @@ _svcauth_gss(struct svc_req *req, bool *no_dispatch)
 				(void)authgss_ctx_hash_set(gd);
 			}
 		}
+
+		req->rq_msg.RPCM_ack.ar_results.where = &gr;
+		req->rq_msg.RPCM_ack.ar_results.proc =
+					(xdrproc_t) xdr_rpc_gss_init_res;
+		call_stat = svc_sendreply(req);
+
+		/* XXX */
+		gss_release_buffer(&min_stat, &gr.gr_token);
+		gss_release_buffer(&min_stat, &gd->checksum);
+		mem_free(gr.gr_ctx.value, 0);
+
+		if (call_stat >= XPRT_DIED)
+			svcauth_gss_return(AUTH_FAILED);
 		break;
 
 		/* XXX next 2 cases:  is it correct to leave gd in cache
@@ -664,6 +711,9 @@ svcauth_gss_destroy(SVCAUTH *auth)
 		gss_release_buffer(&min_stat, &gd->pac.ms_pac);
 
 	gss_release_buffer(&min_stat, &gd->checksum);
+	if (gd->seqwin.ring)
+		mem_free(gd->seqwin.ring,
+			 gd->seqwin.nwords * sizeof(uint64_t));
 	mutex_destroy(&gd->lock);
 
 	mem_free(gd, sizeof(*gd));
@@ -672,6 +722,143 @@ svcauth_gss_destroy(SVCAUTH *auth)
 	return (true);
 }
 
+#ifdef HAVE_GSS_IOV
+/*
+ * Optional crypto stage.
+ *
+ * Sealing (get_mic or wrap) a large stream reply is handed to a small,
+ * separately bounded work pool, so that request workers are released as
+ * soon as the results are encoded.  The crypto thread then queues the
+ * sealed reply for output, as svc_vc_reply() would have.
+ *
+ * Replies of fewer than gss.crypto_min bytes are sealed inline, as the
+ * task switch would cost more than the crypto.  A krb5 token covers the
+ * whole body, so a single reply cannot be split across threads;  the
+ * parallelism is across replies.
+ */
+static struct work_pool svc_gss_crypto_pool;
+
+struct svc_rpc_gss_seal {
+	struct work_pool_entry wpe;
+	struct rpc_gss_wrap_iov wi;
+	struct svc_rpc_gss_data *gd;
+	struct xdr_ioq *xioq;
+	SVCXPRT *xprt;
+};
+
+void
+svcauth_gss_crypto_init(void)
+{
+	struct work_pool_params params = {
+		.thrd_max = __svc_params->gss.crypto_thrd_max,
+		.thrd_min = 1,
+	};
+
+	if (!params.thrd_max)
+		return;
+
+	if (work_pool_init(&svc_gss_crypto_pool, "gss_", &params)) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() work_pool_init failed, sealing inline",
+			__func__);
+		__svc_params->gss.crypto_thrd_max = 0;
+	}
+}
+
+void
+svcauth_gss_crypto_shutdown(void)
+{
+	if (__svc_params->gss.crypto_thrd_max)
+		work_pool_shutdown(&svc_gss_crypto_pool);
+}
+
+static void
+svcauth_gss_seal_callback(struct work_pool_entry *wpe)
+{
+	struct svc_rpc_gss_seal *seal =
+		opr_containerof(wpe, struct svc_rpc_gss_seal, wpe);
+	struct svc_rpc_gss_data *gd = seal->gd;
+	SVCXPRT *xprt = seal->xprt;
+	bool result;
+
+	mutex_lock(&gd->lock);
+	result = xdr_rpc_gss_wrap_seal(seal->xioq->xdrs, gd->ctx,
+				       gd->sec.qop, &seal->wi);
+	mutex_unlock(&gd->lock);
+
+	if (result) {
+		xdr_tail_update(seal->xioq->xdrs);
+		svc_ioq_write_now(xprt, seal->xioq);
+	} else {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: %p fd %d seal failed (will set dead)",
+			__func__, xprt, xprt->xp_fd);
+		XDR_DESTROY(seal->xioq->xdrs);
+		SVC_DESTROY(xprt);
+	}
+
+	unref_svc_rpc_gss_data(gd, SVC_RPC_GSS_FLAG_NONE);
+	SVC_RELEASE(xprt, SVC_RELEASE_FLAG_NONE);
+	mem_free(seal, sizeof(*seal));
+}
+
+/*
+ * Marshal the reply, then defer sealing to the crypto pool when it is
+ * large enough.  On deferral (*deferred), the stream belongs to the
+ * crypto stage, and may already be written and destroyed on return.
+ */
+static bool
+svcauth_gss_wrap_deferred(struct svc_req *req, struct xdr_ioq *xioq,
+			  struct svc_rpc_gss_data *gd, rpc_gss_svc_t svc,
+			  u_int gc_seq, bool *deferred)
+{
+	XDR *xdrs = xioq->xdrs;
+	struct svc_rpc_gss_seal *seal;
+	struct rpc_gss_wrap_iov wi;
+	bool result;
+
+	mutex_lock(&gd->lock);
+	result = xdr_rpc_gss_wrap_marshal(xdrs,
+				req->rq_msg.RPCM_ack.ar_results.proc,
+				req->rq_msg.RPCM_ack.ar_results.where,
+				gd->ctx, gd->sec.qop, svc, gc_seq, &wi);
+	if (result && wi.end - wi.data < __svc_params->gss.crypto_min) {
+		result = xdr_rpc_gss_wrap_seal(xdrs, gd->ctx, gd->sec.qop,
+					       &wi);
+		mutex_unlock(&gd->lock);
+		return (result);
+	}
+	mutex_unlock(&gd->lock);
+
+	if (!result)
+		return (FALSE);
+
+	seal = mem_alloc(sizeof(*seal));
+	seal->wi = wi;
+	seal->gd = gd;
+	seal->xioq = xioq;
+	seal->xprt = req->rq_xprt;
+	seal->wpe.fun = svcauth_gss_seal_callback;
+
+	atomic_inc_uint32_t(&gd->refcnt);
+	SVC_REF(req->rq_xprt, SVC_REF_FLAG_NONE);
+	*deferred = true;
+
+	work_pool_submit(&svc_gss_crypto_pool, &seal->wpe);
+	return (TRUE);
+}
+#else
+void
+svcauth_gss_crypto_init(void)
+{
+}
+
+void
+svcauth_gss_crypto_shutdown(void)
+{
+}
+#endif /* HAVE_GSS_IOV */
+
 static bool
 svcauth_gss_wrap(struct svc_req *req, XDR *xdrs)
 {
@@ -681,7 +868,12 @@ svcauth_gss_wrap(struct svc_req *req, XDR *xdrs)
 					req->rq_msg.rq_cred_body;
 	bool result;
 
-	if (!gd->established || gc->gc_svc == RPCSEC_GSS_SVC_NONE)
+	/* context creation replies are never wrapped (RFC 2203 5.2.3.1),
+	 * and are sent with gd->lock held
+	 */
+	if (!gd->established || gc->gc_svc == RPCSEC_GSS_SVC_NONE
+	 || gc->gc_proc == RPCSEC_GSS_INIT
+	 || gc->gc_proc == RPCSEC_GSS_CONTINUE_INIT)
 		return (svc_auth_none.svc_ah_ops->svc_ah_wrap(req, xdrs));
 
 	mutex_lock(&gd->lock);
@@ -703,9 +895,11 @@ svcauth_gss_unwrap(struct svc_req *req)
 		return (svc_auth_none.svc_ah_ops->svc_ah_unwrap(req));
 
 	mutex_lock(&gd->lock);
+	xdr_arena_attach(req->rq_xdrs, &req->rq_arena);
 	result = xdr_rpc_gss_unwrap(req->rq_xdrs, req->rq_msg.rm_xdr.proc,
 				    req->rq_msg.rm_xdr.where, gd->ctx,
 				    gd->sec.qop, gd->sec.svc, gc_seq);
+	xdr_arena_detach(req->rq_xdrs);
 	mutex_unlock(&gd->lock);
 	return (result);
 }
@@ -782,6 +976,7 @@ xdr_rpc_gss_checksum(struct svc_req *req, gss_ctx_id_t ctx, gss_qop_t qop,
 	}
 	/* Decode rpc_gss_data_t (sequence number + arguments). */
 	xdrmem_create(&tmpxdrs, databuf.value, databuf.length, XDR_DECODE);
+	xdr_arena_attach(&tmpxdrs, &req->rq_arena);
 	SVC_CHECKSUM(req, databuf.value, databuf.length);
 	xdr_stat = (XDR_GETUINT32(&tmpxdrs, &seq_num)
 		    && (*req->rq_msg.rm_xdr.proc)
@@ -825,6 +1020,39 @@ static struct svc_auth_ops svc_auth_gss_ops = {
 	svcauth_gss_destroy
 };
 
+/*
+ * SVCAUTH_WRAP() of a stream reply (svc_vc_reply()), deferring the
+ * sealing of large replies to the crypto stage.  When *deferred, the
+ * stream is no longer the caller's, and must not be touched.
+ */
+bool
+svcauth_gss_reply_ioq(struct svc_req *req, struct xdr_ioq *xioq,
+		      bool *deferred)
+{
+#ifdef HAVE_GSS_IOV
+	struct svc_rpc_gss_data *gd;
+	struct rpc_gss_cred *gc;
+#endif
+
+	*deferred = false;
+#ifdef HAVE_GSS_IOV
+	if (!__svc_params->gss.crypto_thrd_max
+	 || req->rq_auth->svc_ah_ops != &svc_auth_gss_ops)
+		return (SVCAUTH_WRAP(req, xioq->xdrs));
+
+	gd = SVCAUTH_PRIVATE(req->rq_auth);
+	gc = (struct rpc_gss_cred *)req->rq_msg.rq_cred_body;
+	if (gd->established
+	 && gc->gc_proc != RPCSEC_GSS_INIT
+	 && gc->gc_proc != RPCSEC_GSS_CONTINUE_INIT
+	 && (gc->gc_svc == RPCSEC_GSS_SVC_INTEGRITY
+	  || gc->gc_svc == RPCSEC_GSS_SVC_PRIVACY))
+		return (svcauth_gss_wrap_deferred(req, xioq, gd, gc->gc_svc,
+				(u_int) (uintptr_t) req->rq_ap1, deferred));
+#endif
+	return (SVCAUTH_WRAP(req, xioq->xdrs));
+}
+
 char *
 svcauth_gss_get_principal(SVCAUTH *auth)
 {
@@ -49,17 +49,26 @@ svcauth_none_wrap(struct svc_req *req, XDR *xdrs)
 static bool
 svcauth_none_unwrap(struct svc_req *req)
 {
-	return ((*req->rq_msg.rm_xdr.proc)
-		(req->rq_xdrs, req->rq_msg.rm_xdr.where));
+	XDR *xdrs = req->rq_xdrs;
+	bool rslt;
+
+	xdr_arena_attach(xdrs, &req->rq_arena);
+	rslt = (*req->rq_msg.rm_xdr.proc) (xdrs, req->rq_msg.rm_xdr.where);
+	xdr_arena_detach(xdrs);
+	return (rslt);
 }
 
 static bool
 svcauth_none_checksum(struct svc_req *req)
 {
 	XDR *xdrs = req->rq_xdrs;
+	bool rslt;
 
 	SVC_CHECKSUM(req, xdrs->x_data, xdr_size_inline(xdrs));
-	return ((*req->rq_msg.rm_xdr.proc) (xdrs, req->rq_msg.rm_xdr.where));
+	xdr_arena_attach(xdrs, &req->rq_arena);
+	rslt = (*req->rq_msg.rm_xdr.proc) (xdrs, req->rq_msg.rm_xdr.where);
+	xdr_arena_detach(xdrs);
+	return (rslt);
 }
 
 static bool
@@ -32,7 +32,7 @@
  * There are two svc auth implementations here: AUTH_UNIX and AUTH_SHORT.
  * _svcauth_unix does full blown unix style uid,gid+gids auth,
  * _svcauth_short uses a shorthand auth to index into a cache of longhand auths.
- * Note: the shorthand has been gutted for efficiency.
+ * Note: the shorthand is only honored when the cache is configured.
  *
  * Copyright (C) 1984, Sun Microsystems, Inc.
  */
@@ -45,33 +45,370 @@
 #include <rpc/rpc.h>
 #include <rpc/svc.h>
 #include <rpc/svc_auth.h>
+#include <misc/abstract_atomic.h>
+#include <misc/city.h>
+#include <misc/rbtree_x.h>
+#include "svc_internal.h"
 
 extern SVCAUTH svc_auth_none;
 
+struct area {
+	struct authunix_parms area_aup;
+	char area_machname[MAX_MACHINE_NAME + 1];
+	gid_t area_gids[NGRPS];
+};
+
 /*
- * Unix longhand authenticator
+ * AUTH_SYS credential cache
+ *
+ * When svc_init_params.authsys_max_cred is set, parsed credentials are
+ * interned by a hash of their raw bytes (less the timestamp).  Requests
+ * share the cached credential:  aup_machname and aup_gids point into the
+ * entry, which is held until SVCAUTH_RELEASE(), as for RPCSEC_GSS.
+ *
+ * With SVC_INIT_AUTH_SHORT, replies carry an AUTH_SHORT verifier naming
+ * the entry (hash and serial number), for the client to send instead of
+ * the full credential.  A short credential that is no longer cached is
+ * rejected, and the client falls back to its AUTH_SYS credential.
+ *
+ * Recency is approximated CLOCK-style, as in the GSS context cache.
  */
-enum auth_stat
-_svcauth_unix(struct svc_req *req)
+#define SVCAUTH_UNIX_PARTITIONS 13
+#define SVCAUTH_UNIX_CACHESZ 255
+#define SVCAUTH_UNIX_SEED 0x5ecd
+#define SVCAUTH_UNIX_SHORT_LEN (3 * BYTES_PER_XDR_UNIT)
+
+#define SVCAUTH_UNIX_FLAG_NONE		0x0000
+#define SVCAUTH_UNIX_FLAG_REFERENCED	0x0001
+
+struct svcauth_unix_cred {
+	struct opr_rbtree_node node_k;
+	TAILQ_ENTRY(svcauth_unix_cred) lru_q;
+	SVCAUTH auth;
+	uint64_t hk;
+	uint32_t refcnt;
+	uint32_t flags;
+	uint32_t serial;
+	u_int len;		/* of raw, the credential less timestamp */
+	struct authunix_parms aup;
+	char machname[MAX_MACHINE_NAME + 1];
+	gid_t gids[NGRPS];
+	/* struct short_hand_verf, serialized */
+	char verf[2 * BYTES_PER_XDR_UNIT + SVCAUTH_UNIX_SHORT_LEN];
+	char raw[];
+};
+
+TAILQ_HEAD(svcauth_unix_lru, svcauth_unix_cred);
+
+struct svcauth_unix_part {
+	uint32_t size;
+	struct svcauth_unix_lru lru_q;
+};
+
+static struct {
+	mutex_t lock;
+	struct rbtree_x xt;
+	uint32_t max_part;
+	uint32_t serial;
+	bool initialized;
+} svcauth_unix_cache = {
+	MUTEX_INITIALIZER,	/* lock */
+	{
+	 0,			/* npart */
+	 RBT_X_FLAG_NONE,	/* flags */
+	 SVCAUTH_UNIX_CACHESZ,	/* cachesz */
+	 NULL			/* tree */
+	 },			/* xt */
+	0,			/* max_part */
+	0,			/* serial */
+	false			/* initialized */
+};
+
+static int
+svcauth_unix_cmpf(const struct opr_rbtree_node *lhs,
+		  const struct opr_rbtree_node *rhs)
+{
+	struct svcauth_unix_cred *lk, *rk;
+
+	lk = opr_containerof(lhs, struct svcauth_unix_cred, node_k);
+	rk = opr_containerof(rhs, struct svcauth_unix_cred, node_k);
+
+	if (lk->hk < rk->hk)
+		return (-1);
+
+	if (lk->hk == rk->hk)
+		return (0);
+
+	return (1);
+}
+
+void
+svcauth_unix_init(void)
+{
+	struct rbtree_x_part *xp;
+	struct svcauth_unix_part *up;
+	int ix;
+
+	if (!__svc_params->authsys.max_cred)
+		return;
+
+	mutex_lock(&svcauth_unix_cache.lock);
+	if (svcauth_unix_cache.initialized)
+		goto unlock;
+
+	if (rbtx_init(&svcauth_unix_cache.xt, svcauth_unix_cmpf,
+		      SVCAUTH_UNIX_PARTITIONS,
+		      RBT_X_FLAG_ALLOC | RBT_X_FLAG_CACHE_RT)) {
+		__warnx(TIRPC_DEBUG_FLAG_AUTH, "%s: rbtx_init failed",
+			__func__);
+		goto unlock;
+	}
+
+	for (ix = 0; ix < SVCAUTH_UNIX_PARTITIONS; ++ix) {
+		xp = &(svcauth_unix_cache.xt.tree[ix]);
+		xp->cache = mem_calloc(svcauth_unix_cache.xt.cachesz,
+				       sizeof(struct opr_rbtree_node *));
+		up = mem_zalloc(sizeof(*up));
+		TAILQ_INIT(&up->lru_q);
+		xp->u1 = up;
+	}
+
+	svcauth_unix_cache.max_part =
+		__svc_params->authsys.max_cred / SVCAUTH_UNIX_PARTITIONS + 1;
+	svcauth_unix_cache.initialized = true;
+
+ unlock:
+	mutex_unlock(&svcauth_unix_cache.lock);
+}
+
+static inline void
+svcauth_unix_unref(struct svcauth_unix_cred *uc)
+{
+	if (atomic_dec_uint32_t(&uc->refcnt) == 0)
+		mem_free(uc, sizeof(*uc) + uc->len);
+}
+
+/* after the workers:  entries still held by a request are freed at its
+ * SVCAUTH_RELEASE()
+ */
+void
+svcauth_unix_shutdown(void)
+{
+	struct rbtree_x_part *xp;
+	struct svcauth_unix_part *up;
+	struct svcauth_unix_cred *uc;
+	int ix;
+
+	mutex_lock(&svcauth_unix_cache.lock);
+	if (!svcauth_unix_cache.initialized)
+		goto unlock;
+
+	for (ix = 0; ix < SVCAUTH_UNIX_PARTITIONS; ++ix) {
+		xp = &(svcauth_unix_cache.xt.tree[ix]);
+		up = xp->u1;
+
+		/* every entry is on the lru, holding the cache reference */
+		prof_rwlock_wrlock(&xp->lock, "svcauth_unix_cache.xt");
+		while ((uc = TAILQ_FIRST(&up->lru_q))) {
+			TAILQ_REMOVE(&up->lru_q, uc, lru_q);
+			opr_rbtree_remove(&xp->t, &uc->node_k);
+			svcauth_unix_unref(uc);
+		}
+		prof_rwlock_unlock(&xp->lock);
+
+		mem_free(up, sizeof(*up));
+		mem_free(xp->cache, svcauth_unix_cache.xt.cachesz *
+			 sizeof(struct opr_rbtree_node *));
+		rwlock_destroy(&xp->lock);
+		mutex_destroy(&xp->mtx);
+		pthread_spin_destroy(&xp->sp);
+	}
+
+	/* free tree */
+	mem_free(svcauth_unix_cache.xt.tree,
+		 SVCAUTH_UNIX_PARTITIONS * sizeof(struct rbtree_x_part));
+	svcauth_unix_cache.xt.tree = NULL;
+	svcauth_unix_cache.initialized = false;
+
+ unlock:
+	mutex_unlock(&svcauth_unix_cache.lock);
+}
+
+static bool
+svcauth_unix_wrap(struct svc_req *req, XDR *xdrs)
+{
+	return (svc_auth_none.svc_ah_ops->svc_ah_wrap(req, xdrs));
+}
+
+static bool
+svcauth_unix_unwrap(struct svc_req *req)
+{
+	return (svc_auth_none.svc_ah_ops->svc_ah_unwrap(req));
+}
+
+static bool
+svcauth_unix_checksum(struct svc_req *req)
+{
+	return (svc_auth_none.svc_ah_ops->svc_ah_checksum(req));
+}
+
+static bool
+svcauth_unix_release(struct svc_req *req)
+{
+	struct svcauth_unix_cred *uc = req->rq_auth->svc_ah_private;
+
+	req->rq_auth = &svc_auth_none;
+	svcauth_unix_unref(uc);
+	return (true);
+}
+
+static bool
+svcauth_unix_destroy(SVCAUTH *auth)
+{
+	return (true);
+}
+
+static struct svc_auth_ops svcauth_unix_ops = {
+	svcauth_unix_wrap,
+	svcauth_unix_unwrap,
+	svcauth_unix_checksum,
+	svcauth_unix_release,
+	svcauth_unix_destroy
+};
+
+/* returns a referenced entry, to be matched by the caller */
+static struct svcauth_unix_cred *
+svcauth_unix_get(uint64_t hk)
+{
+	struct svcauth_unix_cred uk, *uc = NULL;
+	struct opr_rbtree_node *ns;
+	struct rbtree_x_part *t;
+
+	uk.hk = hk;
+	t = rbtx_partition_of_scalar(&svcauth_unix_cache.xt, hk);
+
+	prof_rwlock_rdlock(&t->lock, "svcauth_unix_cache.xt");
+	ns = rbtree_x_cached_lookup(&svcauth_unix_cache.xt, t, &uk.node_k,
+				    hk);
+	if (ns) {
+		uc = opr_containerof(ns, struct svcauth_unix_cred, node_k);
+		(void)atomic_inc_uint32_t(&uc->refcnt);
+		if (!(atomic_fetch_uint32_t(&uc->flags)
+		      & SVCAUTH_UNIX_FLAG_REFERENCED))
+			(void)atomic_set_uint32_t_bits(&uc->flags,
+						SVCAUTH_UNIX_FLAG_REFERENCED);
+	}
+	prof_rwlock_unlock(&t->lock);
+
+	return (uc);
+}
+
+/* call with partition write locked */
+static void
+svcauth_unix_trim(struct rbtree_x_part *t, struct svcauth_unix_lru *reap)
+{
+	struct svcauth_unix_part *up = t->u1;
+	struct svcauth_unix_cred *uc;
+	uint32_t n = 2 * up->size;
+
+	while (up->size > svcauth_unix_cache.max_part && n-- > 0) {
+		uc = TAILQ_FIRST(&up->lru_q);
+		TAILQ_REMOVE(&up->lru_q, uc, lru_q);
+
+		/* second chance */
+		if (uc->flags & SVCAUTH_UNIX_FLAG_REFERENCED) {
+			(void)atomic_clear_uint32_t_bits(&uc->flags,
+						SVCAUTH_UNIX_FLAG_REFERENCED);
+			TAILQ_INSERT_TAIL(&up->lru_q, uc, lru_q);
+			continue;
+		}
+
+		rbtree_x_cached_remove(&svcauth_unix_cache.xt, t,
+				       &uc->node_k, uc->hk);
+		--(up->size);
+		TAILQ_INSERT_TAIL(reap, uc, lru_q);
+	}
+}
+
+/* returns a referenced entry, or NULL if another has the same hash */
+static struct svcauth_unix_cred *
+svcauth_unix_intern(uint64_t hk, const char *raw, u_int len,
+		    struct authunix_parms *aup)
+{
+	struct svcauth_unix_lru reap = TAILQ_HEAD_INITIALIZER(reap);
+	struct svcauth_unix_cred *uc, *next;
+	struct svcauth_unix_part *up;
+	struct rbtree_x_part *t;
+	int32_t *buf;
+
+	uc = mem_zalloc(sizeof(*uc) + len);
+	uc->auth.svc_ah_ops = &svcauth_unix_ops;
+	uc->auth.svc_ah_private = uc;
+	uc->hk = hk;
+	uc->refcnt = 2;		/* cache and request */
+	uc->serial = atomic_inc_uint32_t(&svcauth_unix_cache.serial);
+	uc->len = len;
+	memcpy(uc->raw, raw, len);
+
+	uc->aup = *aup;
+	uc->aup.aup_machname = strcpy(uc->machname, aup->aup_machname);
+	uc->aup.aup_gids = memcpy(uc->gids, aup->aup_gids,
+				  aup->aup_len * sizeof(gid_t));
+
+	buf = (int32_t *)uc->verf;
+	IXDR_PUT_ENUM(buf, AUTH_SHORT);
+	IXDR_PUT_U_INT32(buf, SVCAUTH_UNIX_SHORT_LEN);
+	IXDR_PUT_U_INT32(buf, hk >> 32);
+	IXDR_PUT_U_INT32(buf, hk);
+	IXDR_PUT_U_INT32(buf, uc->serial);
+
+	t = rbtx_partition_of_scalar(&svcauth_unix_cache.xt, hk);
+	up = t->u1;
+
+	prof_rwlock_wrlock(&t->lock, "svcauth_unix_cache.xt");
+	if (opr_rbtree_lookup(&t->t, &uc->node_k)) {
+		/* raced, or collided */
+		prof_rwlock_unlock(&t->lock);
+		mem_free(uc, sizeof(*uc) + len);
+		return (NULL);
+	}
+	(void)rbtree_x_cached_insert(&svcauth_unix_cache.xt, t, &uc->node_k,
+				     hk);
+	TAILQ_INSERT_TAIL(&up->lru_q, uc, lru_q);
+	if (++(up->size) > svcauth_unix_cache.max_part)
+		svcauth_unix_trim(t, &reap);
+	prof_rwlock_unlock(&t->lock);
+
+	while ((next = TAILQ_FIRST(&reap))) {
+		TAILQ_REMOVE(&reap, next, lru_q);
+		svcauth_unix_unref(next);
+	}
+	return (uc);
+}
+
+static inline void
+svcauth_unix_attach(struct svc_req *req, struct svcauth_unix_cred *uc,
+		    int32_t stamp)
+{
+	struct authunix_parms *aup =
+		(struct authunix_parms *)req->rq_msg.rq_cred_body;
+
+	*aup = uc->aup;
+	aup->aup_time = stamp;
+	req->rq_auth = &uc->auth;
+}
+
+static enum auth_stat
+svcauth_unix_parse(struct svc_req *req, struct area *area)
 {
 	enum auth_stat stat;
 	XDR xdrs;
 	struct authunix_parms *aup;
 	int32_t *buf;
-	struct area {
-		struct authunix_parms area_aup;
-		char area_machname[MAX_MACHINE_NAME + 1];
-		gid_t area_gids[NGRPS];
-	} *area;
 	u_int auth_len;
 	size_t str_len, gid_len;
 	u_int i;
 
-	assert(req != NULL);
-
-	req->rq_auth = &svc_auth_none;
-
-	area = (struct area *)req->rq_msg.rq_cred_body;
 	aup = &area->area_aup;
 	aup->aup_machname = area->area_machname;
 	aup->aup_gids = area->area_gids;
@@ -119,9 +456,6 @@ _svcauth_unix(struct svc_req *req)
 		stat = AUTH_BADCRED;
 		goto done;
 	}
-
-	/* get the verifier */
-	req->rq_msg.RPCM_ack.ar_verf = req->rq_msg.cb_verf;
 	stat = AUTH_OK;
  done:
 	XDR_DESTROY(&xdrs);
@@ -129,14 +463,106 @@ _svcauth_unix(struct svc_req *req)
 	return (stat);
 }
 
+static inline void
+svcauth_unix_verf(struct svc_req *req, struct svcauth_unix_cred *uc)
+{
+	if (uc && (__svc_params->flags & SVC_FLAG_AUTH_SHORT)) {
+		req->rq_msg.RPCM_ack.ar_verf.oa_flavor = AUTH_SHORT;
+		req->rq_msg.RPCM_ack.ar_verf.oa_length = sizeof(uc->verf);
+		memcpy(req->rq_msg.RPCM_ack.ar_verf.oa_body, uc->verf,
+		       sizeof(uc->verf));
+	} else
+		req->rq_msg.RPCM_ack.ar_verf = req->rq_msg.cb_verf;
+}
+
+/*
+ * Unix longhand authenticator
+ */
+enum auth_stat
+_svcauth_unix(struct svc_req *req)
+{
+	enum auth_stat stat;
+	struct svcauth_unix_cred *uc = NULL;
+	struct area *area;
+	char *raw = req->rq_msg.cb_cred.oa_body;
+	u_int auth_len = (u_int) req->rq_msg.cb_cred.oa_length;
+	uint64_t hk = 0;
+	int32_t stamp;
+	bool intern = svcauth_unix_cache.initialized;
+
+	assert(req != NULL);
+
+	req->rq_auth = &svc_auth_none;
+
+	/* the raw credential, less timestamp, identifies the entry */
+	if (intern && auth_len >= 5 * BYTES_PER_XDR_UNIT) {
+		memcpy(&stamp, raw, sizeof(stamp));
+		stamp = (int32_t)ntohl(stamp);
+		raw += BYTES_PER_XDR_UNIT;
+		auth_len -= BYTES_PER_XDR_UNIT;
+		hk = CityHash64WithSeed(raw, auth_len, SVCAUTH_UNIX_SEED);
+
+		uc = svcauth_unix_get(hk);
+		if (uc) {
+			if (uc->len == auth_len
+			 && !memcmp(uc->raw, raw, auth_len)) {
+				svcauth_unix_attach(req, uc, stamp);
+				svcauth_unix_verf(req, uc);
+				return (AUTH_OK);
+			}
+			/* collided, parse this one */
+			svcauth_unix_unref(uc);
+			intern = false;
+		}
+	} else
+		intern = false;
+
+	area = (struct area *)req->rq_msg.rq_cred_body;
+	stat = svcauth_unix_parse(req, area);
+	if (stat != AUTH_OK)
+		return (stat);
+
+	if (intern) {
+		uc = svcauth_unix_intern(hk, raw, auth_len, &area->area_aup);
+		if (uc)
+			svcauth_unix_attach(req, uc, stamp);
+	}
+
+	/* get the verifier */
+	svcauth_unix_verf(req, uc);
+	return (AUTH_OK);
+}
+
 /*
  * Shorthand unix authenticator
  * Looks up longhand in a cache.
  */
- /*ARGSUSED*/
 enum auth_stat
 _svcauth_short(struct svc_req *req)
 {
+	struct svcauth_unix_cred *uc;
+	uint32_t handle[3];
+	uint64_t hk;
+
 	req->rq_auth = &svc_auth_none;
-	return (AUTH_REJECTEDCRED);
+
+	if (!(__svc_params->flags & SVC_FLAG_AUTH_SHORT)
+	 || !svcauth_unix_cache.initialized
+	 || req->rq_msg.cb_cred.oa_length != SVCAUTH_UNIX_SHORT_LEN)
+		return (AUTH_REJECTEDCRED);
+
+	memcpy(handle, req->rq_msg.cb_cred.oa_body, sizeof(handle));
+	hk = ((uint64_t)ntohl(handle[0]) << 32) | ntohl(handle[1]);
+
+	uc = svcauth_unix_get(hk);
+	if (!uc)
+		return (AUTH_REJECTEDCRED);
+
+	if (uc->serial != ntohl(handle[2])) {
+		svcauth_unix_unref(uc);
+		return (AUTH_REJECTEDCRED);
+	}
+
+	svcauth_unix_attach(req, uc, uc->aup.aup_time);
+	return (AUTH_OK);
 }
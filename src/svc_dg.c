@@ -57,9 +57,8 @@
 #include "rpc_com.h"
 #include "svc_internal.h"
 #include "svc_xprt.h"
+#include "rpc_probe.h"
 #include <rpc/svc_rqst.h>
-#include <misc/city.h>
-#include <rpc/rpc_cksum.h>
 
 #ifndef MAX
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
@@ -82,6 +81,8 @@ static int svc_dg_store_pktinfo(struct msghdr *, SVCXPRT *);
 static void
 svc_dg_xprt_free(struct svc_dg_xprt *su)
 {
+	if (su->su_dr.ioq.ioq_slow)
+		svc_slow_free(su->su_dr.ioq.ioq_slow);
 	XDR_DESTROY(su->su_dr.ioq.xdrs);
 	rpc_dplx_rec_destroy(&su->su_dr);
 	mem_free(su, sizeof(struct svc_dg_xprt) + su->su_dr.maxrec);
@@ -276,6 +277,9 @@ svc_dg_rendezvous(SVCXPRT *xprt)
 		svc_dg_xprt_free(su);
 		return (XPRT_DIED);
 	}
+	rpc_dplx_stat_add(&REC_XPRT(xprt)->stats.bytes_in, rlen);
+	rpc_dplx_stat_inc(&REC_XPRT(xprt)->stats.records_in);
+	RPC_PROBE2(svc_record, xprt->xp_fd, 1);
 
 	__rpc_address_setup(&newxprt->xp_local);
 	__rpc_address_setup(&newxprt->xp_remote);
@@ -296,6 +300,11 @@ svc_dg_rendezvous(SVCXPRT *xprt)
 
 	xdrmem_create(su->su_dr.ioq.xdrs, iov.iov_base, iov.iov_len,
 		      XDR_DECODE);
+	if (svc_latency_enabled)
+		su->su_dr.ioq.ioq_ts = REC_XPRT(xprt)->recv.ev;
+	if (svc_slow_enabled)
+		svc_slow_recv(&su->su_dr.ioq, REC_XPRT(xprt),
+			      &newxprt->xp_remote.ss, rlen);
 
 	SVC_REF(xprt, SVC_REF_FLAG_NONE);
 	newxprt->xp_parent = xprt;
@@ -331,10 +340,17 @@ svc_dg_decode(struct svc_req *req)
 			__func__, xprt, xprt->xp_fd);
 		return (XPRT_DIED);
 	}
+	RPC_PROBE3(svc_decode, req->rq_msg.rm_xid, xprt->xp_fd,
+		   req->rq_msg.rm_direction);
 
 	/* in order of likelihood */
 	if (req->rq_msg.rm_direction == CALL) {
 		/* an ordinary call header */
+		svc_latency_call(req);
+		svc_slow_call(req);
+		RPC_PROBE5(svc_dispatch, req->rq_msg.rm_xid, xprt->xp_fd,
+			   req->rq_msg.cb_prog, req->rq_msg.cb_vers,
+			   req->rq_msg.cb_proc);
 		return xprt->xp_dispatch.process_cb(req);
 	}
 
@@ -354,14 +370,7 @@ svc_dg_decode(struct svc_req *req)
 static void
 svc_dg_checksum(struct svc_req *req, void *data, size_t length)
 {
-	req->rq_cksum =
-#if 1
-	/* CithHash64 is -substantially- faster than crc32c from FreeBSD
-	 * SCTP, so prefer it until fast crc32c bests it */
-		CityHash64WithSeed(data, MIN(256, length), 103);
-#else
-		calculate_crc32c(0, data, MIN(256, length));
-#endif
+	req->rq_cksum = svc_drc_cksum(req, data, length);
 }
 
 static enum xprt_stat
@@ -372,9 +381,14 @@ svc_dg_reply(struct svc_req *req)
 	XDR *xdrs = rec->ioq.xdrs;
 	struct svc_dg_xprt *su = DG_DR(rec);
 	struct msghdr *msg = &su->su_msghdr;
+	struct timespec ts;
 	struct iovec iov;
 	size_t slen;
 
+	if (req->rq_lat)
+		svc_latency_reply(req, &ts);
+	svc_slow_stamp(req->rq_slow, SVC_SLOW_REPLY);
+
 	if (!xprt->xp_remote.nb.len) {
 		__warnx(TIRPC_DEBUG_FLAG_WARN,
 			"%s: %p fd %d has no remote address",
@@ -394,12 +408,17 @@ svc_dg_reply(struct svc_req *req)
 	if (req->rq_msg.rm_reply.rp_stat == MSG_ACCEPTED
 	 && req->rq_msg.rm_reply.rp_acpt.ar_stat == SUCCESS
 	 && req->rq_auth
-	 && !SVCAUTH_WRAP(req, xdrs)) {
+	 && !svc_auth_reply(req, xdrs)) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s: %p fd %d SVCAUTH_WRAP failed (will set dead)",
 			__func__, xprt, xprt->xp_fd);
 		return (XPRT_DIED);
 	}
+	RPC_PROBE6(svc_reply, req->rq_msg.rm_xid, xprt->xp_fd,
+		   req->rq_msg.cb_prog, req->rq_msg.cb_vers,
+		   req->rq_msg.cb_proc,
+		   req->rq_msg.rm_reply.rp_acpt.ar_stat);
+
 	iov.iov_base = &su[1];
 	iov.iov_len = slen = XDR_GETPOS(xdrs);
 	msg->msg_iov = &iov;
@@ -408,13 +427,29 @@ svc_dg_reply(struct svc_req *req)
 	msg->msg_namelen = xprt->xp_remote.nb.len;
 	/* cmsg already set in svc_dg_rendezvous */
 
+	RPC_PROBE3(svc_write, req->rq_msg.rm_xid, xprt->xp_fd, slen);
 	if (sendmsg(xprt->xp_fd, msg, 0) != (ssize_t) slen) {
+		RPC_PROBE4(svc_written, req->rq_msg.rm_xid, xprt->xp_fd,
+			   slen, errno);
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s: %p fd %d sendmsg failed (will set dead)",
 			__func__, xprt, xprt->xp_fd);
 		return (XPRT_DIED);
 	}
+	RPC_PROBE4(svc_written, req->rq_msg.rm_xid, xprt->xp_fd, 0, 0);
+	if (xprt->xp_parent) {
+		rec = REC_XPRT(xprt->xp_parent);
+		rpc_dplx_stat_add(&rec->stats.bytes_out, slen);
+		rpc_dplx_stat_inc(&rec->stats.records_out);
+	}
 
+	if (req->rq_lat)
+		svc_latency_output(req->rq_lat, &ts);
+	if (req->rq_slow) {
+		svc_slow_done(req->rq_slow, slen);
+		su->su_dr.ioq.ioq_slow = NULL;
+		req->rq_slow = NULL;
+	}
 	return (XPRT_IDLE);
 }
 
@@ -505,14 +540,18 @@ svc_dg_control(SVCXPRT *xprt, const u_int rq, void *in)
 		xprt->xp_flags = *(u_int *) in;
 		break;
 	case SVCGET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		*(svc_xprt_fun_t *) in = xprt->xp_ops->xp_free_user_data;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
 		break;
 	case SVCSET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		xprt->xp_ops->xp_free_user_data = *(svc_xprt_fun_t) in;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
+		break;
+	case SVCGET_XP_STATS:
+		svc_xprt_stats_get(xprt->xp_parent ? xprt->xp_parent : xprt,
+				   (struct svc_xprt_stats *)in);
 		break;
 	default:
 		return (false);
@@ -526,7 +565,7 @@ svc_dg_override_ops(SVCXPRT *xprt, SVCXPRT *rendezvous)
 	static struct xp_ops ops;
 
 	/* VARIABLES PROTECTED BY ops_lock: ops, xp_type */
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 
 	/* Fill in type of service */
 	xprt->xp_type = XPRT_UDP;
@@ -543,7 +582,7 @@ svc_dg_override_ops(SVCXPRT *xprt, SVCXPRT *rendezvous)
 	}
 	svc_override_ops(&ops, rendezvous);
 	xprt->xp_ops = &ops;
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
 
 static void
@@ -551,7 +590,7 @@ svc_dg_rendezvous_ops(SVCXPRT *xprt)
 {
 	static struct xp_ops ops;
 
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 
 	xprt->xp_type = XPRT_UDP_RENDEZVOUS;
 
@@ -566,7 +605,7 @@ svc_dg_rendezvous_ops(SVCXPRT *xprt)
 		ops.xp_free_user_data = NULL;	/* no default */
 	}
 	xprt->xp_ops = &ops;
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
 
 /*
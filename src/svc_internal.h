@@ -26,6 +26,7 @@
 #ifndef TIRPC_SVC_INTERNAL_H
 #define TIRPC_SVC_INTERNAL_H
 
+#include <signal.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <misc/os_epoll.h>
@@ -62,8 +63,20 @@ struct svc_params {
 		int max_ctx;
 		int max_idle_gen;
 		int max_gc;
+		u_int seq_win;
+		u_int crypto_thrd_max;
+		u_int crypto_min;
 	} gss;
 
+	struct {
+		u_int max_cred;
+	} authsys;
+
+	struct {
+		u_int mode;
+		u_int len;
+	} drc;
+
 	struct {
 		u_int send_max;
 		u_int thrd_max;
@@ -112,6 +125,11 @@ struct svc_dg_xprt {
 struct svc_vc_xprt {
 	struct rpc_dplx_rec sx_dr;	/* SVCXPRT indexed by fd */
 	int32_t sx_fbtbc;		/* fragment bytes to be consumed */
+	uint32_t sx_rmark;		/* record marker, as received */
+	u_int sx_rmlen;			/* bytes of sx_rmark received */
+#ifdef USE_RPC_SHM
+	struct svc_shm *sx_shm;		/* shared-memory stream, or NULL */
+#endif
 };
 #define VC_DR(p) (opr_containerof((p), struct svc_vc_xprt, sx_dr))
 
@@ -147,9 +165,111 @@ svc_override_ops(struct xp_ops *ops, SVCXPRT *rendezvous)
 	}
 }
 
+/* in svc.c */
+uint64_t svc_drc_cksum(struct svc_req *, void *, size_t);
+
+/*
+ * Not a supported control:  a hook for tests/connbench.c, which includes
+ * this header.  Sweeps for idle xprts now, as the event loops do from
+ * time to time with svc_init_params.idle_timeout.  A timeout longer than
+ * any idle time walks the xprts without destroying any.  A sweep gives
+ * up after a few destroys; repeat while cleaned.  Fails if a sweep is
+ * already running.
+ */
+#define SVC_CTL_CLEAN_IDLE      11	/* struct svc_clean_idle * */
+
+struct svc_clean_idle {
+	int32_t timeout;		/* IN: seconds, <= 0 skips the walk */
+	uint32_t scanned;		/* OUT: xprts walked */
+	uint32_t cleaned;		/* OUT: idle xprts destroyed */
+};
+
 /* in svc_rqst.c */
 int svc_rqst_rearm_events(SVCXPRT *);
 int svc_rqst_xprt_register(SVCXPRT *, SVCXPRT *);
 void svc_rqst_xprt_unregister(SVCXPRT *);
+bool svc_rqst_clean_idle(int, struct svc_clean_idle *);
+
+/* in svc_auth.c */
+bool svc_auth_reply(struct svc_req *, XDR *);
+
+/* in svc_auth_unix.c */
+void svcauth_unix_init(void);
+void svcauth_unix_shutdown(void);
+
+/* in svc_latency.c */
+#define SVC_LATENCY_SLOTS 256		/* power of 2 */
+
+extern bool svc_latency_enabled;
+void svc_latency_dispatch(struct svc_req *);
+void svc_latency_reply(struct svc_req *, struct timespec *);
+void svc_latency_output(uint32_t, const struct timespec *);
+bool svc_latency_control(const u_int, void *);
+
+static inline void
+svc_latency_call(struct svc_req *req)
+{
+	req->rq_lat = 0;
+	if (svc_latency_enabled)
+		svc_latency_dispatch(req);
+}
+
+/* in xdr_ioq.c */
+void xdr_ioq_stats_get(struct svc_buffer_stats *);
+
+/* in svc_slow.c */
+extern bool svc_slow_enabled;
+extern volatile sig_atomic_t svc_slow_signalled;
+uint64_t svc_slow_now(void);
+void svc_slow_recv(struct xdr_ioq *, struct rpc_dplx_rec *,
+		   const struct sockaddr_storage *, uint32_t);
+void svc_slow_dispatch(struct svc_req *);
+void svc_slow_done(struct svc_slow_req *, uint32_t);
+void svc_slow_free(struct svc_slow_req *);
+void svc_slow_dump(void);
+bool svc_slow_control(const u_int, void *);
+
+static inline void
+svc_slow_call(struct svc_req *req)
+{
+	req->rq_slow = XIOQ(req->rq_xdrs)->ioq_slow;
+	if (req->rq_slow)
+		svc_slow_dispatch(req);
+}
+
+static inline void
+svc_slow_stamp(struct svc_slow_req *slow, enum svc_slow_stage stage)
+{
+	if (slow)
+		slow->ns[stage] = svc_slow_now();
+}
+
+/* dump requested by signal, from a thread that may log */
+static inline void
+svc_slow_check(void)
+{
+	if (unlikely(svc_slow_signalled))
+		svc_slow_dump();
+}
+
+#ifdef USE_RPC_TLS
+/* in rpc_tls.c */
+bool rpc_tls_accept(SVCXPRT *);
+#endif
+
+#ifdef USE_RPC_SHM
+/* in svc_shm.c */
+struct svc_shm;
+struct iovec;
+ssize_t svc_shm_recv(struct svc_shm *, void *, size_t);
+ssize_t svc_shm_writev(struct svc_shm *, const struct iovec *, int);
+void svc_shm_free(struct svc_shm *);
+SVCXPRT *svc_shm_connect(const int, u_int, const uint32_t);
+int svc_shm_sock(struct svc_shm *);
+int svc_shm_rxfd(struct svc_shm *);
+
+/* in svc_vc.c */
+SVCXPRT *svc_vc_ncreate_shm(struct svc_shm *, const uint32_t);
+#endif
 
 #endif				/* TIRPC_SVC_INTERNAL_H */
@@ -60,6 +60,7 @@
 #include "svc_internal.h"
 #include "svc_xprt.h"
 #include "rpc_dplx_internal.h"
+#include "rpc_probe.h"
 #include <rpc/svc_rqst.h>
 #include <rpc/xdr_ioq.h>
 #include <getpeereid.h>
@@ -103,9 +104,21 @@ svc_ioq_init(void)
 #define LAST_FRAG ((u_int32_t)(1 << 31))
 #define MAXALLOCA (256)
 
+/* every record (call or reply) begins with its xid */
+static inline uint32_t
+svc_ioq_xid(struct xdr_ioq *xioq)
+{
+	struct poolq_entry *have = TAILQ_FIRST(&xioq->ioq_uv.uvqh.qh);
+
+	if (!have || ioquv_length(IOQ_(have)) < sizeof(uint32_t))
+		return (0);
+	return (ntohl(*(uint32_t *)IOQ_(have)->v.vio_head));
+}
+
 static inline void
 svc_ioq_flushv(SVCXPRT *xprt, struct xdr_ioq *xioq)
 {
+	struct svc_xprt_stats *stats = &REC_XPRT(xprt)->stats;
 	struct iovec *iov, *tiov, *wiov;
 	struct poolq_entry *have;
 	struct xdr_ioq_uv *data;
@@ -136,6 +149,7 @@ svc_ioq_flushv(SVCXPRT *xprt, struct xdr_ioq *xioq)
 		remaining += tiov->iov_len;
 		ix++;
 	}
+	RPC_PROBE3(svc_write, svc_ioq_xid(xioq), xprt->xp_fd, remaining);
 
 	while (remaining > 0) {
 		if (iw == 0) {
@@ -166,24 +180,36 @@ svc_ioq_flushv(SVCXPRT *xprt, struct xdr_ioq *xioq)
 			/* writev return includes fragment header */
 			remaining += sizeof(u_int32_t);
 			fbytes += sizeof(u_int32_t);
+			rpc_dplx_stat_inc(&stats->frags_out);
 		}
 
 		/* blocking write */
+#ifdef USE_RPC_SHM
+		if (xprt->xp_type == XPRT_SHM)
+			result = svc_shm_writev(VC_DR(REC_XPRT(xprt))->sx_shm,
+						wiov, iw);
+		else
+#endif
 		result = writev(xprt->xp_fd, wiov, iw);
 		remaining -= result;
 
 		if (result == fbytes) {
+			rpc_dplx_stat_add(&stats->bytes_out, result);
 			wiov += iw - 1;
 			iw = 0;
 			continue;
 		}
 		if (unlikely(result < 0)) {
+			RPC_PROBE4(svc_written, svc_ioq_xid(xioq),
+				   xprt->xp_fd, remaining, errno);
 			__warnx(TIRPC_DEBUG_FLAG_ERROR,
 				"%s() writev failed (%d)\n",
 				__func__, errno);
 			SVC_DESTROY(xprt);
 			break;
 		}
+		rpc_dplx_stat_add(&stats->bytes_out, result);
+		rpc_dplx_stat_inc(&stats->partial_writes);
 		fbytes -= result;
 
 		/* rare? writev underrun? (assume never overrun) */
@@ -199,6 +225,11 @@ svc_ioq_flushv(SVCXPRT *xprt, struct xdr_ioq *xioq)
 		} /* for */
 	} /* while */
 
+	if (!remaining) {
+		rpc_dplx_stat_inc(&stats->records_out);
+		RPC_PROBE4(svc_written, svc_ioq_xid(xioq), xprt->xp_fd, 0, 0);
+	}
+
 	if (unlikely(vsize > MAXALLOCA)) {
 		mem_free(iov, vsize);
 	}
@@ -215,22 +246,31 @@ svc_ioq_write(SVCXPRT *xprt, struct xdr_ioq *xioq, struct poolq_head *ifph)
 		 && !(xprt->xp_flags & SVC_XPRT_FLAG_DESTROYED)) {
 			/* all systems are go! */
 			svc_ioq_flushv(xprt, xioq);
+			if (xioq->ioq_lat)
+				svc_latency_output(xioq->ioq_lat,
+						   &xioq->ioq_ts);
+			if (xioq->ioq_slow) {
+				svc_slow_done(xioq->ioq_slow,
+					      XDR_GETPOS(xioq->xdrs));
+				xioq->ioq_slow = NULL;
+			}
 		}
+		rpc_dplx_stat_dequeued(REC_XPRT(xprt));
 		SVC_RELEASE(xprt, SVC_RELEASE_FLAG_NONE);
 		XDR_DESTROY(xioq->xdrs);
 
-		mutex_lock(&ifph->qmutex);
+		prof_mutex_lock(&ifph->qmutex, "poolq_head.qmutex");
 		if (--(ifph->qcount) == 0)
 			break;
 
 		have = TAILQ_FIRST(&ifph->qh);
 		TAILQ_REMOVE(&ifph->qh, have, q);
-		mutex_unlock(&ifph->qmutex);
+		prof_mutex_unlock(&ifph->qmutex);
 
 		xioq = _IOQ(have);
 		xprt = (SVCXPRT *)xioq->xdrs[0].x_lib[1];
 	}
-	mutex_unlock(&ifph->qmutex);
+	prof_mutex_unlock(&ifph->qmutex);
 }
 
 static void
@@ -249,15 +289,16 @@ svc_ioq_write_now(SVCXPRT *xprt, struct xdr_ioq *xioq)
 	struct poolq_head *ifph = &ioq_ifqh[xprt->xp_ifindex & IOQ_IF_MASK];
 
 	SVC_REF(xprt, SVC_REF_FLAG_NONE);
-	mutex_lock(&ifph->qmutex);
+	rpc_dplx_stat_queued(REC_XPRT(xprt));
+	prof_mutex_lock(&ifph->qmutex, "poolq_head.qmutex");
 
 	if ((ifph->qcount)++ > 0) {
 		/* queue additional output requests without task switch */
 		TAILQ_INSERT_TAIL(&ifph->qh, &(xioq->ioq_s), q);
-		mutex_unlock(&ifph->qmutex);
+		prof_mutex_unlock(&ifph->qmutex);
 		return;
 	}
-	mutex_unlock(&ifph->qmutex);
+	prof_mutex_unlock(&ifph->qmutex);
 
 	/* handle this output request without queuing, then any additional
 	 * output requests without a task switch (using this thread).
@@ -278,17 +319,18 @@ svc_ioq_write_submit(SVCXPRT *xprt, struct xdr_ioq *xioq)
 	struct poolq_head *ifph = &ioq_ifqh[xprt->xp_ifindex & IOQ_IF_MASK];
 
 	SVC_REF(xprt, SVC_REF_FLAG_NONE);
-	mutex_lock(&ifph->qmutex);
+	rpc_dplx_stat_queued(REC_XPRT(xprt));
+	prof_mutex_lock(&ifph->qmutex, "poolq_head.qmutex");
 
 	if ((ifph->qcount)++ > 0) {
 		/* queue additional output requests, they will be handled by
 		 * existing thread without another task switch.
 		 */
 		TAILQ_INSERT_TAIL(&ifph->qh, &(xioq->ioq_s), q);
-		mutex_unlock(&ifph->qmutex);
+		prof_mutex_unlock(&ifph->qmutex);
 		return;
 	}
-	mutex_unlock(&ifph->qmutex);
+	prof_mutex_unlock(&ifph->qmutex);
 
 	xioq->ioq_wpe.fun = svc_ioq_write_callback;
 	work_pool_submit(&svc_work_pool, &xioq->ioq_wpe);
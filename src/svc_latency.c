@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file svc_latency.c
+ * @brief Per-procedure service latency histograms
+ *
+ * Three stages are timed for each call:
+ *  - queue:   the event that completed the record, to dispatch (after the
+ *             call header is decoded), including the svc_work_pool wait;
+ *  - service: dispatch to SVC_REPLY();
+ *  - output:  SVC_REPLY() to the reply being written (or sent).
+ *
+ * Histograms are keyed by (prog, vers, proc) in a small open-addressed
+ * table, populated without locks and never shrunk.  Each entry carries
+ * one set of histograms per shard, chosen by the current CPU, so that
+ * concurrent atomic increments seldom share a cache line.
+ *
+ * Buckets are log-linear:  4 per power of 2 nanoseconds (about 19%
+ * resolution), the last bucket catching everything above ~60 seconds.
+ */
+
+#include "config.h"
+
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#include <misc/abstract_atomic.h>
+
+#include "svc_internal.h"
+
+#define SVC_LATENCY_SHARDS 8		/* power of 2 */
+#define SVC_LATENCY_SUB_BITS 2
+
+/* slot states */
+#define SVC_LATENCY_FREE 0
+#define SVC_LATENCY_BUSY 1
+#define SVC_LATENCY_READY 2
+
+struct svc_latency_shard {
+	uint64_t count[SVC_LATENCY_STAGES][SVC_LATENCY_BUCKETS];
+};
+
+struct svc_latency_slot {
+	uint32_t state;
+	rpcprog_t prog;
+	rpcvers_t vers;
+	rpcproc_t proc;
+	struct svc_latency_shard *shard;	/* [SVC_LATENCY_SHARDS] */
+};
+
+bool svc_latency_enabled;
+
+static struct svc_latency_slot svc_latency_slots[SVC_LATENCY_SLOTS];
+static uint64_t svc_latency_dropped;
+
+static inline u_int
+svc_latency_bucket(uint64_t ns)
+{
+	u_int exp;
+	u_int idx;
+
+	if (ns < (1 << SVC_LATENCY_SUB_BITS))
+		return (ns);
+
+	exp = 63 - __builtin_clzll(ns);
+	idx = ((exp - SVC_LATENCY_SUB_BITS + 1) << SVC_LATENCY_SUB_BITS)
+	    + ((ns >> (exp - SVC_LATENCY_SUB_BITS))
+	       & ((1 << SVC_LATENCY_SUB_BITS) - 1));
+	return MIN(idx, SVC_LATENCY_BUCKETS - 1);
+}
+
+/* lower bound of a bucket, in nanoseconds */
+uint64_t
+svc_latency_bucket_ns(u_int idx)
+{
+	u_int exp;
+
+	if (idx < (1 << SVC_LATENCY_SUB_BITS))
+		return (idx);
+
+	exp = (idx >> SVC_LATENCY_SUB_BITS) + SVC_LATENCY_SUB_BITS - 1;
+	return ((uint64_t)((1 << SVC_LATENCY_SUB_BITS)
+			   | (idx & ((1 << SVC_LATENCY_SUB_BITS) - 1)))
+		<< (exp - SVC_LATENCY_SUB_BITS));
+}
+
+static inline uint64_t
+svc_latency_ns(const struct timespec *from, const struct timespec *to)
+{
+	int64_t ns = (int64_t)(to->tv_sec - from->tv_sec) * 1000000000LL
+		   + (to->tv_nsec - from->tv_nsec);
+
+	return (ns > 0 ? ns : 0);
+}
+
+static inline void
+svc_latency_add(uint32_t lat, enum svc_latency_stage stage,
+		const struct timespec *from, const struct timespec *to)
+{
+	struct svc_latency_slot *slot = &svc_latency_slots[lat - 1];
+	int cpu = sched_getcpu();
+	u_int shard = (cpu < 0 ? 0 : cpu) & (SVC_LATENCY_SHARDS - 1);
+
+	atomic_inc_uint64_t(&slot->shard[shard].count[stage]
+				[svc_latency_bucket(svc_latency_ns(from, to))]);
+}
+
+/* find or claim the slot for a procedure;  returns index + 1, or 0 */
+static uint32_t
+svc_latency_lookup(rpcprog_t prog, rpcvers_t vers, rpcproc_t proc)
+{
+	struct svc_latency_slot *slot;
+	uint32_t hash = (prog * 2654435761U) ^ (vers * 40503U) ^ proc;
+	uint32_t state;
+	u_int probe;
+	u_int ix;
+
+	for (probe = 0; probe < SVC_LATENCY_SLOTS; probe++) {
+		ix = (hash + probe) & (SVC_LATENCY_SLOTS - 1);
+		slot = &svc_latency_slots[ix];
+		state = atomic_fetch_uint32_t(&slot->state);
+
+		if (state == SVC_LATENCY_FREE) {
+			if (!atomic_cas_uint32_t(&slot->state,
+						 SVC_LATENCY_FREE,
+						 SVC_LATENCY_BUSY)) {
+				/* lost the race, look again */
+				state = atomic_fetch_uint32_t(&slot->state);
+				goto claimed;
+			}
+			slot->prog = prog;
+			slot->vers = vers;
+			slot->proc = proc;
+			slot->shard = mem_zalloc(SVC_LATENCY_SHARDS
+						 * sizeof(*slot->shard));
+			atomic_store_uint32_t(&slot->state,
+					      SVC_LATENCY_READY);
+			return (ix + 1);
+		}
+
+claimed:
+		/* rare:  wait for another thread's claim to complete */
+		while (state == SVC_LATENCY_BUSY) {
+			sched_yield();
+			state = atomic_fetch_uint32_t(&slot->state);
+		}
+
+		if (slot->prog == prog
+		 && slot->vers == vers
+		 && slot->proc == proc)
+			return (ix + 1);
+	}
+
+	atomic_inc_uint64_t(&svc_latency_dropped);
+	return (0);
+}
+
+/*
+ * Called by xp_decode after a CALL header is decoded.  The event time
+ * rides in the request stream (xdr_ioq).
+ */
+void
+svc_latency_dispatch(struct svc_req *req)
+{
+	struct xdr_ioq *xioq = XIOQ(req->rq_xdrs);
+
+	req->rq_lat = 0;
+	if (!timespecisset(&xioq->ioq_ts))
+		return;
+
+	req->rq_lat = svc_latency_lookup(req->rq_msg.cb_prog,
+					 req->rq_msg.cb_vers,
+					 req->rq_msg.cb_proc);
+	(void)clock_gettime(CLOCK_MONOTONIC, &req->rq_lat_ts);
+	if (req->rq_lat)
+		svc_latency_add(req->rq_lat, SVC_LATENCY_QUEUE,
+				&xioq->ioq_ts, &req->rq_lat_ts);
+}
+
+/* Called by xp_reply;  returns the start of the output stage in *ts */
+void
+svc_latency_reply(struct svc_req *req, struct timespec *ts)
+{
+	(void)clock_gettime(CLOCK_MONOTONIC, ts);
+	svc_latency_add(req->rq_lat, SVC_LATENCY_SERVICE,
+			&req->rq_lat_ts, ts);
+}
+
+/* Called after the reply is written */
+void
+svc_latency_output(uint32_t lat, const struct timespec *from)
+{
+	struct timespec now;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+	svc_latency_add(lat, SVC_LATENCY_OUTPUT, from, &now);
+}
+
+static bool
+svc_latency_snapshot(struct svc_latency_snapshot *snap)
+{
+	struct svc_latency_slot *slot = svc_latency_slots;
+	struct svc_latency_hist *hist = snap->hist;
+	u_int shard;
+	u_int stage;
+	u_int ix;
+	u_int b;
+
+	snap->count = 0;
+	snap->dropped = atomic_fetch_uint64_t(&svc_latency_dropped);
+
+	for (ix = 0; ix < SVC_LATENCY_SLOTS; ix++, slot++) {
+		if (atomic_fetch_uint32_t(&slot->state) != SVC_LATENCY_READY)
+			continue;
+		if (snap->count >= snap->max)
+			return (false);
+
+		memset(hist, 0, sizeof(*hist));
+		hist->prog = slot->prog;
+		hist->vers = slot->vers;
+		hist->proc = slot->proc;
+
+		for (shard = 0; shard < SVC_LATENCY_SHARDS; shard++)
+			for (stage = 0; stage < SVC_LATENCY_STAGES; stage++)
+				for (b = 0; b < SVC_LATENCY_BUCKETS; b++)
+					hist->count[stage][b] +=
+					    atomic_fetch_uint64_t(
+						&slot->shard[shard]
+						.count[stage][b]);
+		hist++;
+		snap->count++;
+	}
+	return (true);
+}
+
+static void
+svc_latency_reset(void)
+{
+	struct svc_latency_slot *slot = svc_latency_slots;
+	u_int ix;
+
+	/* concurrent samples may survive;  slots are kept */
+	for (ix = 0; ix < SVC_LATENCY_SLOTS; ix++, slot++) {
+		if (atomic_fetch_uint32_t(&slot->state) != SVC_LATENCY_READY)
+			continue;
+		memset(slot->shard, 0,
+		       SVC_LATENCY_SHARDS * sizeof(*slot->shard));
+	}
+	atomic_store_uint64_t(&svc_latency_dropped, 0);
+}
+
+bool
+svc_latency_control(const u_int rq, void *in)
+{
+	switch (rq) {
+	case SVC_CTL_LATENCY_GET:
+		return svc_latency_snapshot((struct svc_latency_snapshot *)in);
+	case SVC_CTL_LATENCY_RESET:
+		svc_latency_reset();
+		break;
+	case SVC_CTL_LATENCY_ENABLE:
+		svc_latency_enabled = *(bool *)in;
+		break;
+	default:
+		return (false);
+	}
+	return (true);
+}
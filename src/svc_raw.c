@@ -152,6 +152,7 @@ svc_raw_decode(struct svc_req *req)
 	xdrs->x_op = XDR_DECODE;
 	(void)XDR_SETPOS(xdrs, 0);
 	rpc_msg_init(&req->rq_msg);
+	req->rq_slow = NULL;
 
 	if (!xdr_callmsg(xdrs, &req->rq_msg))
 		return (XPRT_DIED);
@@ -205,7 +206,7 @@ svc_raw_ops(SVCXPRT *xprt)
 
 	/* VARIABLES PROTECTED BY ops_lock: ops */
 
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 	if (ops.xp_recv == NULL) {
 		ops.xp_recv = svc_raw_recv;
 		ops.xp_stat = svc_raw_stat;
@@ -217,5 +218,5 @@ svc_raw_ops(SVCXPRT *xprt)
 		ops.xp_free_user_data = NULL;	/* no default */
 	}
 	xprt->xp_ops = &ops;
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
@@ -157,6 +157,7 @@ svc_rdma_decode(struct svc_req *req)
 	XDR_SETPOS(xdrs, 0);
 	 */
 	rpc_msg_init(&req->rq_msg);
+	req->rq_slow = NULL;
 
 	if (!xdr_dplx_decode(xdrs, &req->rq_msg)) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
@@ -202,7 +203,7 @@ svc_rdma_reply(struct svc_req *req)
 	if (req->rq_msg.rm_reply.rp_stat == MSG_ACCEPTED
 	 && req->rq_msg.rm_reply.rp_acpt.ar_stat == SUCCESS
 	 && req->rq_auth
-	 && !SVCAUTH_WRAP(req, xdrs)) {
+	 && !svc_auth_reply(req, xdrs)) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s: SVCAUTH_WRAP failed (will set dead)",
 			__func__);
@@ -255,14 +256,14 @@ svc_rdma_control(SVCXPRT *xprt, const u_int rq, void *in)
 	    xprt->xp_flags = *(u_int *)in;
 	    break;
 	case SVCGET_XP_FREE_USER_DATA:
-	    mutex_lock(&ops_lock);
+	    prof_mutex_lock(&ops_lock, "ops_lock");
 	    *(svc_xprt_fun_t *)in = xprt->xp_ops->xp_free_user_data;
-	    mutex_unlock(&ops_lock);
+	    prof_mutex_unlock(&ops_lock);
 	    break;
 	case SVCSET_XP_FREE_USER_DATA:
-	    mutex_lock(&ops_lock);
+	    prof_mutex_lock(&ops_lock, "ops_lock");
 	    xprt->xp_ops->xp_free_user_data = *(svc_xprt_fun_t)in;
-	    mutex_unlock(&ops_lock);
+	    prof_mutex_unlock(&ops_lock);
 	    break;
 	default:
 	    return (FALSE);
@@ -277,7 +278,7 @@ svc_rdma_ops(SVCXPRT *xprt)
 
 	/* VARIABLES PROTECTED BY ops_lock: ops, xp_type */
 
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 
 	/* Fill in type of service */
 	xprt->xp_type = XPRT_RDMA;
@@ -294,5 +295,5 @@ svc_rdma_ops(SVCXPRT *xprt)
 	}
 	xprt->xp_ops = &ops;
 
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
@@ -51,6 +51,7 @@
 #include "clnt_internal.h"
 #include "svc_internal.h"
 #include "svc_xprt.h"
+#include "rpc_probe.h"
 
 /**
  * @file svc_rqst.c
@@ -232,7 +233,7 @@ svc_rqst_expire_insert(struct clnt_req *cc)
 
 	cc->cc_expire_ms = svc_rqst_expire_ms(&cc->cc_timeout);
 
-	mutex_lock(&sr_rec->ev_lock);
+	prof_mutex_lock(&sr_rec->ev_lock, "ev_lock");
 	cc->cc_flags = CLNT_REQ_FLAG_EXPIRING;
  repeat:
 	nv = opr_rbtree_insert(&sr_rec->call_expires, &cc->cc_rqst);
@@ -241,7 +242,7 @@ svc_rqst_expire_insert(struct clnt_req *cc)
 		cc->cc_expire_ms++;
 		goto repeat;
 	}
-	mutex_unlock(&sr_rec->ev_lock);
+	prof_mutex_unlock(&sr_rec->ev_lock);
 
 	ev_sig(sr_rec->sv[0], 0);	/* send wakeup */
 }
@@ -252,9 +253,9 @@ svc_rqst_expire_remove(struct clnt_req *cc)
 	struct cx_data *cx = CX_DATA(cc->cc_clnt);
 	struct svc_rqst_rec *sr_rec = cx->cx_rec->ev_p;
 
-	mutex_lock(&sr_rec->ev_lock);
+	prof_mutex_lock(&sr_rec->ev_lock, "ev_lock");
 	opr_rbtree_remove(&sr_rec->call_expires, &cc->cc_rqst);
-	mutex_unlock(&sr_rec->ev_lock);
+	prof_mutex_unlock(&sr_rec->ev_lock);
 
 	ev_sig(sr_rec->sv[0], 0);	/* send wakeup */
 }
@@ -268,6 +269,9 @@ svc_rqst_expire_task(struct work_pool_entry *wpe)
 					   CLNT_REQ_FLAG_BACKSYNC)
 	      & (CLNT_REQ_FLAG_ACKSYNC | CLNT_REQ_FLAG_BACKSYNC))) {
 		/* task switch takes time, response wasn't previously queued */
+		RPC_PROBE3(clnt_expire, cc->cc_xid,
+			   CX_DATA(cc->cc_clnt)->cx_rec->xprt.xp_fd,
+			   cc->cc_proc);
 		cc->cc_error.re_status = RPC_TIMEDOUT;
 		(*cc->cc_process_cb)(cc);
 	}
@@ -503,16 +507,11 @@ svc_rqst_rearm_events(SVCXPRT *xprt)
 				sr_rec->ev_u.epoll.epoll_fd,
 				sr_rec->sv[0], sr_rec->sv[1], code);
 		} else {
-			__warnx(TIRPC_DEBUG_FLAG_SVC_RQST |
-				TIRPC_DEBUG_FLAG_REFCNT,
-				"%s: %p fd %d xp_refs %" PRIu32
-				" sr_rec %p evchan %d refcnt %" PRIu32
-				" epoll_fd %d control fd pair (%d:%d) rearm",
-				__func__, rec, rec->xprt.xp_fd,
-				rec->xprt.xp_refs,
-				sr_rec, sr_rec->id_k, sr_rec->refcnt,
-				sr_rec->ev_u.epoll.epoll_fd,
-				sr_rec->sv[0], sr_rec->sv[1]);
+			__tracex(TIRPC_DEBUG_FLAG_SVC_RQST |
+				 TIRPC_DEBUG_FLAG_REFCNT,
+				 TIRPC_TRACE_SVC_RQST_REARM,
+				 rec, rec->xprt.xp_fd, rec->xprt.xp_refs,
+				 sr_rec->id_k, sr_rec->ev_u.epoll.epoll_fd);
 		}
 		break;
 	}
@@ -747,6 +746,8 @@ svc_rqst_xprt_task(struct work_pool_entry *wpe)
 		 * xp_refs need more than 1 (this task).
 		 */
 		(void)clock_gettime(CLOCK_MONOTONIC_FAST, &(rec->recv.ts));
+		if (svc_slow_enabled)
+			rec->recv.deq = svc_slow_now();
 		(void)SVC_RECV(&rec->xprt);
 	}
 
@@ -762,6 +763,7 @@ struct svc_rqst_clean_arg {
 	struct timespec ts;
 	int timeout;
 	int cleaned;
+	int scanned;
 };
 
 static bool
@@ -769,6 +771,7 @@ svc_rqst_clean_func(SVCXPRT *xprt, void *arg)
 {
 	struct svc_rqst_clean_arg *acc = (struct svc_rqst_clean_arg *)arg;
 
+	acc->scanned++;
 	if (xprt->xp_ops == NULL)
 		return (false);
 
@@ -785,20 +788,28 @@ svc_rqst_clean_func(SVCXPRT *xprt, void *arg)
 
 void authgss_ctx_gc_idle(void);
 
-static void
-svc_rqst_clean_idle(int timeout)
+/*
+ * Returns false if another sweep is running.  The counts (if any) are
+ * only set by a sweep that ran.
+ */
+bool
+svc_rqst_clean_idle(int timeout, struct svc_clean_idle *out)
 {
 	struct svc_rqst_clean_arg acc;
 	static mutex_t active_mtx = MUTEX_INITIALIZER;
 	static uint32_t active;
 
 	if (mutex_trylock(&active_mtx) != 0)
-		return;
+		return (false);
 
-	if (active > 0)
-		goto unlock;
+	if (active > 0) {
+		mutex_unlock(&active_mtx);
+		return (false);
+	}
 
 	++active;
+	acc.cleaned = 0;
+	acc.scanned = 0;
 
 #ifdef _HAVE_GSSAPI
 	/* trim gss context cache */
@@ -811,14 +822,17 @@ svc_rqst_clean_idle(int timeout)
 	/* trim xprts (not sorted, not aggressive [but self limiting]) */
 	(void)clock_gettime(CLOCK_MONOTONIC_FAST, &acc.ts);
 	acc.timeout = timeout;
-	acc.cleaned = 0;
 
 	svc_xprt_foreach(svc_rqst_clean_func, (void *)&acc);
 
  unlock:
 	--active;
 	mutex_unlock(&active_mtx);
-	return;
+	if (out) {
+		out->scanned = acc.scanned;
+		out->cleaned = acc.cleaned;
+	}
+	return (true);
 }
 
 #ifdef TIRPC_EPOLL
@@ -832,15 +846,10 @@ svc_rqst_epoll_event(struct svc_rqst_rec *sr_rec, struct epoll_event *ev)
 	if (unlikely(ev->data.fd == sr_rec->sv[1])) {
 		/* signalled -- there was a wakeup on ctrl_ev (see
 		 * top-of-loop) */
-		__warnx(TIRPC_DEBUG_FLAG_SVC_RQST,
-			"%s: fd %d wakeup (sr_rec %p)",
-			__func__, sr_rec->sv[1],
-			sr_rec);
+		__tracex(TIRPC_DEBUG_FLAG_SVC_RQST,
+			 TIRPC_TRACE_SVC_RQST_WAKEUP,
+			 sr_rec->sv[1], sr_rec, 0, 0, 0);
 		(void)consume_ev_sig_nb(sr_rec->sv[1]);
-		__warnx(TIRPC_DEBUG_FLAG_SVC_RQST,
-			"%s: fd %d after consume sig (sr_rec %p)",
-			__func__, sr_rec->sv[1],
-			sr_rec);
 		return (NULL);
 	}
 
@@ -856,12 +865,9 @@ svc_rqst_epoll_event(struct svc_rqst_rec *sr_rec, struct epoll_event *ev)
 	xp_flags = atomic_postclear_uint16_t_bits(&rec->xprt.xp_flags,
 						  SVC_XPRT_FLAG_ADDED);
 
-	__warnx(TIRPC_DEBUG_FLAG_SVC_RQST |
-		TIRPC_DEBUG_FLAG_REFCNT,
-		"%s: %p fd %d xp_refs %" PRIu32
-		" event %d",
-		__func__, rec, rec->xprt.xp_fd, rec->xprt.xp_refs,
-		ev->events);
+	__tracex(TIRPC_DEBUG_FLAG_SVC_RQST | TIRPC_DEBUG_FLAG_REFCNT,
+		 TIRPC_TRACE_SVC_RQST_EVENT,
+		 rec, rec->xprt.xp_fd, rec->xprt.xp_refs, ev->events, 0);
 
 	if (rec->xprt.xp_refs > 1
 	 && (xp_flags & SVC_XPRT_FLAG_ADDED)
@@ -872,6 +878,8 @@ svc_rqst_epoll_event(struct svc_rqst_rec *sr_rec, struct epoll_event *ev)
 		/* (idempotent) xp_flags and xp_refs are set atomic.
 		 * xp_refs need more than 1 (this event).
 		 */
+		if (svc_latency_enabled || svc_slow_enabled)
+			(void)clock_gettime(CLOCK_MONOTONIC, &rec->recv.ev);
 		return (rec);
 	}
 
@@ -910,6 +918,8 @@ svc_rqst_epoll_events(struct svc_rqst_rec *sr_rec, int n_events)
 			continue;
 
 		rec->ioq.ioq_wpe.fun = svc_rqst_xprt_task;
+		if (svc_slow_enabled)
+			rec->recv.enq = svc_slow_now();
 		work_pool_submit(&svc_work_pool, &(rec->ioq.ioq_wpe));
 	}
 
@@ -919,12 +929,14 @@ svc_rqst_epoll_events(struct svc_rqst_rec *sr_rec, int n_events)
 
 	/* in most cases have only one event, use this hot thread */
 	rec->ioq.ioq_wpe.fun = svc_rqst_xprt_task;
+	if (svc_slow_enabled)
+		rec->recv.enq = svc_slow_now();
 	svc_rqst_xprt_task(&(rec->ioq.ioq_wpe));
 
 	/* failsafe idle processing after work task */
 	if (atomic_postclear_uint32_t_bits(&wakeups, ~SVC_RQST_WAKEUPS)
 	    > SVC_RQST_WAKEUPS) {
-		svc_rqst_clean_idle(__svc_params->idle_timeout);
+		(void)svc_rqst_clean_idle(__svc_params->idle_timeout, NULL);
 	}
 
 	return true;
@@ -948,7 +960,7 @@ svc_rqst_epoll_loop(struct svc_rqst_rec *sr_rec)
 		expire_ms = timespec_ms(&ts);
 
 		/* before epoll_wait will accumulate events during scan */
-		mutex_lock(&sr_rec->ev_lock);
+		prof_mutex_lock(&sr_rec->ev_lock, "ev_lock");
 		while ((n = opr_rbtree_first(&sr_rec->call_expires))) {
 			cc = opr_containerof(n, struct clnt_req, cc_rqst);
 
@@ -968,18 +980,16 @@ svc_rqst_epoll_loop(struct svc_rqst_rec *sr_rec)
 			cc->cc_wpe.arg = NULL;
 			work_pool_submit(&svc_work_pool, &cc->cc_wpe);
 		}
-		mutex_unlock(&sr_rec->ev_lock);
+		prof_mutex_unlock(&sr_rec->ev_lock);
 
-		__warnx(TIRPC_DEBUG_FLAG_SVC_RQST,
-			"%s: epoll_fd %d before epoll_wait (%d)",
-			__func__,
-			sr_rec->ev_u.epoll.epoll_fd,
-			timeout_ms);
+		__tracex(TIRPC_DEBUG_FLAG_SVC_RQST, TIRPC_TRACE_SVC_RQST_WAIT,
+			 sr_rec->ev_u.epoll.epoll_fd, timeout_ms, 0, 0, 0);
 
 		n_events = epoll_wait(sr_rec->ev_u.epoll.epoll_fd,
 				      sr_rec->ev_u.epoll.events,
 				      sr_rec->ev_u.epoll.max_events,
 				      timeout_ms);
+		svc_slow_check();
 
 		if (unlikely(sr_rec->flags & SVC_RQST_FLAG_SHUTDOWN)) {
 			__warnx(TIRPC_DEBUG_FLAG_SVC_RQST,
@@ -0,0 +1,552 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file svc_shm.c
+ * @brief Shared-memory stream for same-host peers
+ *
+ * The client creates a memfd holding two single-producer/single-consumer
+ * byte rings (one per direction) and two eventfd doorbells, then passes
+ * them to the server over a connected AF_LOCAL socket (SCM_RIGHTS).
+ *
+ * Each side wraps them in an ordinary svc_vc transport:  the usual record
+ * marking is written into the transmit ring by svc_ioq_flushv(), and read
+ * from the receive ring by svc_vc_recv().  The receive doorbell is the
+ * transport fd, so it is armed on the event channels as any socket.
+ *
+ * A producer rings the peer's doorbell when the consumer had caught up;
+ * the consumer quiets its doorbell whenever it catches up, and re-rings
+ * it should a publication race with that.  A producer facing a full ring
+ * sleeps on a futex in the ring header, and the consumer wakes it after
+ * freeing space.  The socket is only used to notice a departed
+ * peer;  it carries no data.
+ *
+ * Indices are free-running, and each side keeps its own index privately,
+ * so a misbehaving peer can at worst corrupt the stream.  The memfd is
+ * sealed against resizing, and the server refuses one that is not.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#include <misc/abstract_atomic.h>
+
+#include "rpc_com.h"
+#include "svc_internal.h"
+
+#define SVC_SHM_MAGIC (0x52504353)	/* "RPCS" */
+#define SVC_SHM_RING_MIN (65536)
+#define SVC_SHM_RING_MAX (64 * 1024 * 1024)
+#define SVC_SHM_TIMEOUT_MS (10000)
+#define SVC_SHM_FD_COUNT (3)
+
+/* a fixed size, so neither side can be faulted by the other */
+#define SVC_SHM_SEALS (F_SEAL_SHRINK | F_SEAL_GROW)
+
+/* ring control, shared;  each index is written by one side only */
+struct svc_shm_ring {
+	uint64_t sr_tail;		/* producer */
+	CACHE_PAD(0);
+	uint64_t sr_head;		/* consumer */
+	uint32_t sr_waiting;		/* producer sleeping for space */
+	uint32_t sr_space;		/* futex word, bumped by consumer */
+	CACHE_PAD(1);
+};
+
+/* memfd layout:  this header on its own page(s), then the two rings */
+struct svc_shm_map {
+	uint32_t sm_magic;
+	uint32_t sm_ringsz;
+	struct svc_shm_ring sm_ring[2];	/* client to server, and reverse */
+};
+
+struct svc_shm {
+	struct svc_shm_map *sh_map;
+	size_t sh_maplen;
+	struct svc_shm_ring *sh_rx;
+	struct svc_shm_ring *sh_tx;
+	uint8_t *sh_rxbuf;
+	uint8_t *sh_txbuf;
+	uint64_t sh_head;		/* private copy of sh_rx->sr_head */
+	uint64_t sh_tail;		/* private copy of sh_tx->sr_tail */
+	uint32_t sh_ringsz;
+	int sh_rxfd;			/* our doorbell (xp_fd) */
+	int sh_txfd;			/* peer doorbell */
+	int sh_sock;
+	bool sh_close;			/* close sh_sock with the transport */
+};
+
+static inline size_t
+svc_shm_data_offset(void)
+{
+	size_t pagesz = sysconf(_SC_PAGESIZE);
+
+	return ((sizeof(struct svc_shm_map) + pagesz - 1) / pagesz) * pagesz;
+}
+
+static inline size_t
+svc_shm_map_length(uint32_t ringsz)
+{
+	return svc_shm_data_offset() + 2 * (size_t)ringsz;
+}
+
+static inline int
+svc_shm_futex(uint32_t *uaddr, int op, uint32_t val,
+	      const struct timespec *timeout)
+{
+	/* shared mapping:  not FUTEX_PRIVATE_FLAG */
+	return syscall(SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+/* the socket is readable only upon hangup (or a misbehaving peer) */
+static bool
+svc_shm_peer_gone(struct svc_shm *shm)
+{
+	struct pollfd pfd = {
+		.fd = shm->sh_sock,
+		.events = POLLIN | POLLRDHUP,
+	};
+
+	return (poll(&pfd, 1, 0) > 0);
+}
+
+static inline void
+svc_shm_ring(int fd)
+{
+	uint64_t one = 1;
+
+	if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d doorbell failed (%d)",
+			__func__, fd, errno);
+	}
+}
+
+static inline void
+svc_shm_drain(struct svc_shm *shm)
+{
+	uint64_t count;
+
+	(void)read(shm->sh_rxfd, &count, sizeof(count));
+}
+
+/*
+ * Copy out up to len bytes;  returns like recv(2) on a non-blocking
+ * socket, with 0 when the peer has gone.
+ */
+ssize_t
+svc_shm_recv(struct svc_shm *shm, void *buf, size_t len)
+{
+	struct svc_shm_ring *ring = shm->sh_rx;
+	uint64_t tail = atomic_fetch_uint64_t(&ring->sr_tail);
+	uint64_t avail = tail - shm->sh_head;
+	size_t off;
+	size_t n;
+
+	if (!avail) {
+		svc_shm_drain(shm);
+		if (atomic_fetch_uint64_t(&ring->sr_tail) == shm->sh_head) {
+			if (svc_shm_peer_gone(shm))
+				return (0);
+			errno = EAGAIN;
+			return (-1);
+		}
+		return svc_shm_recv(shm, buf, len);
+	}
+	if (unlikely(avail > shm->sh_ringsz)) {
+		errno = EPROTO;
+		return (-1);
+	}
+
+	n = MIN(len, avail);
+	off = shm->sh_head & (shm->sh_ringsz - 1);
+	if (off + n > shm->sh_ringsz) {
+		size_t first = shm->sh_ringsz - off;
+
+		memcpy(buf, shm->sh_rxbuf + off, first);
+		memcpy((uint8_t *)buf + first, shm->sh_rxbuf, n - first);
+	} else {
+		memcpy(buf, shm->sh_rxbuf + off, n);
+	}
+	shm->sh_head += n;
+	atomic_store_uint64_t(&ring->sr_head, shm->sh_head);
+
+	if (atomic_fetch_uint32_t(&ring->sr_waiting)) {
+		atomic_store_uint32_t(&ring->sr_waiting, 0);
+		atomic_inc_uint32_t(&ring->sr_space);
+		svc_shm_futex(&ring->sr_space, FUTEX_WAKE, 1, NULL);
+	}
+
+	/* caught up:  quiet the doorbell, unless a publication raced */
+	if (shm->sh_head == tail) {
+		svc_shm_drain(shm);
+		if (atomic_fetch_uint64_t(&ring->sr_tail) != tail)
+			svc_shm_ring(shm->sh_rxfd);
+	}
+	return (n);
+}
+
+/*
+ * Copy in as much of iov as fits, waiting for space as needed;  returns
+ * like writev(2) on a blocking socket (possibly short).
+ *
+ * Producers are serialized by the svc_ioq output queue.
+ */
+ssize_t
+svc_shm_writev(struct svc_shm *shm, const struct iovec *iov, int iovcnt)
+{
+	struct svc_shm_ring *ring = shm->sh_tx;
+	struct timespec timeout = {
+		.tv_sec = 1,
+		.tv_nsec = 0,
+	};
+	uint64_t start = shm->sh_tail;
+	uint64_t used;
+	uint32_t space;
+	size_t room;
+	size_t copied = 0;
+	size_t off;
+	size_t n;
+
+	for (;;) {
+		space = atomic_fetch_uint32_t(&ring->sr_space);
+		used = shm->sh_tail - atomic_fetch_uint64_t(&ring->sr_head);
+		if (unlikely(used > shm->sh_ringsz)) {
+			errno = EPROTO;
+			return (-1);
+		}
+		if (used < shm->sh_ringsz)
+			break;
+
+		atomic_store_uint32_t(&ring->sr_waiting, 1);
+		used = shm->sh_tail - atomic_fetch_uint64_t(&ring->sr_head);
+		if (used < shm->sh_ringsz)
+			continue;
+
+		if (svc_shm_futex(&ring->sr_space, FUTEX_WAIT, space, &timeout)
+		 && errno == ETIMEDOUT
+		 && svc_shm_peer_gone(shm)) {
+			errno = EPIPE;
+			return (-1);
+		}
+	}
+	room = shm->sh_ringsz - used;
+
+	for (; iovcnt > 0 && room > 0; iov++, iovcnt--) {
+		n = MIN(iov->iov_len, room);
+		off = shm->sh_tail & (shm->sh_ringsz - 1);
+		if (off + n > shm->sh_ringsz) {
+			size_t first = shm->sh_ringsz - off;
+
+			memcpy(shm->sh_txbuf + off, iov->iov_base, first);
+			memcpy(shm->sh_txbuf, (uint8_t *)iov->iov_base + first,
+			       n - first);
+		} else {
+			memcpy(shm->sh_txbuf + off, iov->iov_base, n);
+		}
+		shm->sh_tail += n;
+		copied += n;
+		room -= n;
+	}
+	atomic_store_uint64_t(&ring->sr_tail, shm->sh_tail);
+
+	/* otherwise, the consumer will find this before quieting */
+	if (atomic_fetch_uint64_t(&ring->sr_head) == start)
+		svc_shm_ring(shm->sh_txfd);
+	return (copied);
+}
+
+int
+svc_shm_sock(struct svc_shm *shm)
+{
+	return (shm->sh_sock);
+}
+
+int
+svc_shm_rxfd(struct svc_shm *shm)
+{
+	return (shm->sh_rxfd);
+}
+
+/* called as the transport is freed;  xp_fd (sh_rxfd) is closed there */
+void
+svc_shm_free(struct svc_shm *shm)
+{
+	if (shm->sh_map)
+		munmap(shm->sh_map, shm->sh_maplen);
+	if (shm->sh_txfd >= 0)
+		close(shm->sh_txfd);
+	if (shm->sh_close)
+		close(shm->sh_sock);
+	mem_free(shm, sizeof(*shm));
+}
+
+static struct svc_shm *
+svc_shm_setup(int sock, int memfd, uint32_t ringsz, bool server,
+	      const uint32_t flags)
+{
+	struct svc_shm *shm;
+	size_t maplen = svc_shm_map_length(ringsz);
+	uint8_t *data;
+	void *map;
+
+	map = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	if (map == MAP_FAILED) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d mmap failed (%d)",
+			__func__, sock, errno);
+		return (NULL);
+	}
+	data = (uint8_t *)map + svc_shm_data_offset();
+
+	shm = mem_zalloc(sizeof(*shm));
+	shm->sh_map = map;
+	shm->sh_maplen = maplen;
+	shm->sh_ringsz = ringsz;
+	shm->sh_rx = &shm->sh_map->sm_ring[server ? 0 : 1];
+	shm->sh_tx = &shm->sh_map->sm_ring[server ? 1 : 0];
+	shm->sh_rxbuf = data + (server ? 0 : ringsz);
+	shm->sh_txbuf = data + (server ? ringsz : 0);
+	shm->sh_head = atomic_fetch_uint64_t(&shm->sh_rx->sr_head);
+	shm->sh_tail = atomic_fetch_uint64_t(&shm->sh_tx->sr_tail);
+	shm->sh_rxfd = -1;
+	shm->sh_txfd = -1;
+	shm->sh_sock = sock;
+	shm->sh_close = !!(flags & SVC_CREATE_FLAG_CLOSE);
+	return (shm);
+}
+
+static SVCXPRT *
+svc_shm_xprt(struct svc_shm *shm, int rxfd, int txfd, const uint32_t flags)
+{
+	SVCXPRT *xprt;
+
+	shm->sh_rxfd = rxfd;
+	shm->sh_txfd = txfd;
+
+	xprt = svc_vc_ncreate_shm(shm, flags);
+	if (!xprt) {
+		close(rxfd);
+		shm->sh_close = false;
+		svc_shm_free(shm);
+	}
+	return (xprt);
+}
+
+/*
+ * Server side:  receive the client's rings and doorbells.
+ */
+SVCXPRT *
+svc_shm_ncreatef(const int fd, const uint32_t flags)
+{
+	union {
+		char buf[CMSG_SPACE(SVC_SHM_FD_COUNT * sizeof(int))];
+		struct cmsghdr align;
+	} cmsgbuf;
+	struct pollfd pfd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct svc_shm_map *map;
+	struct svc_shm *shm;
+	struct stat st;
+	uint32_t hello;
+	int fds[SVC_SHM_FD_COUNT] = { -1, -1, -1 };
+	int seals;
+	ssize_t rlen;
+
+	if (poll(&pfd, 1, SVC_SHM_TIMEOUT_MS) <= 0) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d no rings offered",
+			__func__, fd);
+		return (NULL);
+	}
+
+	iov.iov_base = &hello;
+	iov.iov_len = sizeof(hello);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	rlen = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (rlen != sizeof(hello)
+	 || hello != SVC_SHM_MAGIC
+	 || !cmsg
+	 || cmsg->cmsg_level != SOL_SOCKET
+	 || cmsg->cmsg_type != SCM_RIGHTS
+	 || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d invalid offer (%zd)",
+			__func__, fd, rlen);
+		if (cmsg && cmsg->cmsg_type == SCM_RIGHTS
+		 && cmsg->cmsg_len == CMSG_LEN(sizeof(fds)))
+			memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+		goto err;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	/* the client is not trusted with the size of our mapping */
+	seals = fcntl(fds[0], F_GET_SEALS);
+	if (seals < 0
+	 || (seals & SVC_SHM_SEALS) != SVC_SHM_SEALS) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() fd %d rings not sealed (%d)",
+			__func__, fd, seals);
+		goto err;
+	}
+	if (fstat(fds[0], &st) < 0
+	 || (size_t)st.st_size < svc_shm_map_length(0))
+		goto err;
+
+	map = mmap(NULL, sizeof(*map), PROT_READ, MAP_SHARED, fds[0], 0);
+	if (map == MAP_FAILED)
+		goto err;
+	hello = map->sm_ringsz;
+	if (map->sm_magic != SVC_SHM_MAGIC
+	 || hello < SVC_SHM_RING_MIN
+	 || hello > SVC_SHM_RING_MAX
+	 || (hello & (hello - 1))
+	 || (size_t)st.st_size != svc_shm_map_length(hello)) {
+		munmap(map, sizeof(*map));
+		goto err;
+	}
+	munmap(map, sizeof(*map));
+
+	shm = svc_shm_setup(fd, fds[0], hello, true, flags);
+	close(fds[0]);
+	fds[0] = -1;
+	if (!shm)
+		goto err;
+
+	return svc_shm_xprt(shm, fds[1], fds[2], flags);
+
+ err:
+	__warnx(TIRPC_DEBUG_FLAG_ERROR,
+		"%s() fd %d failed",
+		__func__, fd);
+	for (rlen = 0; rlen < SVC_SHM_FD_COUNT; rlen++)
+		if (fds[rlen] >= 0)
+			close(fds[rlen]);
+	return (NULL);
+}
+
+/*
+ * Client side:  create and offer the rings and doorbells.
+ */
+SVCXPRT *
+svc_shm_connect(const int fd, u_int ringsz, const uint32_t flags)
+{
+	union {
+		char buf[CMSG_SPACE(SVC_SHM_FD_COUNT * sizeof(int))];
+		struct cmsghdr align;
+	} cmsgbuf;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct svc_shm *shm;
+	uint32_t hello = SVC_SHM_MAGIC;
+	size_t maplen;
+	int fds[SVC_SHM_FD_COUNT] = { -1, -1, -1 };
+	int ix;
+
+	/* power of 2, within bounds */
+	ringsz = MAX(ringsz, SVC_SHM_RING_MIN);
+	ringsz = MIN(ringsz, SVC_SHM_RING_MAX);
+	while (ringsz & (ringsz - 1))
+		ringsz &= ringsz - 1;
+	maplen = svc_shm_map_length(ringsz);
+
+	fds[0] = memfd_create("ntirpc-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fds[0] < 0
+	 || ftruncate(fds[0], maplen) < 0
+	 || fcntl(fds[0], F_ADD_SEALS, SVC_SHM_SEALS) < 0)
+		goto err;
+	fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);	/* to server */
+	fds[2] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);	/* to client */
+	if (fds[1] < 0 || fds[2] < 0)
+		goto err;
+
+	shm = svc_shm_setup(fd, fds[0], ringsz, false, flags);
+	if (!shm)
+		goto err;
+	shm->sh_map->sm_ringsz = ringsz;
+	shm->sh_map->sm_magic = SVC_SHM_MAGIC;
+
+	iov.iov_base = &hello;
+	iov.iov_len = sizeof(hello);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(hello)) {
+		shm->sh_close = false;
+		svc_shm_free(shm);
+		goto err;
+	}
+
+	/* the mapping holds the memory;  the server has its own copies */
+	close(fds[0]);
+	return svc_shm_xprt(shm, fds[2], fds[1], flags);
+
+ err:
+	__warnx(TIRPC_DEBUG_FLAG_ERROR,
+		"%s() fd %d failed (%d)",
+		__func__, fd, errno);
+	for (ix = 0; ix < SVC_SHM_FD_COUNT; ix++)
+		if (fds[ix] >= 0)
+			close(fds[ix]);
+	return (NULL);
+}
@@ -266,7 +266,7 @@ universal(struct svc_req *req)
 				__warnx(TIRPC_DEBUG_FLAG_ERROR,
 					"rpc: SVCAUTH_CHECKSUM failed prog %u vers %u",
 					(unsigned)prog, (unsigned)vers);
-				xdr_free(pl->p_inproc, xdrbuf);
+				svc_freeargs(req, pl->p_inproc, xdrbuf);
 				svcerr_decode(req);
 				mutex_unlock(&proglst_lock);
 				return;
@@ -276,7 +276,7 @@ universal(struct svc_req *req)
 			if (outdata == NULL
 			    && pl->p_outproc != (xdrproc_t) xdr_void) {
 				/* there was an error */
-				xdr_free(pl->p_inproc, xdrbuf);
+				svc_freeargs(req, pl->p_inproc, xdrbuf);
 				mutex_unlock(&proglst_lock);
 				return;
 			}
@@ -289,7 +289,7 @@ universal(struct svc_req *req)
 					(unsigned)prog, (unsigned)vers);
 			}
 			/* free the decoded arguments */
-			xdr_free(pl->p_inproc, xdrbuf);
+			svc_freeargs(req, pl->p_inproc, xdrbuf);
 			mutex_unlock(&proglst_lock);
 			return;
 		}
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file svc_slow.c
+ * @brief Slowest requests per time window
+ *
+ * While enabled, each call carries a small record of its stage times
+ * (struct svc_slow_req) in the request stream, handed to the reply
+ * stream by SVC_REPLY().  When the reply is written, the record is
+ * offered to the current window, which keeps the N slowest by total
+ * time (event to write).  The previous window is kept until the current
+ * one ends, so a snapshot or dump always covers a full window.
+ *
+ * Calls faster than all N already kept are rejected without the lock.
+ * Calls that are never replied are not recorded.
+ *
+ * The signal handler only sets a flag;  the dump is logged by the next
+ * reply written, or the next event loop wakeup.
+ */
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/un.h>
+#include <time.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/svc.h>
+#include <misc/abstract_atomic.h>
+
+#include "svc_internal.h"
+
+#define SVC_SLOW_MAX 1024		/* per window */
+#define SVC_SLOW_NS 1000000000ULL
+
+struct svc_slow_window {
+	struct svc_slow_req *reqs;	/* [svc_slow_n] */
+	uint64_t start;
+	u_int count;
+};
+
+bool svc_slow_enabled;
+volatile sig_atomic_t svc_slow_signalled;
+
+static mutex_t svc_slow_mtx = MUTEX_INITIALIZER;
+static struct svc_slow_window svc_slow_win[2];
+static u_int svc_slow_cur;
+static u_int svc_slow_n;
+static uint64_t svc_slow_window_ns;
+static uint64_t svc_slow_floor = UINT64_MAX;	/* fastest kept, if full */
+static uint64_t svc_slow_expire = UINT64_MAX;	/* current window end */
+static int svc_slow_signo;
+static struct sigaction svc_slow_oldact;
+
+static const char *svc_slow_stage_name[SVC_SLOW_STAGES] = {
+	"recv", "enqueue", "dequeue", "dispatch", "auth", "reply", "write"
+};
+
+uint64_t
+svc_slow_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * SVC_SLOW_NS + ts.tv_nsec);
+}
+
+/* earliest stage reached to write */
+static inline uint64_t
+svc_slow_total(const struct svc_slow_req *slow)
+{
+	u_int stage;
+
+	for (stage = 0; stage < SVC_SLOW_WRITE; stage++)
+		if (slow->ns[stage])
+			return (slow->ns[SVC_SLOW_WRITE] > slow->ns[stage]
+				? slow->ns[SVC_SLOW_WRITE] - slow->ns[stage]
+				: 0);
+	return (0);
+}
+
+/*
+ * Called when a call record is complete.  The receive stage times are
+ * those of the event and task that completed it.
+ */
+void
+svc_slow_recv(struct xdr_ioq *xioq, struct rpc_dplx_rec *rec,
+	      const struct sockaddr_storage *remote, uint32_t bytes)
+{
+	struct svc_slow_req *slow = mem_zalloc(sizeof(*slow));
+
+	if (timespecisset(&rec->recv.ev))
+		slow->ns[SVC_SLOW_RECV] = (uint64_t)rec->recv.ev.tv_sec
+					* SVC_SLOW_NS + rec->recv.ev.tv_nsec;
+	slow->ns[SVC_SLOW_ENQUEUE] = rec->recv.enq;
+	slow->ns[SVC_SLOW_DEQUEUE] = rec->recv.deq;
+	slow->remote = *remote;
+	slow->call_bytes = bytes;
+
+	if (xioq->ioq_slow)
+		svc_slow_free(xioq->ioq_slow);
+	xioq->ioq_slow = slow;
+}
+
+/* Called by xp_decode after a CALL header is decoded */
+void
+svc_slow_dispatch(struct svc_req *req)
+{
+	struct svc_slow_req *slow = req->rq_slow;
+
+	slow->ns[SVC_SLOW_DISPATCH] = svc_slow_now();
+	slow->xid = req->rq_msg.rm_xid;
+	slow->prog = req->rq_msg.cb_prog;
+	slow->vers = req->rq_msg.cb_vers;
+	slow->proc = req->rq_msg.cb_proc;
+}
+
+void
+svc_slow_free(struct svc_slow_req *slow)
+{
+	mem_free(slow, sizeof(*slow));
+}
+
+/* new window;  the current one becomes previous, unless long stale */
+static void
+svc_slow_rotate(uint64_t now)
+{
+	uint64_t start = svc_slow_expire;
+	struct svc_slow_window *win;
+
+	if (now - start >= svc_slow_window_ns) {
+		/* no calls for a whole window */
+		svc_slow_win[svc_slow_cur].count = 0;
+		start = now;
+	}
+	svc_slow_cur ^= 1;
+	win = &svc_slow_win[svc_slow_cur];
+	win->start = start;
+	win->count = 0;
+	atomic_store_uint64_t(&svc_slow_floor, 0);
+	atomic_store_uint64_t(&svc_slow_expire, start + svc_slow_window_ns);
+}
+
+/* locked */
+static void
+svc_slow_insert(const struct svc_slow_req *slow, uint64_t total)
+{
+	struct svc_slow_window *win;
+	uint64_t floor = UINT64_MAX;
+	uint64_t t;
+	u_int low = 0;
+	u_int ix;
+
+	if (!svc_slow_n)
+		return;
+
+	if (slow->ns[SVC_SLOW_WRITE] >= svc_slow_expire)
+		svc_slow_rotate(slow->ns[SVC_SLOW_WRITE]);
+
+	win = &svc_slow_win[svc_slow_cur];
+	if (win->count < svc_slow_n) {
+		win->reqs[win->count++] = *slow;
+		if (win->count < svc_slow_n)
+			return;
+	} else {
+		for (ix = 0; ix < win->count; ix++) {
+			t = svc_slow_total(&win->reqs[ix]);
+			if (t < floor) {
+				floor = t;
+				low = ix;
+			}
+		}
+		if (total <= floor)
+			return;
+		win->reqs[low] = *slow;
+	}
+
+	/* full:  later calls must beat the fastest kept */
+	floor = UINT64_MAX;
+	for (ix = 0; ix < win->count; ix++) {
+		t = svc_slow_total(&win->reqs[ix]);
+		if (t < floor)
+			floor = t;
+	}
+	atomic_store_uint64_t(&svc_slow_floor, floor);
+}
+
+/*
+ * Called after the reply is written (or sent);  consumes the record.
+ */
+void
+svc_slow_done(struct svc_slow_req *slow, uint32_t bytes)
+{
+	uint64_t total;
+
+	slow->ns[SVC_SLOW_WRITE] = svc_slow_now();
+	slow->reply_bytes = bytes;
+	total = svc_slow_total(slow);
+
+	if (total > atomic_fetch_uint64_t(&svc_slow_floor)
+	 || slow->ns[SVC_SLOW_WRITE]
+	    >= atomic_fetch_uint64_t(&svc_slow_expire)) {
+		mutex_lock(&svc_slow_mtx);
+		svc_slow_insert(slow, total);
+		mutex_unlock(&svc_slow_mtx);
+	}
+	svc_slow_free(slow);
+	svc_slow_check();
+}
+
+static int
+svc_slow_cmp(const void *a, const void *b)
+{
+	uint64_t ta = svc_slow_total(a);
+	uint64_t tb = svc_slow_total(b);
+
+	return (ta < tb) - (ta > tb);
+}
+
+/* locked;  slowest first */
+static u_int
+svc_slow_copy(struct svc_slow_window *win, struct svc_slow_req *reqs,
+	      u_int max)
+{
+	u_int count = MIN(win->count, max);
+
+	qsort(win->reqs, win->count, sizeof(*win->reqs), svc_slow_cmp);
+	memcpy(reqs, win->reqs, count * sizeof(*reqs));
+	return (count);
+}
+
+static bool
+svc_slow_snapshot(struct svc_slow_snapshot *snap)
+{
+	struct svc_slow_window *win;
+	uint64_t now = svc_slow_now();
+	u_int total;
+
+	mutex_lock(&svc_slow_mtx);
+	snap->count = 0;
+	snap->previous = 0;
+	if (!svc_slow_n) {
+		mutex_unlock(&svc_slow_mtx);
+		return (true);
+	}
+
+	/* an expired current window is previous */
+	if (now >= svc_slow_expire)
+		svc_slow_rotate(now);
+
+	win = &svc_slow_win[svc_slow_cur];
+	total = win->count + svc_slow_win[svc_slow_cur ^ 1].count;
+	snap->count = svc_slow_copy(win, snap->reqs, snap->max);
+	snap->previous = svc_slow_copy(&svc_slow_win[svc_slow_cur ^ 1],
+				       snap->reqs + snap->count,
+				       snap->max - snap->count);
+	snap->count += snap->previous;
+	mutex_unlock(&svc_slow_mtx);
+	return (snap->count == total);
+}
+
+static void
+svc_slow_addr(const struct sockaddr_storage *ss, char *buf, size_t len)
+{
+	const struct sockaddr_in *sin = (const struct sockaddr_in *)ss;
+	const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)ss;
+	char host[INET6_ADDRSTRLEN];
+
+	switch (ss->ss_family) {
+	case AF_INET:
+		(void)inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host));
+		(void)snprintf(buf, len, "%s:%u", host, ntohs(sin->sin_port));
+		return;
+	case AF_INET6:
+		(void)inet_ntop(AF_INET6, &sin6->sin6_addr, host,
+				sizeof(host));
+		(void)snprintf(buf, len, "[%s]:%u", host,
+			       ntohs(sin6->sin6_port));
+		return;
+	case AF_LOCAL:
+		(void)snprintf(buf, len, "local");
+		return;
+	default:
+		(void)snprintf(buf, len, "af %u", ss->ss_family);
+		return;
+	}
+}
+
+static void
+svc_slow_print(const char *which, const struct svc_slow_req *slow)
+{
+	char addr[INET6_ADDRSTRLEN + 16];
+	char stages[SVC_SLOW_STAGES * 24] = "";
+	uint64_t from = 0;
+	size_t n = 0;
+	u_int stage;
+
+	svc_slow_addr(&slow->remote, addr, sizeof(addr));
+
+	/* microseconds from the earliest stage reached */
+	for (stage = 0; stage < SVC_SLOW_STAGES; stage++) {
+		if (!slow->ns[stage])
+			continue;
+		if (!from)
+			from = slow->ns[stage];
+		n += snprintf(stages + n, sizeof(stages) - n,
+			      " %s +%" PRIu64 "us",
+			      svc_slow_stage_name[stage],
+			      (slow->ns[stage] - from) / 1000);
+	}
+
+	__ntirpc_pkg_params.warnx_(
+		"svc_slow: %s %" PRIu64 "us xid %" PRIx32 " %" PRIu32
+		"/%" PRIu32 "/%" PRIu32 " from %s call %" PRIu32
+		" reply %" PRIu32 ":%s",
+		which, svc_slow_total(slow) / 1000, slow->xid, slow->prog,
+		slow->vers, slow->proc, addr, slow->call_bytes,
+		slow->reply_bytes, stages);
+}
+
+/* log both windows through warnx_, regardless of debug flags */
+void
+svc_slow_dump(void)
+{
+	struct svc_slow_snapshot snap;
+	u_int ix;
+
+	svc_slow_signalled = 0;
+
+	mutex_lock(&svc_slow_mtx);
+	snap.max = 2 * svc_slow_n;
+	mutex_unlock(&svc_slow_mtx);
+	if (!snap.max)
+		return;
+
+	snap.reqs = mem_alloc(snap.max * sizeof(*snap.reqs));
+	(void)svc_slow_snapshot(&snap);
+
+	__ntirpc_pkg_params.warnx_(
+		"svc_slow: %u current, %u previous (window %" PRIu64 "s)",
+		snap.count - snap.previous, snap.previous,
+		svc_slow_window_ns / SVC_SLOW_NS);
+	for (ix = 0; ix < snap.count; ix++)
+		svc_slow_print(ix < snap.count - snap.previous
+			       ? "current" : "previous", &snap.reqs[ix]);
+
+	mem_free(snap.reqs, snap.max * sizeof(*snap.reqs));
+}
+
+static void
+svc_slow_signal(int signo)
+{
+	svc_slow_signalled = 1;
+}
+
+/* locked */
+static void
+svc_slow_sigset(int signo)
+{
+	struct sigaction act;
+
+	if (signo == svc_slow_signo)
+		return;
+
+	if (svc_slow_signo)
+		(void)sigaction(svc_slow_signo, &svc_slow_oldact, NULL);
+	svc_slow_signo = 0;
+	if (!signo)
+		return;
+
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = svc_slow_signal;
+	act.sa_flags = SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(signo, &act, &svc_slow_oldact)) {
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s() sigaction %d failed (%d)",
+			__func__, signo, errno);
+		return;
+	}
+	svc_slow_signo = signo;
+}
+
+static void
+svc_slow_set(const struct svc_slow_params *params)
+{
+	u_int n = MIN(params->slowest, SVC_SLOW_MAX);
+	uint64_t now = svc_slow_now();
+	u_int ix;
+
+	mutex_lock(&svc_slow_mtx);
+	svc_slow_enabled = false;
+
+	for (ix = 0; ix < 2; ix++) {
+		if (svc_slow_n)
+			mem_free(svc_slow_win[ix].reqs,
+				 svc_slow_n * sizeof(struct svc_slow_req));
+		svc_slow_win[ix].reqs = n
+			? mem_alloc(n * sizeof(struct svc_slow_req))
+			: NULL;
+		svc_slow_win[ix].start = now;
+		svc_slow_win[ix].count = 0;
+	}
+	svc_slow_cur = 0;
+	svc_slow_n = n;
+	svc_slow_window_ns = MAX(params->window, 1) * SVC_SLOW_NS;
+	atomic_store_uint64_t(&svc_slow_floor, n ? 0 : UINT64_MAX);
+	atomic_store_uint64_t(&svc_slow_expire,
+			      n ? now + svc_slow_window_ns : UINT64_MAX);
+
+	svc_slow_sigset(n ? params->signo : 0);
+	svc_slow_enabled = !!n;
+	mutex_unlock(&svc_slow_mtx);
+}
+
+bool
+svc_slow_control(const u_int rq, void *in)
+{
+	switch (rq) {
+	case SVC_CTL_SLOW_SET:
+		svc_slow_set((struct svc_slow_params *)in);
+		break;
+	case SVC_CTL_SLOW_GET:
+		return svc_slow_snapshot((struct svc_slow_snapshot *)in);
+	case SVC_CTL_SLOW_DUMP:
+		svc_slow_dump();
+		break;
+	default:
+		return (false);
+	}
+	return (true);
+}
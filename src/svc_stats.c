@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Library statistics as an RPC program, see <rpc/svc_stats.h>.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/rpc.h>
+#include <rpc/svc_auth.h>
+#include <rpc/xdr_inline.h>
+#include <rpc/svc_stats.h>
+
+#include "rpc_com.h"
+#include "svc_internal.h"
+
+/* longest universal address (INET6_ADDRSTRLEN + ".p1.p2") */
+#define SVC_STATS_UADDR_MAX 64
+
+/*
+ * Only the non-zero buckets of a histogram are sent, as index and count.
+ */
+static bool
+xdr_svc_latency_hist(XDR *xdrs, struct svc_latency_hist *hist)
+{
+	u_int stage, b, n;
+
+	if (!xdr_u_int32_t(xdrs, &hist->prog)
+	    || !xdr_u_int32_t(xdrs, &hist->vers)
+	    || !xdr_u_int32_t(xdrs, &hist->proc))
+		return (false);
+
+	for (stage = 0; stage < SVC_LATENCY_STAGES; stage++) {
+		uint64_t *count = hist->count[stage];
+
+		if (xdrs->x_op == XDR_ENCODE) {
+			for (n = 0, b = 0; b < SVC_LATENCY_BUCKETS; b++)
+				if (count[b])
+					n++;
+			if (!xdr_u_int(xdrs, &n))
+				return (false);
+			for (b = 0; b < SVC_LATENCY_BUCKETS; b++) {
+				if (!count[b])
+					continue;
+				if (!xdr_u_int(xdrs, &b)
+				    || !xdr_uint64_t(xdrs, &count[b]))
+					return (false);
+			}
+			continue;
+		}
+
+		memset(count, 0, SVC_LATENCY_BUCKETS * sizeof(*count));
+		if (!xdr_u_int(xdrs, &n)
+		    || n > SVC_LATENCY_BUCKETS)
+			return (false);
+		while (n--) {
+			if (!xdr_u_int(xdrs, &b)
+			    || b >= SVC_LATENCY_BUCKETS
+			    || !xdr_uint64_t(xdrs, &count[b]))
+				return (false);
+		}
+	}
+	return (true);
+}
+
+bool
+xdr_svc_latency_snapshot(XDR *xdrs, struct svc_latency_snapshot *snap)
+{
+	u_int ix;
+
+	if (xdrs->x_op == XDR_FREE) {
+		if (snap->hist)
+			mem_free(snap->hist, snap->max * sizeof(*snap->hist));
+		snap->hist = NULL;
+		snap->max = snap->count = 0;
+		return (true);
+	}
+
+	if (!xdr_uint64_t(xdrs, &snap->dropped)
+	    || !xdr_u_int(xdrs, &snap->count))
+		return (false);
+
+	if (xdrs->x_op == XDR_DECODE) {
+		if (snap->count > TIRPC_STATS_LATENCY_MAX)
+			return (false);
+		snap->max = snap->count;
+		snap->hist = snap->count
+			? mem_alloc(snap->count * sizeof(*snap->hist))
+			: NULL;
+	}
+
+	for (ix = 0; ix < snap->count; ix++)
+		if (!xdr_svc_latency_hist(xdrs, &snap->hist[ix]))
+			return (false);
+	return (true);
+}
+
+/*
+ * Remote addresses travel as universal addresses;  the decoder picks
+ * the family from the form.  Others are sent empty (AF_UNSPEC).
+ */
+static bool
+xdr_svc_stats_remote(XDR *xdrs, struct sockaddr_storage *ss)
+{
+	struct netbuf nb;
+	struct netbuf *taddr;
+	char *uaddr = NULL;
+	char *none = "";
+	bool rslt;
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		if (ss->ss_family == AF_INET || ss->ss_family == AF_INET6) {
+			nb.buf = ss;
+			nb.len = nb.maxlen = sizeof(*ss);
+			uaddr = __rpc_taddr2uaddr_af(ss->ss_family, &nb);
+		}
+		if (!uaddr)
+			return (xdr_string(xdrs, &none, SVC_STATS_UADDR_MAX));
+		rslt = xdr_string(xdrs, &uaddr, SVC_STATS_UADDR_MAX);
+		mem_free(uaddr, 0);
+		return (rslt);
+	}
+
+	memset(ss, 0, sizeof(*ss));
+	if (xdrs->x_op != XDR_DECODE)
+		return (true);
+
+	if (!xdr_string(xdrs, &uaddr, SVC_STATS_UADDR_MAX))
+		return (false);
+	taddr = *uaddr
+		? __rpc_uaddr2taddr_af(strchr(uaddr, ':') ? AF_INET6 : AF_INET,
+				       uaddr)
+		: NULL;
+	if (taddr) {
+		memcpy(ss, taddr->buf, MIN(taddr->len, sizeof(*ss)));
+		mem_free(taddr->buf, 0);
+		mem_free(taddr, sizeof(*taddr));
+	}
+	mem_free(uaddr, 0);
+	return (true);
+}
+
+static bool
+xdr_svc_xprt_stats_entry(XDR *xdrs, struct svc_xprt_stats_entry *xe)
+{
+	struct svc_xprt_stats *stats = &xe->stats;
+	int64_t sec = stats->active.tv_sec;
+	int64_t nsec = stats->active.tv_nsec;
+
+	if (!xdr_uint64_t(xdrs, &stats->bytes_in)
+	    || !xdr_uint64_t(xdrs, &stats->bytes_out)
+	    || !xdr_uint64_t(xdrs, &stats->records_in)
+	    || !xdr_uint64_t(xdrs, &stats->records_out)
+	    || !xdr_uint64_t(xdrs, &stats->frags_in)
+	    || !xdr_uint64_t(xdrs, &stats->frags_out)
+	    || !xdr_uint64_t(xdrs, &stats->partial_writes)
+	    || !xdr_uint64_t(xdrs, &stats->eagain)
+	    || !xdr_uint32_t(xdrs, &stats->queued)
+	    || !xdr_uint32_t(xdrs, &stats->queued_max)
+	    || !xdr_int64_t(xdrs, &sec)
+	    || !xdr_int64_t(xdrs, &nsec)
+	    || !xdr_svc_stats_remote(xdrs, &xe->remote)
+	    || !xdr_int(xdrs, &xe->fd)
+	    || !xdr_int(xdrs, &xe->type))
+		return (false);
+
+	stats->active.tv_sec = sec;
+	stats->active.tv_nsec = nsec;
+	return (true);
+}
+
+bool
+xdr_svc_xprt_stats_snapshot(XDR *xdrs, struct svc_xprt_stats_snapshot *snap)
+{
+	u_int ix;
+
+	if (xdrs->x_op == XDR_FREE) {
+		if (snap->xprts)
+			mem_free(snap->xprts,
+				 snap->max * sizeof(*snap->xprts));
+		snap->xprts = NULL;
+		snap->max = snap->count = 0;
+		return (true);
+	}
+
+	if (!xdr_u_int(xdrs, &snap->total)
+	    || !xdr_u_int(xdrs, &snap->count))
+		return (false);
+
+	if (xdrs->x_op == XDR_DECODE) {
+		if (snap->count > TIRPC_STATS_XPRTS_MAX)
+			return (false);
+		snap->max = snap->count;
+		snap->xprts = snap->count
+			? mem_alloc(snap->count * sizeof(*snap->xprts))
+			: NULL;
+	}
+
+	for (ix = 0; ix < snap->count; ix++)
+		if (!xdr_svc_xprt_stats_entry(xdrs, &snap->xprts[ix]))
+			return (false);
+	return (true);
+}
+
+/*
+ * Task functions are only meaningful to the server;  sent as addresses
+ * to tell them apart.
+ */
+bool
+xdr_work_pool_stats(XDR *xdrs, struct work_pool_stats *stats)
+{
+	struct work_pool_fun_stats *fs;
+	uint64_t fun;
+	u_int ix;
+
+	if (!xdr_uint64_t(xdrs, &stats->submitted)
+	    || !xdr_uint64_t(xdrs, &stats->started)
+	    || !xdr_uint64_t(xdrs, &stats->spawned)
+	    || !xdr_uint64_t(xdrs, &stats->retired)
+	    || !xdr_uint64_t(xdrs, &stats->spawn_failed)
+	    || !xdr_uint64_t(xdrs, &stats->depth_ns))
+		return (false);
+
+	for (ix = 0; ix < WORK_POOL_WAIT_BUCKETS; ix++)
+		if (!xdr_uint64_t(xdrs, &stats->wait[ix]))
+			return (false);
+
+	if (!xdr_uint32_t(xdrs, &stats->queued)
+	    || !xdr_uint32_t(xdrs, &stats->queued_max)
+	    || !xdr_uint32_t(xdrs, &stats->busy)
+	    || !xdr_uint32_t(xdrs, &stats->idle)
+	    || !xdr_uint32_t(xdrs, &stats->threads))
+		return (false);
+
+	for (ix = 0, fs = stats->fun; ix <= WORK_POOL_FUNS; ix++, fs++) {
+		fun = (uintptr_t)fs->fun;
+		if (!xdr_uint64_t(xdrs, &fun)
+		    || !xdr_uint64_t(xdrs, &fs->runs)
+		    || !xdr_uint64_t(xdrs, &fs->run_ns)
+		    || !xdr_uint64_t(xdrs, &fs->run_max_ns))
+			return (false);
+		fs->fun = (work_pool_fun_t)(uintptr_t)fun;
+	}
+	return (true);
+}
+
+bool
+xdr_svc_buffer_stats(XDR *xdrs, struct svc_buffer_stats *stats)
+{
+	return (xdr_uint64_t(xdrs, &stats->created)
+		&& xdr_uint64_t(xdrs, &stats->freed)
+		&& xdr_uint64_t(xdrs, &stats->bytes_created)
+		&& xdr_uint64_t(xdrs, &stats->bytes_freed)
+		&& xdr_uint64_t(xdrs, &stats->grown)
+		&& xdr_uint64_t(xdrs, &stats->pool_fetches)
+		&& xdr_uint64_t(xdrs, &stats->pool_waits)
+		&& xdr_uint64_t(xdrs, &stats->pool_recycles));
+}
+
+bool
+xdr_svc_stats_gss_res(XDR *xdrs, struct svc_stats_gss_res *res)
+{
+	struct svc_gss_cache_stats *gss = &res->gss;
+
+	if (!xdr_bool(xdrs, &res->stats))
+		return (false);
+	if (!res->stats)
+		return (true);
+
+	return (xdr_uint64_t(xdrs, &gss->hits)
+		&& xdr_uint64_t(xdrs, &gss->tree_hits)
+		&& xdr_uint64_t(xdrs, &gss->misses)
+		&& xdr_uint64_t(xdrs, &gss->inserts)
+		&& xdr_uint64_t(xdrs, &gss->deletes)
+		&& xdr_uint64_t(xdrs, &gss->expired)
+		&& xdr_uint64_t(xdrs, &gss->evicted)
+		&& xdr_uint32_t(xdrs, &gss->size)
+		&& xdr_uint32_t(xdrs, &gss->max)
+		&& xdr_uint32_t(xdrs, &gss->partitions));
+}
+
+/*
+ * The tables name peers and descriptors, so beyond NULL the program
+ * answers only callers on this host (AF_LOCAL or a loopback address),
+ * or authenticated by RPCSEC_GSS.
+ */
+static bool
+svc_stats_allowed(struct svc_req *req)
+{
+	struct sockaddr_storage *ss = svc_getrpccaller(req->rq_xprt);
+	struct in6_addr *in6;
+	struct in_addr *in;
+
+	if (req->rq_msg.cb_cred.oa_flavor == RPCSEC_GSS)
+		return (true);
+
+	switch (ss->ss_family) {
+	case AF_LOCAL:
+		return (true);
+	case AF_INET:
+		/* 127.0.0.0/8 */
+		in = &((struct sockaddr_in *)ss)->sin_addr;
+		return (((uint8_t *)&in->s_addr)[0] == 127);
+	case AF_INET6:
+		in6 = &((struct sockaddr_in6 *)ss)->sin6_addr;
+		return (IN6_IS_ADDR_LOOPBACK(in6)
+			|| (IN6_IS_ADDR_V4MAPPED(in6)
+			    && in6->s6_addr[12] == 127));
+	default:
+		break;
+	}
+	return (false);
+}
+
+/*
+ * Replies are encoded before svc_sendreply() returns, so the results
+ * may live on the stack.  Called after the application has
+ * authenticated the request (svc_auth_authenticate).
+ */
+enum xprt_stat
+svc_stats_dispatch(struct svc_req *req)
+{
+	union {
+		struct svc_latency_snapshot latency;
+		struct svc_xprt_stats_snapshot xprts;
+		struct work_pool_stats pool;
+		struct svc_stats_gss_res gss;
+		struct svc_buffer_stats buffers;
+	} res;
+	enum xprt_stat stat;
+	u_int max;
+
+	if (req->rq_msg.cb_vers != TIRPC_STATS_VERS)
+		return svcerr_progvers(req, TIRPC_STATS_VERS,
+				       TIRPC_STATS_VERS);
+
+	if (req->rq_msg.cb_proc != TIRPC_STATSPROC_NULL
+	    && !svc_stats_allowed(req)) {
+		__warnx(TIRPC_DEBUG_FLAG_WARN,
+			"%s: %p fd %d proc %" PRIu32 " refused, remote caller",
+			__func__, req->rq_xprt, req->rq_xprt->xp_fd,
+			req->rq_msg.cb_proc);
+		return svcerr_weakauth(req);
+	}
+
+	memset(&res, 0, sizeof(res));
+	req->rq_msg.RPCM_ack.ar_results.where = &res;
+
+	switch (req->rq_msg.cb_proc) {
+	case TIRPC_STATSPROC_NULL:
+		req->rq_msg.RPCM_ack.ar_results.where = NULL;
+		req->rq_msg.RPCM_ack.ar_results.proc = (xdrproc_t) xdr_void;
+		return svc_sendreply(req);
+
+	case TIRPC_STATSPROC_LATENCY:
+		res.latency.max = SVC_LATENCY_SLOTS;
+		res.latency.hist = mem_alloc(res.latency.max
+					     * sizeof(*res.latency.hist));
+		if (!svc_control(SVC_CTL_LATENCY_GET, &res.latency)) {
+			stat = svcerr_systemerr(req);
+		} else {
+			req->rq_msg.RPCM_ack.ar_results.proc =
+				(xdrproc_t) xdr_svc_latency_snapshot;
+			stat = svc_sendreply(req);
+		}
+		mem_free(res.latency.hist,
+			 res.latency.max * sizeof(*res.latency.hist));
+		return (stat);
+
+	case TIRPC_STATSPROC_XPRTS:
+		req->rq_msg.rm_xdr.where = &max;
+		req->rq_msg.rm_xdr.proc = (xdrproc_t) xdr_u_int;
+		if (!SVCAUTH_UNWRAP(req))
+			return svcerr_decode(req);
+		res.xprts.max = MIN(max, TIRPC_STATS_XPRTS_MAX);
+		res.xprts.xprts = res.xprts.max
+			? mem_alloc(res.xprts.max * sizeof(*res.xprts.xprts))
+			: NULL;
+		(void)svc_control(SVC_CTL_XPRT_STATS_GET, &res.xprts);
+		req->rq_msg.RPCM_ack.ar_results.proc =
+			(xdrproc_t) xdr_svc_xprt_stats_snapshot;
+		stat = svc_sendreply(req);
+		if (res.xprts.xprts)
+			mem_free(res.xprts.xprts,
+				 res.xprts.max * sizeof(*res.xprts.xprts));
+		return (stat);
+
+	case TIRPC_STATSPROC_POOL:
+		(void)svc_control(SVC_CTL_WORK_POOL_GET, &res.pool);
+		req->rq_msg.RPCM_ack.ar_results.proc =
+			(xdrproc_t) xdr_work_pool_stats;
+		return svc_sendreply(req);
+
+	case TIRPC_STATSPROC_GSS:
+		res.gss.stats = svc_control(SVC_CTL_GSS_CACHE_GET,
+					    &res.gss.gss);
+		req->rq_msg.RPCM_ack.ar_results.proc =
+			(xdrproc_t) xdr_svc_stats_gss_res;
+		return svc_sendreply(req);
+
+	case TIRPC_STATSPROC_BUFFERS:
+		(void)svc_control(SVC_CTL_BUFFERS_GET, &res.buffers);
+		req->rq_msg.RPCM_ack.ar_results.proc =
+			(xdrproc_t) xdr_svc_buffer_stats;
+		return svc_sendreply(req);
+
+	default:
+		break;
+	}
+	req->rq_msg.RPCM_ack.ar_results.where = NULL;
+	return svcerr_noproc(req);
+}
+
+static void
+svc_stats_callout(struct svc_req *req)
+{
+	(void)svc_stats_dispatch(req);
+}
+
+bool
+svc_stats_reg(SVCXPRT *xprt, const struct netconfig *nconf)
+{
+	return svc_reg(xprt, TIRPC_STATS_PROG, TIRPC_STATS_VERS,
+		       svc_stats_callout, nconf);
+}
+
+void
+svc_stats_unreg(void)
+{
+	svc_unreg(TIRPC_STATS_PROG, TIRPC_STATS_VERS);
+}
@@ -63,7 +63,6 @@
 #include <getpeereid.h>
 
 #include <rpc/types.h>
-#include <misc/city.h>
 #include <misc/portable.h>
 #include <misc/timespec.h>
 #include <rpc/clnt.h>
@@ -78,7 +77,11 @@
 #include "svc_internal.h"
 #include "svc_xprt.h"
 #include "rpc_dplx_internal.h"
+#include "rpc_probe.h"
 #include "svc_ioq.h"
+#ifdef _HAVE_GSSAPI
+#include <rpc/gss_internal.h>
+#endif
 
 static void svc_vc_rendezvous_ops(SVCXPRT *);
 static void svc_vc_override_ops(SVCXPRT *, SVCXPRT *);
@@ -116,6 +119,10 @@ static void svc_vc_override_ops(SVCXPRT *, SVCXPRT *);
 static void
 svc_vc_xprt_free(struct svc_vc_xprt *xd)
 {
+#ifdef USE_RPC_SHM
+	if (xd->sx_shm)
+		svc_shm_free(xd->sx_shm);
+#endif
 	XDR_DESTROY(xd->sx_dr.ioq.xdrs);
 	rpc_dplx_rec_destroy(&xd->sx_dr);
 	mem_free(xd, sizeof(struct svc_vc_xprt));
@@ -399,6 +406,79 @@ svc_fd_ncreatef(const int fd, const u_int sendsize, const u_int recvsize,
 	return (xprt);
 }
 
+#ifdef USE_RPC_SHM
+/*
+ * Like svc_fd_ncreatef(), for the shared-memory stream (svc_shm.c).  The
+ * receive doorbell stands in for the socket;  addresses are taken from
+ * the AF_LOCAL socket that negotiated the rings.
+ */
+SVCXPRT *
+svc_vc_ncreate_shm(struct svc_shm *shm, const uint32_t flags)
+{
+	SVCXPRT *xprt;
+	struct svc_vc_xprt *xd;
+	struct rpc_dplx_rec *rec;
+	int sock = svc_shm_sock(shm);
+	u_int xp_flags;
+
+	/* atomically find or create shared fd state; ref+1; locked */
+	xprt = svc_xprt_lookup(svc_shm_rxfd(shm), svc_vc_xprt_setup);
+	if (!xprt) {
+		__warnx(TIRPC_DEBUG_FLAG_SVC_VC,
+			"%s: fd %d svc_xprt_lookup failed",
+			__func__, sock);
+		return (NULL);
+	}
+	rec = REC_XPRT(xprt);
+
+	/* the doorbell is always ours to close */
+	xp_flags = atomic_postset_uint16_t_bits(&xprt->xp_flags,
+						SVC_XPRT_FLAG_CLOSE
+						| SVC_XPRT_FLAG_INITIALIZED);
+	if (unlikely(xp_flags & SVC_XPRT_FLAG_INITIALIZED)) {
+		/* a fresh eventfd cannot already be in use */
+		rpc_dplx_rui(rec);
+		__warnx(TIRPC_DEBUG_FLAG_ERROR,
+			"%s: fd %d doorbell %d already in use",
+			__func__, sock, xprt->xp_fd);
+		return (NULL);
+	}
+
+	xd = VC_DR(rec);
+	xd->sx_shm = shm;
+	xd->sx_dr.sendsz = __rpc_get_t_size(AF_LOCAL, IPPROTO_TCP, 0);
+	xd->sx_dr.recvsz = xd->sx_dr.sendsz;
+	xd->sx_dr.pagesz = sysconf(_SC_PAGESIZE);
+	xd->sx_dr.maxrec = __svc_maxrec;
+
+	svc_vc_override_ops(xprt, NULL);
+	xprt->xp_type = XPRT_SHM;
+	xprt->xp_netid = mem_strdup("shm");
+
+	__rpc_address_setup(&xprt->xp_local);
+	if (getsockname(sock, xprt->xp_local.nb.buf,
+			&xprt->xp_local.nb.len) < 0)
+		xprt->xp_local.nb.len = 0;
+
+	__rpc_address_setup(&xprt->xp_remote);
+	if (getpeername(sock, xprt->xp_remote.nb.buf,
+			&xprt->xp_remote.nb.len) < 0)
+		xprt->xp_remote.nb.len = 0;
+
+	rpc_dplx_rui(rec);
+	XPRT_TRACE(xprt, __func__, __func__, __LINE__);
+
+	/* Conditional register */
+	if ((!(__svc_params->flags & SVC_FLAG_NOREG_XPRTS)
+	     && !(flags & SVC_CREATE_FLAG_XPRT_NOREG))
+	    || (flags & SVC_CREATE_FLAG_XPRT_DOREG))
+		svc_rqst_evchan_reg(__svc_params->ev_u.evchan.id, xprt,
+				    SVC_RQST_FLAG_CHAN_AFFINITY);
+
+	return (xprt);
+}
+#endif /* USE_RPC_SHM */
+
  /*ARGSUSED*/
 static enum xprt_stat
 svc_vc_rendezvous(SVCXPRT *xprt)
@@ -455,6 +535,7 @@ svc_vc_rendezvous(SVCXPRT *xprt)
 		return (XPRT_DIED);
 
 	svc_vc_override_ops(newxprt, xprt);
+	RPC_PROBE2(svc_accept, xprt->xp_fd, fd);
 
 	__rpc_address_setup(&newxprt->xp_remote);
 	memcpy(newxprt->xp_remote.nb.buf, &addr, len);
@@ -549,6 +630,7 @@ svc_vc_destroy_it(SVCXPRT *xprt, u_int flags, const char *tag, const int line)
 
 	/* clears xprt from the xprt table (eg, idle scans) */
 	svc_rqst_xprt_unregister(xprt);
+	RPC_PROBE2(svc_destroy, xprt->xp_fd, xprt->xp_refs);
 
 	__warnx(TIRPC_DEBUG_FLAG_REFCNT,
 		"%s() %p fd %d xp_refs %" PRIu32
@@ -585,14 +667,17 @@ svc_vc_control(SVCXPRT *xprt, const u_int rq, void *in)
 		xprt->xp_flags = *(u_int *) in;
 		break;
 	case SVCGET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		*(svc_xprt_fun_t *) in = xprt->xp_ops->xp_free_user_data;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
 		break;
 	case SVCSET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		xprt->xp_ops->xp_free_user_data = *(svc_xprt_fun_t) in;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
+		break;
+	case SVCGET_XP_STATS:
+		svc_xprt_stats_get(xprt, (struct svc_xprt_stats *)in);
 		break;
 	default:
 		return (FALSE);
@@ -613,14 +698,14 @@ svc_vc_rendezvous_control(SVCXPRT *xprt, const u_int rq, void *in)
 		xd->sx_dr.maxrec = *(int *)in;
 		break;
 	case SVCGET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		*(svc_xprt_fun_t *) in = xprt->xp_ops->xp_free_user_data;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
 		break;
 	case SVCSET_XP_FREE_USER_DATA:
-		mutex_lock(&ops_lock);
+		prof_mutex_lock(&ops_lock, "ops_lock");
 		xprt->xp_ops->xp_free_user_data = *(svc_xprt_fun_t) in;
-		mutex_unlock(&ops_lock);
+		prof_mutex_unlock(&ops_lock);
 		break;
 	default:
 		return (FALSE);
@@ -637,6 +722,17 @@ svc_vc_stat(SVCXPRT *xprt)
 	return (XPRT_IDLE);
 }
 
+static inline ssize_t
+svc_vc_recv_bytes(SVCXPRT *xprt, struct svc_vc_xprt *xd, void *buf,
+		  size_t len, int flags)
+{
+#ifdef USE_RPC_SHM
+	if (xd->sx_shm)
+		return svc_shm_recv(xd->sx_shm, buf, len);
+#endif
+	return recv(xprt->xp_fd, buf, len, flags);
+}
+
 static enum xprt_stat
 svc_vc_recv(SVCXPRT *xprt)
 {
@@ -652,6 +748,26 @@ svc_vc_recv(SVCXPRT *xprt)
 	/* no need for locking, only one svc_rqst_xprt_task() per event.
 	 * depends upon svc_rqst_rearm_events() for ordering.
 	 */
+#ifdef USE_RPC_TLS
+	if (xprt->xp_flags & SVC_XPRT_FLAG_TLS_CONNECT) {
+		/* clnt_vc_starttls() owns the socket, and will rearm */
+		return SVC_STAT(xprt);
+	}
+	if (xprt->xp_flags & SVC_XPRT_FLAG_TLS_ACCEPT) {
+		/* the next bytes are a ClientHello, not a record */
+		if (!rpc_tls_accept(xprt)) {
+			SVC_DESTROY(xprt);
+			return SVC_STAT(xprt);
+		}
+		if (unlikely(svc_rqst_rearm_events(xprt))) {
+			__warnx(TIRPC_DEBUG_FLAG_ERROR,
+				"%s: %p fd %d svc_rqst_rearm_events failed (will set dead)",
+				__func__, xprt, xprt->xp_fd);
+			SVC_DESTROY(xprt);
+		}
+		return SVC_STAT(xprt);
+	}
+#endif /* USE_RPC_TLS */
 	have = TAILQ_LAST(&rec->ioq.ioq_uv.uvqh.qh, poolq_head_s);
 	if (!have) {
 		xioq = xdr_ioq_create(xd->sx_dr.pagesz, xd->sx_dr.maxrec,
@@ -663,8 +779,10 @@ svc_vc_recv(SVCXPRT *xprt)
 	}
 
 	if (!xd->sx_fbtbc) {
-		rlen = recv(xprt->xp_fd, &xd->sx_fbtbc, BYTES_PER_XDR_UNIT,
-			    MSG_WAITALL);
+		rlen = svc_vc_recv_bytes(xprt, xd,
+					 (char *)&xd->sx_rmark + xd->sx_rmlen,
+					 BYTES_PER_XDR_UNIT - xd->sx_rmlen,
+					 MSG_WAITALL);
 
 		if (unlikely(rlen < 0)) {
 			code = errno;
@@ -673,6 +791,7 @@ svc_vc_recv(SVCXPRT *xprt)
 				__warnx(TIRPC_DEBUG_FLAG_WARN,
 					"%s: %p fd %d recv errno %d (try again)",
 					"svc_vc_wait", xprt, xprt->xp_fd, code);
+				rpc_dplx_stat_inc(&rec->stats.eagain);
 				if (unlikely(svc_rqst_rearm_events(xprt))) {
 					__warnx(TIRPC_DEBUG_FLAG_ERROR,
 						"%s: %p fd %d svc_rqst_rearm_events failed (will set dead)",
@@ -697,7 +816,24 @@ svc_vc_recv(SVCXPRT *xprt)
 			return SVC_STAT(xprt);
 		}
 
-		xd->sx_fbtbc = (int32_t)ntohl((long)xd->sx_fbtbc);
+		rpc_dplx_stat_add(&rec->stats.bytes_in, rlen);
+		xd->sx_rmlen += rlen;
+		if (xd->sx_rmlen < BYTES_PER_XDR_UNIT) {
+			/* marker split across arrivals, keep what we have */
+			rpc_dplx_stat_inc(&rec->stats.eagain);
+			if (unlikely(svc_rqst_rearm_events(xprt))) {
+				__warnx(TIRPC_DEBUG_FLAG_ERROR,
+					"%s: %p fd %d svc_rqst_rearm_events failed (will set dead)",
+					"svc_vc_wait",
+					xprt, xprt->xp_fd);
+				SVC_DESTROY(xprt);
+			}
+			return SVC_STAT(xprt);
+		}
+		xd->sx_rmlen = 0;
+
+		rpc_dplx_stat_inc(&rec->stats.frags_in);
+		xd->sx_fbtbc = (int32_t)ntohl(xd->sx_rmark);
 		flags = UIO_FLAG_FREE | UIO_FLAG_MORE;
 
 		if (xd->sx_fbtbc & LAST_FRAG) {
@@ -722,15 +858,17 @@ svc_vc_recv(SVCXPRT *xprt)
 		flags = uv->u.uio_flags;
 	}
 
-	rlen = recv(xprt->xp_fd, uv->v.vio_tail, xd->sx_fbtbc, MSG_DONTWAIT);
+	rlen = svc_vc_recv_bytes(xprt, xd, uv->v.vio_tail, xd->sx_fbtbc,
+				 MSG_DONTWAIT);
 
 	if (unlikely(rlen < 0)) {
 		code = errno;
 
 		if (code == EAGAIN || code == EWOULDBLOCK) {
-			__warnx(TIRPC_DEBUG_FLAG_SVC_VC,
-				"%s: %p fd %d recv errno %d (try again)",
-				__func__, xprt, xprt->xp_fd, code);
+			__tracex(TIRPC_DEBUG_FLAG_SVC_VC,
+				 TIRPC_TRACE_SVC_VC_EAGAIN,
+				 xprt, xprt->xp_fd, code, 0, 0);
+			rpc_dplx_stat_inc(&rec->stats.eagain);
 			if (unlikely(svc_rqst_rearm_events(xprt))) {
 				__warnx(TIRPC_DEBUG_FLAG_ERROR,
 					"%s: %p fd %d svc_rqst_rearm_events failed (will set dead)",
@@ -756,10 +894,10 @@ svc_vc_recv(SVCXPRT *xprt)
 
 	uv->v.vio_tail += rlen;
 	xd->sx_fbtbc -= rlen;
+	rpc_dplx_stat_add(&rec->stats.bytes_in, rlen);
 
-	__warnx(TIRPC_DEBUG_FLAG_SVC_VC,
-		"%s: %p fd %d recv %zd, need %" PRIu32 ", flags %x",
-		__func__, xprt, xprt->xp_fd, rlen, xd->sx_fbtbc, flags);
+	__tracex(TIRPC_DEBUG_FLAG_SVC_VC, TIRPC_TRACE_SVC_VC_RECV,
+		 xprt, xprt->xp_fd, rlen, xd->sx_fbtbc, flags);
 
 	if (xd->sx_fbtbc || (flags & UIO_FLAG_MORE)) {
 		if (unlikely(svc_rqst_rearm_events(xprt))) {
@@ -772,9 +910,20 @@ svc_vc_recv(SVCXPRT *xprt)
 	}
 
 	/* finished a request */
+	rpc_dplx_stat_inc(&rec->stats.records_in);
 	(rec->ioq.ioq_uv.uvqh.qcount)--;
 	TAILQ_REMOVE(&rec->ioq.ioq_uv.uvqh.qh, &xioq->ioq_s, q);
 	xdr_ioq_reset(xioq, 0);
+	RPC_PROBE2(svc_record, xprt->xp_fd, xioq->ioq_uv.uvqh.qcount);
+	if (svc_latency_enabled)
+		xioq->ioq_ts = rec->recv.ev;
+	if (svc_slow_enabled) {
+		uint32_t bytes = 0;
+
+		TAILQ_FOREACH(have, &xioq->ioq_uv.uvqh.qh, q)
+			bytes += ioquv_length(IOQ_(have));
+		svc_slow_recv(xioq, rec, &xprt->xp_remote.ss, bytes);
+	}
 
 	if (unlikely(svc_rqst_rearm_events(xprt))) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
@@ -808,10 +957,17 @@ svc_vc_decode(struct svc_req *req)
 		SVC_DESTROY(xprt);
 		return SVC_STAT(xprt);
 	}
+	RPC_PROBE3(svc_decode, req->rq_msg.rm_xid, xprt->xp_fd,
+		   req->rq_msg.rm_direction);
 
 	/* in order of likelihood */
 	if (req->rq_msg.rm_direction == CALL) {
 		/* an ordinary call header */
+		svc_latency_call(req);
+		svc_slow_call(req);
+		RPC_PROBE5(svc_dispatch, req->rq_msg.rm_xid, xprt->xp_fd,
+			   req->rq_msg.cb_prog, req->rq_msg.cb_vers,
+			   req->rq_msg.cb_proc);
 		return xprt->xp_dispatch.process_cb(req);
 	}
 
@@ -832,14 +988,19 @@ svc_vc_decode(struct svc_req *req)
 static void
 svc_vc_checksum(struct svc_req *req, void *data, size_t length)
 {
-	req->rq_cksum =
-#if 1
-	/* CithHash64 is -substantially- faster than crc32c from FreeBSD
-	 * SCTP, so prefer it until fast crc32c bests it */
-		CityHash64WithSeed(data, MIN(256, length), 103);
-#else
-		calculate_crc32c(0, data, MIN(256, length));
+	req->rq_cksum = svc_drc_cksum(req, data, length);
+}
+
+/* as svc_auth_reply(), RPCSEC_GSS sealing may be deferred */
+static inline bool
+svc_vc_auth_reply(struct svc_req *req, struct xdr_ioq *xioq, bool *deferred)
+{
+#ifdef _HAVE_GSSAPI
+	if (req->rq_msg.cb_cred.oa_flavor == RPCSEC_GSS)
+		return (svcauth_gss_reply_ioq(req, xioq, deferred));
 #endif
+	*deferred = false;
+	return (svc_auth_reply(req, xioq->xdrs));
 }
 
 static enum xprt_stat
@@ -847,19 +1008,28 @@ svc_vc_reply(struct svc_req *req)
 {
 	SVCXPRT *xprt = req->rq_xprt;
 	struct xdr_ioq *xioq;
+	struct timespec ts;
+	bool deferred = false;
+
+	if (req->rq_lat)
+		svc_latency_reply(req, &ts);
 
-	/* XXX Until gss_get_mic and gss_wrap can be replaced with
-	 * iov equivalents, replies with RPCSEC_GSS security must be
-	 * encoded in a contiguous buffer.
+	/* Unless gss_get_mic_iov and gss_wrap_iov are available,
+	 * replies with RPCSEC_GSS security must be encoded in a
+	 * contiguous buffer.
 	 *
 	 * Nb, we should probably use getpagesize() on Unix.  Need
 	 * an equivalent for Windows.
 	 */
 	xioq = xdr_ioq_create(RPC_MAXDATA_DEFAULT,
 			      __svc_params->ioq.send_max + RPC_MAXDATA_DEFAULT,
+#ifdef HAVE_GSS_IOV
+			      UIO_FLAG_FREE);
+#else
 			      (req->rq_msg.cb_cred.oa_flavor == RPCSEC_GSS)
 			      ? UIO_FLAG_REALLOC | UIO_FLAG_FREE
 			      : UIO_FLAG_FREE);
+#endif
 
 	if (!xdr_reply_encode(xioq->xdrs, &req->rq_msg)) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
@@ -868,19 +1038,41 @@ svc_vc_reply(struct svc_req *req)
 		return (XPRT_DIED);
 	}
 	xdr_tail_update(xioq->xdrs);
+	xioq->xdrs[0].x_lib[1] = (void *)req->rq_xprt;
+	if (req->rq_lat) {
+		xioq->ioq_ts = ts;
+		xioq->ioq_lat = req->rq_lat;
+	}
+	if (req->rq_slow) {
+		/* the request stream may be gone before the write */
+		svc_slow_stamp(req->rq_slow, SVC_SLOW_REPLY);
+		xioq->ioq_slow = req->rq_slow;
+		XIOQ(req->rq_xdrs)->ioq_slow = NULL;
+		req->rq_slow = NULL;
+	}
 
 	if (req->rq_msg.rm_reply.rp_stat == MSG_ACCEPTED
 	 && req->rq_msg.rm_reply.rp_acpt.ar_stat == SUCCESS
 	 && req->rq_auth
-	 && !SVCAUTH_WRAP(req, xioq->xdrs)) {
+	 && !svc_vc_auth_reply(req, xioq, &deferred)) {
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s: %p fd %d SVCAUTH_WRAP failed (will set dead)",
 			__func__, xprt, xprt->xp_fd);
 		return (XPRT_DIED);
 	}
-	xdr_tail_update(xioq->xdrs);
 
-	xioq->xdrs[0].x_lib[1] = (void *)req->rq_xprt;
+	RPC_PROBE6(svc_reply, req->rq_msg.rm_xid, xprt->xp_fd,
+		   req->rq_msg.cb_prog, req->rq_msg.cb_vers,
+		   req->rq_msg.cb_proc,
+		   req->rq_msg.rm_reply.rp_acpt.ar_stat);
+
+	/* sealing (and output) handed to the RPCSEC_GSS crypto stage,
+	 * which may already have written and destroyed xioq
+	 */
+	if (deferred)
+		return (XPRT_IDLE);
+
+	xdr_tail_update(xioq->xdrs);
 	svc_ioq_write_now(req->rq_xprt, xioq);
 	return (XPRT_IDLE);
 }
@@ -891,7 +1083,7 @@ svc_vc_override_ops(SVCXPRT *xprt, SVCXPRT *rendezvous)
 	static struct xp_ops ops;
 
 	/* VARIABLES PROTECTED BY ops_lock: ops, xp_type */
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 
 	xprt->xp_type = XPRT_TCP;
 
@@ -907,7 +1099,7 @@ svc_vc_override_ops(SVCXPRT *xprt, SVCXPRT *rendezvous)
 	}
 	svc_override_ops(&ops, rendezvous);
 	xprt->xp_ops = &ops;
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
 
 static void
@@ -916,7 +1108,7 @@ svc_vc_rendezvous_ops(SVCXPRT *xprt)
 	static struct xp_ops ops;
 	extern mutex_t ops_lock;
 
-	mutex_lock(&ops_lock);
+	prof_mutex_lock(&ops_lock, "ops_lock");
 
 	xprt->xp_type = XPRT_TCP_RENDEZVOUS;
 
@@ -931,7 +1123,7 @@ svc_vc_rendezvous_ops(SVCXPRT *xprt)
 		ops.xp_free_user_data = NULL;	/* no default */
 	}
 	xprt->xp_ops = &ops;
-	mutex_unlock(&ops_lock);
+	prof_mutex_unlock(&ops_lock);
 }
 
 /*
@@ -151,20 +151,20 @@ svc_xprt_lookup(int fd, svc_xprt_setup_t setup)
 	sk.xprt.xp_fd = fd;
 	t = rbtx_partition_of_scalar(&svc_xprt_fd.xt, fd);
 
-	rwlock_rdlock(&t->lock);
+	prof_rwlock_rdlock(&t->lock, "svc_xprt_fd.xt");
 	nv = opr_rbtree_lookup(&t->t, &sk.fd_node);
 	if (!nv) {
-		rwlock_unlock(&t->lock);
+		prof_rwlock_unlock(&t->lock);
 		if (!setup)
 			return (NULL);
 
-		rwlock_wrlock(&t->lock);
+		prof_rwlock_wrlock(&t->lock, "svc_xprt_fd.xt");
 		nv = opr_rbtree_lookup(&t->t, &sk.fd_node);
 		if (!nv) {
 			if (atomic_inc_uint32_t(&svc_xprt_fd.connections)
 			    > __svc_params->max_connections) {
 				atomic_dec_uint32_t(&svc_xprt_fd.connections);
-				rwlock_unlock(&t->lock);
+				prof_rwlock_unlock(&t->lock);
 				__warnx(TIRPC_DEBUG_FLAG_ERROR,
 					"%s: fd %d max_connections %u exceeded\n",
 					__func__, fd,
@@ -186,7 +186,7 @@ svc_xprt_lookup(int fd, svc_xprt_setup_t setup)
 				(*setup)(&xprt);	/* free, sets NULL */
 				atomic_dec_uint32_t(&svc_xprt_fd.connections);
 			}
-			rwlock_unlock(&t->lock);
+			prof_rwlock_unlock(&t->lock);
 			return (xprt);
 		}
 		/* raced, fallthru */
@@ -196,7 +196,7 @@ svc_xprt_lookup(int fd, svc_xprt_setup_t setup)
 
 	/* lookup reference before unlock ensures shutdown cannot release */
 	SVC_REF(xprt, SVC_REF_FLAG_NONE);
-	rwlock_unlock(&t->lock);
+	prof_rwlock_unlock(&t->lock);
 
 	/* unlocked window here permits shutdown to destroy without release;
 	 * then duplex lock is required to match allocation return,
@@ -240,9 +240,9 @@ svc_xprt_clear(SVCXPRT *xprt)
 		 * this lock (and generation test) prevents repeats.
 		 */
 		atomic_dec_uint32_t(&svc_xprt_fd.connections);
-		rwlock_wrlock(&t->lock);
+		prof_rwlock_wrlock(&t->lock, "svc_xprt_fd.xt");
 		opr_rbtree_remove(&t->t, &REC_XPRT(xprt)->fd_node);
-		rwlock_unlock(&t->lock);
+		prof_rwlock_unlock(&t->lock);
 	}
 }
 
@@ -274,8 +274,8 @@ svc_xprt_foreach(svc_xprt_each_func_t each_f, void *arg)
 		if (++restarts > 5)
 			return (1);
 
-		/* start with rlock */
-		rwlock_rdlock(&t->lock);	/* t RLOCKED */
+		/* start with rlock (t RLOCKED) */
+		prof_rwlock_rdlock(&t->lock, "svc_xprt_fd.xt");
 		tgen = t->t.gen;
 		x_ix = 0;
 		n = opr_rbtree_first(&t->t);
@@ -286,33 +286,79 @@ svc_xprt_foreach(svc_xprt_each_func_t each_f, void *arg)
 			sk.xprt.xp_fd = rec->xprt.xp_fd;
 
 			/* call each_func with t !LOCKED */
-			rwlock_unlock(&t->lock);
+			prof_rwlock_unlock(&t->lock);
 
 			/* restart if each_f disposed xprt */
 			if (each_f(&rec->xprt, arg))
 				goto restart;
 
 			/* validate */
-			rwlock_rdlock(&t->lock);
+			prof_rwlock_rdlock(&t->lock, "svc_xprt_fd.xt");
 
 			if (tgen != t->t.gen) {
 				n = opr_rbtree_lookup(&t->t, &sk.fd_node);
 				if (!n) {
 					/* invalidated, try harder */
-					rwlock_unlock(&t->lock);
+					prof_rwlock_unlock(&t->lock);
 							/* t !LOCKED */
 					goto restart;
 				}
 			}
 			n = opr_rbtree_next(n);
 		}		/* curr partition */
-		rwlock_unlock(&t->lock); /* t !LOCKED */
+		prof_rwlock_unlock(&t->lock); /* t !LOCKED */
 		p_ix++;
 	}			/* SVC_XPRT_PARTITIONS */
 
 	return (0);
 }
 
+void
+svc_xprt_stats_get(SVCXPRT *xprt, struct svc_xprt_stats *out)
+{
+	struct svc_xprt_stats *stats = &REC_XPRT(xprt)->stats;
+
+	out->bytes_in = atomic_fetch_uint64_t(&stats->bytes_in);
+	out->bytes_out = atomic_fetch_uint64_t(&stats->bytes_out);
+	out->records_in = atomic_fetch_uint64_t(&stats->records_in);
+	out->records_out = atomic_fetch_uint64_t(&stats->records_out);
+	out->frags_in = atomic_fetch_uint64_t(&stats->frags_in);
+	out->frags_out = atomic_fetch_uint64_t(&stats->frags_out);
+	out->partial_writes = atomic_fetch_uint64_t(&stats->partial_writes);
+	out->eagain = atomic_fetch_uint64_t(&stats->eagain);
+	out->queued = atomic_fetch_uint32_t(&stats->queued);
+	out->queued_max = atomic_fetch_uint32_t(&stats->queued_max);
+	out->active = REC_XPRT(xprt)->recv.ts;
+}
+
+static bool
+svc_xprt_stats_each(SVCXPRT *xprt, void *arg)
+{
+	struct svc_xprt_stats_snapshot *snap = arg;
+	struct svc_xprt_stats_entry *xe;
+
+	if (xprt->xp_flags & SVC_XPRT_FLAG_DESTROYED)
+		return (false);
+
+	if (snap->count < snap->max) {
+		xe = &snap->xprts[snap->count++];
+		svc_xprt_stats_get(xprt, &xe->stats);
+		xe->remote = xprt->xp_remote.ss;
+		xe->fd = xprt->xp_fd;
+		xe->type = xprt->xp_type;
+	}
+	snap->total++;
+	return (false);
+}
+
+bool
+svc_xprt_stats_collect(struct svc_xprt_stats_snapshot *snap)
+{
+	snap->count = 0;
+	snap->total = 0;
+	return (svc_xprt_foreach(svc_xprt_stats_each, snap) == 0);
+}
+
 void
 svc_xprt_dump_xprts(const char *tag)
 {
@@ -327,7 +373,8 @@ svc_xprt_dump_xprts(const char *tag)
 	p_ix = 0;
 	while (p_ix < SVC_XPRT_PARTITIONS) {
 		t = &svc_xprt_fd.xt.tree[p_ix];
-		rwlock_rdlock(&t->lock);	/* t RLOCKED */
+		/* t RLOCKED */
+		prof_rwlock_rdlock(&t->lock, "svc_xprt_fd.xt");
 		__warnx(TIRPC_DEBUG_FLAG_SVC_XPRT,
 			"xprts at %s: tree %d size %d", tag, p_ix, t->t.size);
 		n = opr_rbtree_first(&t->t);
@@ -338,7 +385,7 @@ svc_xprt_dump_xprts(const char *tag)
 				tag, &rec->xprt, rec->xprt.xp_fd);
 			n = opr_rbtree_next(n);
 		}		/* curr partition */
-		rwlock_unlock(&t->lock);	/* t !LOCKED */
+		prof_rwlock_unlock(&t->lock);	/* t !LOCKED */
 		p_ix++;
 	}			/* SVC_XPRT_PARTITIONS */
  out:
@@ -360,7 +407,8 @@ svc_xprt_shutdown()
 	while (p_ix < SVC_XPRT_PARTITIONS) {
 		t = &svc_xprt_fd.xt.tree[p_ix];
 
-		rwlock_wrlock(&t->lock);	/* t WLOCKED */
+		/* t WLOCKED */
+		prof_rwlock_wrlock(&t->lock, "svc_xprt_fd.xt");
 		while ((n = opr_rbtree_first(&t->t))) {
 			rec = opr_containerof(n, struct rpc_dplx_rec, fd_node);
 
@@ -370,11 +418,11 @@ svc_xprt_shutdown()
 			/* fd_node is counted by initial xp_refs = 1,
 			 * SVC_DESTROY() decrements that reference.
 			 */
-			rwlock_unlock(&t->lock);
+			prof_rwlock_unlock(&t->lock);
 			SVC_DESTROY(&rec->xprt);
-			rwlock_wrlock(&t->lock);
+			prof_rwlock_wrlock(&t->lock, "svc_xprt_fd.xt");
 		}		/* curr partition */
-		rwlock_unlock(&t->lock);	/* t !LOCKED */
+		prof_rwlock_unlock(&t->lock);	/* t !LOCKED */
 		rwlock_destroy(&t->lock);
 		p_ix++;
 	}			/* SVC_XPRT_PARTITIONS */
@@ -45,6 +45,8 @@
  *  svc_xprt_lookup -- find or create shared fd state
  *  svc_xprt_clear -- remove a transport
  *  svc_xprt_foreach -- scan registered transports
+ *  svc_xprt_stats_get -- copy counters of one transport
+ *  svc_xprt_stats_collect -- copy counters of registered transports
  *  svc_xprt_dump_xprts -- dump registered transports
  *  svc_xprt_shutdown -- clear the tree, destroy transports
  */
@@ -62,6 +64,9 @@ void svc_xprt_clear(SVCXPRT *);
 typedef bool(*svc_xprt_each_func_t) (SVCXPRT *, void *);
 int svc_xprt_foreach(svc_xprt_each_func_t, void *);
 
+void svc_xprt_stats_get(SVCXPRT *, struct svc_xprt_stats *);
+bool svc_xprt_stats_collect(struct svc_xprt_stats_snapshot *);
+
 void svc_xprt_dump_xprts(const char *);
 void svc_xprt_shutdown();
 
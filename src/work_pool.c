@@ -58,6 +58,8 @@
 
 #include <rpc/work_pool.h>
 
+#include "lock_prof_internal.h"
+
 #define WORK_POOL_STACK_SIZE MAX(1 * 1024 * 1024, PTHREAD_STACK_MIN)
 #define WORK_POOL_TIMEOUT_MS (31 /* seconds (prime) */ * 1000)
 
@@ -65,6 +67,66 @@
 
 static int work_pool_spawn(struct work_pool *pool);
 
+/*
+ * Telemetry (work_pool_stats_get), maintained under pqh.qmutex.
+ *
+ * pqh.qcount is negative for queued tasks, positive for idle workers.
+ * The queue depth is integrated over time (depth_ns), so the mean depth
+ * between two snapshots is the difference over the elapsed time.
+ */
+static inline uint64_t
+work_pool_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/* before pqh.qcount changes */
+static inline void
+work_pool_depth(struct work_pool *pool, uint64_t now)
+{
+	if (pool->pqh.qcount < 0)
+		pool->stats.depth_ns += (uint64_t)(-pool->pqh.qcount)
+				      * (now - pool->depth_ts);
+	pool->depth_ts = now;
+}
+
+static inline void
+work_pool_started(struct work_pool *pool, struct work_pool_entry *work,
+		  uint64_t now)
+{
+	uint64_t ns = now > work->submitted_ns ? now - work->submitted_ns : 0;
+	u_int b = ns ? 63 - __builtin_clzll(ns) : 0;
+
+	pool->stats.started++;
+	pool->stats.busy++;
+	pool->stats.wait[MIN(b, WORK_POOL_WAIT_BUCKETS - 1)]++;
+}
+
+static inline void
+work_pool_ran(struct work_pool *pool, work_pool_fun_t fun, uint64_t ns)
+{
+	struct work_pool_fun_stats *fs = pool->stats.fun;
+	int ix;
+
+	/* few task types, in order of first use */
+	for (ix = 0; ix < WORK_POOL_FUNS; ix++, fs++) {
+		if (fs->fun == fun)
+			break;
+		if (!fs->fun) {
+			fs->fun = fun;
+			break;
+		}
+	}
+	fs->runs++;
+	fs->run_ns += ns;
+	if (ns > fs->run_max_ns)
+		fs->run_max_ns = ns;
+	pool->stats.busy--;
+}
+
 int
 work_pool_init(struct work_pool *pool, const char *name,
 		struct work_pool_params *params)
@@ -76,6 +138,7 @@ work_pool_init(struct work_pool *pool, const char *name,
 	TAILQ_INIT(&pool->wptqh);
 
 	pool->timeout_ms = WORK_POOL_TIMEOUT_MS;
+	pool->depth_ts = work_pool_now();
 
 	pool->name = mem_strdup(name);
 	pool->params = *params;
@@ -146,12 +209,15 @@ work_pool_thread(void *arg)
 	struct work_pool *pool = wpt->pool;
 	struct poolq_entry *have;
 	struct timespec ts;
+	work_pool_fun_t fun;
+	uint64_t start;
 	int rc;
 	bool spawn;
 
 	pthread_cond_init(&wpt->pqcond, NULL);
-	pthread_mutex_lock(&pool->pqh.qmutex);
+	prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
 	TAILQ_INSERT_TAIL(&pool->wptqh, wpt, wptq);
+	pool->stats.spawned++;
 
 	wpt->worker_index = atomic_inc_uint32_t(&pool->worker_index);
 	snprintf(wpt->worker_name, sizeof(wpt->worker_name), "%.5s%" PRIu32,
@@ -168,7 +234,9 @@ work_pool_thread(void *arg)
 			      && pool->n_threads < pool->params.thrd_max;
 			if (spawn)
 				pool->n_threads++;
-			pthread_mutex_unlock(&pool->pqh.qmutex);
+			start = work_pool_now();
+			work_pool_started(pool, wpt->work, start);
+			prof_mutex_unlock(&pool->pqh.qmutex);
 
 			if (spawn) {
 				/* busy, so dynamically add another thread */
@@ -178,11 +246,16 @@ work_pool_thread(void *arg)
 			__warnx(TIRPC_DEBUG_FLAG_WORKER,
 				"%s() %s task %p",
 				__func__, wpt->worker_name, wpt->work);
-			wpt->work->fun(wpt->work);
+			/* the entry may be gone after its function */
+			fun = wpt->work->fun;
+			fun(wpt->work);
 			wpt->work = NULL;
-			pthread_mutex_lock(&pool->pqh.qmutex);
+			start = work_pool_now() - start;
+			prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
+			work_pool_ran(pool, fun, start);
 		}
 
+		work_pool_depth(pool, work_pool_now());
 		if (0 > pool->pqh.qcount++) {
 			/* negative for task(s) */
 			have = TAILQ_FIRST(&pool->pqh.qh);
@@ -209,7 +282,7 @@ work_pool_thread(void *arg)
 		 * but the condition is per worker,
 		 * making the signal efficient!
 		 */
-		rc = pthread_cond_timedwait(&wpt->pqcond, &pool->pqh.qmutex,
+		rc = prof_cond_timedwait(&wpt->pqcond, &pool->pqh.qmutex,
 					    &ts);
 		if (!wpt->work) {
 			/* Allow for possible timing race:
@@ -230,8 +303,9 @@ work_pool_thread(void *arg)
 	} while (wpt->work || pool->pqh.qcount < pool->params.thrd_min);
 
 	pool->n_threads--;
+	pool->stats.retired++;
 	TAILQ_REMOVE(&pool->wptqh, wpt, wptq);
-	pthread_mutex_unlock(&pool->pqh.qmutex);
+	prof_mutex_unlock(&pool->pqh.qmutex);
 
 	__warnx(TIRPC_DEBUG_FLAG_WORKER,
 		"%s() %s terminating",
@@ -255,6 +329,7 @@ work_pool_spawn(struct work_pool *pool)
 		__warnx(TIRPC_DEBUG_FLAG_ERROR,
 			"%s() pthread_create failed (%d)\n",
 			__func__, rc);
+		atomic_inc_uint64_t(&pool->stats.spawn_failed);
 		return rc;
 	}
 
@@ -270,7 +345,10 @@ work_pool_submit(struct work_pool *pool, struct work_pool_entry *work)
 		/* queue is draining */
 		return (0);
 	}
-	pthread_mutex_lock(&pool->pqh.qmutex);
+	work->submitted_ns = work_pool_now();
+	prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
+	pool->stats.submitted++;
+	work_pool_depth(pool, work->submitted_ns);
 
 	if (0 < pool->pqh.qcount--) {
 		struct work_pool_thread *wpt = (struct work_pool_thread *)
@@ -288,12 +366,26 @@ work_pool_submit(struct work_pool *pool, struct work_pool_entry *work)
 	} else {
 		/* negative for task(s) */
 		TAILQ_INSERT_TAIL(&pool->pqh.qh, &work->pqe, q);
+		if (-pool->pqh.qcount > pool->stats.queued_max)
+			pool->stats.queued_max = -pool->pqh.qcount;
 	}
 
-	pthread_mutex_unlock(&pool->pqh.qmutex);
+	prof_mutex_unlock(&pool->pqh.qmutex);
 	return rc;
 }
 
+void
+work_pool_stats_get(struct work_pool *pool, struct work_pool_stats *stats)
+{
+	prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
+	work_pool_depth(pool, work_pool_now());
+	*stats = pool->stats;
+	stats->queued = pool->pqh.qcount < 0 ? -pool->pqh.qcount : 0;
+	stats->idle = pool->pqh.qcount > 0 ? pool->pqh.qcount : 0;
+	stats->threads = pool->n_threads;
+	prof_mutex_unlock(&pool->pqh.qmutex);
+}
+
 int
 work_pool_shutdown(struct work_pool *pool)
 {
@@ -303,7 +395,7 @@ work_pool_shutdown(struct work_pool *pool)
 		.tv_nsec = 3000,
 	};
 
-	pthread_mutex_lock(&pool->pqh.qmutex);
+	prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
 	pool->timeout_ms = 1;
 	pool->params.thrd_max =
 	pool->params.thrd_min = 0;
@@ -315,14 +407,14 @@ work_pool_shutdown(struct work_pool *pool)
 	}
 
 	while (pool->n_threads > 0) {
-		pthread_mutex_unlock(&pool->pqh.qmutex);
+		prof_mutex_unlock(&pool->pqh.qmutex);
 		__warnx(TIRPC_DEBUG_FLAG_WORKER,
 			"%s() \"%s\" %" PRIu32,
 			__func__, pool->name, pool->n_threads);
 		nanosleep(&ts, NULL);
-		pthread_mutex_lock(&pool->pqh.qmutex);
+		prof_mutex_lock(&pool->pqh.qmutex, "poolq_head.qmutex");
 	}
-	pthread_mutex_unlock(&pool->pqh.qmutex);
+	prof_mutex_unlock(&pool->pqh.qmutex);
 
 	mem_free(pool->name, 0);
 	poolq_head_destroy(&pool->pqh);
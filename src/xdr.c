@@ -66,6 +66,18 @@ XDR xdr_free_null_stream = {
 	.x_v = {NULL, NULL, NULL, NULL},
 };
 
+/* for cleanup of arena decodes:  clears pointers, frees nothing */
+XDR xdr_free_arena_stream = {
+	.x_op = XDR_FREE,
+	.x_public = NULL,
+	.x_private = NULL,
+	.x_lib = {NULL, NULL},
+	.x_data = NULL,
+	.x_base = NULL,
+	.x_v = {NULL, NULL, NULL, NULL},
+	.x_flags = XDR_FLAG_ARENA,
+};
+
 /*
  * XDR nothing
  */
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file xdr_arena.c
+ * @brief Per-request decode arena
+ *
+ * Decoders bump-allocate from fixed size chunks (see xdr_arena_alloc()).
+ * An allocation larger than half a chunk gets a chunk of its own, so the
+ * remainder of the current chunk is not wasted.  On release, fixed size
+ * chunks are kept in a short per-thread cache for the next request handled
+ * by the thread;  the others are freed.  The cache is freed at thread exit.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <misc/portable.h>
+#include <rpc/xdr.h>
+
+#define XDR_ARENA_CHUNK		8192	/* bytes, with header */
+#define XDR_ARENA_CACHE		4	/* chunks kept per thread */
+
+struct xdr_arena_chunk {
+	struct xdr_arena_chunk *xac_next;
+	size_t xac_size;		/* bytes, with header */
+};
+
+#define XDR_ARENA_HEADER \
+	((sizeof(struct xdr_arena_chunk) + XDR_ARENA_ALIGN - 1) \
+	 & ~(size_t)(XDR_ARENA_ALIGN - 1))
+
+struct xdr_arena_cache {
+	struct xdr_arena_chunk *head;
+	u_int count;
+	bool registered;		/* for thread exit */
+};
+
+static __thread struct xdr_arena_cache xdr_arena_cache;
+static pthread_key_t xdr_arena_key;
+static pthread_once_t xdr_arena_once = PTHREAD_ONCE_INIT;
+
+static void
+xdr_arena_thread_exit(void *arg)
+{
+	struct xdr_arena_cache *cache = arg;
+	struct xdr_arena_chunk *chunk;
+
+	while ((chunk = cache->head)) {
+		cache->head = chunk->xac_next;
+		mem_free(chunk, chunk->xac_size);
+	}
+	cache->count = 0;
+	cache->registered = false;
+}
+
+static void
+xdr_arena_key_init(void)
+{
+	(void)pthread_key_create(&xdr_arena_key, xdr_arena_thread_exit);
+}
+
+static inline char *
+xdr_arena_data(struct xdr_arena_chunk *chunk)
+{
+	return ((char *)chunk + XDR_ARENA_HEADER);
+}
+
+/* slow path of xdr_arena_alloc(), size already aligned */
+void *
+xdr_arena_grow(struct xdr_arena *arena, size_t size)
+{
+	struct xdr_arena_cache *cache = &xdr_arena_cache;
+	struct xdr_arena_chunk *chunk;
+
+	if (size > (XDR_ARENA_CHUNK - XDR_ARENA_HEADER) / 2) {
+		chunk = mem_alloc(XDR_ARENA_HEADER + size);
+		chunk->xac_size = XDR_ARENA_HEADER + size;
+
+		/* behind the current chunk, which remains in use */
+		if (arena->xa_chunks) {
+			chunk->xac_next = arena->xa_chunks->xac_next;
+			arena->xa_chunks->xac_next = chunk;
+		} else {
+			chunk->xac_next = NULL;
+			arena->xa_chunks = chunk;
+		}
+		return (xdr_arena_data(chunk));
+	}
+
+	chunk = cache->head;
+	if (chunk) {
+		cache->head = chunk->xac_next;
+		cache->count--;
+	} else {
+		chunk = mem_alloc(XDR_ARENA_CHUNK);
+		chunk->xac_size = XDR_ARENA_CHUNK;
+	}
+	chunk->xac_next = arena->xa_chunks;
+	arena->xa_chunks = chunk;
+	arena->xa_next = xdr_arena_data(chunk) + size;
+	arena->xa_end = (char *)chunk + XDR_ARENA_CHUNK;
+	return (xdr_arena_data(chunk));
+}
+
+/* everything allocated from the arena, at once */
+void
+xdr_arena_release(struct xdr_arena *arena)
+{
+	struct xdr_arena_cache *cache = &xdr_arena_cache;
+	struct xdr_arena_chunk *chunk;
+
+	if (!arena->xa_chunks)
+		return;
+
+	while ((chunk = arena->xa_chunks)) {
+		arena->xa_chunks = chunk->xac_next;
+		if (chunk->xac_size != XDR_ARENA_CHUNK
+		 || cache->count >= XDR_ARENA_CACHE) {
+			mem_free(chunk, chunk->xac_size);
+			continue;
+		}
+		if (unlikely(!cache->registered)) {
+			(void)pthread_once(&xdr_arena_once, xdr_arena_key_init);
+			(void)pthread_setspecific(xdr_arena_key, cache);
+			cache->registered = true;
+		}
+		chunk->xac_next = cache->head;
+		cache->head = chunk;
+		cache->count++;
+	}
+	arena->xa_next = NULL;
+	arena->xa_end = NULL;
+}
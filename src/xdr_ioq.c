@@ -50,6 +50,8 @@
 #include <intrinsic.h>
 #include <misc/abstract_atomic.h>
 #include "rpc_com.h"
+#include "svc_internal.h"
+#include "rpc_dplx_internal.h"
 
 #include <rpc/xdr_ioq.h>
 
@@ -59,6 +61,9 @@ static bool xdr_ioq_noop(void) __attribute__ ((unused));
 
 static uint64_t next_id;
 
+/* SVC_CTL_BUFFERS_GET */
+static struct svc_buffer_stats xdr_ioq_stats;
+
 #if 0				/* jemalloc docs warn about reclaim */
 #define alloc_buffer(size) mem_aligned(0x8, (size))
 #else
@@ -71,6 +76,8 @@ xdr_ioq_uv_create(size_t size, u_int uio_flags)
 {
 	struct xdr_ioq_uv *uv = mem_zalloc(sizeof(struct xdr_ioq_uv));
 
+	rpc_dplx_stat_inc(&xdr_ioq_stats.created);
+	rpc_dplx_stat_add(&xdr_ioq_stats.bytes_created, size);
 	if (size) {
 		uv->v.vio_base = alloc_buffer(size);
 		uv->v.vio_head = uv->v.vio_base;
@@ -94,9 +101,10 @@ xdr_ioq_uv_fetch(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 	__warnx(TIRPC_DEBUG_FLAG_XDR,
 		"%s() %u %s",
 		__func__, count, comment);
-	pthread_mutex_lock(&ioqh->qmutex);
+	prof_mutex_lock(&ioqh->qmutex, "poolq_head.qmutex");
 
 	while (count--) {
+		rpc_dplx_stat_inc(&xdr_ioq_stats.pool_fetches);
 		if (likely(0 < ioqh->qcount--)) {
 			/* positive for buffer(s) */
 			have = TAILQ_FIRST(&ioqh->qh);
@@ -106,10 +114,11 @@ xdr_ioq_uv_fetch(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 			 * this lock is needed for context header queues,
 			 * but is not a burden on uncontested data queues.
 			 */
-			pthread_mutex_lock(&xioq->ioq_uv.uvqh.qmutex);
+			prof_mutex_lock(&xioq->ioq_uv.uvqh.qmutex,
+					"poolq_head.qmutex");
 			(xioq->ioq_uv.uvqh.qcount)++;
 			TAILQ_INSERT_TAIL(&xioq->ioq_uv.uvqh.qh, have, q);
-			pthread_mutex_unlock(&xioq->ioq_uv.uvqh.qmutex);
+			prof_mutex_unlock(&xioq->ioq_uv.uvqh.qmutex);
 		} else {
 			u_int saved = xioq->xdrs[0].x_handy;
 
@@ -118,6 +127,7 @@ xdr_ioq_uv_fetch(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 			 * simplifying mutex and pointer setup.
 			 */
 			TAILQ_INSERT_TAIL(&ioqh->qh, &xioq->ioq_s, q);
+			rpc_dplx_stat_inc(&xdr_ioq_stats.pool_waits);
 
 			__warnx(TIRPC_DEBUG_FLAG_XDR,
 				"%s() waiting for %u %s",
@@ -132,7 +142,7 @@ xdr_ioq_uv_fetch(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 			 * then will wrap as unsigned.
 			 */
 			xioq->xdrs[0].x_handy = count;
-			pthread_cond_wait(&xioq->ioq_cond, &ioqh->qmutex);
+			prof_cond_wait(&xioq->ioq_cond, &ioqh->qmutex);
 			xioq->xdrs[0].x_handy = saved;
 
 			/* entry was already added directly to the queue */
@@ -140,7 +150,7 @@ xdr_ioq_uv_fetch(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 		}
 	}
 
-	pthread_mutex_unlock(&ioqh->qmutex);
+	prof_mutex_unlock(&ioqh->qmutex);
 	return have;
 }
 
@@ -154,7 +164,8 @@ xdr_ioq_uv_fetch_nothing(struct xdr_ioq *xioq, struct poolq_head *ioqh,
 static inline void
 xdr_ioq_uv_recycle(struct poolq_head *ioqh, struct poolq_entry *have)
 {
-	pthread_mutex_lock(&ioqh->qmutex);
+	rpc_dplx_stat_inc(&xdr_ioq_stats.pool_recycles);
+	prof_mutex_lock(&ioqh->qmutex, "poolq_head.qmutex");
 
 	if (likely(0 <= ioqh->qcount++)) {
 		/* positive for buffer(s) */
@@ -182,7 +193,7 @@ xdr_ioq_uv_recycle(struct poolq_head *ioqh, struct poolq_entry *have)
 		}
 	}
 
-	pthread_mutex_unlock(&ioqh->qmutex);
+	prof_mutex_unlock(&ioqh->qmutex);
 }
 
 void
@@ -199,6 +210,9 @@ xdr_ioq_uv_release(struct xdr_ioq_uv *uv)
 			/* handle both xdr_ioq_uv and vio */
 			uv->u.uio_release(&uv->u, UIO_FLAG_NONE);
 		} else if (uv->u.uio_flags & UIO_FLAG_FREE) {
+			rpc_dplx_stat_inc(&xdr_ioq_stats.freed);
+			rpc_dplx_stat_add(&xdr_ioq_stats.bytes_freed,
+					  ioquv_size(uv));
 			free_buffer(uv->v.vio_base, ioquv_size(uv));
 			mem_free(uv, sizeof(*uv));
 		} else if (uv->u.uio_flags & UIO_FLAG_BUFQ) {
@@ -331,6 +345,13 @@ xdr_ioq_uv_advance(struct xdr_ioq *xioq)
 	return IOQ_(TAILQ_NEXT(&uv->uvq, q));
 }
 
+/* Spliced by putbufs:  the data belongs to the caller's uio_refer. */
+static void
+xdr_ioq_uv_release_splice(struct xdr_uio *uio, u_int flags)
+{
+	mem_free(IOQU(uio), sizeof(struct xdr_ioq_uv));
+}
+
 /*
  * Append at read/insert or fill position.
  */
@@ -369,6 +390,10 @@ xdr_ioq_uv_append(struct xdr_ioq *xioq, u_int ioq_flags)
 			base = mem_alloc(xioq->ioq_uv.max_bsize);
 			memcpy(base, uv->v.vio_head, len);
 			mem_free(uv->v.vio_base, size);
+			rpc_dplx_stat_inc(&xdr_ioq_stats.grown);
+			rpc_dplx_stat_add(&xdr_ioq_stats.bytes_created,
+					  xioq->ioq_uv.max_bsize);
+			rpc_dplx_stat_add(&xdr_ioq_stats.bytes_freed, size);
 			uv->v.vio_base =
 			uv->v.vio_head = base + 0;
 			uv->v.vio_tail = base + len;
@@ -383,6 +408,7 @@ xdr_ioq_uv_append(struct xdr_ioq *xioq, u_int ioq_flags)
 	} else {
 		/* XXX empty buffer slot (not supported for now) */
 		uv = xdr_ioq_uv_create(0, UIO_FLAG_NONE);
+		uv->u.uio_release = xdr_ioq_uv_release_splice;
 		(xioq->ioq_uv.uvqh.qcount)++;
 		TAILQ_INSERT_TAIL(&xioq->ioq_uv.uvqh.qh, &uv->uvq, q);
 	}
@@ -583,7 +609,7 @@ xdr_ioq_putbufs(XDR *xdrs, xdr_uio *uio, u_int flags)
 			xdr_ioq_uv_update(XIOQ(xdrs), uv);
 
 		v = &(uio->uio_vio[ix]);
-		uv->u.uio_flags = UIO_FLAG_NONE; /* !RECLAIM */
+		uv->u.uio_flags = UIO_FLAG_REFER; /* !RECLAIM */
 		uv->v = *v;
 
 #if 0
@@ -665,8 +691,8 @@ xdr_ioq_setpos(XDR *xdrs, u_int pos)
 	TAILQ_FOREACH(have, &(XIOQ(xdrs)->ioq_uv.uvqh.qh), q) {
 		struct xdr_ioq_uv *uv = IOQ_(have);
 		u_int len = ioquv_length(uv);
-		u_int full = (uintptr_t)xdrs->x_v.vio_wrap
-			   - (uintptr_t)xdrs->x_v.vio_head;
+		u_int full = (uintptr_t)uv->v.vio_wrap
+			   - (uintptr_t)uv->v.vio_head;
 
 		if (pos <= full) {
 			/* allow up to the end of the buffer,
@@ -685,6 +711,96 @@ xdr_ioq_setpos(XDR *xdrs, u_int pos)
 	return (false);
 }
 
+/*
+ * Describe stream bytes [start, end) in place, as a vector of segment
+ * ranges (e.g., for gss_get_mic_iov and gss_wrap_iov).
+ *
+ * Fills at most count entries of vio, and returns the number needed
+ * (0 if the range is outside the stream).
+ */
+int
+xdr_ioq_vio(XDR *xdrs, u_int start, u_int end, xdr_vio *vio, int count)
+{
+	struct poolq_entry *have;
+	u_int pos = 0;
+	int ix = 0;
+
+	/* update the most recent data length, just in case */
+	xdr_tail_update(xdrs);
+
+	TAILQ_FOREACH(have, &(XIOQ(xdrs)->ioq_uv.uvqh.qh), q) {
+		struct xdr_ioq_uv *uv = IOQ_(have);
+		u_int len = ioquv_length(uv);
+		u_int lo, hi;
+
+		if (pos + len <= start) {
+			pos += len;
+			continue;
+		}
+		if (pos >= end)
+			break;
+
+		lo = (start > pos) ? start - pos : 0;
+		hi = (end < pos + len) ? end - pos : len;
+		if (ix < count) {
+			vio[ix].vio_base = uv->v.vio_base;
+			vio[ix].vio_head = uv->v.vio_head + lo;
+			vio[ix].vio_tail = uv->v.vio_head + hi;
+			vio[ix].vio_wrap = uv->v.vio_wrap;
+		}
+		ix++;
+		pos += len;
+	}
+
+	return ((pos < end) ? 0 : ix);
+}
+
+/*
+ * Copy the segments of stream bytes [start, end) that were spliced in
+ * by XDR_PUTBUFS into buffers of the stream's own, before the range is
+ * modified in place (e.g., by gss_wrap_iov).  The spliced data belongs
+ * to the caller, and is only referenced.
+ */
+void
+xdr_ioq_unsplice(XDR *xdrs, u_int start, u_int end)
+{
+	struct poolq_entry *have;
+	u_int pos = 0;
+
+	/* update the most recent data length, just in case */
+	xdr_tail_update(xdrs);
+
+	TAILQ_FOREACH(have, &(XIOQ(xdrs)->ioq_uv.uvqh.qh), q) {
+		struct xdr_ioq_uv *uv = IOQ_(have);
+		u_int len = ioquv_length(uv);
+		uint8_t *base;
+
+		if (pos >= end)
+			break;
+		pos += len;
+		if (pos <= start || !len
+		 || !(uv->u.uio_flags & UIO_FLAG_REFER))
+			continue;
+
+		base = alloc_buffer(len);
+		memcpy(base, uv->v.vio_head, len);
+		rpc_dplx_stat_add(&xdr_ioq_stats.bytes_created, len);
+
+		if (xdrs->x_base == &uv->v)
+			xdrs->x_data = base + (xdrs->x_data - uv->v.vio_head);
+		uv->v.vio_base =
+		uv->v.vio_head = base;
+		uv->v.vio_tail =
+		uv->v.vio_wrap = base + len;
+		if (xdrs->x_base == &uv->v)
+			xdrs->x_v = uv->v;
+
+		/* ours to free;  uio_refer is still released as before */
+		uv->u.uio_flags = UIO_FLAG_FREE;
+		uv->u.uio_release = NULL;
+	}
+}
+
 void
 xdr_ioq_release(struct poolq_head *ioqh)
 {
@@ -716,6 +832,12 @@ xdr_ioq_destroy(struct xdr_ioq *xioq, size_t qsize)
 
 	xdr_ioq_release(&xioq->ioq_uv.uvqh);
 
+	if (xioq->ioq_slow) {
+		/* never replied */
+		svc_slow_free(xioq->ioq_slow);
+		xioq->ioq_slow = NULL;
+	}
+
 	if (xioq->ioq_pool) {
 		xdr_ioq_uv_recycle(xioq->ioq_pool, &xioq->ioq_s);
 		return;
@@ -752,6 +874,21 @@ xdr_ioq_destroy_pool(struct poolq_head *ioqh)
 	poolq_head_destroy(ioqh);
 }
 
+void
+xdr_ioq_stats_get(struct svc_buffer_stats *out)
+{
+	struct svc_buffer_stats *stats = &xdr_ioq_stats;
+
+	out->created = atomic_fetch_uint64_t(&stats->created);
+	out->freed = atomic_fetch_uint64_t(&stats->freed);
+	out->bytes_created = atomic_fetch_uint64_t(&stats->bytes_created);
+	out->bytes_freed = atomic_fetch_uint64_t(&stats->bytes_freed);
+	out->grown = atomic_fetch_uint64_t(&stats->grown);
+	out->pool_fetches = atomic_fetch_uint64_t(&stats->pool_fetches);
+	out->pool_waits = atomic_fetch_uint64_t(&stats->pool_waits);
+	out->pool_recycles = atomic_fetch_uint64_t(&stats->pool_recycles);
+}
+
 static bool
 xdr_ioq_control(XDR *xdrs, /* const */ int rq, void *in)
 {
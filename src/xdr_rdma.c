@@ -270,10 +270,11 @@ xdr_rdma_respond_callback(struct rpc_rdma_cbc *cbc, RDMAXPRT *xprt)
 		"%s() %p[%u] cbc %p\n",
 		__func__, xprt, xprt->state, cbc);
 
-	mutex_lock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
+	prof_mutex_lock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex,
+			"poolq_head.qmutex");
 	TAILQ_REMOVE(&xprt->sm_dr.ioq.ioq_uv.uvqh.qh, &cbc->workq.ioq_s, q);
 	(xprt->sm_dr.ioq.ioq_uv.uvqh.qcount)--;
-	mutex_unlock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
+	prof_mutex_unlock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
 
 	xdr_ioq_destroy(&cbc->workq, sizeof(*cbc));
 	return (0);
@@ -286,10 +287,11 @@ xdr_rdma_destroy_callback(struct rpc_rdma_cbc *cbc, RDMAXPRT *xprt)
 		"%s() %p[%u] cbc %p\n",
 		__func__, xprt, xprt->state, cbc);
 
-	mutex_lock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
+	prof_mutex_lock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex,
+			"poolq_head.qmutex");
 	TAILQ_REMOVE(&xprt->sm_dr.ioq.ioq_uv.uvqh.qh, &cbc->workq.ioq_s, q);
 	(xprt->sm_dr.ioq.ioq_uv.uvqh.qcount)--;
-	mutex_unlock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
+	prof_mutex_unlock(&xprt->sm_dr.ioq.ioq_uv.uvqh.qmutex);
 
 	xdr_ioq_destroy(&cbc->workq, sizeof(*cbc));
 	return (0);
@@ -77,7 +77,7 @@ xdr_reference(XDR *xdrs, void **pp,	/* the pointer to work on */
 			return (true);
 
 		case XDR_DECODE:
-			*pp = loc = mem_zalloc(size);
+			*pp = loc = xdr_zalloc(xdrs, size);
 			break;
 
 		case XDR_ENCODE:
@@ -87,7 +87,7 @@ xdr_reference(XDR *xdrs, void **pp,	/* the pointer to work on */
 	stat = (*proc) (xdrs, loc);
 
 	if (xdrs->x_op == XDR_FREE) {
-		mem_free(loc, size);
+		xdr_dealloc(xdrs, loc, size);
 		*pp = NULL;
 	}
 	return (stat);
@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file connbench.c
+ * @brief Connection scaling benchmark
+ *
+ * @section DESCRIPTION
+ *
+ * Opens loopback connections to an in-process TCP server (svc_vc) in
+ * steps (--conns, cumulative), nearly all of them idle.  After each
+ * step, reports:
+ *
+ *	accept	connections accepted per second during the step
+ *	rss	resident memory per connection, since before the first step
+ *	sweep	SVC_CTL_CLEAN_IDLE walk of all xprts (destroying none)
+ *	ping	null RPC latency of the --active connections, serially
+ *
+ * Finally, with --reap, the idle xprts are destroyed by repeated
+ * sweeps; then svc_shutdown() destroys the rest, and is timed.
+ *
+ * Each connection takes 2 descriptors in this process; RLIMIT_NOFILE is
+ * raised to its hard limit, and the steps are capped to fit.  Clients
+ * bind a new 127.0.x.1 source address every --per-address connections,
+ * so that the ephemeral ports last.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <rpc/rpc.h>
+#include <rpc/svc_auth.h>
+
+/* SVC_CTL_CLEAN_IDLE is a test hook, not part of the public svc.h */
+#include "config.h"
+#include "../src/svc_internal.h"
+
+#define CB_PROG 0x2000009a
+#define CB_VERS 1
+
+#define CB_STEPS_MAX 16
+
+static struct timespec to = {30, 0};
+
+static struct sockaddr_in cb_addr;
+static uint32_t cb_accepted;
+
+static uint64_t timespec_elapsed(const struct timespec *starting,
+				 const struct timespec *stopping)
+{
+	time_t elapsed = stopping->tv_sec - starting->tv_sec;
+	long nsec = stopping->tv_nsec - starting->tv_nsec;
+
+	return (elapsed * 1000000000L) + nsec;
+}
+
+static uint64_t
+cb_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* bytes */
+static uint64_t
+cb_rss(void)
+{
+	unsigned long size, resident;
+	FILE *f = fopen("/proc/self/statm", "r");
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return (uint64_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+/*
+ * Server
+ */
+
+static enum xprt_stat
+cb_process(struct svc_req *req)
+{
+	enum auth_stat why;
+	bool no_dispatch = false;
+
+	why = svc_auth_authenticate(req, &no_dispatch);
+	if (why != AUTH_OK)
+		return svcerr_auth(req, why);
+	if (no_dispatch)
+		return XPRT_IDLE;
+
+	if (req->rq_msg.cb_prog != CB_PROG)
+		return svcerr_noprog(req);
+	if (req->rq_msg.cb_proc)
+		return svcerr_noproc(req);
+
+	req->rq_msg.RPCM_ack.ar_results.where = NULL;
+	req->rq_msg.RPCM_ack.ar_results.proc = (xdrproc_t) xdr_void;
+	return svc_sendreply(req);
+}
+
+static enum xprt_stat
+cb_rendezvous(SVCXPRT *xprt)
+{
+	xprt->xp_dispatch.process_cb = cb_process;
+	(void)atomic_inc_uint32_t(&cb_accepted);
+	return XPRT_IDLE;
+}
+
+/* serves both calls and the replies to our own clients */
+static enum xprt_stat
+decode_request(SVCXPRT *xprt, XDR *xdrs)
+{
+	struct svc_req *req = calloc(1, sizeof(*req));
+	enum xprt_stat stat;
+
+	SVC_REF(xprt, SVC_REF_FLAG_NONE);
+	req->rq_xprt = xprt;
+	req->rq_xdrs = xdrs;
+	req->rq_refs = 1;
+
+	stat = SVC_DECODE(req);
+
+	if (req->rq_auth)
+		SVCAUTH_RELEASE(req);
+
+	XDR_DESTROY(req->rq_xdrs);
+	SVC_RELEASE(xprt, SVC_RELEASE_FLAG_NONE);
+	free(req);
+	return stat;
+}
+
+static int
+cb_server(void)
+{
+	socklen_t len = sizeof(cb_addr);
+	SVCXPRT *xprt;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		perror("socket failed");
+		return -1;
+	}
+	memset(&cb_addr, 0, sizeof(cb_addr));
+	cb_addr.sin_family = AF_INET;
+	cb_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)&cb_addr, len) < 0
+	 || getsockname(fd, (struct sockaddr *)&cb_addr, &len) < 0) {
+		perror("bind failed");
+		close(fd);
+		return -1;
+	}
+	xprt = svc_vc_ncreatef(fd, 0, 0,
+			       SVC_CREATE_FLAG_CLOSE | SVC_CREATE_FLAG_LISTEN
+			       | SVC_CREATE_FLAG_XPRT_DOREG);
+	if (!xprt) {
+		fprintf(stderr, "svc_vc_ncreatef failed\n");
+		return -1;
+	}
+	xprt->xp_dispatch.rendezvous_cb = cb_rendezvous;
+	return 0;
+}
+
+/*
+ * Clients
+ */
+
+static int
+cb_connect(u_int n, u_int per_address)
+{
+	struct sockaddr_in sin;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+
+	if (fd < 0)
+		return -1;
+
+	/* 127.0.x.1, x from 1 */
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK
+				    + (((n / per_address) % 255 + 1) << 8));
+#ifdef IP_BIND_ADDRESS_NO_PORT
+	(void)setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one,
+			 sizeof(one));
+#else
+	(void)one;
+#endif
+	if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0
+	 || connect(fd, (struct sockaddr *)&cb_addr, sizeof(cb_addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static CLIENT *
+cb_clnt(u_int n, u_int per_address)
+{
+	struct netbuf raddr = {
+		.buf = &cb_addr,
+		.len = sizeof(cb_addr),
+		.maxlen = sizeof(cb_addr),
+	};
+	CLIENT *clnt;
+	int fd = cb_connect(n, per_address);
+
+	if (fd < 0)
+		return NULL;
+	clnt = clnt_vc_ncreatef(fd, &raddr, CB_PROG, CB_VERS, 0, 0,
+				CLNT_CREATE_FLAG_CLOSE);
+	if (CLNT_FAILURE(clnt)) {
+		rpc_perror(&clnt->cl_error, "clnt_ncreate failed");
+		CLNT_DESTROY(clnt);
+		return NULL;
+	}
+	return clnt;
+}
+
+/* wait for the server to catch up, up to the call timeout */
+static bool
+cb_accept_wait(uint32_t want)
+{
+	uint64_t end = cb_now() + to.tv_sec * 1000000000ULL;
+
+	while (atomic_fetch_uint32_t(&cb_accepted) < want) {
+		if (cb_now() > end)
+			return false;
+		usleep(1000);
+	}
+	return true;
+}
+
+static int
+uint64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* returns errors; latencies sorted */
+static u_int
+cb_ping(CLIENT **clnts, u_int active, uint64_t *lat, u_int pings)
+{
+	struct clnt_req *cc;
+	uint64_t start;
+	u_int errors = 0;
+	u_int i;
+
+	for (i = 0; i < pings; i++) {
+		cc = calloc(1, sizeof(*cc));
+		clnt_req_fill(cc, clnts[i % active], authnone_ncreate(), 0,
+			      (xdrproc_t) xdr_void, NULL,
+			      (xdrproc_t) xdr_void, NULL);
+		start = cb_now();
+		if (clnt_req_setup(cc, to) != RPC_SUCCESS
+		 || CLNT_CALL_WAIT(cc) != RPC_SUCCESS)
+			errors++;
+		lat[i] = cb_now() - start;
+		clnt_req_release(cc);
+	}
+	qsort(lat, pings, sizeof(uint64_t), uint64_cmp);
+	return errors;
+}
+
+static int
+parse_list(const char *arg, u_int *list)
+{
+	char *end;
+	int n = 0;
+
+	while (*arg && n < CB_STEPS_MAX) {
+		list[n++] = strtoul(arg, &end, 0);
+		if (*end == 'k' || *end == 'K')
+			list[n - 1] *= 1000, end++;
+		if (*end && *end != ',')
+			return -1;
+		arg = *end ? end + 1 : end;
+	}
+	return n;
+}
+
+static void usage()
+{
+	printf("Usage: connbench [--conns=10k,50k,100k,200k] [--active=<n>] [--pings=<n>] [--per-address=<n>] [--workers=<n>] [--reap]\n");
+}
+
+static struct option long_options[] =
+{
+	{"conns", required_argument, NULL, 'n'},
+	{"active", required_argument, NULL, 'a'},
+	{"pings", required_argument, NULL, 'p'},
+	{"per-address", required_argument, NULL, 'A'},
+	{"workers", required_argument, NULL, 'w'},
+	{"reap", no_argument, NULL, 'r'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	svc_init_params svc_params;
+	struct svc_clean_idle sweep;
+	struct timespec starting, stopping;
+	struct rlimit rl;
+	CLIENT **clnts;
+	uint64_t *lat;
+	uint64_t rss0, ns;
+	int *fds;
+	u_int steps[CB_STEPS_MAX] = {10000, 50000, 100000, 200000};
+	u_int max_conns;
+	u_int made = 0;
+	u_int errors;
+	u_int active = 16;
+	u_int pings = 2000;
+	u_int per_address = 20000;
+	int nsteps = 4;
+	int nworkers = 5;
+	int opt;
+	int s;
+	bool reap = false;
+
+	while ((opt = getopt_long(argc, argv, "a:n:p:rw:A:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 'n':
+			nsteps = parse_list(optarg, steps);
+			break;
+		case 'a':
+			active = atoi(optarg);
+			break;
+		case 'p':
+			pings = atoi(optarg);
+			break;
+		case 'A':
+			per_address = atoi(optarg);
+			break;
+		case 'w':
+			nworkers = atoi(optarg);
+			break;
+		case 'r':
+			reap = true;
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	if (nsteps <= 0 || !active || !pings || !per_address
+	 || nworkers <= 0) {
+		usage();
+		exit(1);
+	}
+
+	/* 2 descriptors per connection, some to spare */
+	if (!getrlimit(RLIMIT_NOFILE, &rl)) {
+		rl.rlim_cur = rl.rlim_max;
+		if (setrlimit(RLIMIT_NOFILE, &rl))
+			(void)getrlimit(RLIMIT_NOFILE, &rl);
+	} else
+		rl.rlim_cur = 1024;
+	max_conns = rl.rlim_cur > 256 ? (rl.rlim_cur - 256) / 2 : 0;
+	if (active > max_conns) {
+		fprintf(stderr, "descriptor limit %lu too low\n",
+			(unsigned long)rl.rlim_cur);
+		exit(1);
+	}
+
+	memset(&svc_params, 0, sizeof(svc_params));
+	svc_params.request_cb = decode_request;
+	svc_params.flags = SVC_INIT_EPOLL | SVC_INIT_NOREG_XPRTS;
+	svc_params.max_connections = rl.rlim_cur;
+	svc_params.max_events = 512;
+	svc_params.ioq_thrd_max = nworkers;
+
+	if (!svc_init(&svc_params)) {
+		perror("svc_init failed");
+		exit(1);
+	}
+	if (cb_server())
+		exit(2);
+
+	clnts = calloc(active, sizeof(CLIENT *));
+	fds = calloc(max_conns, sizeof(int));
+	lat = calloc(pings, sizeof(uint64_t));
+	if (!clnts || !fds || !lat) {
+		perror("calloc failed");
+		exit(1);
+	}
+
+	rss0 = cb_rss();
+
+	/* the active connections first */
+	for (made = 0; made < active; made++) {
+		clnts[made] = cb_clnt(made, per_address);
+		if (!clnts[made]) {
+			perror("connect failed");
+			exit(3);
+		}
+	}
+
+	for (s = 0; s < nsteps; s++) {
+		u_int want = steps[s];
+		u_int from = made;
+
+		if (want > max_conns) {
+			fprintf(stdout, "conns %u: capped to %u by the "
+				"descriptor limit %lu\n", want, max_conns,
+				(unsigned long)rl.rlim_cur);
+			want = max_conns;
+		}
+		if (want <= made)
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &starting);
+		for (; made < want; made++) {
+			fds[made] = cb_connect(made, per_address);
+			if (fds[made] < 0) {
+				perror("connect failed");
+				break;
+			}
+		}
+		if (!cb_accept_wait(made)) {
+			fprintf(stderr, "accepted %u of %u\n",
+				atomic_fetch_uint32_t(&cb_accepted), made);
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &stopping);
+		ns = timespec_elapsed(&starting, &stopping);
+
+		fprintf(stdout, "conns %u: accept %.1f/s, rss %.2f KiB/conn",
+			made, (made - from) * 1000000000.0 / ns,
+			(double)(cb_rss() - rss0) / 1024 / made);
+
+		/* walk only:  nothing is idle for so long */
+		memset(&sweep, 0, sizeof(sweep));
+		sweep.timeout = INT32_MAX;
+		ns = cb_now();
+		if (svc_control(SVC_CTL_CLEAN_IDLE, &sweep)) {
+			ns = cb_now() - ns;
+			fprintf(stdout, ", sweep %u xprts %.3f ms "
+				"(%.1f ns/xprt)", sweep.scanned, ns / 1000000.0,
+				sweep.scanned ? (double)ns / sweep.scanned
+					      : 0.0);
+		} else
+			fprintf(stdout, ", sweep busy");
+
+		errors = cb_ping(clnts, active, lat, pings);
+		fprintf(stdout, ", ping errors %u p50 %.1f p99 %.1f "
+			"max %.1f us\n", errors,
+			lat[pings / 2] / 1000.0, lat[pings * 99 / 100] / 1000.0,
+			lat[pings - 1] / 1000.0);
+		fflush(stdout);
+		if (made < want)
+			break;
+	}
+
+	for (s = 0; s < active; s++)
+		CLNT_DESTROY(clnts[s]);
+
+	if (reap) {
+		u_int sweeps = 0;
+		u_int cleaned = 0;
+
+		/* everything has been idle at least a second; each sweep
+		 * gives up after a few destroys, so repeat until dry
+		 */
+		sleep(2);
+		ns = cb_now();
+		do {
+			memset(&sweep, 0, sizeof(sweep));
+			sweep.timeout = 1;
+			if (!svc_control(SVC_CTL_CLEAN_IDLE, &sweep))
+				break;
+			sweeps++;
+			cleaned += sweep.cleaned;
+		} while (sweep.cleaned);
+		fprintf(stdout, "reap: %u xprts in %u sweeps, %.3f ms\n",
+			cleaned, sweeps, (cb_now() - ns) / 1000000.0);
+	}
+
+	ns = cb_now();
+	svc_shutdown(SVC_SHUTDOWN_FLAG_NONE);
+	fprintf(stdout, "shutdown: %.3f ms\n", (cb_now() - ns) / 1000000.0);
+
+	for (s = active; s < made; s++)
+		close(fds[s]);
+	free(lat);
+	free(fds);
+	free(clnts);
+	return (0);
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file hashbench.c
+ * @brief Checksum and hash micro-benchmarks
+ *
+ * @section DESCRIPTION
+ *
+ * Measures ns/op and MB/s of the hashes available for the duplicate
+ * request cache checksum (svc_init_params.drc_cksum), at --sizes:
+ *
+ *	city64		CityHash64WithSeed()
+ *	city64-256	CityHash64WithSeed() of the first 256 bytes, the
+ *			SVC_DRC_CKSUM_PREFIX default
+ *	citycrc128	CityHashCrc128WithSeed(), only when built with
+ *			SSE4.2 (-msse4.2)
+ *	crc32c-1	rpc_crc32.c, a byte at a time (singletable)
+ *	crc32c-8	rpc_crc32.c, slicing by 8 (multitable)
+ *	crc32c		calculate_crc32c(), as the library calls it
+ *	crc32c-hw	the SSE4.2 crc32 instruction, when the CPU has it
+ *
+ * Each input is hashed both contiguous (flat) and, when larger than
+ * --segment, as separately allocated segments (seg), continuing the
+ * hash from one segment to the next as SVC_DRC_CKSUM_STREAM does over
+ * the xdr_ioq segments of a record.  The crc32c variants are checked
+ * to agree with each other, and across the layouts, before timing.
+ *
+ * The hash code is compiled into the benchmark:  the library does not
+ * export it.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <misc/city.h>
+#ifdef __SSE4_2__
+#include <misc/citycrc.h>
+#endif
+
+/* for its static variants */
+#include "../src/rpc_crc32.c"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define HB_HW_CRC32C 1
+#endif
+
+#define HB_SIZES_MAX 16
+#define HB_BATCH_BYTES 65536
+
+struct hb_input {
+	char **seg;
+	u_int *len;
+	u_int count;
+	u_int bytes;
+};
+
+struct hb_case {
+	const char *name;
+	uint64_t (*hash)(const struct hb_input *in);
+	bool crc32c;			/* checked against crc32c-1 */
+};
+
+static u_int segment = 4096;
+static uint64_t duration_ns = 200000000;
+static volatile uint64_t hb_sink;
+static bool hb_hw;
+
+static uint64_t timespec_elapsed(const struct timespec *starting,
+				 const struct timespec *stopping)
+{
+	time_t elapsed = stopping->tv_sec - starting->tv_sec;
+	long nsec = stopping->tv_nsec - starting->tv_nsec;
+
+	return (elapsed * 1000000000L) + nsec;
+}
+
+/*
+ * Hashes, continued over the segments
+ */
+
+static uint64_t
+hb_city64(const struct hb_input *in)
+{
+	uint64_t h = 103;
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		h = CityHash64WithSeed(in->seg[i], in->len[i], h);
+	return h;
+}
+
+static uint64_t
+hb_city64_256(const struct hb_input *in)
+{
+	return CityHash64WithSeed(in->seg[0], MIN(256, in->len[0]), 103);
+}
+
+#ifdef __SSE4_2__
+static uint64_t
+hb_citycrc128(const struct hb_input *in)
+{
+	uint128 h = { 103, 0 };
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		h = CityHashCrc128WithSeed(in->seg[i], in->len[i], h);
+	return Uint128Low64(h) ^ Uint128High64(h);
+}
+#endif
+
+static uint64_t
+hb_crc32c_1(const struct hb_input *in)
+{
+	uint32_t crc = 0;
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		crc = singletable_crc32c(crc, in->seg[i], in->len[i]);
+	return crc;
+}
+
+static uint64_t
+hb_crc32c_8(const struct hb_input *in)
+{
+	uint32_t crc = 0;
+	u_int i;
+
+	/* up to 4 bytes are taken to align, whether needed or not */
+	for (i = 0; i < in->count; i++)
+		crc = in->len[i] < 4
+		    ? singletable_crc32c(crc, in->seg[i], in->len[i])
+		    : multitable_crc32c(crc, (unsigned char *)in->seg[i],
+					in->len[i]);
+	return crc;
+}
+
+static uint64_t
+hb_crc32c(const struct hb_input *in)
+{
+	uint32_t crc = 0;
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		crc = calculate_crc32c(crc, (unsigned char *)in->seg[i],
+				       in->len[i]);
+	return crc;
+}
+
+#ifdef HB_HW_CRC32C
+__attribute__ ((target("sse4.2")))
+static uint32_t
+hb_crc32c_sse42(uint32_t crc, const char *p, u_int len)
+{
+	uint64_t c = crc;
+	uint64_t v;
+
+	for (; len >= sizeof(v); len -= sizeof(v), p += sizeof(v)) {
+		memcpy(&v, p, sizeof(v));
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = c;
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+
+static uint64_t
+hb_crc32c_hw(const struct hb_input *in)
+{
+	uint32_t crc = 0;
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		crc = hb_crc32c_sse42(crc, in->seg[i], in->len[i]);
+	return crc;
+}
+#endif
+
+static struct hb_case cases[] = {
+	{ "city64", hb_city64, false },
+	{ "city64-256", hb_city64_256, false },
+#ifdef __SSE4_2__
+	{ "citycrc128", hb_citycrc128, false },
+#endif
+	{ "crc32c-1", hb_crc32c_1, true },
+	{ "crc32c-8", hb_crc32c_8, true },
+	{ "crc32c", hb_crc32c, true },
+#ifdef HB_HW_CRC32C
+	{ "crc32c-hw", hb_crc32c_hw, true },
+#endif
+};
+
+/*
+ * Inputs
+ */
+
+static void
+hb_input_create(struct hb_input *in, const char *data, u_int bytes,
+		u_int seglen)
+{
+	u_int i;
+
+	in->count = (bytes + seglen - 1) / seglen;
+	in->bytes = bytes;
+	in->seg = calloc(in->count, sizeof(char *));
+	in->len = calloc(in->count, sizeof(u_int));
+	for (i = 0; i < in->count; i++) {
+		in->len[i] = MIN(seglen, bytes - i * seglen);
+		in->seg[i] = malloc(in->len[i]);
+		memcpy(in->seg[i], data + i * seglen, in->len[i]);
+	}
+}
+
+static void
+hb_input_destroy(struct hb_input *in)
+{
+	u_int i;
+
+	for (i = 0; i < in->count; i++)
+		free(in->seg[i]);
+	free(in->seg);
+	free(in->len);
+}
+
+static bool
+hb_case_available(const struct hb_case *c)
+{
+#ifdef HB_HW_CRC32C
+	if (c->hash == hb_crc32c_hw)
+		return hb_hw;
+#endif
+	return true;
+}
+
+/* crc32c variants agree, contiguous or not */
+static bool
+hb_check(const char *data, u_int bytes)
+{
+	struct hb_input flat, seg;
+	uint64_t want;
+	int i;
+	bool ok = true;
+
+	hb_input_create(&flat, data, bytes, bytes);
+	hb_input_create(&seg, data, bytes, 4093);	/* unaligned */
+	want = hb_crc32c_1(&flat);
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!cases[i].crc32c || !hb_case_available(&cases[i]))
+			continue;
+		if (cases[i].hash(&flat) != want
+		 || cases[i].hash(&seg) != want) {
+			fprintf(stderr, "%s disagrees at %u bytes\n",
+				cases[i].name, bytes);
+			ok = false;
+		}
+	}
+	hb_input_destroy(&seg);
+	hb_input_destroy(&flat);
+	return ok;
+}
+
+static void
+hb_run(const struct hb_case *c, const struct hb_input *in,
+       const char *layout)
+{
+	struct timespec starting, now;
+	uint64_t ops = 0;
+	uint64_t ns;
+	u_int batch = MAX(1, HB_BATCH_BYTES / in->bytes);
+	u_int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &starting);
+	do {
+		for (i = 0; i < batch; i++)
+			hb_sink += c->hash(in);
+		ops += batch;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		ns = timespec_elapsed(&starting, &now);
+	} while (ns < duration_ns);
+
+	fprintf(stdout, "%-10s %-4s %8u %12.1f ns/op %10.1f MB/s\n",
+		c->name, layout, in->bytes, (double)ns / ops,
+		(double)in->bytes * ops * 1000.0 / ns);
+}
+
+static int
+parse_sizes(const char *arg, u_int *list)
+{
+	char *end;
+	int n = 0;
+
+	while (*arg && n < HB_SIZES_MAX) {
+		list[n] = strtoul(arg, &end, 0);
+		if (*end == 'k' || *end == 'K')
+			list[n] *= 1024, end++;
+		else if (*end == 'm' || *end == 'M')
+			list[n] *= 1024 * 1024, end++;
+		if ((*end && *end != ',') || !list[n])
+			return -1;
+		n++;
+		arg = *end ? end + 1 : end;
+	}
+	return n;
+}
+
+static void usage()
+{
+	printf("Usage: hashbench [--time=<ms>] [--sizes=<bytes,...>] [--segment=<bytes>]\n");
+}
+
+static struct option long_options[] =
+{
+	{"time", required_argument, NULL, 't'},
+	{"sizes", required_argument, NULL, 'S'},
+	{"segment", required_argument, NULL, 's'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	struct hb_input flat, seg;
+	u_int sizes[HB_SIZES_MAX] = {
+		64, 256, 1024, 4096, 16384, 65536, 262144, 1048576
+	};
+	u_int max_size = 0;
+	char *data;
+	int nsizes = 8;
+	int opt;
+	int i, s;
+
+	while ((opt = getopt_long(argc, argv, "s:t:S:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 't':
+			duration_ns = atol(optarg) * 1000000ULL;
+			break;
+		case 'S':
+			nsizes = parse_sizes(optarg, sizes);
+			break;
+		case 's':
+			segment = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	if (!duration_ns || nsizes <= 0 || !segment) {
+		usage();
+		exit(1);
+	}
+
+#ifdef HB_HW_CRC32C
+	__builtin_cpu_init();
+	hb_hw = __builtin_cpu_supports("sse4.2");
+#endif
+	for (s = 0; s < nsizes; s++)
+		max_size = MAX(max_size, sizes[s]);
+	max_size = MAX(max_size, 65536);
+	data = malloc(max_size);
+	if (!data) {
+		perror("malloc failed");
+		exit(1);
+	}
+	srandom(103);
+	for (i = 0; i < max_size; i++)
+		data[i] = random();
+
+	if (!hb_check(data, 3) || !hb_check(data, 65536)
+	 || !hb_check(data, 65536 - 5))
+		exit(2);
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!hb_case_available(&cases[i]))
+			continue;
+		for (s = 0; s < nsizes; s++) {
+			hb_input_create(&flat, data, sizes[s], sizes[s]);
+			hb_run(&cases[i], &flat, "flat");
+			hb_input_destroy(&flat);
+			if (sizes[s] <= segment)
+				continue;
+			hb_input_create(&seg, data, sizes[s], segment);
+			hb_run(&cases[i], &seg, "seg");
+			hb_input_destroy(&seg);
+		}
+	}
+	free(data);
+	return (0);
+}
@@ -0,0 +1,637 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file poolbench.c
+ * @brief Work pool and queue micro-benchmarks
+ *
+ * @section DESCRIPTION
+ *
+ * Hands --tasks tasks from producer threads to consumer threads, and
+ * reports throughput, and the latency from submit to start (wakeup
+ * latency, including any queueing), over each combination of:
+ *
+ *	queue		pool	work_pool_submit() to a private work_pool of
+ *				--consumers threads (work_pool_thread), each
+ *				waiting on its own condition
+ *			poolq	a bare poolq_head, with consumers waiting on
+ *				one shared condition
+ *	submit		external  --producers threads submit every task
+ *			worker	--producers chains:  each producer submits
+ *				the first task, then each task submits the
+ *				next of its chain from the consumer
+ *	--producers, --consumers, --work (task nanoseconds, busy)
+ *
+ * Lock figures are for the queue mutex.  For pool, they come from the
+ * library's lock profiling (TIRPC_GET_LOCK_STATS), when built with
+ * USE_LOCK_PROF; for poolq, they are measured here.  Wait is averaged
+ * over the contended acquisitions, hold over all.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <rpc/rpc.h>
+#include <rpc/work_pool.h>
+#include <rpc/lock_prof.h>
+
+#define PB_LIST_MAX 16
+#define PB_LOCK_NAME "poolq_head.qmutex"
+
+enum pb_queue {
+	PB_POOL,
+	PB_POOLQ,
+	PB_QUEUES
+};
+
+static const char * const queue_names[PB_QUEUES] = {
+	"pool", "poolq"
+};
+
+enum pb_submit {
+	PB_EXTERNAL,
+	PB_WORKER,
+	PB_SUBMITS
+};
+
+static const char * const submit_names[PB_SUBMITS] = {
+	"external", "worker"
+};
+
+struct pb_task {
+	struct work_pool_entry wpe;	/*** 1st ***/
+	uint64_t submit_ns;
+	u_int ix;
+};
+
+struct pb_lock_stats {
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t wait_ns;
+	uint64_t wait_max_ns;
+	uint64_t hold_ns;
+	uint64_t hold_max_ns;
+};
+
+/* the current scenario */
+static struct {
+	enum pb_queue queue;
+	enum pb_submit submit;
+	u_int producers;
+	u_int consumers;
+	uint64_t work_ns;
+	u_int tasks;
+
+	struct pb_task *task;
+	uint64_t *lat;
+	pthread_barrier_t barrier;
+	uint32_t done;
+	mutex_t done_mtx;
+	cond_t done_cond;
+
+	/* PB_POOL */
+	struct work_pool pool;
+	uint32_t warm;
+
+	/* PB_POOLQ, under pqh.qmutex */
+	struct poolq_head pqh;
+	cond_t pqcond;
+	u_int waiters;
+	bool stopping;
+
+	/* PB_POOLQ, summed at thread exit */
+	mutex_t lock_mtx;
+	struct pb_lock_stats lock;
+} pb;
+
+static __thread struct pb_lock_stats pb_lock_self;
+static __thread uint64_t pb_held_ns;
+
+static uint64_t
+pb_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+pb_spin(uint64_t ns)
+{
+	uint64_t end;
+
+	if (!ns)
+		return;
+	end = pb_now() + ns;
+	while (pb_now() < end)
+		;
+}
+
+/*
+ * poolq_head, timing its mutex
+ */
+
+static inline void
+pb_lock(void)
+{
+	uint64_t ns;
+
+	if (mutex_trylock(&pb.pqh.qmutex)) {
+		ns = pb_now();
+		mutex_lock(&pb.pqh.qmutex);
+		ns = pb_now() - ns;
+		pb_lock_self.contended++;
+		pb_lock_self.wait_ns += ns;
+		if (ns > pb_lock_self.wait_max_ns)
+			pb_lock_self.wait_max_ns = ns;
+	}
+	pb_lock_self.acquired++;
+	pb_held_ns = pb_now();
+}
+
+/* also before condition waits */
+static inline void
+pb_hold_end(void)
+{
+	uint64_t ns = pb_now() - pb_held_ns;
+
+	pb_lock_self.hold_ns += ns;
+	if (ns > pb_lock_self.hold_max_ns)
+		pb_lock_self.hold_max_ns = ns;
+}
+
+static inline void
+pb_unlock(void)
+{
+	pb_hold_end();
+	mutex_unlock(&pb.pqh.qmutex);
+}
+
+static void
+pb_lock_merge(struct pb_lock_stats *to, const struct pb_lock_stats *from)
+{
+	to->acquired += from->acquired;
+	to->contended += from->contended;
+	to->wait_ns += from->wait_ns;
+	to->hold_ns += from->hold_ns;
+	if (from->wait_max_ns > to->wait_max_ns)
+		to->wait_max_ns = from->wait_max_ns;
+	if (from->hold_max_ns > to->hold_max_ns)
+		to->hold_max_ns = from->hold_max_ns;
+}
+
+static void
+pb_thread_exit(void)
+{
+	mutex_lock(&pb.lock_mtx);
+	pb_lock_merge(&pb.lock, &pb_lock_self);
+	mutex_unlock(&pb.lock_mtx);
+	memset(&pb_lock_self, 0, sizeof(pb_lock_self));
+}
+
+static void
+pb_poolq_put(struct pb_task *t)
+{
+	pb_lock();
+	TAILQ_INSERT_TAIL(&pb.pqh.qh, &t->wpe.pqe, q);
+	pb.pqh.qcount++;
+	if (pb.waiters)
+		cond_signal(&pb.pqcond);
+	pb_unlock();
+}
+
+/*
+ * Tasks
+ */
+
+static void
+pb_submit(u_int ix)
+{
+	struct pb_task *t = &pb.task[ix];
+
+	t->submit_ns = pb_now();
+	if (pb.queue == PB_POOL)
+		(void)work_pool_submit(&pb.pool, &t->wpe);
+	else
+		pb_poolq_put(t);
+}
+
+static void
+pb_run_task(struct pb_task *t)
+{
+	uint64_t start = pb_now();
+
+	pb.lat[t->ix] = start - t->submit_ns;
+	pb_spin(pb.work_ns);
+
+	if (pb.submit == PB_WORKER && t->ix + pb.producers < pb.tasks)
+		pb_submit(t->ix + pb.producers);
+
+	if (atomic_inc_uint32_t(&pb.done) == pb.tasks) {
+		mutex_lock(&pb.done_mtx);
+		cond_signal(&pb.done_cond);
+		mutex_unlock(&pb.done_mtx);
+	}
+}
+
+static void
+pb_pool_fun(struct work_pool_entry *wpe)
+{
+	pb_run_task((struct pb_task *)wpe);
+}
+
+/* holds each worker until all have started */
+static void
+pb_warm_fun(struct work_pool_entry *wpe)
+{
+	(void)atomic_inc_uint32_t(&pb.warm);
+	while (atomic_fetch_uint32_t(&pb.warm) < pb.consumers)
+		usleep(1000);
+}
+
+/*
+ * Threads
+ */
+
+static void *
+pb_producer(void *arg)
+{
+	u_int ix = (uintptr_t)arg;
+
+	pthread_barrier_wait(&pb.barrier);
+	if (pb.submit == PB_WORKER) {
+		if (ix < pb.tasks)
+			pb_submit(ix);
+	} else {
+		for (; ix < pb.tasks; ix += pb.producers)
+			pb_submit(ix);
+	}
+	pb_thread_exit();
+	return (NULL);
+}
+
+static void *
+pb_consumer(void *arg)
+{
+	struct poolq_entry *have;
+
+	for (;;) {
+		pb_lock();
+		while (TAILQ_EMPTY(&pb.pqh.qh) && !pb.stopping) {
+			pb.waiters++;
+			pb_hold_end();
+			cond_wait(&pb.pqcond, &pb.pqh.qmutex);
+			pb_held_ns = pb_now();
+			pb.waiters--;
+		}
+		have = TAILQ_FIRST(&pb.pqh.qh);
+		if (!have) {
+			pb_unlock();
+			break;
+		}
+		TAILQ_REMOVE(&pb.pqh.qh, have, q);
+		pb.pqh.qcount--;
+		pb_unlock();
+
+		pb_run_task((struct pb_task *)have);
+	}
+	pb_thread_exit();
+	return (NULL);
+}
+
+/*
+ * Scenarios
+ */
+
+static int
+uint64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* the library's figures for the pool's queue mutex, if profiled */
+static bool
+pb_lock_prof(bool enable, struct pb_lock_stats *out)
+{
+	struct tirpc_lock_stat stats[TIRPC_LOCK_SITES];
+	struct tirpc_lock_snapshot snap = {
+		.stats = stats,
+		.max = TIRPC_LOCK_SITES,
+	};
+	struct pb_lock_stats site;
+	u_int i;
+
+	if (enable) {
+		(void)tirpc_control(TIRPC_RESET_LOCK_STATS, NULL);
+		return tirpc_control(TIRPC_SET_LOCK_PROF, &enable);
+	}
+	(void)tirpc_control(TIRPC_SET_LOCK_PROF, &enable);
+	if (!tirpc_control(TIRPC_GET_LOCK_STATS, &snap))
+		return false;
+
+	memset(out, 0, sizeof(*out));
+	for (i = 0; i < snap.count; i++) {
+		if (strcmp(stats[i].name, PB_LOCK_NAME))
+			continue;
+		site.acquired = stats[i].acquired;
+		site.contended = stats[i].contended;
+		site.wait_ns = stats[i].wait_ns;
+		site.wait_max_ns = stats[i].wait_max_ns;
+		site.hold_ns = stats[i].hold_ns;
+		site.hold_max_ns = stats[i].hold_max_ns;
+		pb_lock_merge(out, &site);
+	}
+	return true;
+}
+
+static bool
+pb_setup(void)
+{
+	struct work_pool_params params = {
+		.thrd_max = pb.consumers,
+		.thrd_min = pb.consumers,
+	};
+	struct work_pool_entry *warm;
+	u_int i;
+
+	memset(&pb.lock, 0, sizeof(pb.lock));
+	pb.done = 0;
+	for (i = 0; i < pb.tasks; i++) {
+		memset(&pb.task[i], 0, sizeof(pb.task[i]));
+		pb.task[i].ix = i;
+		pb.task[i].wpe.fun = pb_pool_fun;
+	}
+
+	if (pb.queue == PB_POOLQ) {
+		poolq_head_setup(&pb.pqh);
+		cond_init(&pb.pqcond, NULL, NULL);
+		pb.waiters = 0;
+		pb.stopping = false;
+		return true;
+	}
+
+	if (work_pool_init(&pb.pool, "pbnch", &params)) {
+		fprintf(stderr, "work_pool_init failed\n");
+		return false;
+	}
+
+	/* workers start as the pool gets busy:  start them all first */
+	warm = calloc(pb.consumers, sizeof(*warm));
+	pb.warm = 0;
+	for (i = 0; i < pb.consumers; i++) {
+		warm[i].fun = pb_warm_fun;
+		(void)work_pool_submit(&pb.pool, &warm[i]);
+	}
+	while (atomic_fetch_uint32_t(&pb.warm) < pb.consumers)
+		usleep(1000);
+	/* the last may still be running */
+	usleep(10000);
+	free(warm);
+	return true;
+}
+
+static void
+pb_run(void)
+{
+	struct work_pool_stats stats;
+	struct pb_lock_stats *lock = &pb.lock;
+	pthread_t *producers;
+	pthread_t *consumers = NULL;
+	uint64_t start, ns;
+	u_int threads = pb.consumers;
+	u_int i;
+	bool profiled = true;
+
+	if (!pb_setup())
+		return;
+
+	producers = calloc(pb.producers, sizeof(pthread_t));
+	pthread_barrier_init(&pb.barrier, NULL, pb.producers + 1);
+	for (i = 0; i < pb.producers; i++)
+		pthread_create(&producers[i], NULL, pb_producer,
+			       (void *)(uintptr_t)i);
+
+	if (pb.queue == PB_POOLQ) {
+		consumers = calloc(pb.consumers, sizeof(pthread_t));
+		for (i = 0; i < pb.consumers; i++)
+			pthread_create(&consumers[i], NULL, pb_consumer, NULL);
+	} else
+		profiled = pb_lock_prof(true, NULL);
+
+	/* before the producers can run */
+	start = pb_now();
+	pthread_barrier_wait(&pb.barrier);
+
+	mutex_lock(&pb.done_mtx);
+	while (atomic_fetch_uint32_t(&pb.done) < pb.tasks)
+		cond_wait(&pb.done_cond, &pb.done_mtx);
+	mutex_unlock(&pb.done_mtx);
+	ns = pb_now() - start;
+
+	for (i = 0; i < pb.producers; i++)
+		pthread_join(producers[i], NULL);
+	pthread_barrier_destroy(&pb.barrier);
+	free(producers);
+
+	if (pb.queue == PB_POOLQ) {
+		pb_lock();
+		pb.stopping = true;
+		cond_broadcast(&pb.pqcond);
+		pb_unlock();
+		for (i = 0; i < pb.consumers; i++)
+			pthread_join(consumers[i], NULL);
+		free(consumers);
+		cond_destroy(&pb.pqcond);
+		poolq_head_destroy(&pb.pqh);
+	} else {
+		if (profiled)
+			profiled = pb_lock_prof(false, lock);
+		work_pool_stats_get(&pb.pool, &stats);
+		threads = stats.threads;
+		(void)work_pool_shutdown(&pb.pool);
+	}
+
+	qsort(pb.lat, pb.tasks, sizeof(uint64_t), uint64_cmp);
+
+	fprintf(stdout, "%-5s %-8s producers %2u consumers %2u (threads %2u) "
+		"work %6" PRIu64 " ns: %10.0f tasks/s, "
+		"wakeup p50 %.1f p99 %.1f max %.1f us",
+		queue_names[pb.queue], submit_names[pb.submit],
+		pb.producers, pb.consumers, threads, pb.work_ns,
+		pb.tasks * 1000000000.0 / ns,
+		pb.lat[pb.tasks / 2] / 1000.0,
+		pb.lat[(uint64_t)pb.tasks * 99 / 100] / 1000.0,
+		pb.lat[pb.tasks - 1] / 1000.0);
+	if (profiled && lock->acquired)
+		fprintf(stdout, ", lock %" PRIu64 " contended %" PRIu64 " "
+			"wait %.0f max %" PRIu64 " ns "
+			"hold %.0f max %" PRIu64 " ns\n",
+			lock->acquired,
+			lock->contended,
+			lock->contended
+				? (double)lock->wait_ns / lock->contended : 0.0,
+			lock->wait_max_ns,
+			(double)lock->hold_ns / lock->acquired,
+			lock->hold_max_ns);
+	else
+		fprintf(stdout, ", lock n/a (USE_LOCK_PROF)\n");
+	fflush(stdout);
+}
+
+static int
+parse_list(const char *arg, u_int *list)
+{
+	char *end;
+	int n = 0;
+
+	while (*arg && n < PB_LIST_MAX) {
+		list[n++] = strtoul(arg, &end, 0);
+		if (*end && *end != ',')
+			return -1;
+		arg = *end ? end + 1 : end;
+	}
+	return n;
+}
+
+/* returns a bit per name found */
+static int
+parse_names(const char *arg, const char * const *names, int count)
+{
+	const char *end;
+	int mask = 0;
+	int i;
+
+	while (*arg) {
+		end = strchr(arg, ',');
+		if (!end)
+			end = arg + strlen(arg);
+		for (i = 0; i < count; i++)
+			if (strlen(names[i]) == end - arg
+			 && !strncmp(arg, names[i], end - arg))
+				break;
+		if (i == count)
+			return 0;
+		mask |= 1 << i;
+		arg = *end ? end + 1 : end;
+	}
+	return mask;
+}
+
+static void usage()
+{
+	printf("Usage: poolbench [--queues=pool,poolq] [--submit=external,worker] [--producers=<n,...>] [--consumers=<n,...>] [--work=<ns,...>] [--tasks=<n>]\n");
+}
+
+static struct option long_options[] =
+{
+	{"queues", required_argument, NULL, 'q'},
+	{"submit", required_argument, NULL, 's'},
+	{"producers", required_argument, NULL, 'p'},
+	{"consumers", required_argument, NULL, 'c'},
+	{"work", required_argument, NULL, 'w'},
+	{"tasks", required_argument, NULL, 't'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	u_int producers[PB_LIST_MAX] = {1, 4};
+	u_int consumers[PB_LIST_MAX] = {1, 4};
+	u_int work[PB_LIST_MAX] = {0, 10000};
+	int nproducers = 2;
+	int nconsumers = 2;
+	int nwork = 2;
+	int queues = (1 << PB_QUEUES) - 1;
+	int submits = (1 << PB_SUBMITS) - 1;
+	int opt;
+	int q, s, p, c, w;
+
+	pb.tasks = 100000;
+
+	while ((opt = getopt_long(argc, argv, "c:p:q:s:t:w:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 'q':
+			queues = parse_names(optarg, queue_names, PB_QUEUES);
+			break;
+		case 's':
+			submits = parse_names(optarg, submit_names,
+					      PB_SUBMITS);
+			break;
+		case 'p':
+			nproducers = parse_list(optarg, producers);
+			break;
+		case 'c':
+			nconsumers = parse_list(optarg, consumers);
+			break;
+		case 'w':
+			nwork = parse_list(optarg, work);
+			break;
+		case 't':
+			pb.tasks = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	if (!queues || !submits || nproducers <= 0 || nconsumers <= 0
+	 || nwork <= 0 || !pb.tasks) {
+		usage();
+		exit(1);
+	}
+	for (p = 0; p < nproducers; p++)
+		for (c = 0; c < nconsumers; c++)
+			if (!producers[p] || !consumers[c]) {
+				usage();
+				exit(1);
+			}
+
+	pb.task = calloc(pb.tasks, sizeof(struct pb_task));
+	pb.lat = calloc(pb.tasks, sizeof(uint64_t));
+	if (!pb.task || !pb.lat) {
+		perror("calloc failed");
+		exit(1);
+	}
+	mutex_init(&pb.done_mtx, NULL);
+	cond_init(&pb.done_cond, NULL, NULL);
+	mutex_init(&pb.lock_mtx, NULL);
+
+	for (q = 0; q < PB_QUEUES; q++) {
+		if (!(queues & (1 << q)))
+			continue;
+		for (s = 0; s < PB_SUBMITS; s++) {
+			if (!(submits & (1 << s)))
+				continue;
+			for (p = 0; p < nproducers; p++)
+				for (c = 0; c < nconsumers; c++)
+					for (w = 0; w < nwork; w++) {
+						pb.queue = q;
+						pb.submit = s;
+						pb.producers = producers[p];
+						pb.consumers = consumers[c];
+						pb.work_ns = work[w];
+						pb_run();
+					}
+		}
+	}
+
+	free(pb.lat);
+	free(pb.task);
+	return (0);
+}
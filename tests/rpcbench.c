@@ -0,0 +1,780 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file rpcbench.c
+ * @brief Loopback RPC benchmark
+ *
+ * @section DESCRIPTION
+ *
+ * Self-contained benchmark:  an in-process server (TCP and UDP
+ * listeners on 127.0.0.1, socketpairs for "unix") answers null and
+ * echo calls from rpcping-style clients in the same process.  Each
+ * scenario of the matrix
+ *
+ *	transport x payload size x connections x flavor
+ *
+ * issues its calls round-robin over the connections, keeping --depth
+ * calls in flight, and is reported as one JSON object:  throughput in
+ * calls and megabytes (payload, each way) per second, and latency
+ * percentiles.  Payload 0 is the null procedure.
+ *
+ * UDP keeps fewer calls in flight when --depth datagrams would overrun
+ * the server's receive buffer, and fails a call whose datagram is lost
+ * after a second rather than stall (counted in "errors").  Scenarios that cannot run here are
+ * reported with a "skipped" reason:
+ * UDP payloads beyond a datagram, and connection counts beyond the
+ * descriptor limit (2 per stream connection, 1 per UDP client).
+ *
+ * --arena decodes the server's arguments into the request arena
+ * (SVC_INIT_ARENA).
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <rpc/rpc.h>
+#include <rpc/svc_auth.h>
+#include <rpc/xdr_inline.h>
+
+#define BENCH_PROG 0x20000099
+#define BENCH_VERS 1
+#define BENCH_NULL 0
+#define BENCH_ECHO 1
+
+#define BENCH_VC_SZ (2 * 1024 * 1024)
+#define BENCH_DG_SZ 65536
+#define BENCH_DG_PAYLOAD_MAX 32768
+#define BENCH_DG_SOCKBUF (4 * 1024 * 1024)	/* capped by rmem_max */
+#define BENCH_PAYLOAD_MAX (16 * 1024 * 1024)
+
+#define BENCH_LIST_MAX 16
+
+enum bench_transport {
+	BENCH_TCP,
+	BENCH_UDP,
+	BENCH_UNIX,
+};
+
+static const char * const transport_names[] = {
+	"tcp", "udp", "unix"
+};
+
+enum bench_auth {
+	BENCH_AUTH_NONE,
+	BENCH_AUTH_SYS,
+};
+
+static const char * const auth_names[] = {
+	"none", "sys"
+};
+
+static struct timespec to = {30, 0};
+/* a lost datagram fails its call, rather than stalling the scenario */
+static struct timespec dg_to = {1, 0};
+
+struct payload {
+	u_int len;
+	char *val;
+};
+
+/* one scenario */
+struct bench {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	CLIENT **clnts;
+	AUTH *auth;
+	char *buf;			/* payload, shared by the calls */
+	uint64_t *latency;		/* nanoseconds, by call */
+	uint32_t inflight;
+	uint32_t completed;
+	uint32_t errors;
+	uint32_t mismatches;
+};
+
+/* one call, freed by clnt_req_release() */
+struct bench_call {
+	struct clnt_req cc;		/*** 1st ***/
+	struct bench *b;
+	struct payload res;
+	struct timespec sent;
+	uint32_t ix;
+};
+
+static struct sockaddr_in tcp_addr;
+static struct sockaddr_in udp_addr;
+static int udp_rcvbuf;
+
+static bool
+xdr_payload(XDR *xdrs, struct payload *p)
+{
+	return xdr_bytes(xdrs, &p->val, &p->len, BENCH_PAYLOAD_MAX);
+}
+
+static uint64_t timespec_elapsed(const struct timespec *starting,
+				 const struct timespec *stopping)
+{
+	time_t elapsed = stopping->tv_sec - starting->tv_sec;
+	long nsec = stopping->tv_nsec - starting->tv_nsec;
+
+	return (elapsed * 1000000000L) + nsec;
+}
+
+/*
+ * Server
+ */
+
+static enum xprt_stat
+bench_process(struct svc_req *req)
+{
+	struct payload arg = {0, NULL};
+	enum auth_stat why;
+	enum xprt_stat stat;
+	bool no_dispatch = false;
+
+	why = svc_auth_authenticate(req, &no_dispatch);
+	if (why != AUTH_OK)
+		return svcerr_auth(req, why);
+	if (no_dispatch)
+		return XPRT_IDLE;
+
+	if (req->rq_msg.cb_prog != BENCH_PROG)
+		return svcerr_noprog(req);
+	if (req->rq_msg.cb_vers != BENCH_VERS)
+		return svcerr_progvers(req, BENCH_VERS, BENCH_VERS);
+
+	switch (req->rq_msg.cb_proc) {
+	case BENCH_NULL:
+		req->rq_msg.RPCM_ack.ar_results.where = NULL;
+		req->rq_msg.RPCM_ack.ar_results.proc = (xdrproc_t) xdr_void;
+		return svc_sendreply(req);
+	case BENCH_ECHO:
+		req->rq_msg.rm_xdr.where = &arg;
+		req->rq_msg.rm_xdr.proc = (xdrproc_t) xdr_payload;
+		if (!SVCAUTH_UNWRAP(req)) {
+			svc_freeargs(req, (xdrproc_t) xdr_payload, &arg);
+			return svcerr_decode(req);
+		}
+		req->rq_msg.RPCM_ack.ar_results.where = &arg;
+		req->rq_msg.RPCM_ack.ar_results.proc =
+						(xdrproc_t) xdr_payload;
+		stat = svc_sendreply(req);
+		svc_freeargs(req, (xdrproc_t) xdr_payload, &arg);
+		return stat;
+	default:
+		break;
+	};
+	return svcerr_noproc(req);
+}
+
+static enum xprt_stat
+bench_rendezvous_vc(SVCXPRT *xprt)
+{
+	xprt->xp_dispatch.process_cb = bench_process;
+	return XPRT_IDLE;
+}
+
+static enum xprt_stat
+bench_rendezvous_dg(SVCXPRT *xprt)
+{
+	xprt->xp_dispatch.process_cb = bench_process;
+	return SVC_RECV(xprt);
+}
+
+/* serves both calls and the replies to our own clients */
+static enum xprt_stat
+decode_request(SVCXPRT *xprt, XDR *xdrs)
+{
+	struct svc_req *req = calloc(1, sizeof(*req));
+	enum xprt_stat stat;
+
+	SVC_REF(xprt, SVC_REF_FLAG_NONE);
+	req->rq_xprt = xprt;
+	req->rq_xdrs = xdrs;
+	req->rq_refs = 1;
+
+	stat = SVC_DECODE(req);
+
+	if (req->rq_auth)
+		SVCAUTH_RELEASE(req);
+
+	XDR_DESTROY(req->rq_xdrs);
+	SVC_RELEASE(xprt, SVC_RELEASE_FLAG_NONE);
+	free(req);
+	return stat;
+}
+
+static int
+bench_socket(int type, struct sockaddr_in *sin)
+{
+	socklen_t len = sizeof(*sin);
+	int fd = socket(AF_INET, type, 0);
+
+	if (fd < 0)
+		return -1;
+	memset(sin, 0, sizeof(*sin));
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)sin, len) < 0
+	 || getsockname(fd, (struct sockaddr *)sin, &len) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* both ends, so neither the requests nor the replies are dropped */
+static void
+bench_dg_sockbuf(int fd)
+{
+	int sz = BENCH_DG_SOCKBUF;
+
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+	(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+}
+
+/*
+ * Receive buffer charged per datagram (skb truesize):  the payload
+ * with RPC, UDP and IP headers, in a power of 2 allocation, and the
+ * sk_buff with its shared info.
+ */
+static uint32_t
+bench_dg_truesize(uint32_t size)
+{
+	uint32_t alloc = 512;
+
+	while (alloc < size + 256)
+		alloc <<= 1;
+	return (alloc + 1024);
+}
+
+static int
+bench_server(void)
+{
+	SVCXPRT *xprt;
+	socklen_t len;
+	int fd;
+
+	fd = bench_socket(SOCK_STREAM, &tcp_addr);
+	if (fd < 0) {
+		perror("tcp socket failed");
+		return -1;
+	}
+	xprt = svc_vc_ncreatef(fd, BENCH_VC_SZ, BENCH_VC_SZ,
+			       SVC_CREATE_FLAG_CLOSE | SVC_CREATE_FLAG_LISTEN
+			       | SVC_CREATE_FLAG_XPRT_DOREG);
+	if (!xprt) {
+		fprintf(stderr, "svc_vc_ncreatef failed\n");
+		return -1;
+	}
+	xprt->xp_dispatch.rendezvous_cb = bench_rendezvous_vc;
+
+	fd = bench_socket(SOCK_DGRAM, &udp_addr);
+	if (fd < 0) {
+		perror("udp socket failed");
+		return -1;
+	}
+	bench_dg_sockbuf(fd);
+	len = sizeof(udp_rcvbuf);
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &udp_rcvbuf, &len) < 0)
+		udp_rcvbuf = 65536;
+	xprt = svc_dg_ncreatef(fd, BENCH_DG_SZ, BENCH_DG_SZ,
+			       SVC_CREATE_FLAG_CLOSE
+			       | SVC_CREATE_FLAG_XPRT_DOREG);
+	if (!xprt) {
+		fprintf(stderr, "svc_dg_ncreatef failed\n");
+		return -1;
+	}
+	xprt->xp_dispatch.rendezvous_cb = bench_rendezvous_dg;
+	return 0;
+}
+
+/*
+ * Clients
+ */
+
+static CLIENT *
+bench_clnt(enum bench_transport transport)
+{
+	struct sockaddr_storage ss;
+	struct netbuf raddr = {
+		.buf = &ss,
+	};
+	SVCXPRT *xprt;
+	CLIENT *clnt;
+	int sv[2];
+	int fd;
+
+	switch (transport) {
+	case BENCH_TCP:
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return NULL;
+		if (connect(fd, (struct sockaddr *)&tcp_addr,
+			    sizeof(tcp_addr)) < 0) {
+			close(fd);
+			return NULL;
+		}
+		memcpy(&ss, &tcp_addr, sizeof(tcp_addr));
+		raddr.len = raddr.maxlen = sizeof(tcp_addr);
+		clnt = clnt_vc_ncreatef(fd, &raddr, BENCH_PROG, BENCH_VERS,
+					BENCH_VC_SZ, BENCH_VC_SZ,
+					CLNT_CREATE_FLAG_CLOSE);
+		break;
+	case BENCH_UDP:
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0)
+			return NULL;
+		bench_dg_sockbuf(fd);
+		memcpy(&ss, &udp_addr, sizeof(udp_addr));
+		raddr.len = raddr.maxlen = sizeof(udp_addr);
+		clnt = clnt_dg_ncreatef(fd, &raddr, BENCH_PROG, BENCH_VERS,
+					BENCH_DG_SZ, BENCH_DG_SZ,
+					CLNT_CREATE_FLAG_CLOSE);
+		break;
+	case BENCH_UNIX:
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+			return NULL;
+		xprt = svc_fd_ncreatef(sv[0], BENCH_VC_SZ, BENCH_VC_SZ,
+				       SVC_CREATE_FLAG_CLOSE
+				       | SVC_CREATE_FLAG_XPRT_DOREG);
+		if (!xprt) {
+			close(sv[0]);
+			close(sv[1]);
+			return NULL;
+		}
+		xprt->xp_dispatch.process_cb = bench_process;
+		raddr.len = raddr.maxlen = sizeof(ss);
+		getpeername(sv[1], (struct sockaddr *)&ss, &raddr.len);
+		clnt = clnt_vc_ncreatef(sv[1], &raddr, BENCH_PROG, BENCH_VERS,
+					BENCH_VC_SZ, BENCH_VC_SZ,
+					CLNT_CREATE_FLAG_CLOSE);
+		break;
+	default:
+		return NULL;
+	};
+
+	if (CLNT_FAILURE(clnt)) {
+		rpc_perror(&clnt->cl_error, "clnt_ncreate failed");
+		CLNT_DESTROY(clnt);
+		return NULL;
+	}
+	return clnt;
+}
+
+static void
+bench_cb(struct clnt_req *cc)
+{
+	struct bench_call *call = (struct bench_call *)cc;
+	struct bench *b = call->b;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	b->latency[call->ix] = timespec_elapsed(&call->sent, &now);
+	if (cc->cc_error.re_status != RPC_SUCCESS)
+		(void)atomic_inc_uint32_t(&b->errors);
+	else if (cc->cc_proc == BENCH_ECHO
+		 && call->res.len != ((struct payload *)cc->cc_call.where)->len)
+		(void)atomic_inc_uint32_t(&b->mismatches);
+	xdr_free((xdrproc_t) xdr_payload, &call->res);
+	clnt_req_release(cc);
+
+	pthread_mutex_lock(&b->mutex);
+	b->inflight--;
+	b->completed++;
+	pthread_cond_broadcast(&b->cond);
+	pthread_mutex_unlock(&b->mutex);
+}
+
+static int
+uint64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double
+quantile_us(const uint64_t *sorted, uint32_t n, double q)
+{
+	uint32_t ix = q * n;
+
+	if (!n)
+		return 0.0;
+	return sorted[ix < n ? ix : n - 1] / 1000.0;
+}
+
+static void
+bench_print(bool *first, enum bench_transport transport, u_int size,
+	    u_int conns, enum bench_auth flavor)
+{
+	fprintf(stdout, "%s\n  {\"transport\": \"%s\", \"payload\": %u, "
+		"\"connections\": %u, \"auth\": \"%s\"",
+		*first ? "[" : ",", transport_names[transport], size, conns,
+		auth_names[flavor]);
+	*first = false;
+}
+
+static void
+bench_skip(bool *first, enum bench_transport transport, u_int size,
+	   u_int conns, enum bench_auth flavor, const char *why)
+{
+	bench_print(first, transport, size, conns, flavor);
+	fprintf(stdout, ", \"skipped\": \"%s\"}", why);
+	fflush(stdout);
+}
+
+static void
+bench_run(bool *first, enum bench_transport transport, u_int size,
+	  u_int conns, enum bench_auth flavor, uint32_t calls,
+	  uint32_t depth)
+{
+	struct bench b;
+	struct payload arg;
+	struct bench_call *call;
+	struct timespec setup, starting, stopping;
+	double seconds, mean;
+	uint64_t sum;
+	uint32_t sent, i;
+	u_int made;
+
+	memset(&b, 0, sizeof(b));
+	pthread_mutex_init(&b.mutex, NULL);
+	pthread_cond_init(&b.cond, NULL);
+	b.clnts = calloc(conns, sizeof(CLIENT *));
+	b.latency = calloc(calls, sizeof(uint64_t));
+	b.buf = malloc(size ? size : 1);
+	if (!b.clnts || !b.latency || !b.buf) {
+		bench_skip(first, transport, size, conns, flavor,
+			   "out of memory");
+		goto out;
+	}
+	memset(b.buf, 0x5a, size);
+	arg.len = size;
+	arg.val = b.buf;
+	b.auth = (flavor == BENCH_AUTH_SYS)
+		? authunix_ncreate_default() : authnone_ncreate();
+
+	clock_gettime(CLOCK_MONOTONIC, &setup);
+	for (made = 0; made < conns; made++) {
+		b.clnts[made] = bench_clnt(transport);
+		if (!b.clnts[made])
+			break;
+	}
+	if (made < conns) {
+		bench_skip(first, transport, size, conns, flavor,
+			   "connection setup failed");
+		goto destroy;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &starting);
+	for (sent = 0; sent < calls; sent++) {
+		pthread_mutex_lock(&b.mutex);
+		while (b.inflight >= depth)
+			pthread_cond_wait(&b.cond, &b.mutex);
+		b.inflight++;
+		pthread_mutex_unlock(&b.mutex);
+
+		call = calloc(1, sizeof(*call));
+		call->b = &b;
+		call->ix = sent;
+		if (size)
+			clnt_req_fill(&call->cc, b.clnts[sent % conns], b.auth,
+				      BENCH_ECHO, (xdrproc_t) xdr_payload,
+				      &arg, (xdrproc_t) xdr_payload,
+				      &call->res);
+		else
+			clnt_req_fill(&call->cc, b.clnts[sent % conns], b.auth,
+				      BENCH_NULL, (xdrproc_t) xdr_void, NULL,
+				      (xdrproc_t) xdr_void, NULL);
+		call->cc.cc_size = sizeof(*call);
+
+		clock_gettime(CLOCK_MONOTONIC, &call->sent);
+		if (clnt_req_setup(&call->cc,
+				   transport == BENCH_UDP ? dg_to : to)
+		    != RPC_SUCCESS) {
+			rpc_perror(&call->cc.cc_error,
+				   "clnt_req_setup failed");
+			clnt_req_release(&call->cc);
+			break;
+		}
+		call->cc.cc_refreshes = 1;
+		call->cc.cc_process_cb = bench_cb;
+
+		/* once sent, the call may already be released */
+		if (CLNT_CALL_BACK(&call->cc) != RPC_SUCCESS) {
+			rpc_perror(&call->cc.cc_error,
+				   "CLNT_CALL_BACK failed");
+			clnt_req_release(&call->cc);
+			break;
+		}
+	}
+
+	/* the failed call (if any) never completes */
+	pthread_mutex_lock(&b.mutex);
+	while (b.completed < sent)
+		pthread_cond_wait(&b.cond, &b.mutex);
+	pthread_mutex_unlock(&b.mutex);
+	clock_gettime(CLOCK_MONOTONIC, &stopping);
+
+	seconds = timespec_elapsed(&starting, &stopping) / 1000000000.0;
+	qsort(b.latency, sent, sizeof(uint64_t), uint64_cmp);
+	for (sum = 0, i = 0; i < sent; i++)
+		sum += b.latency[i];
+	mean = sent ? sum / 1000.0 / sent : 0.0;
+
+	bench_print(first, transport, size, conns, flavor);
+	fprintf(stdout, ", \"depth\": %u, \"calls\": %u, \"errors\": %u, "
+		"\"mismatches\": %u, \"setup_seconds\": %.6f, "
+		"\"seconds\": %.6f, \"calls_per_sec\": %.1f, "
+		"\"mbytes_per_sec\": %.2f, \"latency_us\": {\"mean\": %.1f, "
+		"\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+		"\"p99.9\": %.1f, \"max\": %.1f}}",
+		depth, sent, b.errors + (calls - sent), b.mismatches,
+		timespec_elapsed(&setup, &starting) / 1000000000.0,
+		seconds, sent / seconds,
+		(double)size * (sent - b.errors) / seconds / 1000000.0,
+		mean, quantile_us(b.latency, sent, 0.50),
+		quantile_us(b.latency, sent, 0.90),
+		quantile_us(b.latency, sent, 0.99),
+		quantile_us(b.latency, sent, 0.999),
+		sent ? b.latency[sent - 1] / 1000.0 : 0.0);
+	fflush(stdout);
+
+ destroy:
+	for (i = 0; i < made; i++)
+		CLNT_DESTROY(b.clnts[i]);
+	if (flavor == BENCH_AUTH_SYS)
+		AUTH_DESTROY(b.auth);
+ out:
+	free(b.buf);
+	free(b.latency);
+	free(b.clnts);
+	pthread_cond_destroy(&b.cond);
+	pthread_mutex_destroy(&b.mutex);
+}
+
+/*
+ * Options
+ */
+
+/* comma separated numbers */
+static int
+parse_list(const char *arg, u_int *list)
+{
+	char *end;
+	int n = 0;
+
+	while (*arg && n < BENCH_LIST_MAX) {
+		list[n++] = strtoul(arg, &end, 0);
+		if (*end == 'k' || *end == 'K')
+			list[n - 1] <<= 10, end++;
+		else if (*end == 'm' || *end == 'M')
+			list[n - 1] <<= 20, end++;
+		if (*end && *end != ',')
+			return -1;
+		arg = *end ? end + 1 : end;
+	}
+	return n;
+}
+
+/* comma separated names, as a bit mask of their index */
+static int
+parse_names(const char *arg, const char * const *names, int count)
+{
+	int mask = 0;
+	int len;
+	int i;
+
+	while (*arg) {
+		len = strcspn(arg, ",");
+		for (i = 0; i < count; i++) {
+			if (strlen(names[i]) == len
+			 && !strncmp(arg, names[i], len))
+				break;
+		}
+		if (i == count)
+			return -1;
+		mask |= 1 << i;
+		arg += len;
+		if (*arg)
+			arg++;
+	}
+	return mask;
+}
+
+static void usage()
+{
+	printf("Usage: rpcbench [--transports=tcp,udp,unix] [--sizes=0,4k,64k,1m] [--conns=1,10,100,1000,10000] [--auth=none,sys] [--calls=<n>] [--bytes=<n>] [--depth=<n>] [--workers=<n>] [--arena]\n");
+}
+
+static struct option long_options[] =
+{
+	{"transports", required_argument, NULL, 't'},
+	{"sizes", required_argument, NULL, 's'},
+	{"conns", required_argument, NULL, 'n'},
+	{"auth", required_argument, NULL, 'a'},
+	{"calls", required_argument, NULL, 'c'},
+	{"bytes", required_argument, NULL, 'b'},
+	{"depth", required_argument, NULL, 'd'},
+	{"workers", required_argument, NULL, 'w'},
+	{"arena", no_argument, NULL, 'A'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	svc_init_params svc_params;
+	struct rlimit rl;
+	u_int sizes[BENCH_LIST_MAX] = {0, 4096, 65536, 1048576};
+	u_int conns[BENCH_LIST_MAX] = {1, 10, 100, 1000, 10000};
+	u_int bytes[1] = {256 * 1024 * 1024};
+	int nsizes = 4;
+	int nconns = 5;
+	int transports = (1 << BENCH_TCP) | (1 << BENCH_UDP)
+		       | (1 << BENCH_UNIX);
+	int flavors = (1 << BENCH_AUTH_NONE) | (1 << BENCH_AUTH_SYS);
+	int calls = 20000;
+	int depth = 64;
+	int nworkers = 5;
+	bool arena = false;
+	int opt;
+	int t, s, n, a;
+	bool first = true;
+
+	while ((opt = getopt_long(argc, argv, "Aa:b:c:d:n:s:t:w:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 't':
+			transports = parse_names(optarg, transport_names, 3);
+			break;
+		case 's':
+			nsizes = parse_list(optarg, sizes);
+			break;
+		case 'n':
+			nconns = parse_list(optarg, conns);
+			break;
+		case 'a':
+			flavors = parse_names(optarg, auth_names, 2);
+			break;
+		case 'c':
+			calls = atoi(optarg);
+			break;
+		case 'b':
+			if (parse_list(optarg, bytes) != 1)
+				bytes[0] = 0;
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 'w':
+			nworkers = atoi(optarg);
+			break;
+		case 'A':
+			arena = true;
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	if (transports <= 0 || flavors <= 0 || nsizes <= 0 || nconns <= 0
+	 || calls <= 0 || depth <= 0 || nworkers <= 0 || !bytes[0]) {
+		usage();
+		exit(1);
+	}
+	for (s = 0; s < nsizes; s++) {
+		if (sizes[s] > BENCH_PAYLOAD_MAX) {
+			fprintf(stderr, "payload %u exceeds %u\n",
+				sizes[s], BENCH_PAYLOAD_MAX);
+			exit(1);
+		}
+	}
+
+	/* as many connections as the hard limit allows */
+	if (!getrlimit(RLIMIT_NOFILE, &rl)) {
+		rl.rlim_cur = rl.rlim_max;
+		if (setrlimit(RLIMIT_NOFILE, &rl))
+			(void)getrlimit(RLIMIT_NOFILE, &rl);
+	} else
+		rl.rlim_cur = 1024;
+
+	memset(&svc_params, 0, sizeof(svc_params));
+	svc_params.request_cb = decode_request;
+	svc_params.flags = SVC_INIT_EPOLL | SVC_INIT_NOREG_XPRTS;
+	if (arena)
+		svc_params.flags |= SVC_INIT_ARENA;
+	svc_params.max_events = 512;
+	svc_params.ioq_thrd_max = nworkers;
+	svc_params.max_connections = rl.rlim_cur;
+
+	if (!svc_init(&svc_params)) {
+		perror("svc_init failed");
+		exit(1);
+	}
+	if (bench_server())
+		exit(2);
+
+	for (t = 0; t < 3; t++) {
+		if (!(transports & (1 << t)))
+			continue;
+		for (s = 0; s < nsizes; s++)
+		for (n = 0; n < nconns; n++)
+		for (a = 0; a < 2; a++) {
+			uint64_t fds = (uint64_t)conns[n]
+				     * (t == BENCH_UDP ? 1 : 2);
+			uint32_t c = calls;
+			uint32_t d = depth;
+
+			if (!(flavors & (1 << a)))
+				continue;
+			if (t == BENCH_UDP && sizes[s] > BENCH_DG_PAYLOAD_MAX) {
+				bench_skip(&first, t, sizes[s], conns[n], a,
+					   "payload exceeds a datagram");
+				continue;
+			}
+			/* leave some for the server and stdio */
+			if (!conns[n] || fds + 64 > rl.rlim_cur) {
+				bench_skip(&first, t, sizes[s], conns[n], a,
+					   "descriptor limit");
+				continue;
+			}
+			/* bound the bytes moved, but use every connection */
+			if (sizes[s] && c > bytes[0] / sizes[s])
+				c = bytes[0] / sizes[s];
+			if (c < conns[n])
+				c = conns[n];
+			/* a dropped datagram fails its call:  keep those in
+			 * flight within half the server's receive buffer
+			 */
+			if (t == BENCH_UDP
+			 && d > udp_rcvbuf / 2 / bench_dg_truesize(sizes[s])) {
+				d = udp_rcvbuf / 2
+				  / bench_dg_truesize(sizes[s]);
+				if (!d)
+					d = 1;
+			}
+			bench_run(&first, t, sizes[s], conns[n], a, c, d);
+		}
+	}
+	fprintf(stdout, "%s\n", first ? "[]" : "\n]");
+	return (0);
+}
@@ -21,8 +21,19 @@
  *
  * Simple RPC ping test.
  *
+ * By default closed-loop:  each thread fires --count calls and the
+ * aggregate throughput is reported.  With --rate, open-loop:  calls are
+ * issued at the target rate (constant or Poisson arrivals) for
+ * --duration seconds, and latency percentiles are reported.  Latency is
+ * measured from the scheduled send time, not the actual one, so a
+ * stalled sender does not hide the delay of the calls it should have
+ * sent (coordinated omission).
+ *
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <unistd.h>
 #include <sys/times.h>
 #include <sys/types.h>
@@ -39,6 +50,96 @@ static uint32_t rpcping_threads;
 
 static struct timespec to = {30, 0};
 
+/* HDR histogram of nanoseconds, about 2 significant digits:  values
+ * below HIST_SUB are exact, above each power of 2 is divided in
+ * HIST_SUB/2 linear steps (1.6% resolution), up to 2^HIST_TOP ns.
+ */
+#define HIST_SUB_BITS 7
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_HALF (HIST_SUB / 2)
+#define HIST_TOP 44
+#define HIST_BUCKETS (HIST_SUB + (HIST_TOP - HIST_SUB_BITS) * HIST_HALF)
+
+struct hist {
+	uint64_t count[HIST_BUCKETS];
+	uint64_t total;
+	uint64_t sum;
+	uint64_t max;
+};
+
+static u_int
+hist_index(uint64_t v)
+{
+	u_int e;
+
+	if (v < HIST_SUB)
+		return v;
+	e = 63 - __builtin_clzll(v);
+	if (e >= HIST_TOP)
+		return HIST_BUCKETS - 1;
+	return HIST_SUB + (e - HIST_SUB_BITS) * HIST_HALF
+		+ (v >> (e - HIST_SUB_BITS + 1)) - HIST_HALF;
+}
+
+/* highest value in the bucket */
+static uint64_t
+hist_value(u_int ix)
+{
+	u_int e;
+
+	if (ix < HIST_SUB)
+		return ix;
+	ix -= HIST_SUB;
+	e = ix / HIST_HALF + HIST_SUB_BITS;
+	return ((uint64_t)(ix % HIST_HALF + HIST_HALF + 1)
+		<< (e - HIST_SUB_BITS + 1)) - 1;
+}
+
+/* called from concurrent callbacks */
+static void
+hist_record(struct hist *h, uint64_t v)
+{
+	uint64_t max = atomic_fetch_uint64_t(&h->max);
+
+	(void)atomic_inc_uint64_t(&h->count[hist_index(v)]);
+	(void)atomic_inc_uint64_t(&h->total);
+	(void)atomic_add_uint64_t(&h->sum, v);
+	while (v > max) {
+		if (__atomic_compare_exchange_n(&h->max, &max, v, false,
+						__ATOMIC_RELAXED,
+						__ATOMIC_RELAXED))
+			break;
+	}
+}
+
+static void
+hist_merge(struct hist *to, const struct hist *from)
+{
+	u_int ix;
+
+	for (ix = 0; ix < HIST_BUCKETS; ix++)
+		to->count[ix] += from->count[ix];
+	to->total += from->total;
+	to->sum += from->sum;
+	if (from->max > to->max)
+		to->max = from->max;
+}
+
+static uint64_t
+hist_quantile(const struct hist *h, double q)
+{
+	uint64_t want = (uint64_t)ceil(q * h->total);
+	uint64_t sum = 0;
+	u_int ix;
+
+	for (ix = 0; ix < HIST_BUCKETS; ix++) {
+		sum += h->count[ix];
+		if (sum >= want && sum)
+			return MIN(hist_value(ix), h->max);
+	}
+	return h->max;
+}
+
 struct state {
 	CLIENT *handle;
 	pthread_cond_t s_cond;
@@ -49,6 +150,21 @@ struct state {
 	int proc;
 	int id;
 	uint32_t responses;
+
+	/* open-loop */
+	struct hist *hist;
+	double rate;			/* calls per second */
+	uint64_t duration;		/* nanoseconds */
+	uint64_t lag_max;		/* sends behind schedule */
+	unsigned short seed[3];
+	bool poisson;
+	uint32_t errors;
+};
+
+/* open-loop call, freed by clnt_req_release() */
+struct open_call {
+	struct clnt_req cc;		/*** 1st ***/
+	struct timespec intended;
 };
 
 static uint64_t timespec_elapsed(const struct timespec *starting,
@@ -129,7 +245,120 @@ worker_cb(struct clnt_req *cc)
 		return;
 	}
 
+	pthread_mutex_lock(&s->s_mutex);
+	pthread_cond_broadcast(&s->s_cond);
+	pthread_mutex_unlock(&s->s_mutex);
+}
+
+static void
+timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += ns / 1000000000L;
+	ts->tv_nsec = ns % 1000000000L;
+}
+
+static int
+timespec_cmp(const struct timespec *a, const struct timespec *b)
+{
+	if (a->tv_sec != b->tv_sec)
+		return (a->tv_sec < b->tv_sec) ? -1 : 1;
+	if (a->tv_nsec != b->tv_nsec)
+		return (a->tv_nsec < b->tv_nsec) ? -1 : 1;
+	return 0;
+}
+
+static void
+open_cb(struct clnt_req *cc)
+{
+	struct open_call *call = (struct open_call *)cc;
+	struct state *s = cc->cc_clnt->cl_u1;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (cc->cc_error.re_status != RPC_SUCCESS)
+		(void)atomic_inc_uint32_t(&s->errors);
+	else
+		hist_record(s->hist, timespec_elapsed(&call->intended, &now));
+	clnt_req_release(cc);
+
+	if (atomic_inc_uint32_t(&s->responses)
+	    < atomic_fetch_int32_t(&s->count))
+		return;
+
+	pthread_mutex_lock(&s->s_mutex);
 	pthread_cond_broadcast(&s->s_cond);
+	pthread_mutex_unlock(&s->s_mutex);
+}
+
+/* next interarrival (nanoseconds) */
+static uint64_t
+open_interval(struct state *s)
+{
+	double mean = 1000000000.0 / s->rate;
+
+	if (!s->poisson)
+		return mean;
+	return -log(1.0 - erand48(s->seed)) * mean;
+}
+
+static void
+open_loop(struct state *s)
+{
+	struct open_call *call;
+	struct clnt_req *cc;
+	struct timespec next, now, end;
+	int sent = 0;
+
+	/* not complete until all are sent */
+	s->count = INT32_MAX;
+
+	clock_gettime(CLOCK_MONOTONIC, &s->starting);
+	end = next = s->starting;
+	timespec_add_ns(&end, s->duration);
+
+	while (timespec_cmp(&next, &end) < 0) {
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (timespec_elapsed(&next, &now) > s->lag_max)
+			s->lag_max = timespec_elapsed(&next, &now);
+
+		call = calloc(1, sizeof(*call));
+		call->intended = next;
+		cc = &call->cc;
+		clnt_req_fill(cc, s->handle, authnone_ncreate(), s->proc,
+			      (xdrproc_t) xdr_void, NULL,
+			      (xdrproc_t) xdr_void, NULL);
+		cc->cc_size = sizeof(*call);
+
+		if (clnt_req_setup(cc, to) != RPC_SUCCESS) {
+			rpc_perror(&cc->cc_error, "clnt_req_setup failed");
+			clnt_req_release(cc);
+			break;
+		}
+		cc->cc_refreshes = 1;
+		cc->cc_process_cb = open_cb;
+
+		cc->cc_error.re_status = CLNT_CALL_BACK(cc);
+		if (cc->cc_error.re_status != RPC_SUCCESS) {
+			rpc_perror(&cc->cc_error, "CLNT_CALL_BACK failed");
+			clnt_req_release(cc);
+			break;
+		}
+		sent++;
+		timespec_add_ns(&next, open_interval(s));
+	}
+
+	/* wait for the stragglers, up to the call timeout */
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += to.tv_sec;
+	pthread_mutex_lock(&s->s_mutex);
+	atomic_store_int32_t(&s->count, sent);
+	while (atomic_fetch_uint32_t(&s->responses) < sent) {
+		if (pthread_cond_timedwait(&s->s_cond, &s->s_mutex, &end))
+			break;
+	}
+	pthread_mutex_unlock(&s->s_mutex);
 }
 
 static void *
@@ -137,11 +366,20 @@ worker(void *arg)
 {
 	struct state *s = arg;
 	struct clnt_req *cc;
+	pthread_condattr_t attr;
 	int i;
 
-	pthread_cond_init(&s->s_cond, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&s->s_cond, &attr);
+	pthread_condattr_destroy(&attr);
 	pthread_mutex_init(&s->s_mutex, NULL);
 
+	if (s->rate > 0) {
+		open_loop(s);
+		goto done;
+	}
+
 	clock_gettime(CLOCK_MONOTONIC, &s->starting);
 	for (i = 0; i < s->count; i++) {
 		cc = calloc(1, sizeof(*cc));
@@ -167,9 +405,12 @@ worker(void *arg)
 		}
 	}
 
+	/* the last response may have arrived already */
 	pthread_mutex_lock(&s->s_mutex);
-	pthread_cond_wait(&s->s_cond, &s->s_mutex);
+	while (atomic_fetch_uint32_t(&s->responses) < s->count)
+		pthread_cond_wait(&s->s_cond, &s->s_mutex);
 	pthread_mutex_unlock(&s->s_mutex);
+ done:
 	clock_gettime(CLOCK_MONOTONIC, &s->stopping);
 
 	if (atomic_dec_uint32_t(&rpcping_threads) > 0) {
@@ -204,7 +445,7 @@ decode_request(SVCXPRT *xprt, XDR *xdrs)
 
 static void usage()
 {
-	printf("Usage: rpcping <raw|rdma|tcp|udp> <host> [--rpcbind] [--count=<n>] [--threads=<n>] [--workers=<n>] [--port=<n>] [--program=<n>] [--version=<n>] [--procedure=<n>]\n");
+	printf("Usage: rpcping <raw|rdma|tcp|udp> <host> [--rpcbind] [--count=<n>] [--threads=<n>] [--workers=<n>] [--port=<n>] [--program=<n>] [--version=<n>] [--procedure=<n>] [--rate=<calls/s> [--duration=<s>] [--poisson]]\n");
 }
 
 static struct option long_options[] =
@@ -217,6 +458,9 @@ static struct option long_options[] =
 	{"version", required_argument, NULL, 'v'},
 	{"procedure", required_argument, NULL, 'x'},
 	{"rpcbind", no_argument, NULL, 'b'},
+	{"rate", required_argument, NULL, 'r'},
+	{"duration", required_argument, NULL, 'd'},
+	{"poisson", no_argument, NULL, 'P'},
 	{NULL, 0, NULL, 0}
 };
 
@@ -242,6 +486,10 @@ int main(int argc, char *argv[])
 	int send_sz = 8192;
 	int recv_sz = 8192;
 	bool rpcbind = false;
+	double rate = 0.0; /* closed-loop */
+	double duration = 10.0;
+	bool poisson = false;
+	struct hist *hist = NULL;
 
 	/* protocol and host/dest positional */
 	if (argc < 3) {
@@ -253,7 +501,7 @@ int main(int argc, char *argv[])
 	host = argv[2];
 
 	optind = 3;
-	while ((opt = getopt_long(argc, argv, "bc:m:p:t:v:w:x:",
+	while ((opt = getopt_long(argc, argv, "bc:d:m:p:r:t:v:w:x:P",
 				  long_options, NULL)) != -1) {
 		switch (opt)
 		{
@@ -281,6 +529,15 @@ int main(int argc, char *argv[])
 		case 'b':
 			rpcbind = true;
 			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 'd':
+			duration = atof(optarg);
+			break;
+		case 'P':
+			poisson = true;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -289,7 +546,9 @@ int main(int argc, char *argv[])
 	}
 
 	states = calloc(nthreads, sizeof(struct state));
-	if (!states) {
+	if (rate > 0)
+		hist = calloc(nthreads + 1, sizeof(struct hist));
+	if (!states || (rate > 0 && !hist)) {
 		perror("calloc failed");
 		exit(1);
 	}
@@ -346,6 +605,16 @@ int main(int argc, char *argv[])
 		s->id = i;
 		s->count = count;
 		s->proc = proc;
+		if (rate > 0) {
+			/* threads share the rate */
+			s->hist = &hist[i + 1];
+			s->rate = rate / nthreads;
+			s->duration = duration * 1000000000.0;
+			s->poisson = poisson;
+			s->seed[0] = i;
+			s->seed[1] = getpid();
+			s->seed[2] = time(NULL);
+		}
 		pthread_create(&t, NULL, worker, s);
 	}
 
@@ -353,6 +622,39 @@ int main(int argc, char *argv[])
 	pthread_cond_wait(&rpcping_cond, &rpcping_mutex);
 	pthread_mutex_unlock(&rpcping_mutex);
 
+	if (rate > 0) {
+		uint64_t lag_max = 0;
+		uint32_t errors = 0;
+
+		/* hist[0] sums the threads */
+		elapsed_ns = 0.0;
+		for (i = 0; i < nthreads; i++) {
+			s = &states[i];
+			hist_merge(&hist[0], s->hist);
+			errors += s->errors;
+			if (s->lag_max > lag_max)
+				lag_max = s->lag_max;
+			if (timespec_elapsed(&s->starting, &s->stopping)
+			    > elapsed_ns)
+				elapsed_ns = timespec_elapsed(&s->starting,
+							      &s->stopping);
+			CLNT_DESTROY(s->handle);
+		}
+		fprintf(stdout, "rpcping %s %s rate=%.0lf %s duration=%.1lf threads=%d workers=%d (port=%d program=%d version=%d procedure=%d): throughput %2.4lf, errors %u, latency (us) mean %.1lf p50 %.1lf p90 %.1lf p99 %.1lf p99.9 %.1lf max %.1lf, send lag max %.1lf\n",
+			proto, host, rate, poisson ? "poisson" : "constant",
+			duration, nthreads, nworkers, port, prog, vers, proc,
+			hist[0].total * 1000000000.0 / elapsed_ns, errors,
+			hist[0].total ? hist[0].sum / 1000.0 / hist[0].total
+				      : 0.0,
+			hist_quantile(&hist[0], 0.50) / 1000.0,
+			hist_quantile(&hist[0], 0.90) / 1000.0,
+			hist_quantile(&hist[0], 0.99) / 1000.0,
+			hist_quantile(&hist[0], 0.999) / 1000.0,
+			hist[0].max / 1000.0, lag_max / 1000.0);
+		fflush(stdout);
+		return (0);
+	}
+
 	total = 0.0;
 	elapsed_ns = 0.0;
 	for (i = 0; i < nthreads; i++) {
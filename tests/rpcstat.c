@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file rpcstat.c
+ * @brief RPC statistics poller
+ *
+ * @section DESCRIPTION
+ *
+ * Polls the library statistics program (see <rpc/svc_stats.h>) of a
+ * server, printing the difference since the previous poll.  The first
+ * poll shows the totals since the server started.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <getopt.h>
+#include <rpc/rpc.h>
+#include <rpc/svc_auth.h>
+#include <rpc/svc_stats.h>
+
+#define RPCSTAT_LATENCY	0x01
+#define RPCSTAT_XPRTS	0x02
+#define RPCSTAT_POOL	0x04
+#define RPCSTAT_GSS	0x08
+#define RPCSTAT_BUFFERS	0x10
+#define RPCSTAT_ALL	0x1f
+
+static struct timespec to = {30, 0};
+
+static const char * const stage_names[SVC_LATENCY_STAGES] = {
+	"queue", "service", "output"
+};
+
+struct rpcstat {
+	struct svc_latency_snapshot latency;
+	struct svc_xprt_stats_snapshot xprts;
+	struct work_pool_stats pool;
+	struct svc_stats_gss_res gss;
+	struct svc_buffer_stats buffers;
+};
+
+static int
+get_conn_fd(const char *host, int port)
+{
+	struct addrinfo hints, *res, *fr;
+	int fd = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, NULL, &hints, &res))
+		return -1;
+
+	for (fr = res; res; res = res->ai_next) {
+		if (res->ai_family == AF_INET)
+			((struct sockaddr_in *)res->ai_addr)->sin_port =
+				htons(port);
+		else if (res->ai_family == AF_INET6)
+			((struct sockaddr_in6 *)res->ai_addr)->sin6_port =
+				htons(port);
+		else
+			continue;
+
+		fd = socket(res->ai_family, res->ai_socktype,
+			    res->ai_protocol);
+		if (fd < 0)
+			continue;
+		if (!connect(fd, res->ai_addr, res->ai_addrlen))
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(fr);
+	return fd;
+}
+
+static enum xprt_stat
+decode_request(SVCXPRT *xprt, XDR *xdrs)
+{
+	struct svc_req *req = calloc(1, sizeof(*req));
+	enum xprt_stat stat;
+
+	SVC_REF(xprt, SVC_REF_FLAG_NONE);
+	req->rq_xprt = xprt;
+	req->rq_xdrs = xdrs;
+	req->rq_refs = 1;
+
+	/* replies are matched to their calls */
+	stat = SVC_DECODE(req);
+
+	if (req->rq_auth)
+		SVCAUTH_RELEASE(req);
+
+	XDR_DESTROY(req->rq_xdrs);
+	SVC_RELEASE(xprt, SVC_RELEASE_FLAG_NONE);
+	free(req);
+	return stat;
+}
+
+static bool
+rpcstat_call(CLIENT *clnt, rpcproc_t proc, xdrproc_t xargs, void *args,
+	     xdrproc_t xres, void *res)
+{
+	struct clnt_req *cc = calloc(1, sizeof(*cc));
+	enum clnt_stat stat;
+
+	clnt_req_fill(cc, clnt, authnone_ncreate(), proc,
+		      xargs, args, xres, res);
+	stat = clnt_req_setup(cc, to);
+	if (stat == RPC_SUCCESS)
+		stat = CLNT_CALL_WAIT(cc);
+	if (stat != RPC_SUCCESS)
+		rpc_perror(&cc->cc_error, "rpcstat");
+	clnt_req_release(cc);
+	return (stat == RPC_SUCCESS);
+}
+
+/* lower bound of the bucket holding quantile q */
+static uint64_t
+latency_quantile(const uint64_t *count, uint64_t total, double q)
+{
+	uint64_t want = (uint64_t)(q * total);
+	uint64_t sum = 0;
+	u_int b;
+
+	for (b = 0; b < SVC_LATENCY_BUCKETS; b++) {
+		sum += count[b];
+		if (sum > want)
+			return svc_latency_bucket_ns(b);
+	}
+	return svc_latency_bucket_ns(SVC_LATENCY_BUCKETS - 1);
+}
+
+static const struct svc_latency_hist *
+latency_find(const struct svc_latency_snapshot *snap,
+	     const struct svc_latency_hist *hist)
+{
+	u_int ix;
+
+	for (ix = 0; ix < snap->count; ix++) {
+		const struct svc_latency_hist *h = &snap->hist[ix];
+
+		if (h->prog == hist->prog && h->vers == hist->vers
+		    && h->proc == hist->proc)
+			return h;
+	}
+	return NULL;
+}
+
+static void
+show_latency(const struct rpcstat *cur, const struct rpcstat *prev)
+{
+	uint64_t count[SVC_LATENCY_BUCKETS];
+	u_int ix, stage, b;
+
+	printf("latency: %u procedures, %" PRIu64 " dropped\n",
+	       cur->latency.count,
+	       cur->latency.dropped - prev->latency.dropped);
+
+	for (ix = 0; ix < cur->latency.count; ix++) {
+		const struct svc_latency_hist *h = &cur->latency.hist[ix];
+		const struct svc_latency_hist *p = latency_find(&prev->latency,
+								h);
+		uint64_t calls = 0;
+
+		for (b = 0; b < SVC_LATENCY_BUCKETS; b++)
+			calls += h->count[SVC_LATENCY_SERVICE][b]
+				- (p ? p->count[SVC_LATENCY_SERVICE][b] : 0);
+		if (!calls)
+			continue;
+
+		printf("  %u/%u/%u calls %" PRIu64 "\n",
+		       h->prog, h->vers, h->proc, calls);
+		for (stage = 0; stage < SVC_LATENCY_STAGES; stage++) {
+			uint64_t total = 0;
+
+			for (b = 0; b < SVC_LATENCY_BUCKETS; b++) {
+				count[b] = h->count[stage][b]
+					 - (p ? p->count[stage][b] : 0);
+				total += count[b];
+			}
+			if (!total)
+				continue;
+			printf("    %-8s p50 >= %" PRIu64 "ns"
+			       " p90 >= %" PRIu64 "ns p99 >= %" PRIu64 "ns\n",
+			       stage_names[stage],
+			       latency_quantile(count, total, 0.50),
+			       latency_quantile(count, total, 0.90),
+			       latency_quantile(count, total, 0.99));
+		}
+	}
+}
+
+static const struct svc_xprt_stats_entry *
+xprt_find(const struct svc_xprt_stats_snapshot *snap,
+	  const struct svc_xprt_stats_entry *xe)
+{
+	u_int ix;
+
+	for (ix = 0; ix < snap->count; ix++) {
+		const struct svc_xprt_stats_entry *x = &snap->xprts[ix];
+
+		if (x->fd == xe->fd
+		    && !memcmp(&x->remote, &xe->remote, sizeof(x->remote)))
+			return x;
+	}
+	return NULL;
+}
+
+static void
+show_xprts(const struct rpcstat *cur, const struct rpcstat *prev)
+{
+	static const struct svc_xprt_stats zero;
+	char host[NI_MAXHOST], serv[NI_MAXSERV];
+	u_int ix;
+
+	printf("xprts: %u of %u\n", cur->xprts.count, cur->xprts.total);
+
+	for (ix = 0; ix < cur->xprts.count; ix++) {
+		const struct svc_xprt_stats_entry *xe = &cur->xprts.xprts[ix];
+		const struct svc_xprt_stats_entry *xp = xprt_find(&prev->xprts,
+								  xe);
+		const struct svc_xprt_stats *c = &xe->stats;
+		const struct svc_xprt_stats *p = xp ? &xp->stats : &zero;
+
+		if (xe->remote.ss_family == AF_UNSPEC
+		    || getnameinfo((struct sockaddr *)&xe->remote,
+				   sizeof(xe->remote), host, sizeof(host),
+				   serv, sizeof(serv),
+				   NI_NUMERICHOST | NI_NUMERICSERV)) {
+			strcpy(host, "-");
+			strcpy(serv, "-");
+		}
+		printf("  fd %d type %d %s:%s"
+		       " in %" PRIu64 "B/%" PRIu64 " out %" PRIu64 "B/%"
+		       PRIu64 " partial %" PRIu64 " eagain %" PRIu64
+		       " queued %u/%u\n",
+		       xe->fd, xe->type, host, serv,
+		       c->bytes_in - p->bytes_in,
+		       c->records_in - p->records_in,
+		       c->bytes_out - p->bytes_out,
+		       c->records_out - p->records_out,
+		       c->partial_writes - p->partial_writes,
+		       c->eagain - p->eagain,
+		       c->queued, c->queued_max);
+	}
+}
+
+static void
+show_pool(const struct rpcstat *cur, const struct rpcstat *prev,
+	  double elapsed)
+{
+	const struct work_pool_stats *c = &cur->pool;
+	const struct work_pool_stats *p = &prev->pool;
+	uint64_t started = c->started - p->started;
+	uint64_t want = started / 2;
+	uint64_t sum = 0;
+	u_int ix, jx;
+
+	for (ix = 0; started && ix < WORK_POOL_WAIT_BUCKETS - 1; ix++) {
+		sum += c->wait[ix] - p->wait[ix];
+		if (sum > want)
+			break;
+	}
+	printf("pool: submitted %" PRIu64 " started %" PRIu64
+	       " wait p50 < %" PRIu64 "ns mean depth %.2f"
+	       " (max %u) busy %u idle %u threads %u"
+	       " spawned %" PRIu64 " retired %" PRIu64 " failed %" PRIu64 "\n",
+	       c->submitted - p->submitted, started, UINT64_C(2) << ix,
+	       elapsed > 0 ? (c->depth_ns - p->depth_ns) / elapsed : 0.0,
+	       c->queued_max, c->busy, c->idle, c->threads,
+	       c->spawned - p->spawned, c->retired - p->retired,
+	       c->spawn_failed - p->spawn_failed);
+
+	for (ix = 0; ix <= WORK_POOL_FUNS; ix++) {
+		const struct work_pool_fun_stats *f = &c->fun[ix];
+		const struct work_pool_fun_stats *pf = NULL;
+		uint64_t runs;
+
+		if (!f->runs)
+			continue;
+		for (jx = 0; jx <= WORK_POOL_FUNS; jx++)
+			if (p->fun[jx].fun == f->fun && p->fun[jx].runs)
+				pf = &p->fun[jx];
+		runs = f->runs - (pf ? pf->runs : 0);
+		if (!runs)
+			continue;
+		printf("  fun %p runs %" PRIu64 " mean %" PRIu64
+		       "ns max %" PRIu64 "ns\n",
+		       (void *)f->fun, runs,
+		       (f->run_ns - (pf ? pf->run_ns : 0)) / runs,
+		       f->run_max_ns);
+	}
+}
+
+static void
+show_gss(const struct rpcstat *cur, const struct rpcstat *prev)
+{
+	const struct svc_gss_cache_stats *c = &cur->gss.gss;
+	const struct svc_gss_cache_stats *p = &prev->gss.gss;
+
+	if (!cur->gss.stats) {
+		printf("gss: not supported\n");
+		return;
+	}
+	printf("gss: hits %" PRIu64 " tree %" PRIu64 " misses %" PRIu64
+	       " inserts %" PRIu64 " deletes %" PRIu64 " expired %" PRIu64
+	       " evicted %" PRIu64 " size %u/%u partitions %u\n",
+	       c->hits - p->hits, c->tree_hits - p->tree_hits,
+	       c->misses - p->misses, c->inserts - p->inserts,
+	       c->deletes - p->deletes, c->expired - p->expired,
+	       c->evicted - p->evicted, c->size, c->max, c->partitions);
+}
+
+static void
+show_buffers(const struct rpcstat *cur, const struct rpcstat *prev)
+{
+	const struct svc_buffer_stats *c = &cur->buffers;
+	const struct svc_buffer_stats *p = &prev->buffers;
+
+	printf("buffers: created %" PRIu64 " (%" PRIu64 "B) freed %" PRIu64
+	       " (%" PRIu64 "B) grown %" PRIu64 " outstanding %" PRIu64
+	       " (%" PRIu64 "B) pool fetches %" PRIu64 " waits %" PRIu64
+	       " recycles %" PRIu64 "\n",
+	       c->created - p->created, c->bytes_created - p->bytes_created,
+	       c->freed - p->freed, c->bytes_freed - p->bytes_freed,
+	       c->grown - p->grown, c->created - c->freed,
+	       c->bytes_created - c->bytes_freed,
+	       c->pool_fetches - p->pool_fetches,
+	       c->pool_waits - p->pool_waits,
+	       c->pool_recycles - p->pool_recycles);
+}
+
+static bool
+rpcstat_poll(CLIENT *clnt, int which, u_int max_xprts, struct rpcstat *cur)
+{
+	memset(cur, 0, sizeof(*cur));
+
+	if ((which & RPCSTAT_LATENCY)
+	    && !rpcstat_call(clnt, TIRPC_STATSPROC_LATENCY,
+			     (xdrproc_t) xdr_void, NULL,
+			     (xdrproc_t) xdr_svc_latency_snapshot,
+			     &cur->latency))
+		return false;
+	if ((which & RPCSTAT_XPRTS)
+	    && !rpcstat_call(clnt, TIRPC_STATSPROC_XPRTS,
+			     (xdrproc_t) xdr_u_int, &max_xprts,
+			     (xdrproc_t) xdr_svc_xprt_stats_snapshot,
+			     &cur->xprts))
+		return false;
+	if ((which & RPCSTAT_POOL)
+	    && !rpcstat_call(clnt, TIRPC_STATSPROC_POOL,
+			     (xdrproc_t) xdr_void, NULL,
+			     (xdrproc_t) xdr_work_pool_stats, &cur->pool))
+		return false;
+	if ((which & RPCSTAT_GSS)
+	    && !rpcstat_call(clnt, TIRPC_STATSPROC_GSS,
+			     (xdrproc_t) xdr_void, NULL,
+			     (xdrproc_t) xdr_svc_stats_gss_res, &cur->gss))
+		return false;
+	if ((which & RPCSTAT_BUFFERS)
+	    && !rpcstat_call(clnt, TIRPC_STATSPROC_BUFFERS,
+			     (xdrproc_t) xdr_void, NULL,
+			     (xdrproc_t) xdr_svc_buffer_stats, &cur->buffers))
+		return false;
+	return true;
+}
+
+static void
+rpcstat_free(struct rpcstat *st)
+{
+	xdr_free((xdrproc_t) xdr_svc_latency_snapshot, &st->latency);
+	xdr_free((xdrproc_t) xdr_svc_xprt_stats_snapshot, &st->xprts);
+}
+
+static void usage()
+{
+	printf("Usage: rpcstat <tcp|udp> <host> [--rpcbind] [--port=<n>] [--program=<n>] [--interval=<s>] [--count=<n>] [--xprts=<n>] [latency|xprts|pool|gss|buffers|all]...\n");
+}
+
+static struct option long_options[] =
+{
+	{"count", required_argument, NULL, 'c'},
+	{"interval", required_argument, NULL, 'i'},
+	{"port", required_argument, NULL, 'p'},
+	{"program", required_argument, NULL, 'm'},
+	{"xprts", required_argument, NULL, 'x'},
+	{"rpcbind", no_argument, NULL, 'b'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	static const char * const names[] = {
+		"latency", "xprts", "pool", "gss", "buffers", NULL
+	};
+	svc_init_params svc_params;
+	struct rpcstat stats[2];
+	struct timespec then, now;
+	CLIENT *clnt;
+	char *proto;
+	char *host;
+	int i, n;
+	int opt;
+	int count = 0;		/* forever */
+	int interval = 5;
+	int port = 2049;
+	int prog = TIRPC_STATS_PROG;
+	int which = 0;
+	u_int max_xprts = 64;
+	bool rpcbind = false;
+
+	/* protocol and host/dest positional */
+	if (argc < 3) {
+		usage();
+		exit(1);
+	}
+
+	proto = argv[1];
+	host = argv[2];
+
+	optind = 3;
+	while ((opt = getopt_long(argc, argv, "bc:i:m:p:x:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 'c':
+			count = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'm':
+			prog = strtol(optarg, NULL, 0);
+			break;
+		case 'x':
+			max_xprts = atoi(optarg);
+			break;
+		case 'b':
+			rpcbind = true;
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	for (; optind < argc; optind++) {
+		if (!strcmp(argv[optind], "all")) {
+			which |= RPCSTAT_ALL;
+			continue;
+		}
+		for (i = 0; names[i]; i++)
+			if (!strcmp(argv[optind], names[i]))
+				break;
+		if (!names[i]) {
+			usage();
+			exit(1);
+		}
+		which |= 1 << i;
+	}
+	if (!which)
+		which = RPCSTAT_ALL;
+
+	memset(&svc_params, 0, sizeof(svc_params));
+	svc_params.request_cb = decode_request;
+	svc_params.flags = SVC_INIT_EPOLL | SVC_INIT_NOREG_XPRTS;
+	svc_params.max_events = 16;
+	svc_params.ioq_thrd_max = 2;
+
+	if (!svc_init(&svc_params)) {
+		perror("svc_init failed");
+		exit(1);
+	}
+
+	if (rpcbind) {
+		clnt = clnt_ncreate(host, prog, TIRPC_STATS_VERS, proto);
+	} else if (!strcmp(proto, "tcp")) {
+		/* connect to host:port */
+		struct sockaddr_storage ss;
+		struct netbuf raddr = {
+			.buf = &ss,
+			.len = sizeof(ss)
+		};
+		int fd = get_conn_fd(host, port);
+
+		if (fd < 0) {
+			perror("get_conn_fd failed");
+			exit(3);
+		}
+		clnt = clnt_vc_ncreatef(fd, &raddr, prog, TIRPC_STATS_VERS,
+					0, 0, CLNT_CREATE_FLAG_CLOSE);
+	} else {
+		fprintf(stderr, "%s needs --rpcbind\n", proto);
+		exit(1);
+	}
+	if (CLNT_FAILURE(clnt)) {
+		rpc_perror(&clnt->cl_error, "clnt_ncreate failed");
+		exit(2);
+	}
+
+	memset(stats, 0, sizeof(stats));
+	clock_gettime(CLOCK_MONOTONIC, &then);
+	for (n = 0; !count || n < count; n++) {
+		struct rpcstat *cur = &stats[n & 1];
+		struct rpcstat *prev = &stats[!(n & 1)];
+		double elapsed;
+
+		if (n)
+			sleep(interval);
+		if (!rpcstat_poll(clnt, which, max_xprts, cur))
+			exit(4);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = (now.tv_sec - then.tv_sec) * 1000000000.0
+			+ (now.tv_nsec - then.tv_nsec);
+		then = now;
+
+		printf("--- %s %s %s\n", proto, host,
+		       n ? "since previous" : "since start");
+		if (which & RPCSTAT_LATENCY)
+			show_latency(cur, prev);
+		if (which & RPCSTAT_XPRTS)
+			show_xprts(cur, prev);
+		if (which & RPCSTAT_POOL)
+			show_pool(cur, prev, n ? elapsed : 0);
+		if (which & RPCSTAT_GSS)
+			show_gss(cur, prev);
+		if (which & RPCSTAT_BUFFERS)
+			show_buffers(cur, prev);
+		fflush(stdout);
+
+		rpcstat_free(prev);
+		memset(prev, 0, sizeof(*prev));
+	}
+
+	rpcstat_free(&stats[0]);
+	rpcstat_free(&stats[1]);
+	CLNT_DESTROY(clnt);
+	return (0);
+}
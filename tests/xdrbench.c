@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) 2026 The libntirpc contributors.
+ *
+ * This code is released into the "public domain" by its author(s).
+ * Anybody may use, alter, and distribute the code without restriction.
+ * The author(s) make no guarantees, and take no liability of any kind
+ * for use of this code.
+ */
+
+/**
+ * @file xdrbench.c
+ * @brief XDR micro-benchmarks
+ *
+ * @section DESCRIPTION
+ *
+ * Measures ns/op and MB/s of encoding and decoding the XDR primitives
+ * (integers, hypers, strings, opaques, arrays, unions) and the RPC call
+ * and reply headers, on each stream backend:
+ *
+ *	raw	hand-coded stores and loads without XDR, called the same
+ *		way:  the difference is the cost of the XDR routines and
+ *		stream (x_ops) indirection
+ *	mem	xdrmem_ncreate()
+ *	ioq	xdr_ioq_create(), one segment
+ *	ioqseg	xdr_ioq_create(), --segment sized segments, so that items
+ *		cross segment boundaries through the x_ops routines
+ *
+ * The splice case compares appending --splice bytes of data to a
+ * header by copying (xdr_opaque) and by reference (XDR_PUTBUFS), each
+ * including the stream setup and teardown.
+ *
+ * The alloc case decodes arguments that allocate (strings, bytes and an
+ * array of strings), each with malloc and xdr_free(), and with a decode
+ * arena (XDR_FLAG_ARENA) released as a whole, as for SVC_INIT_ARENA.
+ *
+ * Each op is repeated in batches over a rewound stream until --time
+ * milliseconds have passed.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <rpc/rpc.h>
+#include <rpc/xdr_inline.h>
+#include <rpc/xdr_ioq.h>
+
+#define XB_BUFSZ (1024 * 1024)
+#define XB_BATCH 256
+#define XB_STRING "benchmark-string-of-32-bytes-xx"
+#define XB_ARRAY 64
+#define XB_NAMES 8
+#define XB_DATA 256
+
+enum xb_backend {
+	XB_RAW,
+	XB_MEM,
+	XB_IOQ,
+	XB_IOQSEG,
+	XB_BACKENDS
+};
+
+static const char * const backend_names[XB_BACKENDS] = {
+	"raw", "mem", "ioq", "ioqseg"
+};
+
+struct xb_stream {
+	XDR mem;
+	XDR *xdrs;
+	char *buf;
+	uint8_t *raw;			/* XB_RAW position */
+};
+
+struct xb_union {
+	enum_t which;
+	union {
+		uint32_t u32;
+		uint64_t u64;
+	} u;
+};
+
+/* one encoded item per op */
+struct xb_case {
+	const char *name;
+	bool (*op)(XDR *xdrs);		/* XDR backends */
+	void (*raw)(struct xb_stream *xs, enum xdr_op x_op);
+	u_int bytes;			/* encoded size */
+};
+
+static u_int segment = 512;
+static u_int opaque_size = 4096;
+static u_int splice_size = 65536;
+static uint64_t duration_ns = 200000000;
+
+/* values encoded, and targets of decoding */
+static uint32_t xb_u32 = 0x12345678;
+static uint64_t xb_u64 = 0x123456789abcdef0ULL;
+static char *xb_opaque;
+static char *xb_opaque_out;
+static char xb_string[] = XB_STRING;
+static char xb_string_buf[sizeof(XB_STRING)];
+static char *xb_string_out = xb_string_buf;
+static uint32_t xb_array[XB_ARRAY];
+static uint32_t xb_array_buf[XB_ARRAY];
+static char *xb_array_out = (char *)xb_array_buf;
+static struct xb_union xb_union = { 2, { 0 } };
+static struct xb_union xb_union_out;
+static struct rpc_msg xb_call;
+static struct rpc_msg xb_reply;
+static struct rpc_msg xb_msg_out;
+static char xb_data[XB_DATA];
+static char *xb_buf;			/* alloc case, encoded */
+static u_int xb_buf_len;
+static volatile uint64_t xb_sink;
+
+static uint64_t timespec_elapsed(const struct timespec *starting,
+				 const struct timespec *stopping)
+{
+	time_t elapsed = stopping->tv_sec - starting->tv_sec;
+	long nsec = stopping->tv_nsec - starting->tv_nsec;
+
+	return (elapsed * 1000000000L) + nsec;
+}
+
+/*
+ * XDR ops
+ */
+
+static bool
+xb_uint32(XDR *xdrs)
+{
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_uint32_t(xdrs, &xb_u32);
+	return xdr_uint32_t(xdrs, (uint32_t *)&xb_sink);
+}
+
+static bool
+xb_uint64(XDR *xdrs)
+{
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_uint64_t(xdrs, &xb_u64);
+	return xdr_uint64_t(xdrs, (uint64_t *)&xb_sink);
+}
+
+static bool
+xb_string_op(XDR *xdrs)
+{
+	char *sp = xb_string;
+
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_string(xdrs, &sp, sizeof(xb_string));
+	return xdr_string(xdrs, &xb_string_out, sizeof(xb_string));
+}
+
+static bool
+xb_opaque_op(XDR *xdrs)
+{
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_opaque(xdrs, xb_opaque, opaque_size);
+	return xdr_opaque(xdrs, xb_opaque_out, opaque_size);
+}
+
+static bool
+xb_array_op(XDR *xdrs)
+{
+	char *ap = (char *)xb_array;
+	u_int size = XB_ARRAY;
+
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_array(xdrs, &ap, &size, XB_ARRAY,
+				 sizeof(uint32_t), (xdrproc_t) xdr_uint32_t);
+	return xdr_array(xdrs, &xb_array_out, &size, XB_ARRAY,
+			 sizeof(uint32_t), (xdrproc_t) xdr_uint32_t);
+}
+
+static const struct xdr_discrim xb_union_arms[] = {
+	{ 1, (xdrproc_t) xdr_uint32_t },
+	{ 2, (xdrproc_t) xdr_uint64_t },
+	{ __dontcare__, NULL_xdrproc_t }
+};
+
+static bool
+xb_union_op(XDR *xdrs)
+{
+	struct xb_union *up = (xdrs->x_op == XDR_ENCODE)
+			    ? &xb_union : &xb_union_out;
+
+	return xdr_union(xdrs, &up->which, &up->u, xb_union_arms,
+			 NULL_xdrproc_t);
+}
+
+static bool
+xb_call_op(XDR *xdrs)
+{
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_dplx_msg(xdrs, &xb_call);
+	rpc_msg_init(&xb_msg_out);
+	return xdr_dplx_decode(xdrs, &xb_msg_out);
+}
+
+static bool
+xb_reply_op(XDR *xdrs)
+{
+	if (xdrs->x_op == XDR_ENCODE)
+		return xdr_dplx_msg(xdrs, &xb_reply);
+	rpc_msg_init(&xb_msg_out);
+	return xdr_dplx_decode(xdrs, &xb_msg_out);
+}
+
+/*
+ * Raw baselines
+ */
+
+static void
+xb_raw_uint32(struct xb_stream *xs, enum xdr_op x_op)
+{
+	if (x_op == XDR_ENCODE)
+		*(uint32_t *)xs->raw = htonl(xb_u32);
+	else
+		xb_sink = ntohl(*(uint32_t *)xs->raw);
+	xs->raw += sizeof(uint32_t);
+}
+
+static void
+xb_raw_uint64(struct xb_stream *xs, enum xdr_op x_op)
+{
+	if (x_op == XDR_ENCODE) {
+		((uint32_t *)xs->raw)[0] = htonl(xb_u64 >> 32);
+		((uint32_t *)xs->raw)[1] = htonl(xb_u64);
+	} else
+		xb_sink = ((uint64_t)ntohl(((uint32_t *)xs->raw)[0]) << 32)
+			| ntohl(((uint32_t *)xs->raw)[1]);
+	xs->raw += sizeof(uint64_t);
+}
+
+static void
+xb_raw_opaque(struct xb_stream *xs, enum xdr_op x_op)
+{
+	if (x_op == XDR_ENCODE)
+		memcpy(xs->raw, xb_opaque, opaque_size);
+	else
+		memcpy(xb_opaque_out, xs->raw, opaque_size);
+	xs->raw += RNDUP(opaque_size);
+}
+
+static struct xb_case cases[] = {
+	{ "uint32", xb_uint32, xb_raw_uint32, 4 },
+	{ "uint64", xb_uint64, xb_raw_uint64, 8 },
+	{ "string", xb_string_op, NULL, 4 + RNDUP(sizeof(XB_STRING) - 1) },
+	{ "opaque", xb_opaque_op, xb_raw_opaque, 0 },
+	{ "array", xb_array_op, NULL, 4 + XB_ARRAY * 4 },
+	{ "union", xb_union_op, NULL, 4 + 8 },
+	{ "call", xb_call_op, NULL, 0 },
+	{ "reply", xb_reply_op, NULL, 0 },
+};
+
+/*
+ * Streams
+ */
+
+static void
+xb_stream_create(struct xb_stream *xs, enum xb_backend backend)
+{
+	struct xdr_ioq *xioq;
+
+	xs->xdrs = NULL;
+	xs->buf = NULL;
+	switch (backend) {
+	case XB_RAW:
+		xs->buf = mem_alloc(XB_BUFSZ);
+		xs->raw = (uint8_t *)xs->buf;
+		break;
+	case XB_MEM:
+		xs->buf = mem_alloc(XB_BUFSZ);
+		xdrmem_ncreate(&xs->mem, xs->buf, XB_BUFSZ, XDR_ENCODE);
+		xs->xdrs = &xs->mem;
+		break;
+	case XB_IOQ:
+		xioq = xdr_ioq_create(XB_BUFSZ, XB_BUFSZ, UIO_FLAG_FREE);
+		xs->xdrs = xioq->xdrs;
+		break;
+	case XB_IOQSEG:
+		xioq = xdr_ioq_create(segment, segment, UIO_FLAG_FREE);
+		xs->xdrs = xioq->xdrs;
+		break;
+	default:
+		abort();
+	};
+}
+
+static void
+xb_stream_destroy(struct xb_stream *xs)
+{
+	if (xs->xdrs)
+		XDR_DESTROY(xs->xdrs);
+	if (xs->buf)
+		mem_free(xs->buf, XB_BUFSZ);
+}
+
+static void
+xb_rewind(struct xb_stream *xs, enum xdr_op x_op)
+{
+	if (!xs->xdrs) {
+		xs->raw = (uint8_t *)xs->buf;
+		return;
+	}
+	xs->xdrs->x_op = x_op;
+	if (!XDR_SETPOS(xs->xdrs, 0)) {
+		fprintf(stderr, "XDR_SETPOS failed\n");
+		exit(1);
+	}
+}
+
+static bool
+xb_batch(struct xb_stream *xs, const struct xb_case *c, enum xdr_op x_op,
+	 u_int batch)
+{
+	u_int i;
+
+	xb_rewind(xs, x_op);
+	for (i = 0; i < batch; i++) {
+		if (!xs->xdrs)
+			c->raw(xs, x_op);
+		else if (!c->op(xs->xdrs))
+			return false;
+	}
+	return true;
+}
+
+static void
+xb_report(const char *backend, const char *name, const char *op,
+	  uint64_t ops, uint64_t ns, u_int bytes)
+{
+	fprintf(stdout, "%-7s %-7s %-7s %12.1f ns/op %10.1f MB/s\n",
+		backend, name, op, (double)ns / ops,
+		(double)bytes * ops * 1000.0 / ns);
+}
+
+static void
+xb_run(enum xb_backend backend, const struct xb_case *c)
+{
+	struct xb_stream xs;
+	struct timespec starting, now;
+	enum xdr_op x_op;
+	uint64_t ops;
+	uint64_t ns;
+	u_int batch = (XB_BUFSZ / 2) / c->bytes;
+
+	if (backend == XB_RAW && !c->raw)
+		return;
+	if (batch > XB_BATCH)
+		batch = XB_BATCH;
+	if (!batch)
+		batch = 1;
+
+	xb_stream_create(&xs, backend);
+	for (x_op = XDR_ENCODE; x_op <= XDR_DECODE; x_op++) {
+		/* decode the batch as encoded */
+		if (x_op == XDR_DECODE
+		 && !xb_batch(&xs, c, XDR_ENCODE, batch)) {
+			fprintf(stderr, "%s %s encode failed\n",
+				backend_names[backend], c->name);
+			break;
+		}
+		ops = 0;
+		clock_gettime(CLOCK_MONOTONIC, &starting);
+		do {
+			if (!xb_batch(&xs, c, x_op, batch)) {
+				fprintf(stderr, "%s %s %s failed\n",
+					backend_names[backend], c->name,
+					x_op == XDR_ENCODE ? "encode"
+							   : "decode");
+				goto out;
+			}
+			ops += batch;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ns = timespec_elapsed(&starting, &now);
+		} while (ns < duration_ns);
+		xb_report(backend_names[backend], c->name,
+			  x_op == XDR_ENCODE ? "encode" : "decode", ops, ns,
+			  c->bytes);
+	}
+ out:
+	xb_stream_destroy(&xs);
+}
+
+/*
+ * Splice:  a reply header, then the data copied or referenced
+ */
+
+static void
+xb_splice_release(struct xdr_uio *uio, u_int flags)
+{
+	uio->uio_references--;
+}
+
+static bool
+xb_splice_one(bool splice, struct xdr_uio *uio)
+{
+	struct xdr_ioq *xioq = xdr_ioq_create(segment, segment,
+					       UIO_FLAG_FREE);
+	XDR *xdrs = xioq->xdrs;
+	bool ok = xdr_dplx_msg(xdrs, &xb_reply)
+		&& inline_xdr_u_int(xdrs, &splice_size);
+
+	if (ok && splice)
+		ok = XDR_PUTBUFS(xdrs, uio, XDR_PUTBUFS_FLAG_NONE);
+	else if (ok)
+		ok = xdr_opaque(xdrs, xb_opaque, splice_size);
+	XDR_DESTROY(xdrs);
+	return ok;
+}
+
+static void
+xb_splice(void)
+{
+	struct {
+		struct xdr_uio uio;
+		struct xdr_vio vio[1];
+	} u;
+	struct timespec starting, now;
+	uint64_t ops;
+	uint64_t ns;
+	int splice;
+
+	memset(&u, 0, sizeof(u));
+	u.uio.uio_release = xb_splice_release;
+	u.uio.uio_count = 1;
+	u.uio.uio_vio[0].vio_base =
+	u.uio.uio_vio[0].vio_head = (uint8_t *)xb_opaque;
+	u.uio.uio_vio[0].vio_tail =
+	u.uio.uio_vio[0].vio_wrap = (uint8_t *)xb_opaque + splice_size;
+
+	for (splice = 0; splice < 2; splice++) {
+		ops = 0;
+		clock_gettime(CLOCK_MONOTONIC, &starting);
+		do {
+			if (!xb_splice_one(splice, &u.uio)) {
+				fprintf(stderr, "splice %s failed\n",
+					splice ? "putbufs" : "copy");
+				return;
+			}
+			ops++;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ns = timespec_elapsed(&starting, &now);
+		} while (ns < duration_ns);
+		xb_report("ioqseg", "splice", splice ? "putbufs" : "copy",
+			  ops, ns, splice_size);
+	}
+}
+
+/*
+ * Alloc:  decoded arguments allocated each, or from an arena
+ */
+
+struct xb_args {
+	char *name;
+	char *data;
+	u_int data_len;
+	char **names;
+	u_int names_len;
+};
+
+static bool
+xb_args(XDR *xdrs, struct xb_args *args)
+{
+	return xdr_string(xdrs, &args->name, sizeof(XB_STRING))
+		&& xdr_bytes(xdrs, &args->data, &args->data_len, XB_DATA)
+		&& xdr_array(xdrs, (char **)&args->names, &args->names_len,
+			     XB_NAMES, sizeof(char *),
+			     (xdrproc_t) xdr_wrapstring);
+}
+
+static bool
+xb_alloc_one(bool arena)
+{
+	struct xdr_arena xa;
+	struct xb_args args;
+	XDR xdrs;
+	bool ok;
+
+	memset(&args, 0, sizeof(args));
+	xdrmem_ncreate(&xdrs, xb_buf, xb_buf_len, XDR_DECODE);
+	if (arena) {
+		xdr_arena_init(&xa, XDR_ARENA_FLAG_ENABLED);
+		xdr_arena_attach(&xdrs, &xa);
+	}
+	ok = xb_args(&xdrs, &args);
+	XDR_DESTROY(&xdrs);
+	if (arena)
+		xdr_arena_release(&xa);
+	else
+		xdr_free((xdrproc_t) xb_args, &args);
+	return ok;
+}
+
+static void
+xb_alloc(void)
+{
+	char *names[XB_NAMES];
+	struct xb_args args = {
+		xb_string, xb_data, XB_DATA, names, XB_NAMES
+	};
+	struct timespec starting, now;
+	XDR xdrs;
+	uint64_t ops;
+	uint64_t ns;
+	int arena;
+	int i;
+
+	for (i = 0; i < XB_NAMES; i++)
+		names[i] = xb_string;
+	xb_buf = mem_alloc(XB_BUFSZ);
+	xdrmem_ncreate(&xdrs, xb_buf, XB_BUFSZ, XDR_ENCODE);
+	if (!xb_args(&xdrs, &args)) {
+		fprintf(stderr, "alloc encode failed\n");
+		exit(1);
+	}
+	xb_buf_len = XDR_GETPOS(&xdrs);
+
+	for (arena = 0; arena < 2; arena++) {
+		ops = 0;
+		clock_gettime(CLOCK_MONOTONIC, &starting);
+		do {
+			if (!xb_alloc_one(arena)) {
+				fprintf(stderr, "alloc %s failed\n",
+					arena ? "arena" : "malloc");
+				goto out;
+			}
+			ops++;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ns = timespec_elapsed(&starting, &now);
+		} while (ns < duration_ns);
+		xb_report("mem", "alloc", arena ? "arena" : "malloc",
+			  ops, ns, xb_buf_len);
+	}
+ out:
+	mem_free(xb_buf, XB_BUFSZ);
+}
+
+/*
+ * Setup
+ */
+
+static u_int
+xb_msg_size(struct rpc_msg *msg)
+{
+	XDR xdrs;
+	char buf[1024];
+
+	xdrmem_ncreate(&xdrs, buf, sizeof(buf), XDR_ENCODE);
+	if (!xdr_dplx_msg(&xdrs, msg)) {
+		fprintf(stderr, "rpc_msg encode failed\n");
+		exit(1);
+	}
+	return XDR_GETPOS(&xdrs);
+}
+
+static void
+xb_setup(void)
+{
+	u_int size = opaque_size > splice_size ? opaque_size : splice_size;
+	int i;
+
+	xb_opaque = mem_alloc(size);
+	xb_opaque_out = mem_alloc(size);
+	memset(xb_opaque, 0x5a, size);
+	for (i = 0; i < XB_ARRAY; i++)
+		xb_array[i] = i;
+	xb_union.u.u64 = xb_u64;
+
+	/* AUTH_SYS sized credential */
+	xb_call.rm_xid = 1;
+	xb_call.rm_direction = CALL;
+	xb_call.rm_call.cb_rpcvers = RPC_MSG_VERSION;
+	xb_call.cb_prog = 100003;
+	xb_call.cb_vers = 3;
+	xb_call.cb_proc = 6;
+	xb_call.cb_cred.oa_flavor = AUTH_SYS;
+	xb_call.cb_cred.oa_length = 40;
+	memset(xb_call.cb_cred.oa_body, 0x11, 40);
+	xb_call.cb_verf = _null_auth;
+
+	xb_reply.rm_xid = 1;
+	xb_reply.rm_direction = REPLY;
+	xb_reply.rm_reply.rp_stat = MSG_ACCEPTED;
+	rpc_msg_init(&xb_reply);
+	xb_reply.RPCM_ack.ar_stat = SUCCESS;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (cases[i].op == xb_opaque_op)
+			cases[i].bytes = RNDUP(opaque_size);
+		else if (cases[i].op == xb_call_op)
+			cases[i].bytes = xb_msg_size(&xb_call);
+		else if (cases[i].op == xb_reply_op)
+			cases[i].bytes = xb_msg_size(&xb_reply);
+	}
+}
+
+static void usage()
+{
+	printf("Usage: xdrbench [--time=<ms>] [--segment=<bytes>] [--opaque=<bytes>] [--splice=<bytes>]\n");
+}
+
+static struct option long_options[] =
+{
+	{"time", required_argument, NULL, 't'},
+	{"segment", required_argument, NULL, 's'},
+	{"opaque", required_argument, NULL, 'o'},
+	{"splice", required_argument, NULL, 'p'},
+	{NULL, 0, NULL, 0}
+};
+
+int main(int argc, char *argv[])
+{
+	enum xb_backend backend;
+	int opt;
+	int i;
+
+	while ((opt = getopt_long(argc, argv, "o:p:s:t:",
+				  long_options, NULL)) != -1) {
+		switch (opt)
+		{
+		case 't':
+			duration_ns = atol(optarg) * 1000000ULL;
+			break;
+		case 's':
+			segment = atoi(optarg);
+			break;
+		case 'o':
+			opaque_size = atoi(optarg);
+			break;
+		case 'p':
+			splice_size = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(1);
+			break;
+		};
+	}
+	if (!duration_ns || segment < 64 || segment % BYTES_PER_XDR_UNIT
+	 || !opaque_size || opaque_size > XB_BUFSZ / 2 || !splice_size) {
+		usage();
+		exit(1);
+	}
+
+	xb_setup();
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+		for (backend = XB_RAW; backend < XB_BACKENDS; backend++)
+			xb_run(backend, &cases[i]);
+	xb_splice();
+	xb_alloc();
+	return (0);
+}